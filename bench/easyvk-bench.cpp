@@ -0,0 +1,371 @@
+/*
+   Copyright 2025 doyaGu
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// easyvk microbenchmarks. Every result is written as one JSON document (stdout, or the
+// file given with --out) so runs can be compared across easyvk versions and drivers.
+//
+//   easyvk_bench [--device N] [--iterations N] [--max-size-mb N] [--out results.json]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <easyvk.h>
+
+#ifndef EASYVK_BENCH_VERSION
+#define EASYVK_BENCH_VERSION "unknown"
+#endif
+
+namespace {
+
+    // Empty GLSL-style compute shader, LocalSize 1 1 1:
+    //   OpCapability Shader
+    //   OpMemoryModel Logical GLSL450
+    //   OpEntryPoint GLCompute %1 "main"
+    //   OpExecutionMode %1 LocalSize 1 1 1
+    //   %2 = OpTypeVoid
+    //   %3 = OpTypeFunction %2
+    //   %1 = OpFunction %2 None %3
+    //   %4 = OpLabel
+    //        OpReturn
+    //        OpFunctionEnd
+    const uint32_t kEmptyKernel[] = {
+        0x07230203, 0x00010000, 0x00000000, 0x00000005, 0x00000000,
+        0x00020011, 0x00000001,
+        0x0003000E, 0x00000000, 0x00000001,
+        0x0005000F, 0x00000005, 0x00000001, 0x6E69616D, 0x00000000,
+        0x00060010, 0x00000001, 0x00000011, 0x00000001, 0x00000001, 0x00000001,
+        0x00020013, 0x00000002,
+        0x00030021, 0x00000003, 0x00000002,
+        0x00050036, 0x00000002, 0x00000001, 0x00000000, 0x00000003,
+        0x000200F8, 0x00000004,
+        0x000100FD,
+        0x00010038
+    };
+
+    struct Options {
+        int device;
+        uint32_t iterations;
+        uint32_t maxSizeMB;
+        std::string out;
+
+        Options() : device(-1), iterations(200), maxSizeMB(64) {}
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    double elapsedUs(Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // One named measurement: samples are per-iteration values in unit
+    struct Result {
+        std::string name;
+        std::string unit;
+        VkDeviceSize sizeBytes; // 0 when the benchmark has no size parameter
+        std::vector<double> samples;
+    };
+
+    double percentile(const std::vector<double> &sorted, double q) {
+        if (sorted.empty()) return 0.0;
+        size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    // JSON has no inf/nan: a rate over an elapsed time below the clock resolution is written
+    // as null rather than producing an unparseable document
+    std::string jsonNumber(double v) {
+        if (!std::isfinite(v)) return "null";
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.6g", v);
+        return buf;
+    }
+
+    std::string jsonString(const std::string &s) {
+        std::string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    void writeJson(std::ostream &os, const easyvk::Device &device, const Options &opts,
+                   const std::vector<Result> &results) {
+        const VkPhysicalDeviceProperties &props = device.properties();
+        os << "{\n";
+        os << "  \"easyvk_version\": " << jsonString(EASYVK_BENCH_VERSION) << ",\n";
+        os << "  \"device\": {\n";
+        os << "    \"name\": " << jsonString(props.deviceName) << ",\n";
+        os << "    \"vendor\": " << jsonString(device.vendorName()) << ",\n";
+        os << "    \"vendor_id\": " << props.vendorID << ",\n";
+        os << "    \"device_id\": " << props.deviceID << ",\n";
+        os << "    \"driver_version\": " << props.driverVersion << ",\n";
+        os << "    \"api_version\": " << jsonString(std::to_string(VK_API_VERSION_MAJOR(props.apiVersion)) + "." +
+                                                    std::to_string(VK_API_VERSION_MINOR(props.apiVersion)) + "." +
+                                                    std::to_string(VK_API_VERSION_PATCH(props.apiVersion))) << ",\n";
+        os << "    \"unified_memory\": " << (device.unifiedMemory() ? "true" : "false") << "\n";
+        os << "  },\n";
+        os << "  \"iterations\": " << opts.iterations << ",\n";
+        os << "  \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result &r = results[i];
+            // Samples timed at zero elapsed time (inf/nan rates) are left out of the statistics
+            std::vector<double> sorted;
+            sorted.reserve(r.samples.size());
+            for (double v : r.samples) {
+                if (std::isfinite(v)) sorted.push_back(v);
+            }
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0.0;
+            for (double v : sorted) sum += v;
+
+            os << (i ? ",\n" : "\n");
+            os << "    {\"name\": " << jsonString(r.name) << ", \"unit\": " << jsonString(r.unit);
+            if (r.sizeBytes) os << ", \"size_bytes\": " << r.sizeBytes;
+            os << ", \"samples\": " << sorted.size();
+            if (sorted.size() != r.samples.size()) os << ", \"invalid_samples\": " << r.samples.size() - sorted.size();
+            if (!sorted.empty()) {
+                os << ", \"min\": " << jsonNumber(sorted.front())
+                   << ", \"median\": " << jsonNumber(percentile(sorted, 0.5))
+                   << ", \"mean\": " << jsonNumber(sum / static_cast<double>(sorted.size()))
+                   << ", \"p99\": " << jsonNumber(percentile(sorted, 0.99))
+                   << ", \"max\": " << jsonNumber(sorted.back());
+            }
+            os << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    easyvk::ComputeProgramCreateInfo kernelInfo(const std::vector<uint32_t> &spirv, const easyvk::Buffer &buf) {
+        easyvk::ComputeProgramCreateInfo ci;
+        ci.spirv = &spirv;
+        ci.entryPointName = "main";
+        ci.label = "empty";
+        ci.bindings.addStorage(0, buf); // unused by the kernel; gives rebind something to update
+        return ci;
+    }
+
+    // Host-observed dispatch -> wait round trip of an empty kernel
+    Result emptyDispatchLatency(easyvk::ComputeProgram &program, const Options &opts) {
+        Result r{"empty_dispatch_latency", "us", 0, {}};
+        program.dispatch(); // warm-up
+        for (uint32_t i = 0; i < opts.iterations; ++i) {
+            Clock::time_point start = Clock::now();
+            program.dispatch();
+            r.samples.push_back(elapsedUs(start));
+        }
+        return r;
+    }
+
+    // Back-to-back asynchronous submissions of a replayed recording, waited in windows
+    Result submitThroughput(easyvk::Device &device, easyvk::ComputeProgram &program, const Options &opts) {
+        Result r{"submits_per_second", "submits/s", 0, {}};
+        const uint32_t window = 64;
+        program.setCommandReuse(true);
+        std::vector<easyvk::SubmitHandle> handles;
+        handles.reserve(window);
+        for (uint32_t round = 0; round < std::max<uint32_t>(opts.iterations / 10, 5); ++round) {
+            Clock::time_point start = Clock::now();
+            for (uint32_t i = 0; i < window; ++i) {
+                handles.push_back(program.dispatchAsync(easyvk::SubmitHandle(), false));
+            }
+            for (const easyvk::SubmitHandle &h : handles) {
+                device.wait(h);
+            }
+            handles.clear();
+            r.samples.push_back(window / (elapsedUs(start) * 1e-6));
+        }
+        program.setCommandReuse(false);
+        return r;
+    }
+
+    // rebind() + dispatch minus the plain dispatch cost is the descriptor update cost
+    Result descriptorUpdateCost(easyvk::ComputeProgram &program, easyvk::Buffer &a, easyvk::Buffer &b,
+                                const Options &opts) {
+        Result r{"rebind_dispatch_latency", "us", 0, {}};
+        for (uint32_t i = 0; i < opts.iterations; ++i) {
+            Clock::time_point start = Clock::now();
+            program.rebind(0, (i & 1) ? a : b);
+            program.dispatch();
+            r.samples.push_back(elapsedUs(start));
+        }
+        return r;
+    }
+
+    Result pipelineCreation(easyvk::Device &device, const std::vector<uint32_t> &spirv, const easyvk::Buffer &buf,
+                            easyvk::PipelineCache *cache, const Options &opts) {
+        Result r{cache ? "program_create_cached" : "program_create_cold", "us", 0, {}};
+        easyvk::ComputeProgramCreateInfo ci = kernelInfo(spirv, buf);
+        ci.pipelineCache = cache;
+        if (cache) {
+            easyvk::ComputeProgram warm(device, ci); // populate the cache
+        }
+        const uint32_t count = std::max<uint32_t>(opts.iterations / 10, 5);
+        for (uint32_t i = 0; i < count; ++i) {
+            Clock::time_point start = Clock::now();
+            easyvk::ComputeProgram program(device, ci);
+            r.samples.push_back(elapsedUs(start));
+        }
+        return r;
+    }
+
+    uint32_t sizeIterations(const Options &opts, VkDeviceSize bytes) {
+        // Fewer repetitions for large transfers; at least a handful each
+        const VkDeviceSize budget = static_cast<VkDeviceSize>(opts.iterations) * 1024 * 1024;
+        return static_cast<uint32_t>(std::max<VkDeviceSize>(5, std::min<VkDeviceSize>(opts.iterations, budget / bytes)));
+    }
+
+    double gbPerSecond(VkDeviceSize bytes, double us) {
+        return static_cast<double>(bytes) / (us * 1e3);
+    }
+
+    void bandwidth(easyvk::Device &device, VkDeviceSize bytes, const Options &opts, std::vector<Result> &results) {
+        easyvk::Buffer deviceA(device, bytes, easyvk::BufferUsage::Storage, easyvk::HostAccess::None);
+        easyvk::Buffer deviceB(device, bytes, easyvk::BufferUsage::Storage, easyvk::HostAccess::None);
+        easyvk::Buffer hostWrite(device, bytes, easyvk::BufferUsage::Staging, easyvk::HostAccess::Write);
+        easyvk::Buffer hostRead(device, bytes, easyvk::BufferUsage::Staging, easyvk::HostAccess::Read);
+        std::vector<uint8_t> host(static_cast<size_t>(bytes), 0x5a);
+        const uint32_t count = sizeIterations(opts, bytes);
+
+        Result upload{"upload_bandwidth", "GB/s", bytes, {}};
+        Result download{"download_bandwidth", "GB/s", bytes, {}};
+        Result copy{"device_copy_bandwidth", "GB/s", bytes, {}};
+        Result mapWrite{"map_write_bandwidth", "GB/s", bytes, {}};
+        Result mapRead{"map_read_bandwidth", "GB/s", bytes, {}};
+
+        for (uint32_t i = 0; i < count; ++i) {
+            Clock::time_point start = Clock::now();
+            device.upload(deviceA, host.data(), bytes);
+            upload.samples.push_back(gbPerSecond(bytes, elapsedUs(start)));
+
+            start = Clock::now();
+            device.download(deviceA, host.data(), bytes);
+            download.samples.push_back(gbPerSecond(bytes, elapsedUs(start)));
+
+            start = Clock::now();
+            deviceA.copyTo(deviceB, bytes);
+            copy.samples.push_back(gbPerSecond(bytes, elapsedUs(start)));
+
+            start = Clock::now();
+            {
+                easyvk::BufferMapping m = hostWrite.mapWrite(0, bytes);
+                std::memcpy(m.data(), host.data(), static_cast<size_t>(bytes));
+            }
+            mapWrite.samples.push_back(gbPerSecond(bytes, elapsedUs(start)));
+
+            start = Clock::now();
+            {
+                easyvk::BufferMapping m = hostRead.mapRead(0, bytes);
+                std::memcpy(host.data(), m.data(), static_cast<size_t>(bytes));
+            }
+            mapRead.samples.push_back(gbPerSecond(bytes, elapsedUs(start)));
+        }
+
+        results.push_back(upload);
+        results.push_back(download);
+        results.push_back(copy);
+        results.push_back(mapWrite);
+        results.push_back(mapRead);
+    }
+
+    bool parseOptions(int argc, char **argv, Options &opts) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--device" && hasValue) {
+                opts.device = std::atoi(argv[++i]);
+            } else if (arg == "--iterations" && hasValue) {
+                opts.iterations = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+            } else if (arg == "--max-size-mb" && hasValue) {
+                opts.maxSizeMB = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+            } else if (arg == "--out" && hasValue) {
+                opts.out = argv[++i];
+            } else {
+                std::cerr << "usage: " << argv[0]
+                          << " [--device N] [--iterations N] [--max-size-mb N] [--out results.json]\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseOptions(argc, argv, opts)) return 2;
+
+    try {
+        easyvk::Instance instance(/*enableValidationLayers=*/false);
+        easyvk::DeviceCreateInfo deviceInfo;
+        deviceInfo.preferredIndex = opts.device;
+        easyvk::Device device(instance, deviceInfo);
+
+        const std::vector<uint32_t> spirv(kEmptyKernel, kEmptyKernel + sizeof(kEmptyKernel) / sizeof(kEmptyKernel[0]));
+        easyvk::Buffer bindA(device, 256, easyvk::BufferUsage::Storage, easyvk::HostAccess::None);
+        easyvk::Buffer bindB(device, 256, easyvk::BufferUsage::Storage, easyvk::HostAccess::None);
+
+        std::vector<Result> results;
+        {
+            easyvk::ComputeProgram program(device, kernelInfo(spirv, bindA));
+            program.setWorkgroups(1);
+            results.push_back(emptyDispatchLatency(program, opts));
+            results.push_back(submitThroughput(device, program, opts));
+            results.push_back(descriptorUpdateCost(program, bindA, bindB, opts));
+        }
+
+        // Driver-side caches may already warm the "cold" numbers; compare within one run
+        results.push_back(pipelineCreation(device, spirv, bindA, nullptr, opts));
+        easyvk::PipelineCache cache(device);
+        results.push_back(pipelineCreation(device, spirv, bindA, &cache, opts));
+
+        const VkDeviceSize maxBytes = static_cast<VkDeviceSize>(opts.maxSizeMB) * 1024 * 1024;
+        for (VkDeviceSize bytes = 4 * 1024; bytes <= maxBytes; bytes *= 4) {
+            bandwidth(device, bytes, opts, results);
+        }
+
+        if (opts.out.empty()) {
+            writeJson(std::cout, device, opts, results);
+        } else {
+            std::ofstream file(opts.out.c_str());
+            if (!file) {
+                std::cerr << "cannot open " << opts.out << "\n";
+                return 1;
+            }
+            writeJson(file, device, opts, results);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "easyvk_bench: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -21,19 +21,40 @@
 #endif
 #include "easyvk.h"
 
+#include <cassert>
 #include <cstring>
 #include <cstdarg>
+#include <cstdio>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <thread>
 #include <map>
+#include <unordered_map>
 #include <limits>
 
 #ifdef __ANDROID__
 #include <android/log.h>
 #endif
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifdef EASYVK_USE_SPIRV_TOOLS
 #include <spirv-tools/libspirv.hpp>
 #endif
@@ -152,14 +173,22 @@ namespace easyvk {
 
     // -------- SPIR-V validation -------------------------------------------------
     bool isValidSPIRV(const std::vector<uint32_t> &code) {
-        if (code.empty()) return false;
-        if (code.size() < 5) return false;
+        return isValidSPIRV(code.data(), code.size());
+    }
+
+    bool isValidSPIRV(const uint32_t *code, size_t wordCount) {
+        if (!code || wordCount == 0) return false;
+        if (wordCount < 5) return false;
         if (code[0] != 0x07230203) return false; // SPIR-V magic number
         return true;
     }
 
 #ifdef EASYVK_USE_SPIRV_TOOLS
     bool validateSPIRV(const std::vector<uint32_t> &code, std::string &errorMessage) {
+        return validateSPIRV(code.data(), code.size(), errorMessage);
+    }
+
+    bool validateSPIRV(const uint32_t *code, size_t wordCount, std::string &errorMessage) {
         spv_target_env env = SPV_ENV_VULKAN_1_3;
         spvtools::SpirvTools tools(env);
 
@@ -168,7 +197,7 @@ namespace easyvk {
             errorMessage = std::string("line ") + std::to_string(position.index) + ": " + message;
         });
 
-        return tools.Validate(code.data(), code.size());
+        return tools.Validate(code, wordCount);
     }
 #endif
 
@@ -433,6 +462,386 @@ namespace easyvk {
     }
 
     // -------- Device implementation ----------------------------------------------
+    // Upper bound on idle fences / command buffers kept by each command context for reuse
+    static const size_t kMaxPooledSubmitObjects = 64;
+
+    // Backing store of Device::stats(), shared with the internal pools. Plain atomic
+    // increments: the counters never order anything, and they sit next to driver calls.
+    struct DeviceCounters {
+        std::atomic<uint64_t> memoryAllocations;
+        std::atomic<uint64_t> memoryAllocationsTotal;
+        std::atomic<uint64_t> memoryTypeBytes[VK_MAX_MEMORY_TYPES];
+        std::atomic<uint64_t> fencesCreated;
+        std::atomic<uint64_t> commandBuffersAllocated;
+        std::atomic<uint64_t> descriptorPoolsCreated;
+        std::atomic<uint64_t> queueSubmits;
+        std::atomic<uint64_t> hostWaits;
+        std::atomic<uint64_t> hostWaitNs;
+        std::atomic<uint64_t> liveChildren; // DeviceChildRef instances (not reset by resetStats)
+
+        DeviceCounters()
+            : memoryAllocations(0),
+              memoryAllocationsTotal(0),
+              fencesCreated(0),
+              commandBuffersAllocated(0),
+              descriptorPoolsCreated(0),
+              queueSubmits(0),
+              hostWaits(0),
+              hostWaitNs(0),
+              liveChildren(0) {
+            for (std::atomic<uint64_t> &bytes : memoryTypeBytes) bytes.store(0);
+        }
+
+        void allocated(uint32_t memoryType, VkDeviceSize bytes) {
+            ++memoryAllocations;
+            ++memoryAllocationsTotal;
+            if (memoryType < VK_MAX_MEMORY_TYPES) memoryTypeBytes[memoryType] += bytes;
+        }
+        void freed(uint32_t memoryType, VkDeviceSize bytes) {
+            --memoryAllocations;
+            if (memoryType < VK_MAX_MEMORY_TYPES) memoryTypeBytes[memoryType] -= bytes;
+        }
+    };
+
+    namespace {
+        uint64_t steadyNowNs() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        uint32_t traceThreadId() {
+            static std::atomic<uint32_t> nextId(1);
+            thread_local uint32_t id = nextId.fetch_add(1);
+            return id;
+        }
+
+        // Reports one span to tracer (if any) when the scope ends
+        class TraceScope {
+        public:
+            TraceScope(Tracer *tracer, const char *name, uint64_t bytes = 0)
+                : tracer_(tracer), name_(name), bytes_(bytes), startNs_(tracer ? steadyNowNs() : 0) {}
+            ~TraceScope() {
+                if (tracer_) {
+                    tracer_->record(TraceEvent{name_, startNs_, steadyNowNs() - startNs_, bytes_, traceThreadId()});
+                }
+            }
+
+            TraceScope(const TraceScope &) = delete;
+            TraceScope &operator=(const TraceScope &) = delete;
+
+        private:
+            Tracer *tracer_;
+            const char *name_;
+            uint64_t bytes_;
+            uint64_t startNs_;
+        };
+
+        // Blocking host wait: counted in DeviceStats and traced as "wait". Zero timeouts
+        // are polls and stay out of both.
+        class WaitScope {
+        public:
+            WaitScope(DeviceCounters *counters, Tracer *tracer, uint64_t timeoutNs = UINT64_MAX)
+                : counters_(timeoutNs != 0 ? counters : nullptr),
+                  trace_(timeoutNs != 0 ? tracer : nullptr, "wait"),
+                  startNs_(counters_ ? steadyNowNs() : 0) {}
+            ~WaitScope() {
+                if (counters_) {
+                    ++counters_->hostWaits;
+                    counters_->hostWaitNs += steadyNowNs() - startNs_;
+                }
+            }
+
+            WaitScope(const WaitScope &) = delete;
+            WaitScope &operator=(const WaitScope &) = delete;
+
+        private:
+            DeviceCounters *counters_;
+            TraceScope trace_;
+            uint64_t startNs_;
+        };
+    }
+
+    // Per-thread recording state. Vulkan requires a command pool to be externally
+    // synchronized, including while any of its buffers is being recorded, so only the
+    // owning thread touches the pools. Buffers handed back from other threads (Device::wait
+    // on a handle created here) are parked on a returned list under lock_ and reset by the
+    // owner on its next acquire; lock_ is never held across recording or submission.
+    // checkedOut_ counts buffers and fences handed out and not yet back, so a context whose
+    // thread has let go of it (Device::releaseThreadContext) is destroyed only once idle.
+    class CommandContext {
+    public:
+        // transferFamily == UINT32_MAX: no transfer-queue pool
+        CommandContext(VkDevice device, uint32_t computeFamily, uint32_t transferFamily, DeviceCounters *counters);
+        ~CommandContext() noexcept;
+
+        CommandContext(const CommandContext &) = delete;
+        CommandContext &operator=(const CommandContext &) = delete;
+
+        // Owner thread only. completedValue retires deferred buffers first.
+        VkCommandBuffer acquire(bool transferFamily, uint64_t completedValue);
+        void defer(VkCommandBuffer cmdBuf, bool transferFamily, uint64_t value);
+        bool hasDeferred() const { return !deferred_.empty(); }
+        // Any thread
+        void release(VkCommandBuffer cmdBuf, bool transferFamily);
+        VkFence acquireFence();
+        void releaseFence(VkFence fence);
+        // Only once no thread owns the context: retires deferred buffers up to
+        // completedValue and reports whether nothing is checked out or still deferred
+        bool idle(uint64_t completedValue);
+
+    private:
+        struct Family {
+            VkCommandPool pool;
+            std::vector<VkCommandBuffer> idle;     // reset, owner thread only
+            std::vector<VkCommandBuffer> returned; // not yet reset, guarded by lock_
+        };
+        // Command buffers owned by no handle, recycled once the compute timeline passes value
+        struct DeferredCommandBuffer {
+            uint64_t value;
+            bool transferFamily;
+            VkCommandBuffer cmdBuf;
+        };
+
+        VkDevice device_;
+        DeviceCounters *counters_;
+        Family families_[2]; // [0] compute, [1] transfer
+        std::vector<DeferredCommandBuffer> deferred_;
+        std::mutex lock_;
+        std::vector<VkFence> fences_; // reset, idle; guarded by lock_
+        size_t checkedOut_;           // guarded by lock_
+    };
+
+    CommandContext::CommandContext(VkDevice device, uint32_t computeFamily, uint32_t transferFamily,
+                                   DeviceCounters *counters)
+        : device_(device), counters_(counters), checkedOut_(0) {
+        families_[0].pool = VK_NULL_HANDLE;
+        families_[1].pool = VK_NULL_HANDLE;
+
+        VkCommandPoolCreateInfo poolInfo{
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            nullptr,
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            computeFamily
+        };
+        VK_CHECK(vkCreateCommandPool(device_, &poolInfo, nullptr, &families_[0].pool));
+        if (transferFamily != UINT32_MAX) {
+            poolInfo.queueFamilyIndex = transferFamily;
+            VkResult result = vkCreateCommandPool(device_, &poolInfo, nullptr, &families_[1].pool);
+            if (result != VK_SUCCESS) {
+                vkDestroyCommandPool(device_, families_[0].pool, nullptr);
+                families_[0].pool = VK_NULL_HANDLE;
+                VK_CHECK(result);
+            }
+        }
+    }
+
+    CommandContext::~CommandContext() noexcept {
+        for (VkFence fence : fences_) {
+            vkDestroyFence(device_, fence, nullptr);
+        }
+        // Pooled command buffers are released together with their pool
+        for (Family &family : families_) {
+            if (family.pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(device_, family.pool, nullptr);
+            }
+        }
+    }
+
+    VkCommandBuffer CommandContext::acquire(bool transferFamily, uint64_t completedValue) {
+        if (!deferred_.empty()) {
+            // returned is shared with release() on other threads
+            std::lock_guard<std::mutex> lock(lock_);
+            size_t kept = 0;
+            for (size_t i = 0; i < deferred_.size(); ++i) {
+                const DeferredCommandBuffer &entry = deferred_[i];
+                if (entry.value > completedValue) {
+                    deferred_[kept++] = entry;
+                } else {
+                    families_[entry.transferFamily ? 1 : 0].returned.push_back(entry.cmdBuf);
+                }
+            }
+            deferred_.resize(kept);
+        }
+
+        Family &family = families_[transferFamily ? 1 : 0];
+        std::vector<VkCommandBuffer> returned;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            returned.swap(family.returned);
+        }
+        for (VkCommandBuffer cmdBuf : returned) {
+            if (family.idle.size() >= kMaxPooledSubmitObjects || vkResetCommandBuffer(cmdBuf, 0) != VK_SUCCESS) {
+                vkFreeCommandBuffers(device_, family.pool, 1, &cmdBuf);
+            } else {
+                family.idle.push_back(cmdBuf);
+            }
+        }
+
+        if (!family.idle.empty()) {
+            VkCommandBuffer cmdBuf = family.idle.back();
+            family.idle.pop_back();
+            std::lock_guard<std::mutex> lock(lock_);
+            ++checkedOut_;
+            return cmdBuf;
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            nullptr,
+            family.pool,
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            1
+        };
+        VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+        VK_CHECK(vkAllocateCommandBuffers(device_, &allocInfo, &cmdBuf));
+        ++counters_->commandBuffersAllocated;
+        std::lock_guard<std::mutex> lock(lock_);
+        ++checkedOut_;
+        return cmdBuf;
+    }
+
+    void CommandContext::defer(VkCommandBuffer cmdBuf, bool transferFamily, uint64_t value) {
+        deferred_.push_back(DeferredCommandBuffer{value, transferFamily, cmdBuf});
+        // Tracked by deferred_ from here on
+        std::lock_guard<std::mutex> lock(lock_);
+        if (checkedOut_ > 0) --checkedOut_;
+    }
+
+    void CommandContext::release(VkCommandBuffer cmdBuf, bool transferFamily) {
+        if (cmdBuf == VK_NULL_HANDLE) return;
+        std::lock_guard<std::mutex> lock(lock_);
+        families_[transferFamily ? 1 : 0].returned.push_back(cmdBuf);
+        if (checkedOut_ > 0) --checkedOut_;
+    }
+
+    VkFence CommandContext::acquireFence() {
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            if (!fences_.empty()) {
+                VkFence fence = fences_.back();
+                fences_.pop_back();
+                ++checkedOut_;
+                return fence;
+            }
+        }
+
+        VkFence fence = VK_NULL_HANDLE;
+        VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
+        VK_CHECK(vkCreateFence(device_, &fenceInfo, nullptr, &fence));
+        ++counters_->fencesCreated;
+        std::lock_guard<std::mutex> lock(lock_);
+        ++checkedOut_;
+        return fence;
+    }
+
+    void CommandContext::releaseFence(VkFence fence) {
+        if (fence == VK_NULL_HANDLE) return;
+        // Fences are not tied to a pool; resetting from any thread is fine
+        bool reset = vkResetFences(device_, 1, &fence) == VK_SUCCESS;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            if (checkedOut_ > 0) --checkedOut_;
+            if (reset && fences_.size() < kMaxPooledSubmitObjects) {
+                fences_.push_back(fence);
+                return;
+            }
+        }
+        vkDestroyFence(device_, fence, nullptr);
+    }
+
+    bool CommandContext::idle(uint64_t completedValue) {
+        size_t kept = 0;
+        for (size_t i = 0; i < deferred_.size(); ++i) {
+            if (deferred_[i].value > completedValue) deferred_[kept++] = deferred_[i];
+        }
+        deferred_.resize(kept); // retired buffers go with the pool
+        std::lock_guard<std::mutex> lock(lock_);
+        return checkedOut_ == 0 && deferred_.empty();
+    }
+
+    // Thread id -> CommandContext, sharded so that first-use lookups from many threads do
+    // not contend on one lock. Steady-state lookups hit the thread-local cache instead.
+    class CommandContextRegistry {
+    public:
+        CommandContextRegistry(VkDevice device, uint32_t computeFamily, uint32_t transferFamily,
+                               DeviceCounters *counters)
+            : device_(device), computeFamily_(computeFamily), transferFamily_(transferFamily), counters_(counters) {}
+
+        CommandContext *get(std::thread::id thread) {
+            Shard &shard = shards_[std::hash<std::thread::id>()(thread) % kShardCount];
+            std::lock_guard<std::mutex> lock(shard.lock);
+            for (const auto &entry : shard.contexts) {
+                if (entry.first == thread) return entry.second.get();
+            }
+            std::unique_ptr<CommandContext> context(
+                new CommandContext(device_, computeFamily_, transferFamily_, counters_));
+            shard.contexts.emplace_back(thread, std::move(context));
+            return shard.contexts.back().second.get();
+        }
+
+        // Detaches the thread's context; it is destroyed by a later trim() once idle
+        void retire(std::thread::id thread) {
+            std::unique_ptr<CommandContext> context;
+            {
+                Shard &shard = shards_[std::hash<std::thread::id>()(thread) % kShardCount];
+                std::lock_guard<std::mutex> lock(shard.lock);
+                for (size_t i = 0; i < shard.contexts.size(); ++i) {
+                    if (shard.contexts[i].first != thread) continue;
+                    context = std::move(shard.contexts[i].second);
+                    shard.contexts.erase(shard.contexts.begin() + i);
+                    break;
+                }
+            }
+            if (!context) return;
+            std::lock_guard<std::mutex> lock(retiredLock_);
+            retired_.push_back(std::move(context));
+        }
+
+        // Returns the number of retired contexts destroyed
+        size_t trim(uint64_t completedValue) {
+            std::lock_guard<std::mutex> lock(retiredLock_);
+            size_t kept = 0;
+            for (size_t i = 0; i < retired_.size(); ++i) {
+                if (!retired_[i]->idle(completedValue)) retired_[kept++] = std::move(retired_[i]);
+            }
+            size_t destroyed = retired_.size() - kept;
+            retired_.resize(kept);
+            return destroyed;
+        }
+
+        size_t retiredCount() {
+            std::lock_guard<std::mutex> lock(retiredLock_);
+            return retired_.size();
+        }
+
+    private:
+        static const size_t kShardCount = 16;
+        struct Shard {
+            std::mutex lock;
+            std::vector<std::pair<std::thread::id, std::unique_ptr<CommandContext>>> contexts;
+        };
+
+        VkDevice device_;
+        uint32_t computeFamily_;
+        uint32_t transferFamily_;
+        DeviceCounters *counters_;
+        Shard shards_[kShardCount];
+        std::mutex retiredLock_;
+        std::vector<std::unique_ptr<CommandContext>> retired_; // no owning thread
+    };
+
+    namespace {
+        std::atomic<uint64_t> gNextDeviceId(1);
+
+        // One-entry cache of the calling thread's context, keyed by Device::id_ (ids are
+        // never reused, so a destroyed Device cannot be confused with a new one)
+        struct ThreadContextCache {
+            uint64_t deviceId;
+            CommandContext *context;
+        };
+        thread_local ThreadContextCache tlsCommandContext = {0, nullptr};
+    }
+
     uint32_t findComputeQueueFamily(VkPhysicalDevice physicalDevice) {
         if (physicalDevice == VK_NULL_HANDLE) return UINT32_MAX;
 
@@ -515,10 +924,16 @@ namespace easyvk {
           queue_(VK_NULL_HANDLE),
           queueFamilyIndex_(UINT32_MAX),
           limits_(),
-          transferCmdPool_(VK_NULL_HANDLE),
+          properties_(),
+          memProperties_(),
+          deviceUUID_(),
+          driverUUID_(),
+          id_(0),
           robustAccessEnabled_(false),
           robustness2Enabled_(false),
           debugMarkersEnabled_(false),
+          computeTimelineValue_(0),
+          flushedValue_(0),
           supportsTimestamps_(false),
           timestampPeriod_(0.0),
           tornDown_(false)
@@ -526,9 +941,13 @@ namespace easyvk {
       , allocator_(VK_NULL_HANDLE)
 #endif
     {
+        counters_.reset(new DeviceCounters());
         if (!inst.isValid()) {
             EVK_FAIL_VOID("Instance is not valid");
         }
+        if (info.stagingChunkBytes == 0) {
+            EVK_FAIL_VOID("DeviceCreateInfo::stagingChunkBytes must be non-zero");
+        }
 
         // 1. Select a physical device
         std::vector<VkPhysicalDevice> devices = inst.physicalDevices();
@@ -543,9 +962,23 @@ namespace easyvk {
             EVK_FAIL_VOID("No compute queue family found");
         }
 
-        VkPhysicalDeviceProperties props;
-        vkGetPhysicalDeviceProperties(phys_, &props);
+        VkPhysicalDeviceIDProperties idProps{
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES,
+            nullptr
+        };
+        VkPhysicalDeviceProperties2 props2{
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            &idProps
+        };
+        vkGetPhysicalDeviceProperties2(phys_, &props2);
+        const VkPhysicalDeviceProperties &props = props2.properties;
+        properties_ = props;
+        vkGetPhysicalDeviceMemoryProperties(phys_, &memProperties_);
+        unifiedMemory_ = props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ||
+                         props.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
         limits_ = props.limits;
+        std::memcpy(deviceUUID_, idProps.deviceUUID, VK_UUID_SIZE);
+        std::memcpy(driverUUID_, idProps.driverUUID, VK_UUID_SIZE);
 
         // 3. Gather queue family properties
         uint32_t queueFamilyCount = 0;
@@ -557,6 +990,7 @@ namespace easyvk {
         if (queueFamilyIndex_ < queueFamilies.size()) {
             supportsTimestamps_ = (queueFamilies[queueFamilyIndex_].timestampValidBits > 0) && (props.limits.timestampPeriod > 0);
             timestampPeriod_ = static_cast<double>(props.limits.timestampPeriod);
+            timestampValidBits_ = queueFamilies[queueFamilyIndex_].timestampValidBits;
         }
 
         // 4. Locate a dedicated transfer queue family, if available
@@ -578,6 +1012,12 @@ namespace easyvk {
 
         std::vector<const char *> enabledExtensions;
         bool hasRobustness2 = false;
+        bool hasPerformanceQuery = false;
+        bool hasSubgroupSizeControl = false;
+        bool hasShaderModuleIdentifier = false;
+        bool hasBufferDeviceAddress = false;
+        bool hasExternalMemory = false;
+        bool hasExternalMemoryHost = false;
 
         for (const auto &extension : extensions) {
             if (strcmp(extension.extensionName, VK_EXT_ROBUSTNESS_2_EXTENSION_NAME) == 0) {
@@ -590,6 +1030,21 @@ namespace easyvk {
                     enabledExtensions.push_back(VK_EXT_DEBUG_MARKER_EXTENSION_NAME);
                     debugMarkersEnabled_ = true;
                 }
+            } else if (strcmp(extension.extensionName, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME) == 0) {
+                enabledExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+                pushDescriptorsEnabled_ = true;
+            } else if (strcmp(extension.extensionName, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) == 0) {
+                hasExternalMemoryHost = true;
+            } else if (strcmp(extension.extensionName, VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME) == 0) {
+                hasExternalMemory = true;
+            } else if (strcmp(extension.extensionName, VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME) == 0) {
+                hasPerformanceQuery = true;
+            } else if (strcmp(extension.extensionName, VK_EXT_SUBGROUP_SIZE_CONTROL_EXTENSION_NAME) == 0) {
+                hasSubgroupSizeControl = true;
+            } else if (strcmp(extension.extensionName, VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME) == 0) {
+                hasShaderModuleIdentifier = true;
+            } else if (strcmp(extension.extensionName, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME) == 0) {
+                hasBufferDeviceAddress = true;
             } else if (strcmp(extension.extensionName, VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME) == 0) {
                 enabledExtensions.push_back(VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME);
             } else if (strcmp(extension.extensionName, "VK_KHR_portability_subset") == 0) {
@@ -597,6 +1052,19 @@ namespace easyvk {
             }
         }
 
+        // VK_EXT_external_memory_host requires VK_KHR_external_memory (core in 1.1)
+        if (hasExternalMemoryHost) {
+            bool core11 = VK_API_VERSION_MAJOR(props.apiVersion) > 1 ||
+                          (VK_API_VERSION_MAJOR(props.apiVersion) == 1 && VK_API_VERSION_MINOR(props.apiVersion) >= 1);
+            if (core11 || hasExternalMemory) {
+                if (!core11) {
+                    enabledExtensions.push_back(VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME);
+                }
+                enabledExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+                externalMemoryHostEnabled_ = true;
+            }
+        }
+
         // 6. Configure device feature chains (pNext chain)
         void *pNextChain = nullptr;
 
@@ -627,23 +1095,55 @@ namespace easyvk {
             pNextChain = &robustness2Features;
         }
 
-        // 6.2 Basic device features
+        // 6.2 Performance query counters (opt-in)
+        VkPhysicalDevicePerformanceQueryFeaturesKHR performanceQueryFeatures{
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PERFORMANCE_QUERY_FEATURES_KHR
+        };
+
+        if (hasPerformanceQuery && info.enablePerformanceQuery) {
+            VkPhysicalDevicePerformanceQueryFeaturesKHR supported{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PERFORMANCE_QUERY_FEATURES_KHR
+            };
+            VkPhysicalDeviceFeatures2 features2{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                &supported
+            };
+            vkGetPhysicalDeviceFeatures2(phys_, &features2);
+
+            if (supported.performanceCounterQueryPools) {
+                enabledExtensions.push_back(VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME);
+                performanceQueryFeatures.performanceCounterQueryPools = VK_TRUE;
+                performanceQueryFeatures.pNext = pNextChain;
+                pNextChain = &performanceQueryFeatures;
+                // performanceQueryEnabled_ is finalized after function availability checks
+                performanceQueryEnabled_ = true;
+            }
+        }
+
+        // 6.3 Basic device features
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(phys_, &supportedFeatures);
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.robustBufferAccess = info.enableRobustBufferAccess ? VK_TRUE : VK_FALSE;
         robustAccessEnabled_ = info.enableRobustBufferAccess;
+        deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+        pipelineStatisticsEnabled_ = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
 
-        // 6.3 Set up queue creation info
+        // 6.4 Set up queue creation info
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         float priority = 1.0f;
 
-        // Add compute queue
+        // Add compute queues (all at the same priority)
+        const uint32_t computeQueueCount = std::max<uint32_t>(1,
+            std::min(info.computeQueueCount, queueFamilies[queueFamilyIndex_].queueCount));
+        std::vector<float> computePriorities(computeQueueCount, 1.0f);
         VkDeviceQueueCreateInfo computeQueueInfo{
             VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
             nullptr,
             0,
             queueFamilyIndex_,
-            1,
-            &priority
+            computeQueueCount,
+            computePriorities.data()
         };
         queueCreateInfos.push_back(computeQueueInfo);
 
@@ -695,9 +1195,15 @@ namespace easyvk {
         if (VK_API_VERSION_MAJOR(props.apiVersion) > 1 ||
             (VK_API_VERSION_MAJOR(props.apiVersion) == 1 && VK_API_VERSION_MINOR(props.apiVersion) >= 3)) {
             vulkan13Features.synchronization2 = VK_TRUE;
+            // All required features in Vulkan 1.3
+            vulkan13Features.subgroupSizeControl = VK_TRUE;
+            vulkan13Features.computeFullSubgroups = VK_TRUE;
+            vulkan13Features.pipelineCreationCacheControl = VK_TRUE;
             vulkan13Features.pNext = pNextChain;
             pNextChain = &vulkan13Features;
             sync2Enabled_ = true;
+            subgroupSizeControl_ = true;
+            computeFullSubgroups_ = true;
         } else {
             for (const auto &extension : extensions) {
                 if (strcmp(extension.extensionName, "VK_KHR_synchronization2") == 0) {
@@ -711,6 +1217,86 @@ namespace easyvk {
             }
         }
 
+        // 7.3 Subgroup size control (extension before Vulkan 1.3)
+        VkPhysicalDeviceSubgroupSizeControlFeatures subgroupSizeFeatures{
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_FEATURES
+        };
+
+        if (!subgroupSizeControl_ && hasSubgroupSizeControl) {
+            VkPhysicalDeviceSubgroupSizeControlFeatures supported{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_FEATURES
+            };
+            VkPhysicalDeviceFeatures2 features2{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                &supported
+            };
+            vkGetPhysicalDeviceFeatures2(phys_, &features2);
+
+            if (supported.subgroupSizeControl) {
+                enabledExtensions.push_back(VK_EXT_SUBGROUP_SIZE_CONTROL_EXTENSION_NAME);
+                subgroupSizeFeatures.subgroupSizeControl = VK_TRUE;
+                subgroupSizeFeatures.computeFullSubgroups = supported.computeFullSubgroups;
+                subgroupSizeFeatures.pNext = pNextChain;
+                pNextChain = &subgroupSizeFeatures;
+                subgroupSizeControl_ = true;
+                computeFullSubgroups_ = supported.computeFullSubgroups == VK_TRUE;
+            }
+        }
+
+        // 7.4 Shader module identifiers (need pipelineCreationCacheControl from Vulkan 1.3)
+        VkPhysicalDeviceShaderModuleIdentifierFeaturesEXT identifierFeatures{
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_MODULE_IDENTIFIER_FEATURES_EXT
+        };
+
+        if (hasShaderModuleIdentifier && vulkan13Features.pipelineCreationCacheControl) {
+            VkPhysicalDeviceShaderModuleIdentifierFeaturesEXT supported{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_MODULE_IDENTIFIER_FEATURES_EXT
+            };
+            VkPhysicalDeviceFeatures2 features2{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                &supported
+            };
+            vkGetPhysicalDeviceFeatures2(phys_, &features2);
+
+            if (supported.shaderModuleIdentifier) {
+                enabledExtensions.push_back(VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME);
+                identifierFeatures.shaderModuleIdentifier = VK_TRUE;
+                identifierFeatures.pNext = pNextChain;
+                pNextChain = &identifierFeatures;
+                shaderModuleIdentifierEnabled_ = true;
+            }
+        }
+
+        // 7.5 Buffer device addresses (Vulkan 1.2 core or extension)
+        VkPhysicalDeviceBufferDeviceAddressFeatures addressFeatures{
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES
+        };
+
+        if (info.enableBufferDeviceAddress) {
+            VkPhysicalDeviceBufferDeviceAddressFeatures supported{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES
+            };
+            VkPhysicalDeviceFeatures2 features2{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                &supported
+            };
+            vkGetPhysicalDeviceFeatures2(phys_, &features2);
+
+            if (supported.bufferDeviceAddress) {
+                if (vulkan12Features.timelineSemaphore) {
+                    // The Vulkan 1.2 struct is already chained; the standalone one may not be
+                    vulkan12Features.bufferDeviceAddress = VK_TRUE;
+                    bufferDeviceAddressEnabled_ = true;
+                } else if (hasBufferDeviceAddress) {
+                    enabledExtensions.push_back(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+                    addressFeatures.bufferDeviceAddress = VK_TRUE;
+                    addressFeatures.pNext = pNextChain;
+                    pNextChain = &addressFeatures;
+                    bufferDeviceAddressEnabled_ = true;
+                }
+            }
+        }
+
         // 8. Create the logical device
         VkDeviceCreateInfo deviceCreateInfo{
             VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
@@ -728,7 +1314,12 @@ namespace easyvk {
         VK_CHECK(vkCreateDevice(phys_, &deviceCreateInfo, nullptr, &device_));
 
         // 9. Retrieve queue handles
-        vkGetDeviceQueue(device_, queueFamilyIndex_, 0, &queue_);
+        computeQueues_.resize(computeQueueCount);
+        for (uint32_t i = 0; i < computeQueueCount; ++i) {
+            vkGetDeviceQueue(device_, queueFamilyIndex_, i, &computeQueues_[i]);
+            queueLocks_.emplace_back(new std::mutex());
+        }
+        queue_ = computeQueues_[0];
         if (transferFamily != queueFamilyIndex_) {
             vkGetDeviceQueue(device_, transferFamily, 0, &transferQueue_);
             transferQueueFamilyIndex_ = transferFamily;
@@ -737,19 +1328,150 @@ namespace easyvk {
         // 10. Load device-level function pointers via volk
         volkLoadDevice(device_);
 
+        // Finalize push descriptor support
+        if (pushDescriptorsEnabled_ && vkCmdPushDescriptorSetKHR != nullptr) {
+            VkPhysicalDevicePushDescriptorPropertiesKHR pushProps{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR,
+                nullptr,
+                0
+            };
+            VkPhysicalDeviceProperties2 pushProps2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &pushProps};
+            vkGetPhysicalDeviceProperties2(phys_, &pushProps2);
+            maxPushDescriptors_ = pushProps.maxPushDescriptors;
+        } else {
+            pushDescriptorsEnabled_ = false;
+        }
+
+        if (shaderModuleIdentifierEnabled_ && vkGetShaderModuleCreateInfoIdentifierEXT == nullptr) {
+            shaderModuleIdentifierEnabled_ = false;
+        }
+        if (bufferDeviceAddressEnabled_ && vkGetBufferDeviceAddress == nullptr && vkGetBufferDeviceAddressKHR == nullptr) {
+            bufferDeviceAddressEnabled_ = false;
+        }
+
+        // Finalize host pointer import support
+        if (externalMemoryHostEnabled_ && vkGetMemoryHostPointerPropertiesEXT != nullptr) {
+            VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProps{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT,
+                nullptr,
+                0
+            };
+            VkPhysicalDeviceProperties2 hostProps2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &hostProps};
+            vkGetPhysicalDeviceProperties2(phys_, &hostProps2);
+            minImportedHostPointerAlignment_ = hostProps.minImportedHostPointerAlignment;
+        } else {
+            externalMemoryHostEnabled_ = false;
+        }
+
+        // Cache subgroup properties (and the selectable size range with size control)
+        {
+            VkPhysicalDeviceSubgroupSizeControlProperties sizeProps{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_PROPERTIES
+            };
+            VkPhysicalDeviceSubgroupProperties subgroupProps{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+                subgroupSizeControl_ ? &sizeProps : nullptr
+            };
+            VkPhysicalDeviceProperties2 props2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &subgroupProps};
+            vkGetPhysicalDeviceProperties2(phys_, &props2);
+
+            subgroupSize_ = subgroupProps.subgroupSize;
+            subgroupStages_ = subgroupProps.supportedStages;
+            subgroupOperations_ = subgroupProps.supportedOperations;
+            if (subgroupSizeControl_ && (sizeProps.requiredSubgroupSizeStages & VK_SHADER_STAGE_COMPUTE_BIT)) {
+                minSubgroupSize_ = sizeProps.minSubgroupSize;
+                maxSubgroupSize_ = sizeProps.maxSubgroupSize;
+                maxComputeWorkgroupSubgroups_ = sizeProps.maxComputeWorkgroupSubgroups;
+            } else {
+                // Cannot be requested for compute shaders: the default is the only size
+                subgroupSizeControl_ = false;
+                minSubgroupSize_ = maxSubgroupSize_ = subgroupSize_;
+                maxComputeWorkgroupSubgroups_ = 0;
+            }
+        }
+
+        // Finalize performance query support: the counters of the compute family
+        if (performanceQueryEnabled_) {
+            performanceQueryEnabled_ = vkEnumeratePhysicalDeviceQueueFamilyPerformanceQueryCountersKHR != nullptr &&
+                                       vkGetPhysicalDeviceQueueFamilyPerformanceQueryPassesKHR != nullptr &&
+                                       vkAcquireProfilingLockKHR != nullptr && vkReleaseProfilingLockKHR != nullptr;
+        }
+        if (performanceQueryEnabled_) {
+            uint32_t counterCount = 0;
+            vkEnumeratePhysicalDeviceQueueFamilyPerformanceQueryCountersKHR(phys_, queueFamilyIndex_, &counterCount,
+                                                                            nullptr, nullptr);
+            std::vector<VkPerformanceCounterKHR> counters(counterCount);
+            std::vector<VkPerformanceCounterDescriptionKHR> descriptions(counterCount);
+            for (uint32_t i = 0; i < counterCount; ++i) {
+                counters[i].sType = VK_STRUCTURE_TYPE_PERFORMANCE_COUNTER_KHR;
+                counters[i].pNext = nullptr;
+                descriptions[i].sType = VK_STRUCTURE_TYPE_PERFORMANCE_COUNTER_DESCRIPTION_KHR;
+                descriptions[i].pNext = nullptr;
+            }
+            vkEnumeratePhysicalDeviceQueueFamilyPerformanceQueryCountersKHR(phys_, queueFamilyIndex_, &counterCount,
+                                                                            counters.data(), descriptions.data());
+            performanceCounters_.resize(counterCount);
+            for (uint32_t i = 0; i < counterCount; ++i) {
+                performanceCounters_[i].name = descriptions[i].name;
+                performanceCounters_[i].category = descriptions[i].category;
+                performanceCounters_[i].description = descriptions[i].description;
+                performanceCounters_[i].unit = counters[i].unit;
+                performanceCounters_[i].scope = counters[i].scope;
+                performanceCounters_[i].storage = counters[i].storage;
+            }
+            performanceQueryEnabled_ = counterCount > 0;
+        }
+
         // Finalize sync2 availability check
         if (!sync2Enabled_) {
             sync2Enabled_ = (vkQueueSubmit2 != nullptr);
         }
 
-        // 11. Create transfer command pool
-        VkCommandPoolCreateInfo poolInfo{
-            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-            nullptr,
-            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-            queueFamilyIndex_
-        };
-        VK_CHECK(vkCreateCommandPool(device_, &poolInfo, nullptr, &transferCmdPool_));
+        // Finalize timeline availability and create the compute queue timeline
+        if (timelineEnabled_) {
+            waitSemaphores_ = vkWaitSemaphores ? vkWaitSemaphores : vkWaitSemaphoresKHR;
+            getSemaphoreCounterValue_ = vkGetSemaphoreCounterValue ? vkGetSemaphoreCounterValue
+                                                                   : vkGetSemaphoreCounterValueKHR;
+            timelineEnabled_ = waitSemaphores_ != nullptr && getSemaphoreCounterValue_ != nullptr;
+        }
+        if (timelineEnabled_) {
+            VkSemaphoreTypeCreateInfo typeInfo{
+                VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                nullptr,
+                VK_SEMAPHORE_TYPE_TIMELINE,
+                0
+            };
+            VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &typeInfo, 0};
+            VK_CHECK(vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &computeTimeline_));
+            computeTimelineValue_ = 0;
+
+            // Large copies go through the dedicated transfer family when one exists. The
+            // hand-off back to compute is a semaphore wait, hence the timeline requirement.
+            if (transferQueue_ != VK_NULL_HANDLE && info.transferQueueMinCopyBytes != UINT64_MAX) {
+                VK_CHECK(vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &transferTimeline_));
+                transferTimelineValue_ = 0;
+                transferQueueMinCopyBytes_ = info.transferQueueMinCopyBytes;
+            }
+        }
+
+        // Coalescing hands out timeline values before the submit, so it needs timelines
+        coalesceSubmits_ = info.coalesceSubmits && timelineEnabled_;
+        coalesceMaxPending_ = std::max<uint32_t>(info.coalesceMaxPending, 1);
+        coalesceMaxLatencyNs_ = static_cast<uint64_t>(info.coalesceMaxLatencyUs) * 1000;
+
+        arenaMaxAllocationBytes_ = info.memoryArenaMaxAllocationBytes;
+        stagingChunkBytes_ = info.stagingChunkBytes;
+        stagingChunkCount_ = std::max<uint32_t>(info.stagingChunkCount, 2);
+
+        // 11. Per-thread command pools (created on each thread's first submission)
+        id_ = gNextDeviceId.fetch_add(1);
+        contexts_.reset(new CommandContextRegistry(device_, queueFamilyIndex_,
+                                                   transferTimeline_ != VK_NULL_HANDLE ? transferQueueFamilyIndex_
+                                                                                       : UINT32_MAX,
+                                                   counters_.get()));
+        transferQueueLock_.reset(new std::mutex());
+        lazyInitLock_.reset(new std::mutex());
+        fenceOwnersLock_.reset(new std::mutex());
 
 #ifdef EASYVK_USE_VMA
         // 12. Initialize VMA (Vulkan Memory Allocator)
@@ -763,6 +1485,9 @@ namespace easyvk {
         vmaCreateInfo.device = device_;
         vmaCreateInfo.vulkanApiVersion = info.apiVersion;
         vmaCreateInfo.pVulkanFunctions = &vmaFns;
+        if (bufferDeviceAddressEnabled_) {
+            vmaCreateInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+        }
 
         VK_CHECK(vmaCreateAllocator(&vmaCreateInfo, &allocator_));
 #endif
@@ -776,10 +1501,16 @@ namespace easyvk {
           queue_(VK_NULL_HANDLE),
           queueFamilyIndex_(UINT32_MAX),
           limits_(),
-          transferCmdPool_(VK_NULL_HANDLE),
+          properties_(),
+          memProperties_(),
+          deviceUUID_(),
+          driverUUID_(),
+          id_(0),
           robustAccessEnabled_(false),
           robustness2Enabled_(false),
           debugMarkersEnabled_(false),
+          computeTimelineValue_(0),
+          flushedValue_(0),
           supportsTimestamps_(false),
           timestampPeriod_(0.0),
           tornDown_(false) {
@@ -795,30 +1526,96 @@ namespace easyvk {
           device_(other.device_),
           queue_(other.queue_),
           transferQueue_(other.transferQueue_),
+          computeQueues_(std::move(other.computeQueues_)),
+          queueLocks_(std::move(other.queueLocks_)),
           queueFamilyIndex_(other.queueFamilyIndex_),
           transferQueueFamilyIndex_(other.transferQueueFamilyIndex_),
           limits_(other.limits_),
-          transferCmdPool_(other.transferCmdPool_),
+          properties_(other.properties_),
+          memProperties_(other.memProperties_),
+          unifiedMemory_(other.unifiedMemory_),
+          pipelineCache_(other.pipelineCache_),
+          profiler_(other.profiler_),
+          tracer_(other.tracer_),
+          counters_(std::move(other.counters_)),
+          id_(other.id_),
+          contexts_(std::move(other.contexts_)),
           robustAccessEnabled_(other.robustAccessEnabled_),
           robustness2Enabled_(other.robustness2Enabled_),
           debugMarkersEnabled_(other.debugMarkersEnabled_),
+          pushDescriptorsEnabled_(other.pushDescriptorsEnabled_),
+          maxPushDescriptors_(other.maxPushDescriptors_),
+          externalMemoryHostEnabled_(other.externalMemoryHostEnabled_),
+          minImportedHostPointerAlignment_(other.minImportedHostPointerAlignment_),
+          shaderModuleIdentifierEnabled_(other.shaderModuleIdentifierEnabled_),
+          bufferDeviceAddressEnabled_(other.bufferDeviceAddressEnabled_),
+          subgroupSize_(other.subgroupSize_),
+          subgroupStages_(other.subgroupStages_),
+          subgroupOperations_(other.subgroupOperations_),
+          subgroupSizeControl_(other.subgroupSizeControl_),
+          computeFullSubgroups_(other.computeFullSubgroups_),
+          minSubgroupSize_(other.minSubgroupSize_),
+          maxSubgroupSize_(other.maxSubgroupSize_),
+          maxComputeWorkgroupSubgroups_(other.maxComputeWorkgroupSubgroups_),
+          pipelineStatisticsEnabled_(other.pipelineStatisticsEnabled_),
+          performanceQueryEnabled_(other.performanceQueryEnabled_),
+          performanceCounters_(std::move(other.performanceCounters_)),
           timelineEnabled_(other.timelineEnabled_),
           sync2Enabled_(other.sync2Enabled_),
+          computeTimeline_(other.computeTimeline_),
+          computeTimelineValue_(other.computeTimelineValue_.load()),
+          waitSemaphores_(other.waitSemaphores_),
+          getSemaphoreCounterValue_(other.getSemaphoreCounterValue_),
+          transferQueueMinCopyBytes_(other.transferQueueMinCopyBytes_),
+          transferTimeline_(other.transferTimeline_),
+          transferTimelineValue_(other.transferTimelineValue_),
+          transferQueueLock_(std::move(other.transferQueueLock_)),
+          lazyInitLock_(std::move(other.lazyInitLock_)),
+          fenceOwnersLock_(std::move(other.fenceOwnersLock_)),
+          fenceOwners_(std::move(other.fenceOwners_)),
+          fenceSerial_(other.fenceSerial_),
+          coalesceSubmits_(other.coalesceSubmits_),
+          coalesceMaxPending_(other.coalesceMaxPending_),
+          coalesceMaxLatencyNs_(other.coalesceMaxLatencyNs_),
+          pendingSubmits_(std::move(other.pendingSubmits_)),
+          pendingWaits_(std::move(other.pendingWaits_)),
+          oldestPendingNs_(other.oldestPendingNs_),
+          flushedValue_(other.flushedValue_.load()),
+          stagingChunkBytes_(other.stagingChunkBytes_),
+          stagingChunkCount_(other.stagingChunkCount_),
+          arenaMaxAllocationBytes_(other.arenaMaxAllocationBytes_),
+          arena_(std::move(other.arena_)),
+          shaderModules_(std::move(other.shaderModules_)),
           supportsTimestamps_(other.supportsTimestamps_),
           timestampPeriod_(other.timestampPeriod_),
+          timestampValidBits_(other.timestampValidBits_),
           tornDown_(other.tornDown_)
 #ifdef EASYVK_USE_VMA
           , allocator_(other.allocator_)
 #endif
     {
+        // The ring's buffer points at other; drop it while other's handles are still live
+        other.staging_.reset();
+        // Children keep a Device pointer that would dangle (see the class note)
+        assert(!counters_ || counters_->liveChildren.load() == 0);
+        // Attached objects point back at the Device; follow the move
+        if (pipelineCache_ && pipelineCache_->device_ == &other) pipelineCache_->device_ = this;
+        if (profiler_ && profiler_->device_ == &other) profiler_->device_ = this;
+        std::memcpy(deviceUUID_, other.deviceUUID_, VK_UUID_SIZE);
+        std::memcpy(driverUUID_, other.driverUUID_, VK_UUID_SIZE);
         other.phys_ = VK_NULL_HANDLE;
         other.device_ = VK_NULL_HANDLE;
+        other.pipelineCache_ = nullptr;
+        other.profiler_ = nullptr;
+        other.tracer_ = nullptr;
         other.queue_ = VK_NULL_HANDLE;
         other.transferQueue_ = VK_NULL_HANDLE;
         other.transferQueueFamilyIndex_ = UINT32_MAX;
-        other.transferCmdPool_ = VK_NULL_HANDLE;
+        other.id_ = 0;
         other.timelineEnabled_ = false;
         other.sync2Enabled_ = false;
+        other.computeTimeline_ = VK_NULL_HANDLE;
+        other.transferTimeline_ = VK_NULL_HANDLE;
         other.tornDown_ = true;
 #ifdef EASYVK_USE_VMA
         other.allocator_ = VK_NULL_HANDLE;
@@ -828,22 +1625,80 @@ namespace easyvk {
     Device &Device::operator=(Device &&other) noexcept {
         if (this != &other) {
             teardown();
+            other.staging_.reset();
+            assert(!other.counters_ || other.counters_->liveChildren.load() == 0);
             instance_ = other.instance_;
             phys_ = other.phys_;
             device_ = other.device_;
             queue_ = other.queue_;
             transferQueue_ = other.transferQueue_;
+            computeQueues_ = std::move(other.computeQueues_);
+            queueLocks_ = std::move(other.queueLocks_);
             queueFamilyIndex_ = other.queueFamilyIndex_;
             transferQueueFamilyIndex_ = other.transferQueueFamilyIndex_;
             limits_ = other.limits_;
-            transferCmdPool_ = other.transferCmdPool_;
+            properties_ = other.properties_;
+            memProperties_ = other.memProperties_;
+            unifiedMemory_ = other.unifiedMemory_;
+            std::memcpy(deviceUUID_, other.deviceUUID_, VK_UUID_SIZE);
+            std::memcpy(driverUUID_, other.driverUUID_, VK_UUID_SIZE);
+            pipelineCache_ = other.pipelineCache_;
+            profiler_ = other.profiler_;
+            tracer_ = other.tracer_;
+            if (pipelineCache_ && pipelineCache_->device_ == &other) pipelineCache_->device_ = this;
+            if (profiler_ && profiler_->device_ == &other) profiler_->device_ = this;
+            counters_ = std::move(other.counters_);
+            id_ = other.id_;
+            contexts_ = std::move(other.contexts_);
             robustAccessEnabled_ = other.robustAccessEnabled_;
             robustness2Enabled_ = other.robustness2Enabled_;
             debugMarkersEnabled_ = other.debugMarkersEnabled_;
+            pushDescriptorsEnabled_ = other.pushDescriptorsEnabled_;
+            maxPushDescriptors_ = other.maxPushDescriptors_;
+            externalMemoryHostEnabled_ = other.externalMemoryHostEnabled_;
+            minImportedHostPointerAlignment_ = other.minImportedHostPointerAlignment_;
+            shaderModuleIdentifierEnabled_ = other.shaderModuleIdentifierEnabled_;
+            bufferDeviceAddressEnabled_ = other.bufferDeviceAddressEnabled_;
+            subgroupSize_ = other.subgroupSize_;
+            subgroupStages_ = other.subgroupStages_;
+            subgroupOperations_ = other.subgroupOperations_;
+            subgroupSizeControl_ = other.subgroupSizeControl_;
+            computeFullSubgroups_ = other.computeFullSubgroups_;
+            minSubgroupSize_ = other.minSubgroupSize_;
+            maxSubgroupSize_ = other.maxSubgroupSize_;
+            maxComputeWorkgroupSubgroups_ = other.maxComputeWorkgroupSubgroups_;
+            pipelineStatisticsEnabled_ = other.pipelineStatisticsEnabled_;
+            performanceQueryEnabled_ = other.performanceQueryEnabled_;
+            performanceCounters_ = std::move(other.performanceCounters_);
             timelineEnabled_ = other.timelineEnabled_;
             sync2Enabled_ = other.sync2Enabled_;
+            computeTimeline_ = other.computeTimeline_;
+            computeTimelineValue_ = other.computeTimelineValue_.load();
+            waitSemaphores_ = other.waitSemaphores_;
+            getSemaphoreCounterValue_ = other.getSemaphoreCounterValue_;
+            transferQueueMinCopyBytes_ = other.transferQueueMinCopyBytes_;
+            transferTimeline_ = other.transferTimeline_;
+            transferTimelineValue_ = other.transferTimelineValue_;
+            transferQueueLock_ = std::move(other.transferQueueLock_);
+            lazyInitLock_ = std::move(other.lazyInitLock_);
+            fenceOwnersLock_ = std::move(other.fenceOwnersLock_);
+            fenceOwners_ = std::move(other.fenceOwners_);
+            fenceSerial_ = other.fenceSerial_;
+            coalesceSubmits_ = other.coalesceSubmits_;
+            coalesceMaxPending_ = other.coalesceMaxPending_;
+            coalesceMaxLatencyNs_ = other.coalesceMaxLatencyNs_;
+            pendingSubmits_ = std::move(other.pendingSubmits_);
+            pendingWaits_ = std::move(other.pendingWaits_);
+            oldestPendingNs_ = other.oldestPendingNs_;
+            flushedValue_ = other.flushedValue_.load();
+            stagingChunkBytes_ = other.stagingChunkBytes_;
+            stagingChunkCount_ = other.stagingChunkCount_;
+            arenaMaxAllocationBytes_ = other.arenaMaxAllocationBytes_;
+            arena_ = std::move(other.arena_);
+            shaderModules_ = std::move(other.shaderModules_);
             supportsTimestamps_ = other.supportsTimestamps_;
             timestampPeriod_ = other.timestampPeriod_;
+            timestampValidBits_ = other.timestampValidBits_;
             tornDown_ = other.tornDown_;
 
 #ifdef EASYVK_USE_VMA
@@ -856,9 +1711,14 @@ namespace easyvk {
             other.queue_ = VK_NULL_HANDLE;
             other.transferQueue_ = VK_NULL_HANDLE;
             other.transferQueueFamilyIndex_ = UINT32_MAX;
-            other.transferCmdPool_ = VK_NULL_HANDLE;
+            other.id_ = 0;
+            other.pipelineCache_ = nullptr;
+            other.profiler_ = nullptr;
+            other.tracer_ = nullptr;
             other.timelineEnabled_ = false;
             other.sync2Enabled_ = false;
+            other.computeTimeline_ = VK_NULL_HANDLE;
+            other.transferTimeline_ = VK_NULL_HANDLE;
             other.tornDown_ = true;
         }
         return *this;
@@ -871,1522 +1731,7318 @@ namespace easyvk {
     }
 
     bool Device::wait(const SubmitHandle &h, uint64_t timeoutNs) {
-        if (h.fence == VK_NULL_HANDLE) return false;
-        VkResult result = vkWaitForFences(device_, 1, &h.fence, VK_TRUE, timeoutNs);
+        if (!h.isValid()) return false;
 
-        // Consume resources to prevent leaks on success or timeout
-        if (h.cmdBuf != VK_NULL_HANDLE) {
-            vkFreeCommandBuffers(device_, transferCmdPool_, 1, &h.cmdBuf);
+        VkResult result;
+        if (h.isTimeline()) {
+            if (h.semaphore == computeTimeline_ && !flushThrough(h.value)) return false;
+            VkSemaphoreWaitInfo waitInfo{
+                VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                nullptr,
+                0,
+                1, &h.semaphore, &h.value
+            };
+            WaitScope scope(counters_.get(), tracer_, timeoutNs);
+            result = waitSemaphores_(device_, &waitInfo, timeoutNs);
+        } else {
+            WaitScope scope(counters_.get(), tracer_, timeoutNs);
+            result = vkWaitForFences(device_, 1, &h.fence, VK_TRUE, timeoutNs);
         }
-        vkDestroyFence(device_, h.fence, nullptr);
 
-        return result == VK_SUCCESS;
-    }
+        // Still pending: the fence/command buffer are in use, keep them with the handle
+        if (result == VK_TIMEOUT) return false;
 
-    uint32_t Device::selectMemory(uint32_t memoryTypeBits, VkMemoryPropertyFlags flags) {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(phys_, &memProperties);
+        if (result == VK_SUCCESS) {
+            if (h.cmdBuf != VK_NULL_HANDLE) releaseCommandBuffer(h.cmdBuf, h.context);
+            if (h.fence != VK_NULL_HANDLE) releaseFence(h.fence, h.context);
+            return true;
+        }
 
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            if ((memoryTypeBits & (1u << i)) &&
-                ((flags & memProperties.memoryTypes[i].propertyFlags) == flags)) {
-                return i;
-            }
+        // Device loss or similar: do not recycle the fence in an unknown state. The command
+        // buffer can only be freed by its owning thread, which drops it on its next reset.
+        if (h.cmdBuf != VK_NULL_HANDLE) releaseCommandBuffer(h.cmdBuf, h.context);
+        if (h.fence != VK_NULL_HANDLE) {
+            retireFence(h.fence);
+            vkDestroyFence(device_, h.fence, nullptr);
         }
-#ifdef EASYVK_NO_EXCEPTIONS
-        lastError_ = "Failed to find suitable memory type";
-        return UINT32_MAX;
-#else
-        throw std::runtime_error("Failed to find suitable memory type");
-#endif
+        return false;
     }
 
-    uint32_t Device::subgroupSize() const {
-        VkPhysicalDeviceSubgroupProperties subgroupProperties{
-            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
-            nullptr
-        };
-
-        VkPhysicalDeviceProperties2 physicalDeviceProperties{
-            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
-            &subgroupProperties
-        };
-
-        vkGetPhysicalDeviceProperties2(phys_, &physicalDeviceProperties);
-        return subgroupProperties.subgroupSize;
+    bool Device::isComplete(const SubmitHandle &h) const {
+        if (h.isTimeline()) {
+            // A queued submission would never complete on its own
+            if (h.semaphore == computeTimeline_ && !flushThrough(h.value)) return false;
+            uint64_t current = 0;
+            if (getSemaphoreCounterValue_(device_, h.semaphore, &current) != VK_SUCCESS) return false;
+            return current >= h.value;
+        }
+        if (h.fence != VK_NULL_HANDLE) {
+            return vkGetFenceStatus(device_, h.fence) == VK_SUCCESS;
+        }
+        return false;
     }
 
-    const char *Device::vendorName() const {
-        VkPhysicalDeviceProperties props;
-        vkGetPhysicalDeviceProperties(phys_, &props);
-        return vkVendorName(props.vendorID);
+    bool SubmitHandle::poll() const {
+        return device != nullptr && device->isComplete(*this);
     }
 
-    void Device::teardown() {
-        if (tornDown_) return;
-
-        if (device_ != VK_NULL_HANDLE) {
-            vkDeviceWaitIdle(device_);
-
-#ifdef EASYVK_USE_VMA
-            if (allocator_ != VK_NULL_HANDLE) {
-                vmaDestroyAllocator(allocator_);
-                allocator_ = VK_NULL_HANDLE;
+    VkResult Device::waitHandles(const std::vector<SubmitHandle> &handles, bool any, uint64_t timeoutNs) const {
+        // One value per semaphore: most handles share the compute timeline, and waiting for
+        // all (any) of its values is waiting for the largest (smallest) one
+        std::vector<VkSemaphore> semaphores;
+        std::vector<uint64_t> values;
+        std::vector<VkFence> fences;
+        uint64_t computeValue = 0;
+        for (const SubmitHandle &h : handles) {
+            if (!h.isValid()) continue;
+            if (!h.isTimeline()) {
+                fences.push_back(h.fence);
+                continue;
             }
-#endif
-
-            if (transferCmdPool_ != VK_NULL_HANDLE) {
-                vkDestroyCommandPool(device_, transferCmdPool_, nullptr);
-                transferCmdPool_ = VK_NULL_HANDLE;
+            if (h.semaphore == computeTimeline_) computeValue = std::max(computeValue, h.value);
+            size_t j = std::find(semaphores.begin(), semaphores.end(), h.semaphore) - semaphores.begin();
+            if (j == semaphores.size()) {
+                semaphores.push_back(h.semaphore);
+                values.push_back(h.value);
+            } else {
+                values[j] = any ? std::min(values[j], h.value) : std::max(values[j], h.value);
             }
-
-            vkDestroyDevice(device_, nullptr);
-            device_ = VK_NULL_HANDLE;
         }
+        if (semaphores.empty() && fences.empty()) return VK_ERROR_UNKNOWN;
+        if (computeValue != 0 && !flushThrough(computeValue)) return VK_ERROR_UNKNOWN;
 
-        tornDown_ = true;
+        VkSemaphoreWaitInfo waitInfo{
+            VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            nullptr,
+            any ? static_cast<VkSemaphoreWaitFlags>(VK_SEMAPHORE_WAIT_ANY_BIT) : 0u,
+            static_cast<uint32_t>(semaphores.size()), semaphores.data(), values.data()
+        };
+        if (fences.empty()) return waitSemaphores_(device_, &waitInfo, timeoutNs);
+        if (semaphores.empty()) {
+            return vkWaitForFences(device_, static_cast<uint32_t>(fences.size()), fences.data(),
+                                   any ? VK_FALSE : VK_TRUE, timeoutNs);
+        }
+
+        // Fences and semaphores cannot share one wait. Only Stream/TaskGraph handles of a
+        // device without timeline support mix with timeline handles, so this path is rare.
+        const auto start = std::chrono::steady_clock::now();
+        auto remaining = [&]() -> uint64_t {
+            if (timeoutNs == UINT64_C(0xFFFFFFFFFFFFFFFF)) return timeoutNs;
+            const uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            return elapsed >= timeoutNs ? 0 : timeoutNs - elapsed;
+        };
+        if (!any) {
+            VkResult result = waitSemaphores_(device_, &waitInfo, timeoutNs);
+            if (result != VK_SUCCESS) return result;
+            return vkWaitForFences(device_, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, remaining());
+        }
+        for (;;) {
+            VkResult result = waitSemaphores_(device_, &waitInfo, 0);
+            if (result != VK_TIMEOUT) return result;
+            result = vkWaitForFences(device_, static_cast<uint32_t>(fences.size()), fences.data(), VK_FALSE, 0);
+            if (result != VK_TIMEOUT) return result;
+            if (remaining() == 0) return VK_TIMEOUT;
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
     }
 
-    bool BufferCreateInfo::validate(std::string &error) const {
-        if (sizeBytes == 0) {
-            error = "Buffer size cannot be zero";
-            return false;
+    bool Device::waitAll(const std::vector<SubmitHandle> &handles, uint64_t timeoutNs) {
+        VkResult result;
+        {
+            WaitScope scope(counters_.get(), tracer_, timeoutNs);
+            result = waitHandles(handles, false, timeoutNs);
         }
-        if (sizeBytes > UINT64_MAX / 2) {
-            error = "Buffer size too large";
-            return false;
+        if (result == VK_TIMEOUT) return false;
+        bool ok = result == VK_SUCCESS;
+        for (const SubmitHandle &h : handles) {
+            // Recycles the pooled fence/command buffer; after a failure, drops them as wait() does
+            if (h.isValid() && h.context != nullptr) ok = wait(h, 0) && ok;
         }
-        return true;
+        return ok;
     }
 
-    // -------- BufferMapping implementation --------------------------------------
-    BufferMapping::BufferMapping() : buf_(nullptr), ptr_(nullptr), offset_(0), length_(0), write_(false) {}
-
-    BufferMapping::~BufferMapping() noexcept {
-        if (buf_ && ptr_) {
-            if (write_) {
-                buf_->flushRange(offset_, length_);
-            }
-#ifdef EASYVK_USE_VMA
-            if (buf_->allocation_ != VK_NULL_HANDLE) {
-                vmaUnmapMemory(buf_->device_->allocator(), buf_->allocation_);
-            } else
-#endif
-            {
-                vkUnmapMemory(buf_->device_->vk(), buf_->memory_);
-            }
+    uint32_t Device::waitAny(const std::vector<SubmitHandle> &handles, uint64_t timeoutNs) {
+        VkResult result;
+        {
+            WaitScope scope(counters_.get(), tracer_, timeoutNs);
+            result = waitHandles(handles, true, timeoutNs);
+        }
+        if (result != VK_SUCCESS) return UINT32_MAX;
+        for (size_t i = 0; i < handles.size(); ++i) {
+            const SubmitHandle &h = handles[i];
+            if (!h.isValid() || !isComplete(h)) continue;
+            if (h.context != nullptr && !wait(h, 0)) return UINT32_MAX;
+            return static_cast<uint32_t>(i);
         }
+        return UINT32_MAX;
     }
 
-    BufferMapping::BufferMapping(BufferMapping &&other) noexcept
-        : buf_(other.buf_),
-          ptr_(other.ptr_),
-          offset_(other.offset_),
-          length_(other.length_),
-          write_(other.write_) {
-        other.buf_ = nullptr;
-        other.ptr_ = nullptr;
+    uint64_t Device::completedValue() const {
+        if (!timelineEnabled_ || computeTimeline_ == VK_NULL_HANDLE) return 0;
+        uint64_t current = 0;
+        if (getSemaphoreCounterValue_(device_, computeTimeline_, &current) != VK_SUCCESS) return 0;
+        return current;
     }
 
-    BufferMapping &BufferMapping::operator=(BufferMapping &&other) noexcept {
-        if (this != &other) {
-            // Clean up current mapping
-            if (buf_ && ptr_) {
-                if (write_) {
-                    buf_->flushRange(offset_, length_);
-                }
-#ifdef EASYVK_USE_VMA
-                if (buf_->allocation_ != VK_NULL_HANDLE) {
-                    vmaUnmapMemory(buf_->device_->allocator(), buf_->allocation_);
-                } else
-#endif
-                {
-                    vkUnmapMemory(buf_->device_->vk(), buf_->memory_);
-                }
-            }
-
-            buf_ = other.buf_;
-            ptr_ = other.ptr_;
-            offset_ = other.offset_;
-            length_ = other.length_;
-            write_ = other.write_;
-
-            other.buf_ = nullptr;
-            other.ptr_ = nullptr;
-        }
-        return *this;
+    bool Device::waitFor(uint64_t value, uint64_t timeoutNs) const {
+        if (!timelineEnabled_ || computeTimeline_ == VK_NULL_HANDLE) return false;
+        if (!flushThrough(value)) return false;
+        VkSemaphoreWaitInfo waitInfo{
+            VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            nullptr,
+            0,
+            1, &computeTimeline_, &value
+        };
+        WaitScope scope(counters_.get(), tracer_, timeoutNs);
+        return waitSemaphores_(device_, &waitInfo, timeoutNs) == VK_SUCCESS;
     }
 
-    // -------- Buffer implementation ----------------------------------------------
-    VkBufferUsageFlags bufferUsageToVk(BufferUsage usage) {
-        VkBufferUsageFlags flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    DeviceStats Device::stats() const {
+        DeviceStats out = DeviceStats();
+        if (!counters_) return out;
+        const DeviceCounters &c = *counters_;
+        out.memoryAllocations = c.memoryAllocations.load();
+        out.memoryAllocationsTotal = c.memoryAllocationsTotal.load();
+        for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i) {
+            out.memoryTypeBytes[i] = c.memoryTypeBytes[i].load();
+        }
+        out.fencesCreated = c.fencesCreated.load();
+        out.commandBuffersAllocated = c.commandBuffersAllocated.load();
+        out.descriptorPoolsCreated = c.descriptorPoolsCreated.load();
+        out.queueSubmits = c.queueSubmits.load();
+        out.hostWaits = c.hostWaits.load();
+        out.hostWaitNs = c.hostWaitNs.load();
+        return out;
+    }
 
-        switch (usage) {
-        case BufferUsage::Storage:
-            flags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-            break;
-        case BufferUsage::Uniform:
-            flags |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-            break;
-        case BufferUsage::Staging:
-            // Just transfer flags
-            break;
-        case BufferUsage::TransferSrc:
-            flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-            break;
-        case BufferUsage::TransferDst:
-            flags = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-            break;
-        }
-        return flags;
+    void Device::resetStats() {
+        if (!counters_) return;
+        DeviceCounters &c = *counters_;
+        c.memoryAllocationsTotal.store(c.memoryAllocations.load());
+        c.fencesCreated.store(0);
+        c.commandBuffersAllocated.store(0);
+        c.descriptorPoolsCreated.store(0);
+        c.queueSubmits.store(0);
+        c.hostWaits.store(0);
+        c.hostWaitNs.store(0);
     }
 
-    Buffer::Buffer(Device &dev, const BufferCreateInfo &info)
-        : device_(&dev),
-          buffer_(VK_NULL_HANDLE),
-          memory_(VK_NULL_HANDLE),
-          size_(info.sizeBytes),
-          memFlags_(0),
-          hostAccess_(info.host),
-          tornDown_(false)
-#ifdef EASYVK_USE_VMA
-          , allocation_(VK_NULL_HANDLE)
-#endif
-    {
-        std::string validationError;
-        if (!info.validate(validationError)) {
-            EVK_FAIL_VOID(validationError);
+    CommandContext *Device::commandContext() {
+        ThreadContextCache &cache = tlsCommandContext;
+        if (cache.context == nullptr || cache.deviceId != id_) {
+            cache.context = contexts_->get(std::this_thread::get_id());
+            cache.deviceId = id_;
+            trimThreadContexts(); // slow path anyway; reclaim released contexts gone idle
         }
+        return cache.context;
+    }
 
-        if (!dev.isValid()) {
-            EVK_FAIL_VOID("Device is not valid");
+    size_t Device::releaseThreadContext() {
+        if (!contexts_) return 0;
+        ThreadContextCache &cache = tlsCommandContext;
+        if (cache.deviceId == id_) {
+            cache.context = nullptr;
+            cache.deviceId = 0;
         }
+        contexts_->retire(std::this_thread::get_id());
+        return trimThreadContexts();
+    }
 
-        VkBufferUsageFlags usage = bufferUsageToVk(info.usage);
+    size_t Device::trimThreadContexts() {
+        if (!contexts_ || contexts_->retiredCount() == 0) return 0;
+        return contexts_->trim(completedValue());
+    }
 
-        // Determine memory properties based on host access
-        if (hostAccess_ == HostAccess::None) {
-            memFlags_ = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        } else {
-            memFlags_ = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-        }
+    VkFence Device::acquireFence() {
+        return commandContext()->acquireFence();
+    }
 
-#ifdef EASYVK_NO_EXCEPTIONS
-        if (!createVkBuffer(&buffer_, &memory_, size_, usage, memFlags_)) {
-            if (hostAccess_ != HostAccess::None && (memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-                // Fall back to cached memory
-                memFlags_ = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
-                if (!createVkBuffer(&buffer_, &memory_, size_, usage, memFlags_)) {
-                    // Fall back to host-visible (non-coherent)
-                    memFlags_ = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-                    if (!createVkBuffer(&buffer_, &memory_, size_, usage, memFlags_)) {
-                        EVK_FAIL_VOID("Failed to create buffer with any memory type");
-                    }
-                }
-            } else {
-                EVK_FAIL_VOID("Failed to create buffer");
-            }
-        }
-#else
-        try {
-            createVkBuffer(&buffer_, &memory_, size_, usage, memFlags_);
-        } catch (const std::runtime_error &) {
-            if (hostAccess_ != HostAccess::None && (memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-                // Fall back to cached memory
-                memFlags_ = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
-                try {
-                    createVkBuffer(&buffer_, &memory_, size_, usage, memFlags_);
-                } catch (const std::runtime_error &) {
-                    // Fall back to host-visible (non-coherent)
-                    memFlags_ = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-                    createVkBuffer(&buffer_, &memory_, size_, usage, memFlags_);
-                }
-            } else {
-                throw; // Rethrow original exception
-            }
-        }
-#endif
+    void Device::releaseFence(VkFence fence, CommandContext *owner) {
+        retireFence(fence);
+        (owner ? owner : commandContext())->releaseFence(fence);
     }
 
-    Buffer::Buffer(Buffer &&other) noexcept
-        : device_(other.device_),
-          buffer_(other.buffer_),
-          memory_(other.memory_),
-          size_(other.size_),
-          memFlags_(other.memFlags_),
-          hostAccess_(other.hostAccess_),
-          tornDown_(other.tornDown_)
-#ifdef EASYVK_USE_VMA
-          , allocation_(other.allocation_)
-#endif
-    {
-        other.buffer_ = VK_NULL_HANDLE;
-        other.memory_ = VK_NULL_HANDLE;
-        other.tornDown_ = true;
-#ifdef EASYVK_USE_VMA
-        other.allocation_ = VK_NULL_HANDLE;
-#endif
+    uint64_t Device::claimFence(VkFence fence) {
+        std::lock_guard<std::mutex> lock(*fenceOwnersLock_);
+        const uint64_t serial = ++fenceSerial_;
+        fenceOwners_[fence] = serial;
+        return serial;
     }
 
-    Buffer &Buffer::operator=(Buffer &&other) noexcept {
-        if (this != &other) {
-            teardown();
-            device_ = other.device_;
-            buffer_ = other.buffer_;
-            memory_ = other.memory_;
-            size_ = other.size_;
-            memFlags_ = other.memFlags_;
-            hostAccess_ = other.hostAccess_;
-            tornDown_ = other.tornDown_;
+    void Device::retireFence(VkFence fence) {
+        if (fence == VK_NULL_HANDLE) return;
+        // Also waits out a waitFenceDependency slice, so the fence is never reset under it
+        std::lock_guard<std::mutex> lock(*fenceOwnersLock_);
+        fenceOwners_.erase(fence);
+    }
 
-#ifdef EASYVK_USE_VMA
-            allocation_ = other.allocation_;
-            other.allocation_ = VK_NULL_HANDLE;
-#endif
+    VkResult Device::waitFenceDependency(const SubmitHandle &h) {
+        // Slices keep submitting threads (which claim fences under the same lock) moving
+        const uint64_t kSliceNs = 1000000;
+        VkResult result;
+        {
+            std::lock_guard<std::mutex> lock(*fenceOwnersLock_);
+            std::map<VkFence, uint64_t>::const_iterator it = fenceOwners_.find(h.fence);
+            if (it == fenceOwners_.end() || it->second != h.value) return VK_SUCCESS;
+            result = vkGetFenceStatus(device_, h.fence);
+        }
+        if (result != VK_NOT_READY) return result;
 
-            other.buffer_ = VK_NULL_HANDLE;
-            other.memory_ = VK_NULL_HANDLE;
-            other.tornDown_ = true;
+        WaitScope scope(counters_.get(), tracer_);
+        for (;;) {
+            std::lock_guard<std::mutex> lock(*fenceOwnersLock_);
+            std::map<VkFence, uint64_t>::const_iterator it = fenceOwners_.find(h.fence);
+            if (it == fenceOwners_.end() || it->second != h.value) return VK_SUCCESS;
+            result = vkWaitForFences(device_, 1, &h.fence, VK_TRUE, kSliceNs);
+            if (result != VK_TIMEOUT) return result;
         }
-        return *this;
     }
 
-    Buffer::~Buffer() noexcept {
-        if (!tornDown_) {
-            teardown();
-        }
+    VkCommandBuffer Device::acquireCommandBuffer() {
+        CommandContext *context = commandContext();
+        return context->acquire(false, context->hasDeferred() ? completedValue() : 0);
     }
 
-    BufferMapping Buffer::mapWrite(VkDeviceSize offsetBytes, VkDeviceSize lengthBytes) {
-        if (lengthBytes == VK_WHOLE_SIZE) {
-            if (offsetBytes >= size_) {
-                EVK_FAIL("Write map offset beyond buffer size");
-            }
-            lengthBytes = size_ - offsetBytes;
-        }
+    void Device::releaseCommandBuffer(VkCommandBuffer cmdBuf, CommandContext *owner) {
+        (owner ? owner : commandContext())->release(cmdBuf, false);
+    }
 
-        if (!validateRange(offsetBytes, lengthBytes, "mapWrite")) {
-            return {};
+    SubmitHandle Device::submitCommands(VkCommandBuffer cmdBuf, bool transient,
+                                        const SubmitHandle *deps, uint32_t depCount,
+                                        CommandContext *owner, VkPipelineStageFlags waitStage) {
+        if (!owner) owner = commandContext();
+
+        // Collect GPU-side waits; fence-only dependencies can only be honored on the host
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<uint64_t> waitValues;
+        std::vector<VkPipelineStageFlags> waitStages;
+        for (uint32_t i = 0; i < depCount; ++i) {
+            const SubmitHandle &dep = deps[i];
+            if (dep.isTimeline()) {
+                waitSemaphores.push_back(dep.semaphore);
+                waitValues.push_back(dep.value);
+                waitStages.push_back(waitStage);
+            } else if (dep.fence != VK_NULL_HANDLE) {
+                EVK_CHECK(waitFenceDependency(dep), "Waiting for a fence dependency failed");
+            }
         }
 
-        if (hostAccess_ == HostAccess::None || (hostAccess_ != HostAccess::Write && hostAccess_ != HostAccess::ReadWrite)) {
-            EVK_FAIL("Buffer does not support write mapping");
-        }
+        if (timelineEnabled_) {
+            // Values must reach the queue in increasing order, so they are handed out under
+            // the queue lock together with the submit
+            uint64_t signalValue = 0;
+            VkTimelineSemaphoreSubmitInfo timelineInfo{
+                VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+                nullptr,
+                static_cast<uint32_t>(waitValues.size()),
+                waitValues.empty() ? nullptr : waitValues.data(),
+                1, &signalValue
+            };
+            VkSubmitInfo submitInfo{
+                VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                &timelineInfo,
+                static_cast<uint32_t>(waitSemaphores.size()),
+                waitSemaphores.empty() ? nullptr : waitSemaphores.data(),
+                waitStages.empty() ? nullptr : waitStages.data(),
+                1, &cmdBuf,
+                1, &computeTimeline_
+            };
 
-        // Map an aligned superset per nonCoherentAtomSize (safe for both coherent and non-coherent)
-        VkDeviceSize atom = device_->limits().nonCoherentAtomSize;
-        VkDeviceSize alignedOff = alignDown(offsetBytes, atom);
-        VkDeviceSize alignedLen = alignUp(lengthBytes + (offsetBytes - alignedOff), atom);
-        // Clamp to allocation size
-        if (alignedOff + alignedLen > size_) alignedLen = size_ - alignedOff;
+            VkResult result;
+            if (coalesceSubmits_) {
+                std::lock_guard<std::mutex> lock(*queueLocks_[0]);
+                signalValue = computeTimelineValue_.load() + 1;
+                computeTimelineValue_.store(signalValue);
+
+                const uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+                if (pendingSubmits_.empty()) oldestPendingNs_ = now;
+                for (size_t i = 0; i < waitSemaphores.size(); ++i) {
+                    pendingWaits_.push_back(PendingWait{waitSemaphores[i], waitValues[i], waitStages[i]});
+                }
+                pendingSubmits_.push_back(PendingSubmit{cmdBuf, signalValue, static_cast<uint32_t>(waitSemaphores.size())});
 
-        void *base = nullptr;
-#ifdef EASYVK_USE_VMA
-        if (allocation_ != VK_NULL_HANDLE) {
-            // VMA maps the entire allocation starting at offset 0
-            VkResult result = vmaMapMemory(device_->allocator(), allocation_, &base);
-            if (result != VK_SUCCESS) {
-                EVK_FAIL("Failed to map VMA buffer for writing");
+                result = VK_SUCCESS;
+                if (pendingSubmits_.size() >= coalesceMaxPending_ || now - oldestPendingNs_ >= coalesceMaxLatencyNs_) {
+                    result = flushPendingLocked();
+                }
+                if (result != VK_SUCCESS) {
+                    // The whole queued group is lost with the device; report it here
+                    EVK_CHECK(result, "vkQueueSubmit (coalesced) failed");
+                }
+            } else {
+                std::lock_guard<std::mutex> lock(*queueLocks_[0]);
+                signalValue = computeTimelineValue_.load() + 1;
+                ++counters_->queueSubmits;
+                result = vkQueueSubmit(queue_, 1, &submitInfo, VK_NULL_HANDLE);
+                if (result == VK_SUCCESS) {
+                    computeTimelineValue_.store(signalValue);
+                    flushedValue_.store(signalValue);
+                }
             }
-            void *userPtr = static_cast<char *>(base) + offsetBytes;
-            return {this, userPtr, alignedOff, alignedLen, true};
-        } else
-#endif
-        {
-            // Raw Vulkan maps [alignedOff, alignedOff+alignedLen)
-            VkResult result = vkMapMemory(device_->vk(), memory_, alignedOff, alignedLen, 0, &base);
             if (result != VK_SUCCESS) {
-                EVK_FAIL("Failed to map buffer for writing");
+                if (transient) releaseCommandBuffer(cmdBuf, owner);
+                EVK_CHECK(result, "vkQueueSubmit failed");
             }
-            void *userPtr = static_cast<char *>(base) + (offsetBytes - alignedOff);
-            return {this, userPtr, alignedOff, alignedLen, true};
+
+            SubmitHandle handle;
+            handle.cmdBuf = transient ? cmdBuf : VK_NULL_HANDLE;
+            handle.semaphore = computeTimeline_;
+            handle.value = signalValue;
+            handle.context = owner;
+            handle.device = this;
+            return handle;
+        }
+
+        VkFence fence = owner->acquireFence();
+
+        VkSubmitInfo submitInfo{
+            VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            nullptr,
+            0, nullptr, nullptr,
+            1, &cmdBuf,
+            0, nullptr
+        };
+
+        VkResult result;
+        {
+            std::lock_guard<std::mutex> lock(*queueLocks_[0]);
+            ++counters_->queueSubmits;
+            result = vkQueueSubmit(queue_, 1, &submitInfo, fence);
         }
+        if (result != VK_SUCCESS) {
+            owner->releaseFence(fence);
+            if (transient) releaseCommandBuffer(cmdBuf, owner);
+            EVK_CHECK(result, "vkQueueSubmit failed");
+        }
+        SubmitHandle handle{fence, transient ? cmdBuf : VK_NULL_HANDLE};
+        handle.value = claimFence(fence);
+        handle.context = owner;
+        handle.device = this;
+        return handle;
     }
 
-    BufferMapping Buffer::mapRead(VkDeviceSize offsetBytes, VkDeviceSize lengthBytes) {
-        if (lengthBytes == VK_WHOLE_SIZE) {
-            if (offsetBytes >= size_) {
-                EVK_FAIL("Read map offset beyond buffer size");
+    VkResult Device::flushPendingLocked() const {
+        if (pendingSubmits_.empty()) return VK_SUCCESS;
+
+        const uint32_t count = static_cast<uint32_t>(pendingSubmits_.size());
+        VkResult result;
+        PFN_vkQueueSubmit2 queueSubmit2 = sync2Enabled_ ? (vkQueueSubmit2 ? vkQueueSubmit2 : vkQueueSubmit2KHR) : nullptr;
+        if (queueSubmit2) {
+            std::vector<VkSemaphoreSubmitInfo> waits(pendingWaits_.size());
+            for (size_t i = 0; i < pendingWaits_.size(); ++i) {
+                waits[i] = VkSemaphoreSubmitInfo{
+                    VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr,
+                    pendingWaits_[i].semaphore, pendingWaits_[i].value,
+                    static_cast<VkPipelineStageFlags2>(pendingWaits_[i].stage), 0
+                };
             }
-            lengthBytes = size_ - offsetBytes;
+            std::vector<VkCommandBufferSubmitInfo> cmdInfos(count);
+            std::vector<VkSemaphoreSubmitInfo> signals(count);
+            std::vector<VkSubmitInfo2> submits(count);
+            uint32_t firstWait = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                const PendingSubmit &pending = pendingSubmits_[i];
+                cmdInfos[i] = VkCommandBufferSubmitInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO, nullptr, pending.cmdBuf, 0};
+                signals[i] = VkSemaphoreSubmitInfo{
+                    VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr,
+                    computeTimeline_, pending.signalValue,
+                    VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 0
+                };
+                submits[i] = VkSubmitInfo2{
+                    VK_STRUCTURE_TYPE_SUBMIT_INFO_2, nullptr, 0,
+                    pending.waitCount, pending.waitCount ? waits.data() + firstWait : nullptr,
+                    1, &cmdInfos[i],
+                    1, &signals[i]
+                };
+                firstWait += pending.waitCount;
+            }
+            ++counters_->queueSubmits;
+            result = queueSubmit2(queue_, count, submits.data(), VK_NULL_HANDLE);
+        } else {
+            std::vector<VkSemaphore> waitSemaphores(pendingWaits_.size());
+            std::vector<uint64_t> waitValues(pendingWaits_.size());
+            std::vector<VkPipelineStageFlags> waitStages(pendingWaits_.size());
+            for (size_t i = 0; i < pendingWaits_.size(); ++i) {
+                waitSemaphores[i] = pendingWaits_[i].semaphore;
+                waitValues[i] = pendingWaits_[i].value;
+                waitStages[i] = pendingWaits_[i].stage;
+            }
+            std::vector<VkTimelineSemaphoreSubmitInfo> timelineInfos(count);
+            std::vector<VkSubmitInfo> submits(count);
+            uint32_t firstWait = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                const PendingSubmit &pending = pendingSubmits_[i];
+                timelineInfos[i] = VkTimelineSemaphoreSubmitInfo{
+                    VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO, nullptr,
+                    pending.waitCount, pending.waitCount ? waitValues.data() + firstWait : nullptr,
+                    1, &pending.signalValue
+                };
+                submits[i] = VkSubmitInfo{
+                    VK_STRUCTURE_TYPE_SUBMIT_INFO, &timelineInfos[i],
+                    pending.waitCount,
+                    pending.waitCount ? waitSemaphores.data() + firstWait : nullptr,
+                    pending.waitCount ? waitStages.data() + firstWait : nullptr,
+                    1, &pending.cmdBuf,
+                    1, &computeTimeline_
+                };
+                firstWait += pending.waitCount;
+            }
+            ++counters_->queueSubmits;
+            result = vkQueueSubmit(queue_, count, submits.data(), VK_NULL_HANDLE);
         }
 
-        if (!validateRange(offsetBytes, lengthBytes, "mapRead")) {
-            return {};
+        if (result == VK_SUCCESS) {
+            flushedValue_.store(pendingSubmits_.back().signalValue);
         }
+        pendingSubmits_.clear();
+        pendingWaits_.clear();
+        return result;
+    }
 
-        if (hostAccess_ == HostAccess::None || (hostAccess_ != HostAccess::Read && hostAccess_ != HostAccess::ReadWrite)) {
-            EVK_FAIL("Buffer does not support read mapping");
+    bool Device::flushThrough(uint64_t value) const {
+        if (!coalesceSubmits_ || value <= flushedValue_.load()) return true;
+        std::lock_guard<std::mutex> lock(*queueLocks_[0]);
+        return flushPendingLocked() == VK_SUCCESS;
+    }
+
+    bool Device::flush() {
+        if (!coalesceSubmits_) return true;
+        VkResult result;
+        {
+            std::lock_guard<std::mutex> lock(*queueLocks_[0]);
+            result = flushPendingLocked();
         }
+        EVK_CHECK(result, "vkQueueSubmit (coalesced) failed");
+        return true;
+    }
 
-        // Map an aligned superset (see spec VUs for nonCoherentAtomSize alignment)
-        VkDeviceSize atom = device_->limits().nonCoherentAtomSize;
-        VkDeviceSize alignedOff = alignDown(offsetBytes, atom);
-        VkDeviceSize alignedLen = alignUp(lengthBytes + (offsetBytes - alignedOff), atom);
-        if (alignedOff + alignedLen > size_) alignedLen = size_ - alignedOff;
+    bool Device::submitPerformancePass(VkCommandBuffer cmdBuf, uint32_t passIndex) {
+        VkPerformanceQuerySubmitInfoKHR passInfo{
+            VK_STRUCTURE_TYPE_PERFORMANCE_QUERY_SUBMIT_INFO_KHR,
+            nullptr,
+            passIndex
+        };
+        VkSubmitInfo submitInfo{
+            VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            &passInfo,
+            0, nullptr, nullptr,
+            1, &cmdBuf,
+            0, nullptr
+        };
 
-        void *base = nullptr;
-#ifdef EASYVK_USE_VMA
-        if (allocation_ != VK_NULL_HANDLE) {
-            // VMA maps the entire allocation
-            VkResult result = vmaMapMemory(device_->allocator(), allocation_, &base);
-            if (result != VK_SUCCESS) {
-                EVK_FAIL("Failed to map VMA buffer for reading");
-            }
-            void *userPtr = static_cast<char *>(base) + offsetBytes;
-            // For non-coherent memory: invalidate the mapped span
-            if (!(memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-                invalidateRange(alignedOff, alignedLen);
-            }
-            return {this, userPtr, alignedOff, alignedLen, false};
-        } else
-#endif
+        VkFence fence = acquireFence();
+        VkResult result;
         {
-            // Raw Vulkan maps the aligned subrange
-            VkResult result = vkMapMemory(device_->vk(), memory_, alignedOff, alignedLen, 0, &base);
-            if (result != VK_SUCCESS) {
-                EVK_FAIL("Failed to map buffer for reading");
+            std::lock_guard<std::mutex> lock(*queueLocks_[0]);
+            result = coalesceSubmits_ ? flushPendingLocked() : VK_SUCCESS;
+            if (result == VK_SUCCESS) {
+                ++counters_->queueSubmits;
+                result = vkQueueSubmit(queue_, 1, &submitInfo, fence);
             }
-            void *userPtr = static_cast<char *>(base) + (offsetBytes - alignedOff);
-            if (!(memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-                invalidateRange(alignedOff, alignedLen);
-            }
-            return {this, userPtr, alignedOff, alignedLen, false};
         }
+        const bool submitted = result == VK_SUCCESS;
+        if (submitted) {
+            WaitScope scope(counters_.get(), tracer_);
+            result = vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
+        }
+        // A fence that may still be pending must not be reset
+        if (!submitted || result == VK_SUCCESS) {
+            releaseFence(fence);
+        }
+        EVK_CHECK(result, "vkQueueSubmit (performance query pass) failed");
+        return true;
     }
 
-    bool Buffer::copyTo(Buffer &dst, VkDeviceSize bytes, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
-        if (bytes == VK_WHOLE_SIZE) {
-            if (srcOffset >= size_) {
-                EVK_FAIL("Copy source offset beyond buffer size");
-            }
-            bytes = std::min(size_ - srcOffset, dst.size_ - dstOffset);
-        }
+    uint32_t Device::pendingSubmissions() const {
+        if (!coalesceSubmits_) return 0;
+        std::lock_guard<std::mutex> lock(*queueLocks_[0]);
+        return static_cast<uint32_t>(pendingSubmits_.size());
+    }
 
-        if (!validateRange(srcOffset, bytes, "copyTo source")) {
-            return false;
-        }
-        if (!dst.validateRange(dstOffset, bytes, "copyTo destination")) {
-            return false;
+    VkCommandBuffer Device::acquireTransferQueueCommandBuffer() {
+        CommandContext *context = commandContext();
+        return context->acquire(true, context->hasDeferred() ? completedValue() : 0);
+    }
+
+    void Device::releaseTransferQueueCommandBuffer(VkCommandBuffer cmdBuf) {
+        commandContext()->release(cmdBuf, true);
+    }
+
+    void Device::deferCommandBuffer(VkCommandBuffer cmdBuf, bool transferFamily, uint64_t value) {
+        commandContext()->defer(cmdBuf, transferFamily, value);
+    }
+
+    namespace {
+        // Whole-buffer queue family ownership transfer barrier (used for both the release
+        // and the matching acquire half, which must describe the same range and families)
+        VkBufferMemoryBarrier ownershipBarrier(VkBuffer buffer, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                                               uint32_t srcFamily, uint32_t dstFamily) {
+            return VkBufferMemoryBarrier{
+                VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                nullptr,
+                srcAccess,
+                dstAccess,
+                srcFamily,
+                dstFamily,
+                buffer,
+                0,
+                VK_WHOLE_SIZE
+            };
         }
 
-        VkCommandBufferAllocateInfo allocInfo{
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            nullptr,
-            device_->transferCmdPool_,
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            1
+        // One buffer range (a null buffer means all memory) made available from src to dst.
+        // Legacy stage/access bits have the same values as their synchronization2
+        // counterparts, so the same description feeds either barrier entry point.
+        struct RangeBarrier {
+            VkBuffer buffer;
+            VkDeviceSize offset, size;
+            VkPipelineStageFlags srcStage, dstStage;
+            VkAccessFlags srcAccess, dstAccess;
         };
 
-        VkCommandBuffer cmdBuf;
-        VK_CHECK(vkAllocateCommandBuffers(device_->vk(), &allocInfo, &cmdBuf));
+        // Bound ranges beyond this are cheaper to cover with a single global barrier
+        const size_t kMaxRangeBarriers = 16;
+
+        VkDeviceSize rangeEnd(VkDeviceSize offset, VkDeviceSize size) {
+            return size == VK_WHOLE_SIZE ? std::numeric_limits<VkDeviceSize>::max() : offset + size;
+        }
+
+        void recordBarriers(const Device &dev, VkCommandBuffer cmd, const RangeBarrier *barriers, size_t count) {
+            if (count == 0) return;
+
+            PFN_vkCmdPipelineBarrier2 pipelineBarrier2 =
+                dev.synchronization2Enabled() ? (vkCmdPipelineBarrier2 ? vkCmdPipelineBarrier2 : vkCmdPipelineBarrier2KHR)
+                                              : nullptr;
+            if (pipelineBarrier2) {
+                // Per-barrier stage masks: unrelated ranges do not widen each other's scopes
+                std::vector<VkMemoryBarrier2> memory;
+                std::vector<VkBufferMemoryBarrier2> buffers;
+                for (size_t i = 0; i < count; ++i) {
+                    const RangeBarrier &b = barriers[i];
+                    if (b.buffer == VK_NULL_HANDLE) {
+                        memory.push_back(VkMemoryBarrier2{
+                            VK_STRUCTURE_TYPE_MEMORY_BARRIER_2, nullptr,
+                            b.srcStage, b.srcAccess, b.dstStage, b.dstAccess
+                        });
+                    } else {
+                        buffers.push_back(VkBufferMemoryBarrier2{
+                            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2, nullptr,
+                            b.srcStage, b.srcAccess, b.dstStage, b.dstAccess,
+                            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                            b.buffer, b.offset, b.size
+                        });
+                    }
+                }
+                VkDependencyInfo dependency{
+                    VK_STRUCTURE_TYPE_DEPENDENCY_INFO, nullptr, 0,
+                    static_cast<uint32_t>(memory.size()), memory.empty() ? nullptr : memory.data(),
+                    static_cast<uint32_t>(buffers.size()), buffers.empty() ? nullptr : buffers.data(),
+                    0, nullptr
+                };
+                pipelineBarrier2(cmd, &dependency);
+                return;
+            }
 
-        VkCommandBufferBeginInfo beginInfo{
+            VkPipelineStageFlags srcStages = 0;
+            VkPipelineStageFlags dstStages = 0;
+            VkMemoryBarrier memory{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, 0, 0};
+            bool global = false;
+            std::vector<VkBufferMemoryBarrier> buffers;
+            for (size_t i = 0; i < count; ++i) {
+                const RangeBarrier &b = barriers[i];
+                srcStages |= b.srcStage;
+                dstStages |= b.dstStage;
+                if (b.buffer == VK_NULL_HANDLE) {
+                    memory.srcAccessMask |= b.srcAccess;
+                    memory.dstAccessMask |= b.dstAccess;
+                    global = true;
+                } else {
+                    buffers.push_back(VkBufferMemoryBarrier{
+                        VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, nullptr,
+                        b.srcAccess, b.dstAccess,
+                        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                        b.buffer, b.offset, b.size
+                    });
+                }
+            }
+            vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0,
+                                 global ? 1u : 0u, global ? &memory : nullptr,
+                                 static_cast<uint32_t>(buffers.size()), buffers.empty() ? nullptr : buffers.data(),
+                                 0, nullptr);
+        }
+    }
+
+    SubmitHandle Device::copyOnTransferQueue(Buffer &src, Buffer &dst, const VkBufferCopy &region) {
+        const uint32_t computeFamily = queueFamilyIndex_;
+        const uint32_t transferFamily = transferQueueFamilyIndex_;
+        const VkCommandBufferBeginInfo beginInfo{
             VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
             nullptr,
             VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
             nullptr
         };
-        VK_CHECK(vkBeginCommandBuffer(cmdBuf, &beginInfo));
+        // Stages that consume the buffers once they are back on the compute queue
+        const VkPipelineStageFlags computeStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+        VkBuffer buffers[2] = {src.vk(), dst.vk()};
+        const uint32_t bufferCount = src.vk() == dst.vk() ? 1u : 2u;
+        VkBufferMemoryBarrier barriers[2];
+
+        // Transfer queue: acquire, copy (unless rolling back), release back to compute
+        auto recordTransfer = [&](VkCommandBuffer cmd, bool copy) {
+            VkResult result = vkBeginCommandBuffer(cmd, &beginInfo);
+            if (result != VK_SUCCESS) return result;
+            for (uint32_t i = 0; i < bufferCount; ++i) {
+                barriers[i] = ownershipBarrier(buffers[i], 0, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                                               computeFamily, transferFamily);
+            }
+            vkCmdPipelineBarrier(cmd,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 0, nullptr, bufferCount, barriers, 0, nullptr);
+            if (copy) {
+                vkCmdCopyBuffer(cmd, src.vk(), dst.vk(), 1, &region);
+            }
+            for (uint32_t i = 0; i < bufferCount; ++i) {
+                barriers[i] = ownershipBarrier(buffers[i], copy ? static_cast<VkAccessFlags>(VK_ACCESS_TRANSFER_WRITE_BIT) : 0, 0,
+                                               transferFamily, computeFamily);
+            }
+            vkCmdPipelineBarrier(cmd,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 0, 0, nullptr, bufferCount, barriers, 0, nullptr);
+            return vkEndCommandBuffer(cmd);
+        };
 
-        VkBufferCopy copyRegion{srcOffset, dstOffset, bytes};
-        vkCmdCopyBuffer(cmdBuf, buffer_, dst.buffer_, 1, &copyRegion);
-        VK_CHECK(vkEndCommandBuffer(cmdBuf));
+        // Record all three steps before submitting any, so a recording failure leaves the
+        // buffers with the compute queue
+        VkCommandBuffer releaseCmd = acquireCommandBuffer();
+        VkCommandBuffer copyCmd = acquireTransferQueueCommandBuffer();
+        VkCommandBuffer acquireCmd = acquireCommandBuffer();
+
+        // 1. Compute queue: release both buffers after any earlier shader/transfer writes
+        VkResult result = vkBeginCommandBuffer(releaseCmd, &beginInfo);
+        if (result == VK_SUCCESS) {
+            for (uint32_t i = 0; i < bufferCount; ++i) {
+                barriers[i] = ownershipBarrier(buffers[i], VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+                                               computeFamily, transferFamily);
+            }
+            vkCmdPipelineBarrier(releaseCmd,
+                                 computeStages,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 0, 0, nullptr, bufferCount, barriers, 0, nullptr);
+            result = vkEndCommandBuffer(releaseCmd);
+        }
+
+        // 2. Transfer queue
+        if (result == VK_SUCCESS) result = recordTransfer(copyCmd, true);
+
+        // 3. Compute queue: wait for the copy, re-acquire both buffers for shaders, later
+        //    transfers and host reads after Device::wait
+        if (result == VK_SUCCESS) result = vkBeginCommandBuffer(acquireCmd, &beginInfo);
+        if (result == VK_SUCCESS) {
+            for (uint32_t i = 0; i < bufferCount; ++i) {
+                barriers[i] = ownershipBarrier(buffers[i], 0,
+                                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                                               VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                               VK_ACCESS_HOST_READ_BIT,
+                                               transferFamily, computeFamily);
+            }
+            // Chained to the semaphore wait, which covers exactly these stages
+            vkCmdPipelineBarrier(acquireCmd,
+                                 computeStages,
+                                 computeStages | VK_PIPELINE_STAGE_HOST_BIT,
+                                 0, 0, nullptr, bufferCount, barriers, 0, nullptr);
+            result = vkEndCommandBuffer(acquireCmd);
+        }
 
-        VkFence fence;
-        VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
-        VK_CHECK(vkCreateFence(device_->vk(), &fenceInfo, nullptr, &fence));
+        if (result != VK_SUCCESS) {
+            releaseCommandBuffer(releaseCmd);
+            releaseTransferQueueCommandBuffer(copyCmd);
+            releaseCommandBuffer(acquireCmd);
+            VK_CHECK(result);
+        }
+
+        SubmitHandle released = submitCommands(releaseCmd, false);
+        if (!released.isValid()) {
+            releaseCommandBuffer(releaseCmd);
+            releaseTransferQueueCommandBuffer(copyCmd);
+            releaseCommandBuffer(acquireCmd);
+            return SubmitHandle();
+        }
 
+        uint64_t copyValue = 0;
+        const VkPipelineStageFlags copyWaitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        VkTimelineSemaphoreSubmitInfo timelineInfo{
+            VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            nullptr,
+            1, &released.value,
+            1, &copyValue
+        };
         VkSubmitInfo submitInfo{
             VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            nullptr,
-            0, nullptr, nullptr,
-            1, &cmdBuf,
-            0, nullptr
+            &timelineInfo,
+            1, &computeTimeline_, &copyWaitStage,
+            1, &copyCmd,
+            1, &transferTimeline_
+        };
+        auto submitTransfer = [&]() {
+            std::lock_guard<std::mutex> lock(*transferQueueLock_);
+            copyValue = transferTimelineValue_ + 1;
+            ++counters_->queueSubmits;
+            VkResult submitted = vkQueueSubmit(transferQueue_, 1, &submitInfo, VK_NULL_HANDLE);
+            if (submitted == VK_SUCCESS) transferTimelineValue_ = copyValue;
+            return submitted;
         };
 
-        VK_CHECK(vkQueueSubmit(device_->queue_, 1, &submitInfo, fence));
-        VkResult result = vkWaitForFences(device_->vk(), 1, &fence, VK_TRUE, UINT64_MAX);
+        result = submitTransfer();
+        if (result != VK_SUCCESS) {
+            // The release already went out: hand the buffers straight back to the compute queue
+            // (no copy) so they stay usable there, then report the failure
+            VkResult rollback = vkResetCommandBuffer(copyCmd, 0);
+            if (rollback == VK_SUCCESS) rollback = recordTransfer(copyCmd, false);
+            if (rollback == VK_SUCCESS) rollback = submitTransfer();
+            deferCommandBuffer(releaseCmd, false, released.value);
+            if (rollback == VK_SUCCESS) {
+                SubmitHandle returned;
+                returned.semaphore = transferTimeline_;
+                returned.value = copyValue;
+                SubmitHandle handle = submitCommands(acquireCmd, true, &returned, 1, nullptr, computeStages);
+                deferCommandBuffer(copyCmd, true, handle.isValid() ? handle.value : released.value);
+                if (handle.isValid()) wait(handle);
+            } else {
+                // The transfer queue is unusable too: the buffers' contents are undefined now
+                releaseTransferQueueCommandBuffer(copyCmd);
+                releaseCommandBuffer(acquireCmd);
+            }
+            EVK_CHECK(result, "vkQueueSubmit (transfer) failed");
+        }
 
-        vkDestroyFence(device_->vk(), fence, nullptr);
-        vkFreeCommandBuffers(device_->vk(), device_->transferCmdPool_, 1, &cmdBuf);
+        SubmitHandle copied;
+        copied.semaphore = transferTimeline_;
+        copied.value = copyValue;
+        SubmitHandle handle = submitCommands(acquireCmd, true, &copied, 1, nullptr, computeStages);
 
-        return result == VK_SUCCESS;
+        // The release and copy command buffers retire together with the acquire
+        deferCommandBuffer(releaseCmd, false, released.value);
+        deferCommandBuffer(copyCmd, true, handle.value);
+        return handle;
     }
 
-    SubmitHandle Buffer::copyToAsync(Buffer &dst, VkDeviceSize bytes, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
-        if (bytes == VK_WHOLE_SIZE) {
-            if (srcOffset >= size_) {
-                EVK_FAIL("Copy source offset beyond buffer size");
+    uint32_t Device::selectMemory(uint32_t memoryTypeBits, VkMemoryPropertyFlags flags) {
+        for (uint32_t i = 0; i < memProperties_.memoryTypeCount; i++) {
+            if ((memoryTypeBits & (1u << i)) &&
+                ((flags & memProperties_.memoryTypes[i].propertyFlags) == flags)) {
+                return i;
             }
-            bytes = std::min(size_ - srcOffset, dst.size_ - dstOffset);
         }
+#ifdef EASYVK_NO_EXCEPTIONS
+        lastError_ = "Failed to find suitable memory type";
+        return UINT32_MAX;
+#else
+        throw std::runtime_error("Failed to find suitable memory type");
+#endif
+    }
 
-        if (!validateRange(srcOffset, bytes, "copyToAsync source")) {
-            return {};
+    namespace {
+        // Legacy (non-resizable) BAR apertures are 256 MiB
+        const VkDeviceSize kSmallBarHeapBytes = 256ull * 1024 * 1024;
+
+        // Score one memory type for a host access intent; < 0 means unusable
+        int scoreMemoryType(const VkPhysicalDeviceMemoryProperties &props, uint32_t index, HostAccess access,
+                            VkDeviceSize sizeBytes, bool unifiedMemory) {
+            const VkMemoryPropertyFlags f = props.memoryTypes[index].propertyFlags;
+            const VkDeviceSize heapSize = props.memoryHeaps[props.memoryTypes[index].heapIndex].size;
+            const bool deviceLocal = (f & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+            const bool hostVisible = (f & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+            const bool coherent = (f & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+            const bool cached = (f & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+
+            if (f & (VK_MEMORY_PROPERTY_PROTECTED_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) return -1;
+
+            int score = 0;
+            // Device-uncached AMD types exist for special interop; only as a last resort
+            if (f & (VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD | VK_MEMORY_PROPERTY_DEVICE_UNCACHED_BIT_AMD)) {
+                score -= 50;
+            }
+
+            switch (access) {
+            case HostAccess::None:
+                if (deviceLocal) score += 100;
+                // Leave the BAR window to buffers the host actually maps
+                if (hostVisible && !unifiedMemory) score -= 10;
+                break;
+            case HostAccess::Write:
+                if (!hostVisible) return -1;
+                // ReBAR/UMA: the host writes straight into memory kernels read at full speed
+                if (deviceLocal && (unifiedMemory || heapSize > kSmallBarHeapBytes || sizeBytes <= heapSize / 16)) {
+                    score += 40;
+                }
+                if (coherent) score += 20;
+                if (cached) score -= 5; // write-combined suits streaming writes
+                break;
+            case HostAccess::Read:
+                if (!hostVisible) return -1;
+                if (cached) score += 60;
+                if (coherent) score += 10;
+                if (deviceLocal && !cached && !unifiedMemory) score -= 30; // uncached reads over PCIe
+                break;
+            case HostAccess::ReadWrite:
+                if (!hostVisible) return -1;
+                if (cached) score += 40;
+                if (coherent) score += 20;
+                if (deviceLocal && unifiedMemory) score += 10;
+                break;
+            }
+            return score + 1000; // keep usable scores non-negative
         }
-        if (!dst.validateRange(dstOffset, bytes, "copyToAsync destination")) {
-            return {};
+    }
+
+    std::vector<uint32_t> Device::rankMemoryTypes(uint32_t memoryTypeBits, HostAccess access, VkDeviceSize sizeBytes) const {
+        std::vector<std::pair<int, uint32_t>> scored;
+        for (uint32_t i = 0; i < memProperties_.memoryTypeCount; i++) {
+            if (!(memoryTypeBits & (1u << i))) continue;
+            int score = scoreMemoryType(memProperties_, i, access, sizeBytes, unifiedMemory_);
+            if (score >= 0) scored.push_back(std::make_pair(score, i));
+        }
+        // Highest score first; ties keep the driver's (performance-ordered) type order
+        std::stable_sort(scored.begin(), scored.end(),
+                         [](const std::pair<int, uint32_t> &a, const std::pair<int, uint32_t> &b) {
+                             return a.first > b.first;
+                         });
+
+        std::vector<uint32_t> ranked;
+        ranked.reserve(scored.size());
+        for (const auto &entry : scored) {
+            ranked.push_back(entry.second);
+        }
+        return ranked;
+    }
+
+    uint32_t Device::selectMemory(uint32_t memoryTypeBits, HostAccess access, VkDeviceSize sizeBytes) const {
+        std::vector<uint32_t> ranked = rankMemoryTypes(memoryTypeBits, access, sizeBytes);
+        return ranked.empty() ? UINT32_MAX : ranked.front();
+    }
+
+    const char *Device::vendorName() const {
+        return vkVendorName(properties_.vendorID);
+    }
+
+    void Device::teardown() {
+        if (tornDown_) return;
+
+        if (device_ != VK_NULL_HANDLE) {
+            if (coalesceSubmits_) flush();
+            vkDeviceWaitIdle(device_);
+
+            // Attached objects own Vulkan handles of this device; release them (each
+            // detaches itself) while it is still alive
+            if (pipelineCache_ && pipelineCache_->device_ == this) pipelineCache_->teardown();
+            if (profiler_ && profiler_->device_ == this) profiler_->teardown();
+            pipelineCache_ = nullptr;
+            profiler_ = nullptr;
+
+            // Staging buffer memory may come from VMA or the arena, so release it first
+            staging_.reset();
+            arena_.reset();
+            shaderModules_.reset();
+
+#ifdef EASYVK_USE_VMA
+            if (allocator_ != VK_NULL_HANDLE) {
+                vmaDestroyAllocator(allocator_);
+                allocator_ = VK_NULL_HANDLE;
+            }
+#endif
+
+            // Per-thread pools and fences
+            contexts_.reset();
+
+            if (computeTimeline_ != VK_NULL_HANDLE) {
+                vkDestroySemaphore(device_, computeTimeline_, nullptr);
+                computeTimeline_ = VK_NULL_HANDLE;
+            }
+            if (transferTimeline_ != VK_NULL_HANDLE) {
+                vkDestroySemaphore(device_, transferTimeline_, nullptr);
+                transferTimeline_ = VK_NULL_HANDLE;
+            }
+
+            vkDestroyDevice(device_, nullptr);
+            device_ = VK_NULL_HANDLE;
         }
 
-        VkCommandBufferAllocateInfo allocInfo{
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            nullptr,
-            device_->transferCmdPool_,
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            1
+        tornDown_ = true;
+    }
+
+    // -------- DeviceChildRef implementation -------------------------------------
+    DeviceChildRef::DeviceChildRef(Device &dev) : counters_(dev.counters_.get()) {
+        if (counters_) ++counters_->liveChildren;
+    }
+
+    DeviceChildRef::~DeviceChildRef() noexcept {
+        if (counters_) --counters_->liveChildren;
+    }
+
+    DeviceChildRef &DeviceChildRef::operator=(DeviceChildRef &&other) noexcept {
+        if (this != &other) {
+            if (counters_) --counters_->liveChildren;
+            counters_ = other.counters_;
+            other.counters_ = nullptr;
+        }
+        return *this;
+    }
+
+    // -------- PipelineCache implementation --------------------------------------
+    namespace {
+        // On-disk header preceding the raw VkPipelineCache blob.
+        struct PipelineCacheFileHeader {
+            char magic[8];            // "EVKPCACH"
+            uint32_t version;         // file format version
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint32_t driverVersion;
+            uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+            uint8_t deviceUUID[VK_UUID_SIZE];
+            uint8_t driverUUID[VK_UUID_SIZE];
+            uint64_t dataSize;        // bytes of cache data following the header
+            uint64_t dataHash;        // FNV-1a over the cache data
         };
 
-        VkCommandBuffer cmdBuf;
-        VK_CHECK(vkAllocateCommandBuffers(device_->vk(), &allocInfo, &cmdBuf));
+        const char kPipelineCacheMagic[8] = {'E', 'V', 'K', 'P', 'C', 'A', 'C', 'H'};
+        const uint32_t kPipelineCacheFileVersion = 1;
 
-        VkCommandBufferBeginInfo beginInfo{
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        uint64_t fnv1a64(const uint8_t *data, size_t size) {
+            uint64_t hash = UINT64_C(0xcbf29ce484222325);
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= data[i];
+                hash *= UINT64_C(0x100000001b3);
+            }
+            return hash;
+        }
+
+        void fillPipelineCacheHeader(const Device &dev, PipelineCacheFileHeader &h) {
+            std::memset(&h, 0, sizeof(h));
+            std::memcpy(h.magic, kPipelineCacheMagic, sizeof(h.magic));
+            h.version = kPipelineCacheFileVersion;
+            h.vendorID = dev.properties().vendorID;
+            h.deviceID = dev.properties().deviceID;
+            h.driverVersion = dev.properties().driverVersion;
+            std::memcpy(h.pipelineCacheUUID, dev.properties().pipelineCacheUUID, VK_UUID_SIZE);
+            std::memcpy(h.deviceUUID, dev.deviceUUID(), VK_UUID_SIZE);
+            std::memcpy(h.driverUUID, dev.driverUUID(), VK_UUID_SIZE);
+        }
+    } // namespace
+
+    PipelineCache::PipelineCache() : device_(nullptr), cache_(VK_NULL_HANDLE), tornDown_(false) {}
+
+    PipelineCache::PipelineCache(Device &dev, const char *path)
+        : device_(&dev), childRef_(dev), cache_(VK_NULL_HANDLE), tornDown_(false) {
+        if (!dev.isValid()) {
+            EVK_FAIL_VOID("Device is not valid");
+        }
+
+        VkPipelineCacheCreateInfo createInfo{
+            VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
             nullptr,
-            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            0,
+            0,
             nullptr
         };
-        VK_CHECK(vkBeginCommandBuffer(cmdBuf, &beginInfo));
+        VK_CHECK(vkCreatePipelineCache(device_->vk(), &createInfo, nullptr, &cache_));
 
-        VkBufferCopy copyRegion{srcOffset, dstOffset, bytes};
-        vkCmdCopyBuffer(cmdBuf, buffer_, dst.buffer_, 1, &copyRegion);
-        VK_CHECK(vkEndCommandBuffer(cmdBuf));
+        if (path) {
+            load(path);
+        }
+    }
 
-        VkFence fence;
-        VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
-        VK_CHECK(vkCreateFence(device_->vk(), &fenceInfo, nullptr, &fence));
+    PipelineCache::PipelineCache(PipelineCache &&other) noexcept
+        : device_(other.device_), childRef_(std::move(other.childRef_)), cache_(other.cache_), tornDown_(other.tornDown_) {
+        if (device_ && device_->pipelineCache() == &other) {
+            device_->setPipelineCache(this);
+        }
+        other.cache_ = VK_NULL_HANDLE;
+        other.tornDown_ = true;
+    }
 
-        VkSubmitInfo submitInfo{
-            VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            nullptr,
-            0, nullptr, nullptr,
-            1, &cmdBuf,
-            0, nullptr
-        };
+    PipelineCache &PipelineCache::operator=(PipelineCache &&other) noexcept {
+        if (this != &other) {
+            teardown();
+            device_ = other.device_;
+            childRef_ = std::move(other.childRef_);
+            cache_ = other.cache_;
+            tornDown_ = other.tornDown_;
+            if (device_ && device_->pipelineCache() == &other) {
+                device_->setPipelineCache(this);
+            }
 
-        VK_CHECK(vkQueueSubmit(device_->queue_, 1, &submitInfo, fence));
-        return SubmitHandle{fence, cmdBuf};
+            other.cache_ = VK_NULL_HANDLE;
+            other.tornDown_ = true;
+        }
+        return *this;
     }
 
-    bool Buffer::validateRange(VkDeviceSize offset, VkDeviceSize len, const char *operation) const {
-        if (len == 0) {
-#ifdef EASYVK_NO_EXCEPTIONS
-            lastError_ = std::string("Buffer ") + operation + ": length cannot be zero";
+    PipelineCache::~PipelineCache() noexcept {
+        if (!tornDown_) {
+            teardown();
+        }
+    }
+
+    bool PipelineCache::load(const char *path) {
+        if (!isValid() || !path) return false;
+
+        std::ifstream fin(path, std::ios::binary | std::ios::ate);
+        if (!fin.is_open()) return false; // first run: nothing cached yet
+
+        const std::streamoff fileSize = fin.tellg();
+        if (fileSize < static_cast<std::streamoff>(sizeof(PipelineCacheFileHeader))) {
+            evk_log("Pipeline cache %s is truncated, ignoring\n", path);
             return false;
-#else
-            throw std::invalid_argument(std::string("Buffer ") + operation + ": length cannot be zero");
-#endif
         }
+        fin.seekg(0);
 
-        if (offset >= size_) {
-#ifdef EASYVK_NO_EXCEPTIONS
-            lastError_ = std::string("Buffer ") + operation + ": offset beyond buffer size";
+        PipelineCacheFileHeader stored;
+        PipelineCacheFileHeader expected;
+        fin.read(reinterpret_cast<char *>(&stored), sizeof(stored));
+        fillPipelineCacheHeader(*device_, expected);
+
+        if (std::memcmp(stored.magic, expected.magic, sizeof(stored.magic)) != 0 ||
+            stored.version != expected.version) {
+            evk_log("Pipeline cache %s has an unknown format, ignoring\n", path);
+            return false;
+        }
+        if (stored.vendorID != expected.vendorID ||
+            stored.deviceID != expected.deviceID ||
+            stored.driverVersion != expected.driverVersion ||
+            std::memcmp(stored.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+            std::memcmp(stored.deviceUUID, expected.deviceUUID, VK_UUID_SIZE) != 0 ||
+            std::memcmp(stored.driverUUID, expected.driverUUID, VK_UUID_SIZE) != 0) {
+            evk_log("Pipeline cache %s was written by a different device or driver, ignoring\n", path);
+            return false;
+        }
+        if (stored.dataSize != static_cast<uint64_t>(fileSize) - sizeof(PipelineCacheFileHeader)) {
+            evk_log("Pipeline cache %s has an inconsistent size, ignoring\n", path);
             return false;
-#else
-            throw std::out_of_range(std::string("Buffer ") + operation + ": offset beyond buffer size");
-#endif
         }
 
-        // Check for overflow: offset + len should not overflow and should not exceed size_
-        if (offset > size_ - len) { // Avoids overflow in offset + len
-#ifdef EASYVK_NO_EXCEPTIONS
-            lastError_ = std::string("Buffer ") + operation + ": range exceeds buffer bounds (offset=" +
-                std::to_string(offset) + " len=" + std::to_string(len) + " size=" + std::to_string(size_) + ")";
+        std::vector<uint8_t> blob(static_cast<size_t>(stored.dataSize));
+        fin.read(reinterpret_cast<char *>(blob.data()), static_cast<std::streamsize>(blob.size()));
+        if (fin.gcount() != static_cast<std::streamsize>(blob.size()) ||
+            fnv1a64(blob.data(), blob.size()) != stored.dataHash) {
+            evk_log("Pipeline cache %s is corrupt, ignoring\n", path);
             return false;
-#else
-            throw std::out_of_range(std::string("Buffer ") + operation + ": range exceeds buffer bounds (offset=" +
-                std::to_string(offset) + " len=" + std::to_string(len) + " size=" + std::to_string(size_) + ")");
-#endif
         }
 
-        return true;
-    }
+        // The driver validates its own header too, but some drivers crash on foreign data
+        if (blob.size() < sizeof(VkPipelineCacheHeaderVersionOne)) return false;
+        VkPipelineCacheHeaderVersionOne vkHeader;
+        std::memcpy(&vkHeader, blob.data(), sizeof(vkHeader));
+        if (vkHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            vkHeader.vendorID != expected.vendorID ||
+            vkHeader.deviceID != expected.deviceID ||
+            std::memcmp(vkHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            return false;
+        }
 
-    bool Buffer::createVkBuffer(VkBuffer *buf, VkDeviceMemory *mem, VkDeviceSize sizeBytes,
-                                VkBufferUsageFlags usage, VkMemoryPropertyFlags props) {
-        VkBufferCreateInfo bufferInfo{
-            VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        // Seed a temporary cache and merge, so load() works on a cache that is already in use
+        VkPipelineCacheCreateInfo createInfo{
+            VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
             nullptr,
             0,
-            sizeBytes,
-            usage,
-            VK_SHARING_MODE_EXCLUSIVE,
-            0, nullptr
+            blob.size(),
+            blob.data()
         };
+        VkPipelineCache loaded = VK_NULL_HANDLE;
+        if (vkCreatePipelineCache(device_->vk(), &createInfo, nullptr, &loaded) != VK_SUCCESS) {
+            return false;
+        }
+        VkResult result = vkMergePipelineCaches(device_->vk(), cache_, 1, &loaded);
+        vkDestroyPipelineCache(device_->vk(), loaded, nullptr);
+        return result == VK_SUCCESS;
+    }
 
-#ifdef EASYVK_USE_VMA
-        if (device_->allocator() != VK_NULL_HANDLE) {
-            VmaAllocationCreateInfo allocInfo{};
-            if (hostAccess_ == HostAccess::None) {
-                allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-            } else if (hostAccess_ == HostAccess::Write) {
-                allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-                allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-            } else if (hostAccess_ == HostAccess::Read) {
-                allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
-                allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
-            } else { // HostAccess::ReadWrite
-                allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
-                allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
-            }
-
-            VmaAllocationInfo allocationInfo;
-            VkResult result = vmaCreateBuffer(device_->allocator(), &bufferInfo, &allocInfo, buf, &allocation_, &allocationInfo);
-            if (result != VK_SUCCESS) {
-#ifdef EASYVK_NO_EXCEPTIONS
-                lastError_ = "VMA buffer creation failed: " + std::string(vkResultString(result));
-                return false;
-#else
-                throw VulkanError(result, "VMA buffer creation failed", __FILE__, __LINE__);
-#endif
-            }
-            *mem = VK_NULL_HANDLE; // Memory owned by VMA
-            return true;
-        }
-#endif
+    bool PipelineCache::save(const char *path) const {
+        if (!isValid() || !path) return false;
 
-        // Fallback to manual allocation
-        VkResult result = vkCreateBuffer(device_->vk(), &bufferInfo, nullptr, buf);
-        if (result != VK_SUCCESS) {
-#ifdef EASYVK_NO_EXCEPTIONS
-            lastError_ = "Buffer creation failed: " + std::string(vkResultString(result));
-            return false;
-#else
-            throw VulkanError(result, "Buffer creation failed", __FILE__, __LINE__);
-#endif
-        }
+        std::vector<uint8_t> blob = data();
+        if (blob.empty()) return false;
 
-        VkMemoryRequirements memReqs;
-        vkGetBufferMemoryRequirements(device_->vk(), *buf, &memReqs);
+        PipelineCacheFileHeader header;
+        fillPipelineCacheHeader(*device_, header);
+        header.dataSize = blob.size();
+        header.dataHash = fnv1a64(blob.data(), blob.size());
 
-        uint32_t memoryTypeIndex = device_->selectMemory(memReqs.memoryTypeBits, props);
-        if (memoryTypeIndex == UINT32_MAX) {
-            vkDestroyBuffer(device_->vk(), *buf, nullptr);
-            *buf = VK_NULL_HANDLE;
-#ifdef EASYVK_NO_EXCEPTIONS
-            lastError_ = "Failed to find suitable memory type";
-            return false;
-#else
-            throw std::runtime_error("Failed to find suitable memory type");
-#endif
+        // Write to a sibling file first so a crash never leaves a half-written cache behind
+        const std::string tmpPath = std::string(path) + ".tmp";
+        {
+            std::ofstream fout(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+            if (!fout.is_open()) {
+                evk_log("Failed to open pipeline cache %s for writing\n", tmpPath.c_str());
+                return false;
+            }
+            fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            fout.write(reinterpret_cast<const char *>(blob.data()), static_cast<std::streamsize>(blob.size()));
+            if (!fout.good()) {
+                fout.close();
+                std::remove(tmpPath.c_str());
+                return false;
+            }
         }
 
-        VkMemoryAllocateInfo allocInfo{
-            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            nullptr,
-            memReqs.size,
-            memoryTypeIndex
-        };
-        result = vkAllocateMemory(device_->vk(), &allocInfo, nullptr, mem);
-        if (result != VK_SUCCESS) {
-            vkDestroyBuffer(device_->vk(), *buf, nullptr);
-            *buf = VK_NULL_HANDLE;
-#ifdef EASYVK_NO_EXCEPTIONS
-            lastError_ = "Memory allocation failed: " + std::string(vkResultString(result));
-            return false;
-#else
-            throw VulkanError(result, "Memory allocation failed", __FILE__, __LINE__);
+#ifdef _WIN32
+        std::remove(path); // rename() does not replace existing files on Windows
 #endif
-        }
-
-        result = vkBindBufferMemory(device_->vk(), *buf, *mem, 0);
-        if (result != VK_SUCCESS) {
-            vkFreeMemory(device_->vk(), *mem, nullptr);
-            vkDestroyBuffer(device_->vk(), *buf, nullptr);
-            *mem = VK_NULL_HANDLE;
-            *buf = VK_NULL_HANDLE;
-#ifdef EASYVK_NO_EXCEPTIONS
-            lastError_ = "Buffer memory binding failed: " + std::string(vkResultString(result));
+        if (std::rename(tmpPath.c_str(), path) != 0) {
+            std::remove(tmpPath.c_str());
             return false;
-#else
-            throw VulkanError(result, "Buffer memory binding failed", __FILE__, __LINE__);
-#endif
         }
-
         return true;
     }
 
-    void Buffer::flushRange(VkDeviceSize offset, VkDeviceSize sizeBytes) {
-        if (memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) return;
+    std::vector<uint8_t> PipelineCache::data() const {
+        std::vector<uint8_t> blob;
+        if (!isValid()) return blob;
 
-#ifdef EASYVK_USE_VMA
-        if (allocation_ != VK_NULL_HANDLE) {
-            VK_CHECK(vmaFlushAllocation(device_->allocator(), allocation_, offset, sizeBytes));
-            return;
+        size_t size = 0;
+        if (vkGetPipelineCacheData(device_->vk(), cache_, &size, nullptr) != VK_SUCCESS || size == 0) {
+            return blob;
         }
-#endif
-
-        VkDeviceSize atomSize = device_->limits().nonCoherentAtomSize;
-        VkDeviceSize alignedOffset = alignDown(offset, atomSize);
-        VkDeviceSize alignedSize = alignUp(sizeBytes + (offset - alignedOffset), atomSize);
-
-        // Clamp to buffer size
-        if (alignedOffset + alignedSize > size_) {
-            alignedSize = size_ - alignedOffset;
+        blob.resize(size);
+        VkResult result = vkGetPipelineCacheData(device_->vk(), cache_, &size, blob.data());
+        if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+            blob.clear();
+            return blob;
         }
-
-        VkMappedMemoryRange range{
-            VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-            nullptr,
-            memory_,
-            alignedOffset,
-            alignedSize
-        };
-        VK_CHECK(vkFlushMappedMemoryRanges(device_->vk(), 1, &range));
+        blob.resize(size);
+        return blob;
     }
 
-    void Buffer::invalidateRange(VkDeviceSize offset, VkDeviceSize sizeBytes) {
-        if (memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) return;
+    void PipelineCache::teardown() {
+        if (tornDown_) return;
 
-#ifdef EASYVK_USE_VMA
-        if (allocation_ != VK_NULL_HANDLE) {
-            VK_CHECK(vmaInvalidateAllocation(device_->allocator(), allocation_, offset, sizeBytes));
-            return;
+        if (cache_ != VK_NULL_HANDLE && device_ && device_->vk() != VK_NULL_HANDLE) {
+            if (device_->pipelineCache() == this) {
+                device_->setPipelineCache(nullptr);
+            }
+            vkDestroyPipelineCache(device_->vk(), cache_, nullptr);
         }
-#endif
-
-        VkDeviceSize atomSize = device_->limits().nonCoherentAtomSize;
-        VkDeviceSize alignedOffset = alignDown(offset, atomSize);
-        VkDeviceSize alignedSize = alignUp(sizeBytes + (offset - alignedOffset), atomSize);
+        cache_ = VK_NULL_HANDLE;
+        tornDown_ = true;
+    }
 
-        // Clamp to buffer size
-        if (alignedOffset + alignedSize > size_) {
-            alignedSize = size_ - alignedOffset;
+    // -------- ShaderModuleCache implementation ----------------------------------
+    // Device-wide VkShaderModules keyed by an FNV-1a hash of the SPIR-V words and matched by
+    // word count plus a second, independent hash. The module itself is created lazily (a
+    // program whose pipeline comes out of the pipeline cache by module identifier never needs
+    // one), so entries keep a copy of the code only until the module exists. Entries outlive
+    // their last program until trim().
+    struct ShaderModuleEntry {
+        uint64_t hash;
+        uint64_t checkHash;
+        size_t wordCount;
+        std::vector<uint32_t> code; // released once module is created
+        VkShaderModule module;
+        bool identifierQueried;
+        VkShaderModuleIdentifierEXT identifier;
+        uint32_t refs;
+    };
+
+    class ShaderModuleCache {
+    public:
+        explicit ShaderModuleCache(VkDevice device) : device_(device) {}
+        ~ShaderModuleCache() noexcept;
+
+        ShaderModuleCache(const ShaderModuleCache &) = delete;
+        ShaderModuleCache &operator=(const ShaderModuleCache &) = delete;
+
+        // Shared entry for code (added on first use); balance with release()
+        ShaderModuleEntry *acquire(const uint32_t *code, size_t wordCount);
+        void release(ShaderModuleEntry *entry);
+        // Module of entry, created on first request
+        VkResult module(ShaderModuleEntry *entry, VkShaderModule *out);
+        // Identifier of entry without creating the module (VK_EXT_shader_module_identifier)
+        bool identifier(ShaderModuleEntry *entry, VkShaderModuleIdentifierEXT *out);
+
+        size_t size() const;
+        size_t trim(); // destroy unreferenced entries
+
+    private:
+        VkDevice device_;
+        mutable std::mutex lock_;
+        std::unordered_multimap<uint64_t, std::unique_ptr<ShaderModuleEntry>> entries_;
+    };
+
+    namespace {
+        // Word-wise multiply/xor-shift mix, independent of the FNV-1a key
+        uint64_t spirvCheckHash(const uint32_t *code, size_t wordCount) {
+            uint64_t hash = UINT64_C(0x9e3779b97f4a7c15) ^ wordCount;
+            for (size_t i = 0; i < wordCount; ++i) {
+                hash = (hash ^ code[i]) * UINT64_C(0xff51afd7ed558ccd);
+                hash ^= hash >> 29;
+            }
+            return hash;
         }
-
-        VkMappedMemoryRange range{
-            VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-            nullptr,
-            memory_,
-            alignedOffset,
-            alignedSize
-        };
-        VK_CHECK(vkInvalidateMappedMemoryRanges(device_->vk(), 1, &range));
     }
 
-    void Buffer::teardown() {
-        if (tornDown_) return;
-
-#ifdef EASYVK_USE_VMA
-        if (allocation_ != VK_NULL_HANDLE) {
-            vmaDestroyBuffer(device_->allocator(), buffer_, allocation_);
-            buffer_ = VK_NULL_HANDLE;
-            allocation_ = VK_NULL_HANDLE;
-        } else
-#endif
-        {
-            if (memory_ != VK_NULL_HANDLE) {
-                vkFreeMemory(device_->vk(), memory_, nullptr);
-                memory_ = VK_NULL_HANDLE;
+    ShaderModuleCache::~ShaderModuleCache() noexcept {
+        for (auto &it : entries_) {
+            if (it.second->module != VK_NULL_HANDLE) {
+                vkDestroyShaderModule(device_, it.second->module, nullptr);
             }
+        }
+    }
 
-            if (buffer_ != VK_NULL_HANDLE) {
-                vkDestroyBuffer(device_->vk(), buffer_, nullptr);
-                buffer_ = VK_NULL_HANDLE;
+    ShaderModuleEntry *ShaderModuleCache::acquire(const uint32_t *code, size_t wordCount) {
+        const uint64_t hash = fnv1a64(reinterpret_cast<const uint8_t *>(code), wordCount * sizeof(uint32_t));
+        const uint64_t checkHash = spirvCheckHash(code, wordCount);
+
+        std::lock_guard<std::mutex> lock(lock_);
+        auto range = entries_.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            ShaderModuleEntry &entry = *it->second;
+            if (entry.wordCount == wordCount && entry.checkHash == checkHash) {
+                ++entry.refs;
+                return &entry;
             }
         }
 
-        tornDown_ = true;
-    }
-
-    // -------- ComputeBindings implementation ------------------------------------
-    void ComputeBindings::addStorage(uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
-        entries.emplace_back(
-            binding,
-            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            buf.vk(),
-            offset,
-            range == VK_WHOLE_SIZE ? buf.size() : range
-        );
+        std::unique_ptr<ShaderModuleEntry> entry(new ShaderModuleEntry());
+        entry->hash = hash;
+        entry->checkHash = checkHash;
+        entry->wordCount = wordCount;
+        entry->code.assign(code, code + wordCount);
+        entry->module = VK_NULL_HANDLE;
+        entry->identifierQueried = false;
+        entry->identifier = VkShaderModuleIdentifierEXT{VK_STRUCTURE_TYPE_SHADER_MODULE_IDENTIFIER_EXT, nullptr, 0, {}};
+        entry->refs = 1;
+        ShaderModuleEntry *raw = entry.get();
+        entries_.emplace(hash, std::move(entry));
+        return raw;
     }
 
-    void ComputeBindings::addUniform(uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
-        entries.emplace_back(
-            binding,
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            buf.vk(),
-            offset,
-            range == VK_WHOLE_SIZE ? buf.size() : range
-        );
+    void ShaderModuleCache::release(ShaderModuleEntry *entry) {
+        if (!entry) return;
+        std::lock_guard<std::mutex> lock(lock_);
+        if (entry->refs > 0) --entry->refs;
     }
 
-    void ComputeBindings::addStorageArray(uint32_t set, uint32_t binding, const std::vector<Buffer *> &buffers) {
-        std::vector<VkDescriptorBufferInfo> bufferInfos;
-        bufferInfos.reserve(buffers.size());
-        for (const Buffer *buf : buffers) {
-            if (buf) {
-                bufferInfos.push_back({buf->vk(), 0, buf->size()});
+    VkResult ShaderModuleCache::module(ShaderModuleEntry *entry, VkShaderModule *out) {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (entry->module == VK_NULL_HANDLE) {
+            VkShaderModuleCreateInfo createInfo{
+                VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                nullptr,
+                0,
+                entry->code.size() * sizeof(uint32_t),
+                entry->code.data()
+            };
+            VkResult result = vkCreateShaderModule(device_, &createInfo, nullptr, &entry->module);
+            if (result != VK_SUCCESS) {
+                entry->module = VK_NULL_HANDLE;
+                return result;
             }
+            // Pipelines and identifiers come from the module from now on
+            std::vector<uint32_t>().swap(entry->code);
         }
-        entries.emplace_back(set, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfos);
+        *out = entry->module;
+        return VK_SUCCESS;
     }
 
-    void ComputeBindings::addUniformArray(uint32_t set, uint32_t binding, const std::vector<Buffer *> &buffers) {
-        std::vector<VkDescriptorBufferInfo> bufferInfos;
-        bufferInfos.reserve(buffers.size());
-        for (const Buffer *buf : buffers) {
-            if (buf) {
-                bufferInfos.push_back({buf->vk(), 0, buf->size()});
+    bool ShaderModuleCache::identifier(ShaderModuleEntry *entry, VkShaderModuleIdentifierEXT *out) {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!entry->identifierQueried) {
+            if (entry->module != VK_NULL_HANDLE) {
+                vkGetShaderModuleIdentifierEXT(device_, entry->module, &entry->identifier);
+            } else {
+                VkShaderModuleCreateInfo createInfo{
+                    VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                    nullptr,
+                    0,
+                    entry->code.size() * sizeof(uint32_t),
+                    entry->code.data()
+                };
+                vkGetShaderModuleCreateInfoIdentifierEXT(device_, &createInfo, &entry->identifier);
             }
+            entry->identifierQueried = true;
         }
-        entries.emplace_back(set, binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, bufferInfos);
-    }
-
-    void ComputeBindings::addStorageToSet(uint32_t set, uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
-        std::vector<VkDescriptorBufferInfo> bufferInfos;
-        bufferInfos.push_back({buf.vk(), offset, range == VK_WHOLE_SIZE ? buf.size() : range});
-        entries.emplace_back(set, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfos);
+        if (entry->identifier.identifierSize == 0) return false;
+        *out = entry->identifier;
+        return true;
     }
 
-    void ComputeBindings::addUniformToSet(uint32_t set, uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
-        std::vector<VkDescriptorBufferInfo> bufferInfos;
-        bufferInfos.push_back({buf.vk(), offset, range == VK_WHOLE_SIZE ? buf.size() : range});
-        entries.emplace_back(set, binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, bufferInfos);
+    size_t ShaderModuleCache::size() const {
+        std::lock_guard<std::mutex> lock(lock_);
+        return entries_.size();
     }
 
-    bool ComputeBindings::validate(const Device &device, std::string &error) const {
-        for (const auto &entry : entries) {
-            for (const auto &bufInfo : entry.buffers) {
-                VkDeviceSize requiredAlignment = 0;
-                if (entry.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
-                    requiredAlignment = device.limits().minUniformBufferOffsetAlignment;
-                } else if (entry.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
-                    requiredAlignment = device.limits().minStorageBufferOffsetAlignment;
-                }
-
-                if (requiredAlignment > 0 && (bufInfo.offset % requiredAlignment) != 0) {
-                    error = "Descriptor buffer offset violates alignment requirement (binding " +
-                            std::to_string(entry.binding) + ", offset " + std::to_string(bufInfo.offset) +
-                            ", required alignment " + std::to_string(requiredAlignment) + ")";
-                    return false;
+    size_t ShaderModuleCache::trim() {
+        std::lock_guard<std::mutex> lock(lock_);
+        size_t released = 0;
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (it->second->refs == 0) {
+                if (it->second->module != VK_NULL_HANDLE) {
+                    vkDestroyShaderModule(device_, it->second->module, nullptr);
                 }
+                it = entries_.erase(it);
+                ++released;
+            } else {
+                ++it;
             }
         }
-        return true;
+        return released;
     }
 
-    bool ComputeProgramCreateInfo::validate(const Device &device, std::string &error) const {
-        if (!spirv || spirv->empty()) {
-            error = "SPIR-V code is required";
-            return false;
+    ShaderModuleCache *Device::shaderModuleCache() {
+        std::lock_guard<std::mutex> lock(*lazyInitLock_);
+        if (!shaderModules_) {
+            shaderModules_.reset(new ShaderModuleCache(device_));
         }
+        return shaderModules_.get();
+    }
 
-        if (localX == 0 || localY == 0 || localZ == 0) {
-            error = "Local workgroup size must be >= 1 in all dimensions";
-            return false;
-        }
+    size_t Device::shaderModuleCount() const {
+        std::lock_guard<std::mutex> lock(*lazyInitLock_);
+        return shaderModules_ ? shaderModules_->size() : 0;
+    }
 
-        const auto &lim = device.limits();
-        if (localX > lim.maxComputeWorkGroupSize[0] ||
-            localY > lim.maxComputeWorkGroupSize[1] ||
-            localZ > lim.maxComputeWorkGroupSize[2]) {
-            error = "Local workgroup size exceeds device limits";
-            return false;
-        }
+    size_t Device::trimShaderModules() {
+        std::lock_guard<std::mutex> lock(*lazyInitLock_);
+        return shaderModules_ ? shaderModules_->trim() : 0;
+    }
 
-        const uint64_t invocations = static_cast<uint64_t>(localX) * static_cast<uint64_t>(localY) * static_cast<uint64_t>(localZ);
-        if (invocations > lim.maxComputeWorkGroupInvocations) {
-            error = "Local workgroup invocations exceed device limits";
-            return false;
+    // -------- Profiler implementation -------------------------------------------
+    namespace {
+        // Log-scale histogram: eight buckets per power of two of nanoseconds, up to 2^48 ns
+        const uint32_t kProfileBucketsPerOctave = 8;
+        const uint32_t kProfileBucketCount = 48 * kProfileBucketsPerOctave;
+
+        uint32_t profileBucket(double ns) {
+            if (ns < 1.0) return 0;
+            const double b = std::log2(ns) * kProfileBucketsPerOctave;
+            return b >= kProfileBucketCount - 1 ? kProfileBucketCount - 1 : static_cast<uint32_t>(b);
         }
 
-        if (pushConstantBytes > 0) {
-            if (pushConstantBytes % 4 != 0) {
-                error = "Push constant size must be 4-byte aligned";
-                return false;
-            }
-            if (pushConstantBytes > lim.maxPushConstantsSize) {
-                error = "Push constant size exceeds device limit";
-                return false;
-            }
+        // Geometric midpoint of a bucket
+        double profileBucketValue(uint32_t bucket) {
+            return std::exp2((bucket + 0.5) / kProfileBucketsPerOctave);
         }
+    } // namespace
 
-        return bindings.validate(device, error);
-    }
+    Profiler::Profiler()
+        : device_(nullptr), pool_(VK_NULL_HANDLE), capacity_(0), timestampMask_(0), dropped_(0), tornDown_(false) {}
 
-    bool PushConstantConfig::validate(uint32_t maxSize, std::string &error) const {
-        if (sizeBytes > 0 && sizeBytes % 4 != 0) {
-            error = "Push constant size must be 4-byte aligned";
-            return false;
+    Profiler::Profiler(Device &dev, uint32_t capacity)
+        : device_(&dev), childRef_(dev), pool_(VK_NULL_HANDLE), capacity_(capacity), timestampMask_(0),
+          lock_(new std::mutex), dropped_(0), tornDown_(false) {
+        if (!dev.isValid()) {
+            EVK_FAIL_VOID("Device is not valid");
         }
-        if (offset % 4 != 0) {
-            error = "Push constant offset must be 4-byte aligned";
-            return false;
+        if (!dev.supportsTimestamps()) {
+            EVK_FAIL_VOID("Timestamp queries are not supported on the compute queue");
         }
-        if (sizeBytes + offset > maxSize) {
-            error = "Push constant range exceeds device limit";
-            return false;
+        if (capacity == 0 || capacity > UINT32_MAX / 2) {
+            EVK_FAIL_VOID("Profiler capacity must be in [1, 2^31)");
         }
-        return true;
-    }
 
-    // -------- ComputeProgram implementation -------------------------------------
-    ComputeProgram::ComputeProgram()
-        : device_(nullptr),
+        const uint32_t bits = dev.timestampValidBits();
+        timestampMask_ = bits >= 64 ? UINT64_MAX : ((UINT64_C(1) << bits) - 1);
+
+        VkQueryPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = capacity * 2;
+        VK_CHECK(vkCreateQueryPool(dev.vk(), &poolInfo, nullptr, &pool_));
+
+        slotStates_.assign(capacity, SlotState::Resetting);
+        slotLabels_.assign(capacity, 0);
+        freeSlots_.reserve(capacity);
+        resetting_.reserve(capacity);
+        for (uint32_t i = capacity; i-- > 0;) {
+            resetting_.push_back(i);
+        }
+
+        // Queries start out undefined; reset the whole ring once before any slot is handed out
+        submitReset(resetting_);
+        if (!device_->wait(resetHandle_)) {
+            EVK_FAIL_VOID("Profiler query reset failed");
+        }
+        resetHandle_ = SubmitHandle();
+        for (uint32_t slot : resetting_) {
+            slotStates_[slot] = SlotState::Free;
+        }
+        freeSlots_.swap(resetting_);
+    }
+
+    Profiler::Profiler(Profiler &&other) noexcept
+        : device_(other.device_), childRef_(std::move(other.childRef_)), pool_(other.pool_), capacity_(other.capacity_),
+          timestampMask_(other.timestampMask_), lock_(std::move(other.lock_)),
+          slotStates_(std::move(other.slotStates_)), slotLabels_(std::move(other.slotLabels_)),
+          freeSlots_(std::move(other.freeSlots_)), needsReset_(std::move(other.needsReset_)),
+          resetting_(std::move(other.resetting_)), resetHandle_(other.resetHandle_),
+          histograms_(std::move(other.histograms_)), dropped_(other.dropped_), tornDown_(other.tornDown_) {
+        if (device_ && device_->profiler() == &other) {
+            device_->setProfiler(this);
+        }
+        other.pool_ = VK_NULL_HANDLE;
+        other.resetHandle_ = SubmitHandle();
+        other.tornDown_ = true;
+    }
+
+    Profiler &Profiler::operator=(Profiler &&other) noexcept {
+        if (this != &other) {
+            teardown();
+            device_ = other.device_;
+            childRef_ = std::move(other.childRef_);
+            pool_ = other.pool_;
+            capacity_ = other.capacity_;
+            timestampMask_ = other.timestampMask_;
+            lock_ = std::move(other.lock_);
+            slotStates_ = std::move(other.slotStates_);
+            slotLabels_ = std::move(other.slotLabels_);
+            freeSlots_ = std::move(other.freeSlots_);
+            needsReset_ = std::move(other.needsReset_);
+            resetting_ = std::move(other.resetting_);
+            resetHandle_ = other.resetHandle_;
+            histograms_ = std::move(other.histograms_);
+            dropped_ = other.dropped_;
+            tornDown_ = other.tornDown_;
+            if (device_ && device_->profiler() == &other) {
+                device_->setProfiler(this);
+            }
+
+            other.pool_ = VK_NULL_HANDLE;
+            other.resetHandle_ = SubmitHandle();
+            other.tornDown_ = true;
+        }
+        return *this;
+    }
+
+    Profiler::~Profiler() noexcept {
+        if (!tornDown_) {
+            teardown();
+        }
+    }
+
+    uint32_t Profiler::labelIndex(const char *label) {
+        const char *name = label ? label : "dispatch";
+        for (size_t i = 0; i < histograms_.size(); ++i) {
+            if (histograms_[i].label == name) return static_cast<uint32_t>(i);
+        }
+        Histogram h;
+        h.label = name;
+        h.buckets.assign(kProfileBucketCount, 0);
+        h.count = 0;
+        h.sumNs = 0.0;
+        h.minNs = 0.0;
+        h.maxNs = 0.0;
+        histograms_.push_back(std::move(h));
+        return static_cast<uint32_t>(histograms_.size() - 1);
+    }
+
+    uint32_t Profiler::beginScope(VkCommandBuffer cmd, const char *label, VkPipelineStageFlags stage) {
+        if (!isValid()) return UINT32_MAX;
+        std::lock_guard<std::mutex> guard(*lock_);
+        if (freeSlots_.empty()) {
+            ++dropped_;
+            return UINT32_MAX;
+        }
+        const uint32_t slot = freeSlots_.back();
+        freeSlots_.pop_back();
+        slotStates_[slot] = SlotState::Recorded;
+        slotLabels_[slot] = labelIndex(label);
+        vkCmdWriteTimestamp(cmd, stage, pool_, slot * 2);
+        return slot;
+    }
+
+    void Profiler::endScope(VkCommandBuffer cmd, uint32_t slot, VkPipelineStageFlags stage) {
+        if (slot == UINT32_MAX || !isValid()) return;
+        vkCmdWriteTimestamp(cmd, stage, pool_, slot * 2 + 1);
+    }
+
+    void Profiler::cancel(const uint32_t *slots, size_t count) {
+        if (!isValid() || count == 0) return;
+        std::lock_guard<std::mutex> guard(*lock_);
+        for (size_t i = 0; i < count; ++i) {
+            if (slots[i] < capacity_ && slotStates_[slots[i]] == SlotState::Recorded) {
+                slotStates_[slots[i]] = SlotState::Resetting;
+                needsReset_.push_back(slots[i]);
+            }
+        }
+    }
+
+    void Profiler::submitReset(const std::vector<uint32_t> &slots) {
+        std::vector<uint32_t> sorted(slots);
+        std::sort(sorted.begin(), sorted.end());
+
+        VkCommandBuffer cmdBuf = device_->acquireCommandBuffer();
+        VkCommandBufferBeginInfo beginInfo{
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            nullptr,
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            nullptr
+        };
+        VkResult result = vkBeginCommandBuffer(cmdBuf, &beginInfo);
+        if (result != VK_SUCCESS) {
+            device_->releaseCommandBuffer(cmdBuf);
+            VK_CHECK(result);
+        }
+        // One reset per run of adjacent slots
+        for (size_t i = 0; i < sorted.size();) {
+            size_t j = i + 1;
+            while (j < sorted.size() && sorted[j] == sorted[j - 1] + 1) ++j;
+            vkCmdResetQueryPool(cmdBuf, pool_, sorted[i] * 2, static_cast<uint32_t>(j - i) * 2);
+            i = j;
+        }
+        result = vkEndCommandBuffer(cmdBuf);
+        if (result != VK_SUCCESS) {
+            device_->releaseCommandBuffer(cmdBuf);
+            VK_CHECK(result);
+        }
+        resetHandle_ = device_->submitCommands(cmdBuf, true);
+    }
+
+    uint32_t Profiler::collect() {
+        if (!isValid()) return 0;
+        std::lock_guard<std::mutex> guard(*lock_);
+
+        // Slots from the previous reset submission become usable once it has executed
+        if (resetHandle_.isValid() && device_->isComplete(resetHandle_)) {
+            device_->wait(resetHandle_);
+            resetHandle_ = SubmitHandle();
+            for (uint32_t slot : resetting_) {
+                slotStates_[slot] = SlotState::Free;
+                freeSlots_.push_back(slot);
+            }
+            resetting_.clear();
+        }
+
+        // One read over the whole ring; unwritten queries simply report unavailable
+        std::vector<uint64_t> results(static_cast<size_t>(capacity_) * 4);
+        const VkResult result = vkGetQueryPoolResults(device_->vk(), pool_, 0, capacity_ * 2,
+                                                      results.size() * sizeof(uint64_t), results.data(),
+                                                      2 * sizeof(uint64_t),
+                                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY) {
+            VK_CHECK(result);
+        }
+
+        const double period = device_->timestampPeriod();
+        uint32_t added = 0;
+        for (uint32_t slot = 0; slot < capacity_; ++slot) {
+            if (slotStates_[slot] != SlotState::Recorded) continue;
+            const uint64_t *q = results.data() + static_cast<size_t>(slot) * 4;
+            if (q[1] == 0 || q[3] == 0) continue;
+
+            const double ns = static_cast<double>((q[2] - q[0]) & timestampMask_) * period;
+            Histogram &h = histograms_[slotLabels_[slot]];
+            h.minNs = h.count == 0 ? ns : std::min(h.minNs, ns);
+            h.maxNs = h.count == 0 ? ns : std::max(h.maxNs, ns);
+            h.sumNs += ns;
+            ++h.count;
+            ++h.buckets[profileBucket(ns)];
+            ++added;
+
+            slotStates_[slot] = SlotState::Resetting;
+            needsReset_.push_back(slot);
+        }
+
+        if (!resetHandle_.isValid() && !needsReset_.empty()) {
+            submitReset(needsReset_);
+            resetting_.swap(needsReset_);
+            needsReset_.clear();
+        }
+        return added;
+    }
+
+    std::vector<ProfileStats> Profiler::stats() const {
+        std::vector<ProfileStats> out;
+        if (!lock_) return out;
+        std::lock_guard<std::mutex> guard(*lock_);
+        for (const Histogram &h : histograms_) {
+            if (h.count == 0) continue;
+            ProfileStats s;
+            s.label = h.label;
+            s.count = h.count;
+            s.minNs = h.minNs;
+            s.maxNs = h.maxNs;
+            s.meanNs = h.sumNs / static_cast<double>(h.count);
+
+            const double quantiles[2] = {0.50, 0.99};
+            double values[2] = {h.maxNs, h.maxNs};
+            for (int q = 0; q < 2; ++q) {
+                const uint64_t rank = static_cast<uint64_t>(std::ceil(quantiles[q] * static_cast<double>(h.count)));
+                uint64_t seen = 0;
+                for (uint32_t b = 0; b < kProfileBucketCount; ++b) {
+                    seen += h.buckets[b];
+                    if (seen >= rank) {
+                        values[q] = std::min(std::max(profileBucketValue(b), h.minNs), h.maxNs);
+                        break;
+                    }
+                }
+            }
+            s.p50Ns = values[0];
+            s.p99Ns = values[1];
+            out.push_back(s);
+        }
+        std::sort(out.begin(), out.end(),
+                  [](const ProfileStats &a, const ProfileStats &b) { return a.label < b.label; });
+        return out;
+    }
+
+    void Profiler::clear() {
+        if (!lock_) return;
+        std::lock_guard<std::mutex> guard(*lock_);
+        for (Histogram &h : histograms_) {
+            std::fill(h.buckets.begin(), h.buckets.end(), 0);
+            h.count = 0;
+            h.sumNs = h.minNs = h.maxNs = 0.0;
+        }
+        dropped_ = 0;
+    }
+
+    uint64_t Profiler::droppedCount() const {
+        if (!lock_) return 0;
+        std::lock_guard<std::mutex> guard(*lock_);
+        return dropped_;
+    }
+
+    void Profiler::teardown() {
+        if (tornDown_) return;
+
+        if (device_ && device_->vk() != VK_NULL_HANDLE) {
+            if (device_->profiler() == this) {
+                device_->setProfiler(nullptr);
+            }
+            if (resetHandle_.isValid()) {
+                device_->wait(resetHandle_);
+            }
+            if (pool_ != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(device_->vk(), pool_, nullptr);
+            }
+        }
+        pool_ = VK_NULL_HANDLE;
+        resetHandle_ = SubmitHandle();
+        tornDown_ = true;
+    }
+
+    bool BufferCreateInfo::validate(std::string &error) const {
+        if (sizeBytes == 0) {
+            error = "Buffer size cannot be zero";
+            return false;
+        }
+        if (sizeBytes > UINT64_MAX / 2) {
+            error = "Buffer size too large";
+            return false;
+        }
+        if ((persistentMap || hostPointer) && host == HostAccess::None) {
+            error = "Persistently mapped and host-imported buffers need host access";
+            return false;
+        }
+        return true;
+    }
+
+    // -------- Tracer implementation ---------------------------------------------
+    Tracer::Tracer(size_t capacity)
+        : lock_(new std::mutex()),
+          capacity_(capacity),
+          dropped_(0) {}
+
+    Tracer::Tracer(Tracer &&other) noexcept
+        : lock_(std::move(other.lock_)),
+          callback_(std::move(other.callback_)),
+          events_(std::move(other.events_)),
+          capacity_(other.capacity_),
+          dropped_(other.dropped_) {
+        other.dropped_ = 0;
+    }
+
+    Tracer &Tracer::operator=(Tracer &&other) noexcept {
+        if (this != &other) {
+            lock_ = std::move(other.lock_);
+            callback_ = std::move(other.callback_);
+            events_ = std::move(other.events_);
+            capacity_ = other.capacity_;
+            dropped_ = other.dropped_;
+
+            other.dropped_ = 0;
+        }
+        return *this;
+    }
+
+    Tracer::~Tracer() noexcept {}
+
+    void Tracer::setCallback(std::function<void(const TraceEvent &)> callback) {
+        if (!lock_) return;
+        std::lock_guard<std::mutex> lock(*lock_);
+        if (callback) {
+            callback_ = std::make_shared<const std::function<void(const TraceEvent &)>>(std::move(callback));
+        } else {
+            callback_.reset();
+        }
+    }
+
+    void Tracer::record(const TraceEvent &event) {
+        if (!lock_) return;
+        std::shared_ptr<const std::function<void(const TraceEvent &)>> callback;
+        {
+            std::lock_guard<std::mutex> lock(*lock_);
+            if (events_.size() < capacity_) {
+                events_.push_back(event);
+            } else if (capacity_ != 0) {
+                ++dropped_;
+            }
+            callback = callback_;
+        }
+        if (callback) (*callback)(event);
+    }
+
+    std::vector<TraceEvent> Tracer::events() const {
+        if (!lock_) return std::vector<TraceEvent>();
+        std::lock_guard<std::mutex> lock(*lock_);
+        return events_;
+    }
+
+    void Tracer::clear() {
+        if (!lock_) return;
+        std::lock_guard<std::mutex> lock(*lock_);
+        events_.clear();
+        dropped_ = 0;
+    }
+
+    uint64_t Tracer::droppedCount() const {
+        if (!lock_) return 0;
+        std::lock_guard<std::mutex> lock(*lock_);
+        return dropped_;
+    }
+
+    bool Tracer::writeChromeTrace(const std::string &path) const {
+        const std::vector<TraceEvent> snapshot = events();
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            EVK_FAIL("Tracer: cannot open " + path + " for writing");
+        }
+
+        // Complete ("X") events in microseconds; names are static identifiers, no escaping
+        char line[256];
+        file << "{\"traceEvents\":[\n";
+        for (size_t i = 0; i < snapshot.size(); ++i) {
+            const TraceEvent &e = snapshot[i];
+            std::snprintf(line, sizeof(line),
+                          "%s{\"name\":\"%s\",\"cat\":\"easyvk\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                          "\"pid\":1,\"tid\":%u,\"args\":{\"bytes\":%llu}}",
+                          i ? ",\n" : "", e.name ? e.name : "", static_cast<double>(e.startNs) / 1000.0,
+                          static_cast<double>(e.durationNs) / 1000.0, e.threadId,
+                          static_cast<unsigned long long>(e.bytes));
+            file << line;
+        }
+        file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+        file.close();
+        if (!file) {
+            EVK_FAIL("Tracer: failed to write " + path);
+        }
+        return true;
+    }
+
+    // -------- BufferMapping implementation --------------------------------------
+    BufferMapping::BufferMapping() : buf_(nullptr), ptr_(nullptr), offset_(0), length_(0), write_(false) {}
+
+    BufferMapping::~BufferMapping() noexcept {
+        if (buf_ && ptr_) {
+            // Persistent read mappings release nothing
+            TraceScope trace(write_ || !buf_->mapped_ ? buf_->device_->tracer() : nullptr, "unmap", length_);
+            if (write_) {
+                buf_->flushRange(offset_, length_);
+            }
+            if (!buf_->mapped_) { // persistent mappings (arena, persistentMap, import) stay
+#ifdef EASYVK_USE_VMA
+                if (buf_->allocation_ != VK_NULL_HANDLE) {
+                    vmaUnmapMemory(buf_->device_->allocator(), buf_->allocation_);
+                } else
+#endif
+                vkUnmapMemory(buf_->device_->vk(), buf_->memory_);
+            }
+        }
+    }
+
+    BufferMapping::BufferMapping(BufferMapping &&other) noexcept
+        : buf_(other.buf_),
+          ptr_(other.ptr_),
+          offset_(other.offset_),
+          length_(other.length_),
+          write_(other.write_) {
+        other.buf_ = nullptr;
+        other.ptr_ = nullptr;
+    }
+
+    BufferMapping &BufferMapping::operator=(BufferMapping &&other) noexcept {
+        if (this != &other) {
+            // Clean up current mapping
+            if (buf_ && ptr_) {
+                if (write_) {
+                    buf_->flushRange(offset_, length_);
+                }
+                if (!buf_->mapped_) {
+#ifdef EASYVK_USE_VMA
+                    if (buf_->allocation_ != VK_NULL_HANDLE) {
+                        vmaUnmapMemory(buf_->device_->allocator(), buf_->allocation_);
+                    } else
+#endif
+                    vkUnmapMemory(buf_->device_->vk(), buf_->memory_);
+                }
+            }
+
+            buf_ = other.buf_;
+            ptr_ = other.ptr_;
+            offset_ = other.offset_;
+            length_ = other.length_;
+            write_ = other.write_;
+
+            other.buf_ = nullptr;
+            other.ptr_ = nullptr;
+        }
+        return *this;
+    }
+
+    // -------- MemoryArena implementation ----------------------------------------
+    // Size-classed block allocator for the non-VMA path. Requests are rounded up to a
+    // power-of-two slot (>= alignment, >= nonCoherentAtomSize on host-visible types) and
+    // served from pages of equal-sized slots, so offsets are naturally aligned and flush/
+    // invalidate ranges never straddle a neighbouring slot. Host-visible pages are mapped
+    // once for their whole lifetime because a VkDeviceMemory cannot be mapped twice.
+    struct MemoryArenaPage {
+        VkDeviceMemory memory;
+        void *mapped;
+        VkDeviceSize slotBytes;
+        uint32_t memoryType;
+        std::vector<uint32_t> freeSlots;
+        uint32_t slotCount;
+    };
+
+    class MemoryArena {
+    public:
+        struct Allocation {
+            MemoryArenaPage *page;
+            uint32_t slot;
+            VkDeviceMemory memory;
+            VkDeviceSize offset;
+            VkDeviceSize size; // slot size
+            void *mapped;      // persistent mapping of the slot, null if not host-visible
+        };
+
+        MemoryArena(VkDevice device, const VkPhysicalDeviceMemoryProperties &memProperties,
+                    VkDeviceSize maxAllocationBytes, VkDeviceSize nonCoherentAtomSize,
+                    VkMemoryAllocateFlags allocateFlags, DeviceCounters *counters);
+        ~MemoryArena() noexcept;
+
+        MemoryArena(const MemoryArena &) = delete;
+        MemoryArena &operator=(const MemoryArena &) = delete;
+
+        // VK_SUCCESS with out filled, VK_ERROR_FEATURE_NOT_PRESENT if the request is not
+        // arena-eligible (too large), or the vkAllocateMemory/vkMapMemory error.
+        VkResult allocate(const VkMemoryRequirements &reqs, uint32_t memoryType, Allocation &out);
+        void free(MemoryArenaPage *page, uint32_t slot);
+
+    private:
+        VkDevice device_;
+        VkDeviceSize maxAllocationBytes_;
+        VkDeviceSize nonCoherentAtomSize_;
+        VkMemoryAllocateFlags allocateFlags_; // e.g. DEVICE_ADDRESS_BIT for buffer device addresses
+        VkPhysicalDeviceMemoryProperties memProperties_;
+        DeviceCounters *counters_;
+        std::mutex lock_; // Buffers are created and destroyed from any thread
+        std::vector<std::unique_ptr<MemoryArenaPage>> pages_;
+
+        VkResult createPage(uint32_t memoryType, VkDeviceSize slotBytes, MemoryArenaPage *&out);
+        void destroyPage(MemoryArenaPage &page);
+    };
+
+    namespace {
+        const VkDeviceSize kArenaMinSlotBytes = 256;
+        const VkDeviceSize kArenaMinPageBytes = 4 * 1024 * 1024;
+        const VkDeviceSize kArenaMaxPageBytes = 64 * 1024 * 1024;
+        const VkDeviceSize kArenaSlotsPerPage = 16;
+
+        VkDeviceSize nextPowerOfTwo(VkDeviceSize v) {
+            VkDeviceSize p = 1;
+            while (p < v) p <<= 1;
+            return p;
+        }
+    }
+
+    MemoryArena::MemoryArena(VkDevice device, const VkPhysicalDeviceMemoryProperties &memProperties,
+                             VkDeviceSize maxAllocationBytes, VkDeviceSize nonCoherentAtomSize,
+                             VkMemoryAllocateFlags allocateFlags, DeviceCounters *counters)
+        : device_(device),
+          maxAllocationBytes_(maxAllocationBytes),
+          nonCoherentAtomSize_(nonCoherentAtomSize),
+          allocateFlags_(allocateFlags),
+          memProperties_(memProperties),
+          counters_(counters) {}
+
+    MemoryArena::~MemoryArena() noexcept {
+        for (auto &page : pages_) {
+            destroyPage(*page);
+        }
+        pages_.clear();
+    }
+
+    VkResult MemoryArena::allocate(const VkMemoryRequirements &reqs, uint32_t memoryType, Allocation &out) {
+        if (reqs.size > maxAllocationBytes_) return VK_ERROR_FEATURE_NOT_PRESENT;
+        std::lock_guard<std::mutex> lock(lock_);
+
+        const VkMemoryPropertyFlags typeFlags = memProperties_.memoryTypes[memoryType].propertyFlags;
+        VkDeviceSize slotBytes = nextPowerOfTwo(std::max(reqs.size, kArenaMinSlotBytes));
+        slotBytes = std::max(slotBytes, nextPowerOfTwo(reqs.alignment));
+        if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            slotBytes = std::max(slotBytes, nextPowerOfTwo(nonCoherentAtomSize_));
+        }
+
+        MemoryArenaPage *page = nullptr;
+        for (auto &candidate : pages_) {
+            if (candidate->memoryType == memoryType && candidate->slotBytes == slotBytes &&
+                !candidate->freeSlots.empty()) {
+                page = candidate.get();
+                break;
+            }
+        }
+        if (!page) {
+            VkResult result = createPage(memoryType, slotBytes, page);
+            if (result != VK_SUCCESS) return result;
+        }
+
+        const uint32_t slot = page->freeSlots.back();
+        page->freeSlots.pop_back();
+
+        out.page = page;
+        out.slot = slot;
+        out.memory = page->memory;
+        out.offset = slotBytes * slot;
+        out.size = slotBytes;
+        out.mapped = page->mapped ? static_cast<char *>(page->mapped) + out.offset : nullptr;
+        return VK_SUCCESS;
+    }
+
+    void MemoryArena::free(MemoryArenaPage *page, uint32_t slot) {
+        if (!page) return;
+        std::lock_guard<std::mutex> lock(lock_);
+        page->freeSlots.push_back(slot);
+        if (page->freeSlots.size() != page->slotCount) return;
+
+        // Keep one empty page per size class around to absorb alloc/free churn
+        for (auto &other : pages_) {
+            if (other.get() != page && other->memoryType == page->memoryType &&
+                other->slotBytes == page->slotBytes && other->freeSlots.size() == other->slotCount) {
+                for (size_t i = 0; i < pages_.size(); ++i) {
+                    if (pages_[i].get() == page) {
+                        destroyPage(*page);
+                        pages_.erase(pages_.begin() + static_cast<std::ptrdiff_t>(i));
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    VkResult MemoryArena::createPage(uint32_t memoryType, VkDeviceSize slotBytes, MemoryArenaPage *&out) {
+        const VkMemoryType &type = memProperties_.memoryTypes[memoryType];
+        const VkDeviceSize heapSize = memProperties_.memoryHeaps[type.heapIndex].size;
+
+        VkDeviceSize pageBytes = std::max(slotBytes * kArenaSlotsPerPage, kArenaMinPageBytes);
+        pageBytes = std::min(pageBytes, kArenaMaxPageBytes);
+        pageBytes = std::min(pageBytes, heapSize / 8); // small heaps, e.g. 256 MiB BAR windows
+        pageBytes = std::max(pageBytes - pageBytes % slotBytes, slotBytes);
+
+        std::unique_ptr<MemoryArenaPage> page(new MemoryArenaPage());
+        page->memory = VK_NULL_HANDLE;
+        page->mapped = nullptr;
+        page->slotBytes = slotBytes;
+        page->memoryType = memoryType;
+        page->slotCount = static_cast<uint32_t>(pageBytes / slotBytes);
+
+        VkMemoryAllocateFlagsInfo flagsInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO, nullptr, allocateFlags_, 0};
+        VkMemoryAllocateInfo allocInfo{
+            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            allocateFlags_ ? &flagsInfo : nullptr,
+            pageBytes,
+            memoryType
+        };
+        VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, &page->memory);
+        if (result != VK_SUCCESS) return result;
+
+        if (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            result = vkMapMemory(device_, page->memory, 0, VK_WHOLE_SIZE, 0, &page->mapped);
+            if (result != VK_SUCCESS) {
+                vkFreeMemory(device_, page->memory, nullptr);
+                return result;
+            }
+        }
+        counters_->allocated(memoryType, pageBytes);
+
+        // Hand out low offsets first
+        page->freeSlots.reserve(page->slotCount);
+        for (uint32_t i = page->slotCount; i > 0; --i) {
+            page->freeSlots.push_back(i - 1);
+        }
+
+        out = page.get();
+        pages_.push_back(std::move(page));
+        return VK_SUCCESS;
+    }
+
+    void MemoryArena::destroyPage(MemoryArenaPage &page) {
+        if (page.memory == VK_NULL_HANDLE) return;
+        if (page.mapped) {
+            vkUnmapMemory(device_, page.memory);
+            page.mapped = nullptr;
+        }
+        vkFreeMemory(device_, page.memory, nullptr);
+        counters_->freed(page.memoryType, page.slotBytes * page.slotCount); // pageBytes is a multiple of slotBytes
+        page.memory = VK_NULL_HANDLE;
+    }
+
+    MemoryArena *Device::memoryArena() {
+        if (arenaMaxAllocationBytes_ == 0) return nullptr;
+        std::lock_guard<std::mutex> lock(*lazyInitLock_);
+        if (!arena_) {
+            const VkMemoryAllocateFlags flags = bufferDeviceAddressEnabled_
+                ? static_cast<VkMemoryAllocateFlags>(VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT) : 0;
+            arena_.reset(new MemoryArena(device_, memProperties_, arenaMaxAllocationBytes_, limits_.nonCoherentAtomSize,
+                                         flags, counters_.get()));
+        }
+        return arena_.get();
+    }
+
+    // -------- Buffer implementation ----------------------------------------------
+    VkBufferUsageFlags bufferUsageToVk(BufferUsage usage) {
+        VkBufferUsageFlags flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        switch (usage) {
+        case BufferUsage::Storage:
+            // Indirect too: kernels may produce the workgroup counts of a later dispatch
+            flags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+            break;
+        case BufferUsage::Uniform:
+            flags |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+            break;
+        case BufferUsage::Staging:
+            // Just transfer flags
+            break;
+        case BufferUsage::TransferSrc:
+            flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            break;
+        case BufferUsage::TransferDst:
+            flags = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            break;
+        }
+        return flags;
+    }
+
+    Buffer::Buffer(Device &dev, const BufferCreateInfo &info)
+        : device_(&dev),
+          childRef_(dev),
+          buffer_(VK_NULL_HANDLE),
+          memory_(VK_NULL_HANDLE),
+          size_(info.sizeBytes),
+          memFlags_(0),
+          memoryTypeIndex_(UINT32_MAX),
+          hostAccess_(info.host),
+          usageFlags_(0),
+          tornDown_(false),
+          hostImported_(false),
+          deviceAddress_(0),
+          arenaPage_(nullptr),
+          arenaSlot_(0),
+          memoryOffset_(0),
+          allocationSize_(0),
+          mapped_(nullptr)
+#ifdef EASYVK_USE_VMA
+          , allocation_(VK_NULL_HANDLE)
+#endif
+    {
+        std::string validationError;
+        if (!info.validate(validationError)) {
+            EVK_FAIL_VOID(validationError);
+        }
+
+        if (!dev.isValid()) {
+            EVK_FAIL_VOID("Device is not valid");
+        }
+
+        VkBufferUsageFlags usage = bufferUsageToVk(info.usage);
+        if (dev.bufferDeviceAddressEnabled()) {
+            usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        }
+        usageFlags_ = usage;
+
+        if (info.hostPointer) {
+            if (!dev.externalMemoryHostEnabled()) {
+                EVK_FAIL_VOID("Host pointer import needs VK_EXT_external_memory_host");
+            }
+            const VkDeviceSize alignment = dev.minImportedHostPointerAlignment();
+            if (reinterpret_cast<uintptr_t>(info.hostPointer) % alignment != 0 || size_ % alignment != 0) {
+                EVK_FAIL_VOID("Imported host pointer and size must be multiples of minImportedHostPointerAlignment (" +
+                              std::to_string(alignment) + ")");
+            }
+            if (importHostMemory(info.hostPointer, usage)) { // else lastError_ set (EASYVK_NO_EXCEPTIONS)
+                queryDeviceAddress();
+            }
+            return;
+        }
+
+        // The memory type is picked from hostAccess_ (Device::rankMemoryTypes); memFlags_
+        // ends up holding the flags of the type actually used.
+        if (!createVkBuffer(&buffer_, &memory_, size_, usage, info.persistentMap)) {
+            return; // lastError_ set (EASYVK_NO_EXCEPTIONS)
+        }
+        queryDeviceAddress();
+
+        // Arena slots (and VMA's MAPPED allocations) are already mapped; dedicated memory
+        // is mapped whole, once, and unmapped in teardown()
+        if (info.persistentMap && !mapped_) {
+            if (!(memFlags_ & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+                EVK_FAIL_VOID("Persistent mapping needs host-visible memory");
+            }
+            VkResult result = vkMapMemory(device_->vk(), memory_, 0, VK_WHOLE_SIZE, 0, &mapped_);
+            if (result != VK_SUCCESS) {
+                mapped_ = nullptr;
+                EVK_FAIL_VOID("Failed to persistently map buffer (" + std::string(vkResultString(result)) + ")");
+            }
+        }
+    }
+
+    Buffer::Buffer(Buffer &&other) noexcept
+        : device_(other.device_),
+          childRef_(std::move(other.childRef_)),
+          buffer_(other.buffer_),
+          memory_(other.memory_),
+          size_(other.size_),
+          memFlags_(other.memFlags_),
+          memoryTypeIndex_(other.memoryTypeIndex_),
+          hostAccess_(other.hostAccess_),
+          usageFlags_(other.usageFlags_),
+          tornDown_(other.tornDown_),
+          hostImported_(other.hostImported_),
+          deviceAddress_(other.deviceAddress_),
+          arenaPage_(other.arenaPage_),
+          arenaSlot_(other.arenaSlot_),
+          memoryOffset_(other.memoryOffset_),
+          allocationSize_(other.allocationSize_),
+          mapped_(other.mapped_)
+#ifdef EASYVK_USE_VMA
+          , allocation_(other.allocation_)
+#endif
+    {
+        other.buffer_ = VK_NULL_HANDLE;
+        other.memory_ = VK_NULL_HANDLE;
+        other.arenaPage_ = nullptr;
+        other.mapped_ = nullptr;
+        other.tornDown_ = true;
+#ifdef EASYVK_USE_VMA
+        other.allocation_ = VK_NULL_HANDLE;
+#endif
+    }
+
+    Buffer &Buffer::operator=(Buffer &&other) noexcept {
+        if (this != &other) {
+            teardown();
+            device_ = other.device_;
+            childRef_ = std::move(other.childRef_);
+            buffer_ = other.buffer_;
+            memory_ = other.memory_;
+            size_ = other.size_;
+            memFlags_ = other.memFlags_;
+            memoryTypeIndex_ = other.memoryTypeIndex_;
+            hostAccess_ = other.hostAccess_;
+            tornDown_ = other.tornDown_;
+            usageFlags_ = other.usageFlags_;
+            hostImported_ = other.hostImported_;
+            deviceAddress_ = other.deviceAddress_;
+            arenaPage_ = other.arenaPage_;
+            arenaSlot_ = other.arenaSlot_;
+            memoryOffset_ = other.memoryOffset_;
+            allocationSize_ = other.allocationSize_;
+            mapped_ = other.mapped_;
+
+#ifdef EASYVK_USE_VMA
+            allocation_ = other.allocation_;
+            other.allocation_ = VK_NULL_HANDLE;
+#endif
+
+            other.buffer_ = VK_NULL_HANDLE;
+            other.memory_ = VK_NULL_HANDLE;
+            other.arenaPage_ = nullptr;
+            other.mapped_ = nullptr;
+            other.tornDown_ = true;
+        }
+        return *this;
+    }
+
+    Buffer::~Buffer() noexcept {
+        if (!tornDown_) {
+            teardown();
+        }
+    }
+
+    BufferMapping Buffer::mapWrite(VkDeviceSize offsetBytes, VkDeviceSize lengthBytes) {
+        if (lengthBytes == VK_WHOLE_SIZE) {
+            if (offsetBytes >= size_) {
+                EVK_FAIL("Write map offset beyond buffer size");
+            }
+            lengthBytes = size_ - offsetBytes;
+        }
+        TraceScope trace(device_->tracer(), "mapWrite", lengthBytes);
+
+        if (!validateRange(offsetBytes, lengthBytes, "mapWrite")) {
+            return {};
+        }
+
+        if (hostAccess_ == HostAccess::None || (hostAccess_ != HostAccess::Write && hostAccess_ != HostAccess::ReadWrite)) {
+            EVK_FAIL("Buffer does not support write mapping");
+        }
+
+        // Map an aligned superset per nonCoherentAtomSize (safe for both coherent and non-coherent)
+        VkDeviceSize atom = device_->limits().nonCoherentAtomSize;
+        VkDeviceSize alignedOff = alignDown(offsetBytes, atom);
+        VkDeviceSize alignedLen = alignUp(lengthBytes + (offsetBytes - alignedOff), atom);
+        // Clamp to allocation size
+        if (alignedOff + alignedLen > size_) alignedLen = size_ - alignedOff;
+
+        void *base = nullptr;
+        if (mapped_) {
+            // Persistently mapped (arena page, persistentMap, imported host memory): just a view
+            return {this, static_cast<char *>(mapped_) + offsetBytes, alignedOff, alignedLen, true};
+        }
+#ifdef EASYVK_USE_VMA
+        if (allocation_ != VK_NULL_HANDLE) {
+            // VMA maps the entire allocation starting at offset 0
+            VkResult result = vmaMapMemory(device_->allocator(), allocation_, &base);
+            if (result != VK_SUCCESS) {
+                EVK_FAIL("Failed to map VMA buffer for writing");
+            }
+            void *userPtr = static_cast<char *>(base) + offsetBytes;
+            return {this, userPtr, alignedOff, alignedLen, true};
+        } else
+#endif
+        {
+            // Raw Vulkan maps [alignedOff, alignedOff+alignedLen)
+            VkResult result = vkMapMemory(device_->vk(), memory_, alignedOff, alignedLen, 0, &base);
+            if (result != VK_SUCCESS) {
+                EVK_FAIL("Failed to map buffer for writing");
+            }
+            void *userPtr = static_cast<char *>(base) + (offsetBytes - alignedOff);
+            return {this, userPtr, alignedOff, alignedLen, true};
+        }
+    }
+
+    BufferMapping Buffer::mapRead(VkDeviceSize offsetBytes, VkDeviceSize lengthBytes) {
+        if (lengthBytes == VK_WHOLE_SIZE) {
+            if (offsetBytes >= size_) {
+                EVK_FAIL("Read map offset beyond buffer size");
+            }
+            lengthBytes = size_ - offsetBytes;
+        }
+        TraceScope trace(device_->tracer(), "mapRead", lengthBytes);
+
+        if (!validateRange(offsetBytes, lengthBytes, "mapRead")) {
+            return {};
+        }
+
+        if (hostAccess_ == HostAccess::None || (hostAccess_ != HostAccess::Read && hostAccess_ != HostAccess::ReadWrite)) {
+            EVK_FAIL("Buffer does not support read mapping");
+        }
+
+        // Map an aligned superset (see spec VUs for nonCoherentAtomSize alignment)
+        VkDeviceSize atom = device_->limits().nonCoherentAtomSize;
+        VkDeviceSize alignedOff = alignDown(offsetBytes, atom);
+        VkDeviceSize alignedLen = alignUp(lengthBytes + (offsetBytes - alignedOff), atom);
+        if (alignedOff + alignedLen > size_) alignedLen = size_ - alignedOff;
+
+        void *base = nullptr;
+        if (mapped_) {
+            if (!(memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+                invalidateRange(alignedOff, alignedLen);
+            }
+            return {this, static_cast<char *>(mapped_) + offsetBytes, alignedOff, alignedLen, false};
+        }
+#ifdef EASYVK_USE_VMA
+        if (allocation_ != VK_NULL_HANDLE) {
+            // VMA maps the entire allocation
+            VkResult result = vmaMapMemory(device_->allocator(), allocation_, &base);
+            if (result != VK_SUCCESS) {
+                EVK_FAIL("Failed to map VMA buffer for reading");
+            }
+            void *userPtr = static_cast<char *>(base) + offsetBytes;
+            // For non-coherent memory: invalidate the mapped span
+            if (!(memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+                invalidateRange(alignedOff, alignedLen);
+            }
+            return {this, userPtr, alignedOff, alignedLen, false};
+        } else
+#endif
+        {
+            // Raw Vulkan maps the aligned subrange
+            VkResult result = vkMapMemory(device_->vk(), memory_, alignedOff, alignedLen, 0, &base);
+            if (result != VK_SUCCESS) {
+                EVK_FAIL("Failed to map buffer for reading");
+            }
+            void *userPtr = static_cast<char *>(base) + (offsetBytes - alignedOff);
+            if (!(memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+                invalidateRange(alignedOff, alignedLen);
+            }
+            return {this, userPtr, alignedOff, alignedLen, false};
+        }
+    }
+
+    BufferView Buffer::view(VkDeviceSize offsetBytes, VkDeviceSize lengthBytes) const {
+        if (lengthBytes == VK_WHOLE_SIZE) {
+            lengthBytes = offsetBytes < size_ ? size_ - offsetBytes : 0;
+        }
+        if (!validateRange(offsetBytes, lengthBytes, "view")) {
+            return BufferView();
+        }
+        return BufferView(*this, offsetBytes, lengthBytes);
+    }
+
+    bool Buffer::copyTo(Buffer &dst, VkDeviceSize bytes, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+        SubmitHandle handle = copyToAsync(dst, bytes, srcOffset, dstOffset);
+        if (!handle.isValid()) return false;
+        return device_->wait(handle);
+    }
+
+    SubmitHandle Buffer::copyToAsync(Buffer &dst, VkDeviceSize bytes, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+        if (bytes == VK_WHOLE_SIZE) {
+            if (srcOffset >= size_) {
+                EVK_FAIL("Copy source offset beyond buffer size");
+            }
+            bytes = std::min(size_ - srcOffset, dst.size_ - dstOffset);
+        }
+        TraceScope trace(device_->tracer(), "copy", bytes);
+
+        if (!validateRange(srcOffset, bytes, "copyToAsync source")) {
+            return {};
+        }
+        if (!dst.validateRange(dstOffset, bytes, "copyToAsync destination")) {
+            return {};
+        }
+
+        VkBufferCopy copyRegion{srcOffset, dstOffset, bytes};
+        if (device_->useTransferQueueFor(bytes)) {
+            return device_->copyOnTransferQueue(*this, dst, copyRegion);
+        }
+
+        VkCommandBuffer cmdBuf = beginOneShot();
+        if (cmdBuf == VK_NULL_HANDLE) return {};
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf, "copy", VK_PIPELINE_STAGE_TRANSFER_BIT)
+                                       : UINT32_MAX;
+        vkCmdCopyBuffer(cmdBuf, buffer_, dst.buffer_, 1, &copyRegion);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf, slot, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        return submitOneShot(cmdBuf, slot);
+    }
+
+    bool Buffer::fill(uint32_t value, VkDeviceSize offset, VkDeviceSize size) {
+        SubmitHandle handle = fillAsync(value, offset, size);
+        if (!handle.isValid()) return false;
+        return device_->wait(handle);
+    }
+
+    SubmitHandle Buffer::fillAsync(uint32_t value, VkDeviceSize offset, VkDeviceSize size) {
+        if (!validateFill(offset, size, "fillAsync")) {
+            return {};
+        }
+
+        VkCommandBuffer cmdBuf = beginOneShot();
+        if (cmdBuf == VK_NULL_HANDLE) return {};
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf, "fill", VK_PIPELINE_STAGE_TRANSFER_BIT)
+                                       : UINT32_MAX;
+        vkCmdFillBuffer(cmdBuf, buffer_, offset, size, value);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf, slot, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        return submitOneShot(cmdBuf, slot);
+    }
+
+    bool Buffer::update(const void *data, VkDeviceSize offset, VkDeviceSize size) {
+        SubmitHandle handle = updateAsync(data, offset, size);
+        if (!handle.isValid()) return false;
+        return device_->wait(handle);
+    }
+
+    SubmitHandle Buffer::updateAsync(const void *data, VkDeviceSize offset, VkDeviceSize size) {
+        if (!validateUpdate(data, offset, size, "updateAsync")) {
+            return {};
+        }
+
+        VkCommandBuffer cmdBuf = beginOneShot();
+        if (cmdBuf == VK_NULL_HANDLE) return {};
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf, "update", VK_PIPELINE_STAGE_TRANSFER_BIT)
+                                       : UINT32_MAX;
+        vkCmdUpdateBuffer(cmdBuf, buffer_, offset, size, data);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf, slot, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        return submitOneShot(cmdBuf, slot);
+    }
+
+    VkCommandBuffer Buffer::beginOneShot() {
+        VkCommandBuffer cmdBuf = device_->acquireCommandBuffer();
+
+        VkCommandBufferBeginInfo beginInfo{
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            nullptr,
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            nullptr
+        };
+        VkResult result = vkBeginCommandBuffer(cmdBuf, &beginInfo);
+        if (result != VK_SUCCESS) {
+            device_->releaseCommandBuffer(cmdBuf);
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = std::string("Failed to begin command buffer (") + vkResultString(result) + ")";
+            return VK_NULL_HANDLE;
+#else
+            throw std::runtime_error(std::string("Failed to begin command buffer (") + vkResultString(result) + ")");
+#endif
+        }
+        return cmdBuf;
+    }
+
+    SubmitHandle Buffer::submitOneShot(VkCommandBuffer cmdBuf, uint32_t profileSlot) {
+        Profiler *profiler = device_->profiler();
+        VkResult result = vkEndCommandBuffer(cmdBuf);
+        if (result != VK_SUCCESS) {
+            device_->releaseCommandBuffer(cmdBuf);
+            if (profileSlot != UINT32_MAX && profiler) profiler->cancel(&profileSlot, 1);
+            VK_CHECK(result);
+        }
+        SubmitHandle handle = device_->submitCommands(cmdBuf, true);
+        if (!handle.isValid() && profileSlot != UINT32_MAX && profiler) profiler->cancel(&profileSlot, 1);
+        return handle;
+    }
+
+    // Rules shared by vkCmdFillBuffer callers. VK_WHOLE_SIZE fills up to the last full word.
+    bool Buffer::validateFill(VkDeviceSize offset, VkDeviceSize size, const char *operation) const {
+        if (offset % 4 != 0) {
+            EVK_FAIL(std::string("Buffer ") + operation + ": offset must be a multiple of 4");
+        }
+        if (size == VK_WHOLE_SIZE) {
+            if (offset >= size_) {
+                EVK_FAIL(std::string("Buffer ") + operation + ": offset beyond buffer size");
+            }
+            if (size_ - offset < 4) {
+                EVK_FAIL(std::string("Buffer ") + operation + ": less than 4 bytes past offset");
+            }
+            return true;
+        }
+        if (size % 4 != 0) {
+            EVK_FAIL(std::string("Buffer ") + operation + ": size must be a multiple of 4");
+        }
+        return validateRange(offset, size, operation);
+    }
+
+    bool Buffer::validateUpdate(const void *data, VkDeviceSize offset, VkDeviceSize size, const char *operation) const {
+        if (data == nullptr) {
+            EVK_FAIL(std::string("Buffer ") + operation + ": data is null");
+        }
+        if (offset % 4 != 0 || size % 4 != 0) {
+            EVK_FAIL(std::string("Buffer ") + operation + ": offset and size must be multiples of 4");
+        }
+        if (size > maxInlineUpdateSize) {
+            EVK_FAIL(std::string("Buffer ") + operation + ": size exceeds 65536 bytes, use a staging copy");
+        }
+        return validateRange(offset, size, operation);
+    }
+
+    bool Buffer::validateRange(VkDeviceSize offset, VkDeviceSize len, const char *operation) const {
+        if (len == 0) {
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = std::string("Buffer ") + operation + ": length cannot be zero";
+            return false;
+#else
+            throw std::invalid_argument(std::string("Buffer ") + operation + ": length cannot be zero");
+#endif
+        }
+
+        if (offset >= size_) {
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = std::string("Buffer ") + operation + ": offset beyond buffer size";
+            return false;
+#else
+            throw std::out_of_range(std::string("Buffer ") + operation + ": offset beyond buffer size");
+#endif
+        }
+
+        // Check for overflow: offset + len should not overflow and should not exceed size_
+        if (offset > size_ - len) { // Avoids overflow in offset + len
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = std::string("Buffer ") + operation + ": range exceeds buffer bounds (offset=" +
+                std::to_string(offset) + " len=" + std::to_string(len) + " size=" + std::to_string(size_) + ")";
+            return false;
+#else
+            throw std::out_of_range(std::string("Buffer ") + operation + ": range exceeds buffer bounds (offset=" +
+                std::to_string(offset) + " len=" + std::to_string(len) + " size=" + std::to_string(size_) + ")");
+#endif
+        }
+
+        return true;
+    }
+
+    bool Buffer::createVkBuffer(VkBuffer *buf, VkDeviceMemory *mem, VkDeviceSize sizeBytes,
+                                VkBufferUsageFlags usage, bool persistentMap) {
+        VkBufferCreateInfo bufferInfo{
+            VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            nullptr,
+            0,
+            sizeBytes,
+            usage,
+            VK_SHARING_MODE_EXCLUSIVE,
+            0, nullptr
+        };
+
+#ifdef EASYVK_USE_VMA
+        if (device_->allocator() != VK_NULL_HANDLE) {
+            VmaAllocationCreateInfo allocInfo{};
+            if (hostAccess_ == HostAccess::None) {
+                allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+            } else if (hostAccess_ == HostAccess::Write) {
+                allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+                allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+            } else if (hostAccess_ == HostAccess::Read) {
+                allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+                allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+            } else { // HostAccess::ReadWrite
+                allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+                allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+            }
+            if (persistentMap) {
+                allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT; // VMA keeps it mapped until destroy
+            }
+
+            VmaAllocationInfo allocationInfo;
+            VkResult result = vmaCreateBuffer(device_->allocator(), &bufferInfo, &allocInfo, buf, &allocation_, &allocationInfo);
+            if (result != VK_SUCCESS) {
+#ifdef EASYVK_NO_EXCEPTIONS
+                lastError_ = "VMA buffer creation failed: " + std::string(vkResultString(result));
+                return false;
+#else
+                throw VulkanError(result, "VMA buffer creation failed", __FILE__, __LINE__);
+#endif
+            }
+            *mem = VK_NULL_HANDLE; // Memory owned by VMA
+            memoryTypeIndex_ = allocationInfo.memoryType;
+            allocationSize_ = allocationInfo.size;
+            device_->counters_->allocated(memoryTypeIndex_, allocationSize_);
+            memFlags_ = device_->memoryProperties().memoryTypes[memoryTypeIndex_].propertyFlags;
+            mapped_ = persistentMap ? allocationInfo.pMappedData : nullptr;
+            return true;
+        }
+#endif
+
+        // Fallback to manual allocation; mapping is left to the caller here
+        (void)persistentMap;
+        VkResult result = vkCreateBuffer(device_->vk(), &bufferInfo, nullptr, buf);
+        if (result != VK_SUCCESS) {
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = "Buffer creation failed: " + std::string(vkResultString(result));
+            return false;
+#else
+            throw VulkanError(result, "Buffer creation failed", __FILE__, __LINE__);
+#endif
+        }
+
+        VkMemoryRequirements memReqs;
+        vkGetBufferMemoryRequirements(device_->vk(), *buf, &memReqs);
+
+        std::vector<uint32_t> candidates = device_->rankMemoryTypes(memReqs.memoryTypeBits, hostAccess_, memReqs.size);
+        if (candidates.empty()) {
+            vkDestroyBuffer(device_->vk(), *buf, nullptr);
+            *buf = VK_NULL_HANDLE;
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = "Failed to find suitable memory type";
+            return false;
+#else
+            throw std::runtime_error("Failed to find suitable memory type");
+#endif
+        }
+
+        // Walk the ranking; a full heap (e.g. a small BAR window) falls through to the next type
+        for (uint32_t memoryTypeIndex : candidates) {
+            memoryTypeIndex_ = memoryTypeIndex;
+            memFlags_ = device_->memoryProperties().memoryTypes[memoryTypeIndex].propertyFlags;
+
+            // Small buffers share pooled pages; fall back to a dedicated allocation otherwise
+            if (MemoryArena *arena = device_->memoryArena()) {
+                MemoryArena::Allocation slot;
+                if (arena->allocate(memReqs, memoryTypeIndex, slot) == VK_SUCCESS) {
+                    result = vkBindBufferMemory(device_->vk(), *buf, slot.memory, slot.offset);
+                    if (result == VK_SUCCESS) {
+                        *mem = slot.memory;
+                        arenaPage_ = slot.page;
+                        arenaSlot_ = slot.slot;
+                        memoryOffset_ = slot.offset;
+                        allocationSize_ = slot.size;
+                        mapped_ = slot.mapped;
+                        return true;
+                    }
+                    arena->free(slot.page, slot.slot);
+                }
+            }
+
+            VkMemoryAllocateFlagsInfo flagsInfo{
+                VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO, nullptr, VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, 0
+            };
+            VkMemoryAllocateInfo allocInfo{
+                VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                device_->bufferDeviceAddressEnabled() ? &flagsInfo : nullptr,
+                memReqs.size,
+                memoryTypeIndex
+            };
+            result = vkAllocateMemory(device_->vk(), &allocInfo, nullptr, mem);
+            if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY) {
+                continue;
+            }
+            break;
+        }
+
+        if (result != VK_SUCCESS) {
+            vkDestroyBuffer(device_->vk(), *buf, nullptr);
+            *buf = VK_NULL_HANDLE;
+            *mem = VK_NULL_HANDLE;
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = "Memory allocation failed: " + std::string(vkResultString(result));
+            return false;
+#else
+            throw VulkanError(result, "Memory allocation failed", __FILE__, __LINE__);
+#endif
+        }
+
+        result = vkBindBufferMemory(device_->vk(), *buf, *mem, 0);
+        if (result != VK_SUCCESS) {
+            vkFreeMemory(device_->vk(), *mem, nullptr);
+            vkDestroyBuffer(device_->vk(), *buf, nullptr);
+            *mem = VK_NULL_HANDLE;
+            *buf = VK_NULL_HANDLE;
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = "Buffer memory binding failed: " + std::string(vkResultString(result));
+            return false;
+#else
+            throw VulkanError(result, "Buffer memory binding failed", __FILE__, __LINE__);
+#endif
+        }
+        allocationSize_ = memReqs.size;
+        device_->counters_->allocated(memoryTypeIndex_, allocationSize_);
+
+        return true;
+    }
+
+    bool Buffer::importHostMemory(void *hostPointer, VkBufferUsageFlags usage) {
+        VkExternalMemoryBufferCreateInfo externalInfo{
+            VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+            nullptr,
+            VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT
+        };
+        VkBufferCreateInfo bufferInfo{
+            VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            &externalInfo,
+            0,
+            size_,
+            usage,
+            VK_SHARING_MODE_EXCLUSIVE,
+            0, nullptr
+        };
+        EVK_CHECK(vkCreateBuffer(device_->vk(), &bufferInfo, nullptr, &buffer_), "Imported buffer creation failed");
+
+        VkMemoryRequirements memReqs;
+        vkGetBufferMemoryRequirements(device_->vk(), buffer_, &memReqs);
+
+        // The pointer itself restricts the usable memory types (typically host-cached system RAM)
+        VkMemoryHostPointerPropertiesEXT pointerProps{VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT, nullptr, 0};
+        VkResult result = vkGetMemoryHostPointerPropertiesEXT(device_->vk(), VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+                                                              hostPointer, &pointerProps);
+        // Coherent types only: imported memory is never vkMapMemory'd, so it cannot be flushed
+        uint32_t coherentBits = 0;
+        const VkPhysicalDeviceMemoryProperties &memProps = device_->memoryProperties();
+        for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+            if (memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+                coherentBits |= 1u << i;
+            }
+        }
+        std::vector<uint32_t> candidates;
+        if (result == VK_SUCCESS && memReqs.size <= size_) {
+            candidates = device_->rankMemoryTypes(memReqs.memoryTypeBits & pointerProps.memoryTypeBits & coherentBits,
+                                                  hostAccess_, size_);
+        }
+        if (candidates.empty()) {
+            vkDestroyBuffer(device_->vk(), buffer_, nullptr);
+            buffer_ = VK_NULL_HANDLE;
+            EVK_FAIL(result != VK_SUCCESS ? "Host pointer cannot be imported (" + std::string(vkResultString(result)) + ")"
+                                           : std::string("No memory type can back the imported host pointer"));
+        }
+
+        memoryTypeIndex_ = candidates[0];
+        memFlags_ = device_->memoryProperties().memoryTypes[memoryTypeIndex_].propertyFlags;
+
+        VkMemoryAllocateFlagsInfo flagsInfo{
+            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO, nullptr, VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, 0
+        };
+        VkImportMemoryHostPointerInfoEXT importInfo{
+            VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT,
+            device_->bufferDeviceAddressEnabled() ? &flagsInfo : nullptr,
+            VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+            hostPointer
+        };
+        VkMemoryAllocateInfo allocInfo{
+            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            &importInfo,
+            size_, // whole aligned host range; validated against minImportedHostPointerAlignment
+            memoryTypeIndex_
+        };
+        result = vkAllocateMemory(device_->vk(), &allocInfo, nullptr, &memory_);
+        if (result == VK_SUCCESS) {
+            result = vkBindBufferMemory(device_->vk(), buffer_, memory_, 0);
+        }
+        if (result != VK_SUCCESS) {
+            if (memory_ != VK_NULL_HANDLE) {
+                vkFreeMemory(device_->vk(), memory_, nullptr);
+                memory_ = VK_NULL_HANDLE;
+            }
+            vkDestroyBuffer(device_->vk(), buffer_, nullptr);
+            buffer_ = VK_NULL_HANDLE;
+            EVK_FAIL("Host pointer import failed (" + std::string(vkResultString(result)) + ")");
+        }
+
+        allocationSize_ = size_;
+        device_->counters_->allocated(memoryTypeIndex_, allocationSize_);
+
+        // The host allocation is the mapping; the device memory never gets vkMapMemory'd
+        mapped_ = hostPointer;
+        hostImported_ = true;
+        return true;
+    }
+
+    void Buffer::queryDeviceAddress() {
+        if (!device_->bufferDeviceAddressEnabled() || buffer_ == VK_NULL_HANDLE) return;
+        VkBufferDeviceAddressInfo addressInfo{VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, nullptr, buffer_};
+        deviceAddress_ = vkGetBufferDeviceAddress ? vkGetBufferDeviceAddress(device_->vk(), &addressInfo)
+                                                  : vkGetBufferDeviceAddressKHR(device_->vk(), &addressInfo);
+    }
+
+    bool Buffer::flush(VkDeviceSize offsetBytes, VkDeviceSize lengthBytes) {
+        if (lengthBytes == VK_WHOLE_SIZE) {
+            lengthBytes = offsetBytes < size_ ? size_ - offsetBytes : 0;
+        }
+        if (!validateRange(offsetBytes, lengthBytes, "flush")) {
+            return false;
+        }
+        if (!mapped_) {
+            EVK_FAIL("Buffer flush needs a persistently mapped buffer");
+        }
+        flushRange(offsetBytes, lengthBytes);
+        return true;
+    }
+
+    bool Buffer::invalidate(VkDeviceSize offsetBytes, VkDeviceSize lengthBytes) {
+        if (lengthBytes == VK_WHOLE_SIZE) {
+            lengthBytes = offsetBytes < size_ ? size_ - offsetBytes : 0;
+        }
+        if (!validateRange(offsetBytes, lengthBytes, "invalidate")) {
+            return false;
+        }
+        if (!mapped_) {
+            EVK_FAIL("Buffer invalidate needs a persistently mapped buffer");
+        }
+        invalidateRange(offsetBytes, lengthBytes);
+        return true;
+    }
+
+    void Buffer::flushRange(VkDeviceSize offset, VkDeviceSize sizeBytes) {
+        if (memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) return;
+
+#ifdef EASYVK_USE_VMA
+        if (allocation_ != VK_NULL_HANDLE) {
+            VK_CHECK(vmaFlushAllocation(device_->allocator(), allocation_, offset, sizeBytes));
+            return;
+        }
+#endif
+
+        VkDeviceSize atomSize = device_->limits().nonCoherentAtomSize;
+        VkDeviceSize alignedOffset = alignDown(offset, atomSize);
+        VkDeviceSize alignedSize = alignUp(sizeBytes + (offset - alignedOffset), atomSize);
+
+        // Clamp to buffer size (arena slots are atom-aligned, so clamp to the slot instead)
+        const VkDeviceSize limit = arenaPage_ ? allocationSize_ : size_;
+        if (alignedOffset + alignedSize > limit) {
+            alignedSize = limit - alignedOffset;
+        }
+
+        VkMappedMemoryRange range{
+            VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            nullptr,
+            memory_,
+            memoryOffset_ + alignedOffset,
+            alignedSize
+        };
+        VK_CHECK(vkFlushMappedMemoryRanges(device_->vk(), 1, &range));
+    }
+
+    void Buffer::invalidateRange(VkDeviceSize offset, VkDeviceSize sizeBytes) {
+        if (memFlags_ & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) return;
+
+#ifdef EASYVK_USE_VMA
+        if (allocation_ != VK_NULL_HANDLE) {
+            VK_CHECK(vmaInvalidateAllocation(device_->allocator(), allocation_, offset, sizeBytes));
+            return;
+        }
+#endif
+
+        VkDeviceSize atomSize = device_->limits().nonCoherentAtomSize;
+        VkDeviceSize alignedOffset = alignDown(offset, atomSize);
+        VkDeviceSize alignedSize = alignUp(sizeBytes + (offset - alignedOffset), atomSize);
+
+        // Clamp to buffer size (arena slots are atom-aligned, so clamp to the slot instead)
+        const VkDeviceSize limit = arenaPage_ ? allocationSize_ : size_;
+        if (alignedOffset + alignedSize > limit) {
+            alignedSize = limit - alignedOffset;
+        }
+
+        VkMappedMemoryRange range{
+            VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            nullptr,
+            memory_,
+            memoryOffset_ + alignedOffset,
+            alignedSize
+        };
+        VK_CHECK(vkInvalidateMappedMemoryRanges(device_->vk(), 1, &range));
+    }
+
+    void Buffer::teardown() {
+        if (tornDown_) return;
+
+#ifdef EASYVK_USE_VMA
+        if (allocation_ != VK_NULL_HANDLE) {
+            vmaDestroyBuffer(device_->allocator(), buffer_, allocation_);
+            device_->counters_->freed(memoryTypeIndex_, allocationSize_);
+            buffer_ = VK_NULL_HANDLE;
+            allocation_ = VK_NULL_HANDLE;
+        } else
+#endif
+        {
+            if (buffer_ != VK_NULL_HANDLE) {
+                vkDestroyBuffer(device_->vk(), buffer_, nullptr);
+                buffer_ = VK_NULL_HANDLE;
+            }
+
+            if (arenaPage_) {
+                device_->memoryArena()->free(arenaPage_, arenaSlot_);
+                arenaPage_ = nullptr;
+                mapped_ = nullptr;
+                memory_ = VK_NULL_HANDLE;
+            } else if (memory_ != VK_NULL_HANDLE) {
+                if (mapped_ && !hostImported_) {
+                    vkUnmapMemory(device_->vk(), memory_);
+                }
+                vkFreeMemory(device_->vk(), memory_, nullptr);
+                device_->counters_->freed(memoryTypeIndex_, allocationSize_);
+                memory_ = VK_NULL_HANDLE;
+            }
+        }
+
+        mapped_ = nullptr;
+        tornDown_ = true;
+    }
+
+    // -------- StagingRing implementation ----------------------------------------
+    // Persistently mapped host-visible buffer split into fixed-size slots. Every slot
+    // remembers the submission that last used it, so a slot is only overwritten (upload)
+    // or read back (download) once its own copy has completed.
+    class StagingRing {
+    public:
+        StagingRing(Device &dev, VkDeviceSize chunkBytes, uint32_t chunkCount);
+        ~StagingRing() noexcept;
+
+        StagingRing(const StagingRing &) = delete;
+        StagingRing &operator=(const StagingRing &) = delete;
+
+        bool upload(Buffer &dst, const void *src, VkDeviceSize bytes, VkDeviceSize dstOffset);
+        bool download(Buffer &src, void *dst, VkDeviceSize bytes, VkDeviceSize srcOffset);
+
+    private:
+        struct Slot {
+            VkDeviceSize offset;  // slot start inside the staging buffer
+            VkDeviceSize length;  // bytes of the chunk currently in flight
+            VkDeviceSize hostOffset;
+            SubmitHandle pending;
+        };
+
+        Device *device_;
+        VkDeviceSize chunkBytes_;
+        Buffer buffer_;
+        BufferMapping mapping_; // declared after buffer_ so it is unmapped first
+        char *base_;
+        std::vector<Slot> slots_;
+        std::mutex lock_; // one transfer at a time owns the ring
+
+        bool retire(Slot &slot);
+        bool retireAll();
+        SubmitHandle submitCopy(VkBuffer src, VkDeviceSize srcOffset, VkBuffer dst, VkDeviceSize dstOffset,
+                                VkDeviceSize bytes, bool toDevice);
+    };
+
+    StagingRing::StagingRing(Device &dev, VkDeviceSize chunkBytes, uint32_t chunkCount)
+        : device_(&dev),
+          chunkBytes_(alignUp(chunkBytes, dev.limits().nonCoherentAtomSize)),
+          buffer_(dev, BufferCreateInfo(chunkBytes_ * chunkCount, BufferUsage::Staging, HostAccess::ReadWrite)),
+          mapping_(buffer_.mapWrite()),
+          base_(mapping_.as<char>()),
+          slots_(chunkCount) {
+        for (uint32_t i = 0; i < chunkCount; ++i) {
+            slots_[i].offset = chunkBytes_ * i;
+            slots_[i].length = 0;
+            slots_[i].hostOffset = 0;
+        }
+    }
+
+    StagingRing::~StagingRing() noexcept {
+        for (Slot &slot : slots_) {
+            if (slot.pending.isValid()) {
+                device_->wait(slot.pending);
+            }
+        }
+    }
+
+    bool StagingRing::retire(Slot &slot) {
+        if (!slot.pending.isValid()) return true;
+        bool ok = device_->wait(slot.pending);
+        slot.pending = SubmitHandle();
+        return ok;
+    }
+
+    bool StagingRing::retireAll() {
+        bool ok = true;
+        for (Slot &slot : slots_) {
+            ok = retire(slot) && ok;
+        }
+        return ok;
+    }
+
+    SubmitHandle StagingRing::submitCopy(VkBuffer src, VkDeviceSize srcOffset, VkBuffer dst, VkDeviceSize dstOffset,
+                                         VkDeviceSize bytes, bool toDevice) {
+        VkCommandBuffer cmdBuf = device_->acquireCommandBuffer();
+
+        VkCommandBufferBeginInfo beginInfo{
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            nullptr,
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            nullptr
+        };
+        VK_CHECK(vkBeginCommandBuffer(cmdBuf, &beginInfo));
+
+        VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, 0, 0};
+        if (toDevice) {
+            // Upload: earlier GPU reads (WAR) and writes (WAW) of the destination range finish
+            // before the copy overwrites it
+            RangeBarrier before{dst, dstOffset, bytes,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                                VK_ACCESS_TRANSFER_WRITE_BIT};
+            recordBarriers(*device_, cmdBuf, &before, 1);
+        } else {
+            // Readback: make earlier shader/transfer writes to the source visible to the copy
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(cmdBuf,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        VkBufferCopy region{srcOffset, dstOffset, bytes};
+        vkCmdCopyBuffer(cmdBuf, src, dst, 1, &region);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        if (toDevice) {
+            // Uploaded data is consumed by later dispatches and copies
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                                    VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(cmdBuf,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        } else {
+            barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            vkCmdPipelineBarrier(cmdBuf,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_HOST_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+        VK_CHECK(vkEndCommandBuffer(cmdBuf));
+
+        return device_->submitCommands(cmdBuf, true);
+    }
+
+    bool StagingRing::upload(Buffer &dst, const void *src, VkDeviceSize bytes, VkDeviceSize dstOffset) {
+        if (!dst.validateRange(dstOffset, bytes, "upload destination")) return false;
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!retireAll()) return false;
+
+        const char *hostSrc = static_cast<const char *>(src);
+        const size_t slotCount = slots_.size();
+        size_t chunk = 0;
+        for (VkDeviceSize done = 0; done < bytes; done += chunkBytes_, ++chunk) {
+            Slot &slot = slots_[chunk % slotCount];
+            // Block only on the copy that last read this slot; the other slots keep the
+            // DMA engine busy while we fill this one
+            if (!retire(slot)) return false;
+
+            const VkDeviceSize len = std::min(chunkBytes_, bytes - done);
+            std::memcpy(base_ + slot.offset, hostSrc + done, static_cast<size_t>(len));
+            buffer_.flushRange(slot.offset, len);
+            slot.length = len;
+            slot.hostOffset = done;
+            slot.pending = submitCopy(buffer_.vk(), slot.offset, dst.vk(), dstOffset + done, len, true);
+        }
+
+        return retireAll();
+    }
+
+    bool StagingRing::download(Buffer &src, void *dst, VkDeviceSize bytes, VkDeviceSize srcOffset) {
+        if (!src.validateRange(srcOffset, bytes, "download source")) return false;
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!retireAll()) return false;
+
+        char *hostDst = static_cast<char *>(dst);
+        const size_t slotCount = slots_.size();
+        const size_t chunkCount = static_cast<size_t>((bytes + chunkBytes_ - 1) / chunkBytes_);
+        size_t issued = 0;
+        for (size_t drained = 0; drained < chunkCount; ++drained) {
+            // Keep every slot in flight, then drain them in submission order
+            for (; issued < chunkCount && issued - drained < slotCount; ++issued) {
+                Slot &slot = slots_[issued % slotCount];
+                const VkDeviceSize done = static_cast<VkDeviceSize>(issued) * chunkBytes_;
+                slot.length = std::min(chunkBytes_, bytes - done);
+                slot.hostOffset = done;
+                slot.pending = submitCopy(src.vk(), srcOffset + done, buffer_.vk(), slot.offset, slot.length, false);
+            }
+
+            Slot &slot = slots_[drained % slotCount];
+            if (!retire(slot)) return false;
+            buffer_.invalidateRange(slot.offset, slot.length);
+            std::memcpy(hostDst + slot.hostOffset, base_ + slot.offset, static_cast<size_t>(slot.length));
+        }
+        return true;
+    }
+
+    StagingRing *Device::stagingRing() {
+        std::lock_guard<std::mutex> lock(*lazyInitLock_);
+        if (!staging_) {
+            staging_.reset(new StagingRing(*this, stagingChunkBytes_, stagingChunkCount_));
+        }
+        return staging_.get();
+    }
+
+    bool Device::upload(Buffer &dst, const void *src, VkDeviceSize bytes, VkDeviceSize dstOffset) {
+        if (bytes == 0) return true;
+        if (!src) {
+            EVK_FAIL("upload: source pointer is null");
+        }
+        if (dst.isValid() && &dst.device() != this) {
+            EVK_FAIL("upload: destination buffer belongs to a different device");
+        }
+        return stagingRing()->upload(dst, src, bytes, dstOffset);
+    }
+
+    bool Device::download(Buffer &src, void *dst, VkDeviceSize bytes, VkDeviceSize srcOffset) {
+        if (bytes == 0) return true;
+        if (!dst) {
+            EVK_FAIL("download: destination pointer is null");
+        }
+        if (src.isValid() && &src.device() != this) {
+            EVK_FAIL("download: source buffer belongs to a different device");
+        }
+        return stagingRing()->download(src, dst, bytes, srcOffset);
+    }
+
+    // -------- ComputeBindings implementation ------------------------------------
+    void ComputeBindings::addStorage(uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
+        entries.emplace_back(
+            binding,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            buf.vk(),
+            offset,
+            range == VK_WHOLE_SIZE ? buf.size() : range
+        );
+    }
+
+    void ComputeBindings::addUniform(uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
+        entries.emplace_back(
+            binding,
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            buf.vk(),
+            offset,
+            range == VK_WHOLE_SIZE ? buf.size() : range
+        );
+    }
+
+    void ComputeBindings::addStorageArray(uint32_t set, uint32_t binding, const std::vector<Buffer *> &buffers) {
+        std::vector<VkDescriptorBufferInfo> bufferInfos;
+        bufferInfos.reserve(buffers.size());
+        for (const Buffer *buf : buffers) {
+            if (buf) {
+                bufferInfos.push_back({buf->vk(), 0, buf->size()});
+            }
+        }
+        entries.emplace_back(set, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfos);
+    }
+
+    void ComputeBindings::addUniformArray(uint32_t set, uint32_t binding, const std::vector<Buffer *> &buffers) {
+        std::vector<VkDescriptorBufferInfo> bufferInfos;
+        bufferInfos.reserve(buffers.size());
+        for (const Buffer *buf : buffers) {
+            if (buf) {
+                bufferInfos.push_back({buf->vk(), 0, buf->size()});
+            }
+        }
+        entries.emplace_back(set, binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, bufferInfos);
+    }
+
+    void ComputeBindings::addStorageToSet(uint32_t set, uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
+        std::vector<VkDescriptorBufferInfo> bufferInfos;
+        bufferInfos.push_back({buf.vk(), offset, range == VK_WHOLE_SIZE ? buf.size() : range});
+        entries.emplace_back(set, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfos);
+    }
+
+    void ComputeBindings::addUniformToSet(uint32_t set, uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
+        std::vector<VkDescriptorBufferInfo> bufferInfos;
+        bufferInfos.push_back({buf.vk(), offset, range == VK_WHOLE_SIZE ? buf.size() : range});
+        entries.emplace_back(set, binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, bufferInfos);
+    }
+
+    bool ComputeBindings::checkView(const BufferView &view, const char *what) {
+        if (!view.buffer || !view.buffer->isValid()) {
+            EVK_FAIL(std::string(what) + ": view has no valid buffer");
+        }
+        const VkDeviceSize size = view.buffer->size();
+        if (view.offset >= size || (view.range != VK_WHOLE_SIZE && view.range > size - view.offset)) {
+            EVK_FAIL(std::string(what) + ": view [" + std::to_string(view.offset) + ", +" +
+                     std::to_string(view.range) + ") exceeds buffer size " + std::to_string(size));
+        }
+        if (view.range == 0) {
+            EVK_FAIL(std::string(what) + ": view range is zero");
+        }
+        return true;
+    }
+
+    void ComputeBindings::addStorage(uint32_t binding, const BufferView &view) {
+        if (!checkView(view, "addStorage")) return;
+        addStorage(binding, *view.buffer, view.offset, view.range);
+    }
+
+    void ComputeBindings::addUniform(uint32_t binding, const BufferView &view) {
+        if (!checkView(view, "addUniform")) return;
+        addUniform(binding, *view.buffer, view.offset, view.range);
+    }
+
+    void ComputeBindings::addStorageToSet(uint32_t set, uint32_t binding, const BufferView &view) {
+        if (!checkView(view, "addStorageToSet")) return;
+        addStorageToSet(set, binding, *view.buffer, view.offset, view.range);
+    }
+
+    void ComputeBindings::addUniformToSet(uint32_t set, uint32_t binding, const BufferView &view) {
+        if (!checkView(view, "addUniformToSet")) return;
+        addUniformToSet(set, binding, *view.buffer, view.offset, view.range);
+    }
+
+    bool ComputeBindings::setAccess(uint32_t set, uint32_t binding, BufferAccess access) {
+        bool found = false;
+        for (auto &entry : entries) {
+            if (entry.set == set && entry.binding == binding) {
+                entry.access = access;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    bool ComputeBindings::validate(const Device &device, std::string &error) const {
+#ifdef EASYVK_NO_EXCEPTIONS
+        if (!lastError_.empty()) {
+            error = lastError_;
+            return false;
+        }
+#endif
+        for (const auto &entry : entries) {
+            for (const auto &bufInfo : entry.buffers) {
+                VkDeviceSize requiredAlignment = 0;
+                if (entry.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+                    requiredAlignment = device.limits().minUniformBufferOffsetAlignment;
+                } else if (entry.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
+                    requiredAlignment = device.limits().minStorageBufferOffsetAlignment;
+                }
+
+                if (requiredAlignment > 0 && (bufInfo.offset % requiredAlignment) != 0) {
+                    error = "Descriptor buffer offset violates alignment requirement (binding " +
+                            std::to_string(entry.binding) + ", offset " + std::to_string(bufInfo.offset) +
+                            ", required alignment " + std::to_string(requiredAlignment) + ")";
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    namespace {
+        // Local size checks shared by ComputeProgramCreateInfo::validate and ComputeProgram::select
+        bool validateLocalSize(const Device &device, uint32_t x, uint32_t y, uint32_t z,
+                               uint32_t requiredSubgroupSize, bool requireFullSubgroups, std::string &error) {
+            if (x == 0 || y == 0 || z == 0) {
+                error = "Local workgroup size must be >= 1 in all dimensions";
+                return false;
+            }
+
+            const VkPhysicalDeviceLimits &lim = device.limits();
+            if (x > lim.maxComputeWorkGroupSize[0] ||
+                y > lim.maxComputeWorkGroupSize[1] ||
+                z > lim.maxComputeWorkGroupSize[2]) {
+                error = "Local workgroup size exceeds device limits";
+                return false;
+            }
+
+            const uint64_t invocations = static_cast<uint64_t>(x) * static_cast<uint64_t>(y) * static_cast<uint64_t>(z);
+            if (invocations > lim.maxComputeWorkGroupInvocations) {
+                error = "Local workgroup invocations exceed device limits";
+                return false;
+            }
+
+            if (requiredSubgroupSize != 0) {
+                if (!device.subgroupSizeControlEnabled()) {
+                    error = "Subgroup size control is not supported for compute shaders on this device";
+                    return false;
+                }
+                if ((requiredSubgroupSize & (requiredSubgroupSize - 1)) != 0 ||
+                    requiredSubgroupSize < device.minSubgroupSize() || requiredSubgroupSize > device.maxSubgroupSize()) {
+                    error = "Required subgroup size must be a power of two in [minSubgroupSize, maxSubgroupSize]";
+                    return false;
+                }
+                if (invocations > static_cast<uint64_t>(device.maxComputeWorkgroupSubgroups()) * requiredSubgroupSize) {
+                    error = "Local workgroup needs more subgroups of the required size than the device allows";
+                    return false;
+                }
+            }
+
+            if (requireFullSubgroups) {
+                if (!device.computeFullSubgroupsEnabled()) {
+                    error = "Full compute subgroups are not supported on this device";
+                    return false;
+                }
+                const uint32_t multiple = requiredSubgroupSize ? requiredSubgroupSize : device.maxSubgroupSize();
+                if (multiple == 0 || x % multiple != 0) {
+                    error = "Full subgroups require localX to be a multiple of the subgroup size";
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Variant key: (id, value) pairs in ID order
+        std::vector<uint32_t> specializationKey(const std::map<uint32_t, uint32_t> &constants) {
+            std::vector<uint32_t> key;
+            key.reserve(constants.size() * 2);
+            for (const auto &constant : constants) {
+                key.push_back(constant.first);
+                key.push_back(constant.second);
+            }
+            return key;
+        }
+    } // namespace
+
+    bool ComputeProgramCreateInfo::validate(const Device &device, std::string &error) const {
+        if (!spirvData() || spirvWords() == 0) {
+            error = "SPIR-V code is required";
+            return false;
+        }
+
+        if (!validateLocalSize(device, localX, localY, localZ, requiredSubgroupSize, requireFullSubgroups, error)) {
+            return false;
+        }
+
+        for (size_t i = 0; i < specConstants.size(); ++i) {
+            const uint32_t id = specConstants[i].id;
+            bool reserved = id < 3;
+            for (const auto &mem : localMemory) {
+                reserved = reserved || id == 3 + mem.first;
+            }
+            if (reserved) {
+                error = "Specialization constant ID " + std::to_string(id) + " is taken by the local size or local memory";
+                return false;
+            }
+            for (size_t j = 0; j < i; ++j) {
+                if (specConstants[j].id == id) {
+                    error = "Duplicate specialization constant ID " + std::to_string(id);
+                    return false;
+                }
+            }
+        }
+
+        const auto &lim = device.limits();
+        if (pushConstantBytes > 0) {
+            if (pushConstantBytes % 4 != 0) {
+                error = "Push constant size must be 4-byte aligned";
+                return false;
+            }
+            if (pushConstantBytes > lim.maxPushConstantsSize) {
+                error = "Push constant size exceeds device limit";
+                return false;
+            }
+        }
+
+        return bindings.validate(device, error);
+    }
+
+    bool PushConstantConfig::validate(uint32_t maxSize, std::string &error) const {
+        if (sizeBytes > 0 && sizeBytes % 4 != 0) {
+            error = "Push constant size must be 4-byte aligned";
+            return false;
+        }
+        if (offset % 4 != 0) {
+            error = "Push constant offset must be 4-byte aligned";
+            return false;
+        }
+        if (sizeBytes + offset > maxSize) {
+            error = "Push constant range exceeds device limit";
+            return false;
+        }
+        return true;
+    }
+
+    // -------- ComputeProgram implementation -------------------------------------
+    ComputeProgram::ComputeProgram()
+        : device_(nullptr),
+          layout_(VK_NULL_HANDLE),
+          pipeline_(VK_NULL_HANDLE),
+          requiredSubgroupSize_(0),
+          requireFullSubgroups_(false),
+          pipelineCache_(nullptr),
+          dsp_(VK_NULL_HANDLE),
+          pushDescriptors_(false),
+          pushAddresses_(false),
+          shaderEntry_(nullptr),
+          shader_(VK_NULL_HANDLE),
+          cmdPool_(VK_NULL_HANDLE),
+          cmdBuf_(VK_NULL_HANDLE),
+          fence_(VK_NULL_HANDLE),
+          timestampQueryPool_(VK_NULL_HANDLE),
+          statsQueryPool_(VK_NULL_HANDLE),
+          perfQueryPool_(VK_NULL_HANDLE),
+          perfPasses_(0),
+          pcCapacityBytes_(0),
+          groupsX_(1),
+          groupsY_(1),
+          groupsZ_(1),
+          localX_(1),
+          localY_(1),
+          localZ_(1),
+          indirectBuffer_(VK_NULL_HANDLE),
+          indirectOffset_(0),
+          initialized_(false),
+          tornDown_(false),
+          reuseCommands_(false),
+          commandsDirty_(true),
+          recordedHostBarrier_(false),
+          recordedTimestamps_(false),
+          recordedIndirect_(VK_NULL_HANDLE),
+          recordedIndirectOffset_(0),
+          recordedProfiled_(false),
+          recordedProfileSlot_(UINT32_MAX),
+          timestampInFlight_(false),
+          initState_(INIT_NONE),
+          lastTimestamps_() {
+        lastTimestamps_[0] = lastTimestamps_[1] = 0;
+    }
+
+    ComputeProgram::ComputeProgram(Device &dev, const ComputeProgramCreateInfo &info)
+        : device_(&dev),
+          childRef_(dev),
           layout_(VK_NULL_HANDLE),
           pipeline_(VK_NULL_HANDLE),
+          entryPoint_((info.entryPointName && info.entryPointName[0]) ? info.entryPointName : "main"),
+          requiredSubgroupSize_(info.requiredSubgroupSize),
+          requireFullSubgroups_(info.requireFullSubgroups),
+          pipelineCache_(info.pipelineCache),
           dsp_(VK_NULL_HANDLE),
+          pushDescriptors_(false),
+          pushAddresses_(false),
+          shaderEntry_(nullptr),
           shader_(VK_NULL_HANDLE),
           cmdPool_(VK_NULL_HANDLE),
-          cmdBuf_(VK_NULL_HANDLE),
-          fence_(VK_NULL_HANDLE),
-          timestampQueryPool_(VK_NULL_HANDLE),
-          pcCapacityBytes_(0),
-          groupsX_(1),
-          groupsY_(1),
-          groupsZ_(1),
-          localX_(1),
-          localY_(1),
-          localZ_(1),
-          initialized_(false),
-          tornDown_(false),
-          timestampInFlight_(false),
-          initState_(INIT_NONE),
-          lastTimestamps_() {
-        lastTimestamps_[0] = lastTimestamps_[1] = 0;
+          cmdBuf_(VK_NULL_HANDLE),
+          fence_(VK_NULL_HANDLE),
+          timestampQueryPool_(VK_NULL_HANDLE),
+          statsQueryPool_(VK_NULL_HANDLE),
+          perfQueryPool_(VK_NULL_HANDLE),
+          perfPasses_(0),
+          pcCapacityBytes_(info.pushConstantBytes),
+          pcCfg_{info.pushConstantBytes, 0},
+          groupsX_(1),
+          groupsY_(1),
+          groupsZ_(1),
+          localX_(info.localX),
+          localY_(info.localY),
+          localZ_(info.localZ),
+          indirectBuffer_(VK_NULL_HANDLE),
+          indirectOffset_(0),
+          initialized_(false),
+          tornDown_(false),
+          reuseCommands_(false),
+          commandsDirty_(true),
+          recordedHostBarrier_(false),
+          recordedTimestamps_(false),
+          recordedIndirect_(VK_NULL_HANDLE),
+          recordedIndirectOffset_(0),
+          recordedProfiled_(false),
+          recordedProfileSlot_(UINT32_MAX),
+          bindLock_(new std::mutex()),
+          timestampInFlight_(false),
+          initState_(INIT_NONE),
+          lastTimestamps_() {
+        TraceScope trace(dev.tracer(), "createProgram");
+        lastTimestamps_[0] = lastTimestamps_[1] = 0;
+        label_ = info.label ? info.label : "dispatch";
+
+        std::string validationError;
+        if (!info.validate(dev, validationError)) {
+            EVK_FAIL_VOID(validationError);
+        }
+
+#ifdef EASYVK_USE_SPIRV_TOOLS
+        std::string spirvError;
+        if (!validateSPIRV(info.spirvData(), info.spirvWords(), spirvError)) {
+            EVK_FAIL_VOID("SPIR-V validation failed: " + spirvError);
+        }
+#endif
+
+        // Validate push constant constraints
+        if (pcCapacityBytes_ > 0) {
+            pcData_.resize(pcCapacityBytes_, 0);
+        }
+
+        try {
+            // Shared shader module; created below only if the pipeline needs compiling
+            ShaderModuleCache *modules = device_->shaderModuleCache();
+            shaderEntry_ = modules->acquire(info.spirvData(), info.spirvWords());
+            initState_ = INIT_SHADER;
+
+            // Group bindings by set
+            std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> setBindings;
+            for (const auto &entry : info.bindings.entries) {
+                setBindings[entry.set].push_back(VkDescriptorSetLayoutBinding{
+                    entry.binding,
+                    entry.type,
+                    static_cast<uint32_t>(entry.buffers.size()),
+                    VK_SHADER_STAGE_COMPUTE_BIT,
+                    nullptr
+                });
+            }
+
+            // Set 0 becomes a push descriptor set when the device allows it, so rebinding it
+            // costs nothing beyond re-recording
+            uint32_t set0Descriptors = 0;
+            for (const auto &entry : info.bindings.entries) {
+                if (entry.set == 0) set0Descriptors += static_cast<uint32_t>(entry.buffers.size());
+            }
+            pushDescriptors_ = set0Descriptors > 0 && device_->pushDescriptorsEnabled() &&
+                               set0Descriptors <= device_->maxPushDescriptors();
+
+            // Create descriptor set layouts (fill gaps with empty layouts)
+            setLayouts_.resize(setBindings.empty() ? 0 : setBindings.rbegin()->first + 1);
+            for (const auto &pair : setBindings) {
+                uint32_t setIndex = pair.first;
+                const auto &bindings = pair.second;
+                VkDescriptorSetLayoutCreateInfo dslCreateInfo{
+                    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                    nullptr,
+                    (setIndex == 0 && pushDescriptors_) ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0u,
+                    static_cast<uint32_t>(bindings.size()),
+                    bindings.data()
+                };
+                VK_CHECK(vkCreateDescriptorSetLayout(device_->vk(), &dslCreateInfo, nullptr, &setLayouts_[setIndex]));
+            }
+            for (VkDescriptorSetLayout &setLayout : setLayouts_) {
+                if (setLayout == VK_NULL_HANDLE) {
+                    // Create an empty (0-binding) layout for missing lower-index sets
+                    VkDescriptorSetLayoutCreateInfo emptyDsl{
+                        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                        nullptr, 0, 0, nullptr
+                    };
+                    VK_CHECK(vkCreateDescriptorSetLayout(device_->vk(), &emptyDsl, nullptr, &setLayout));
+                }
+            }
+            initState_ = INIT_SET_LAYOUTS;
+
+            // Create pipeline layout
+            VkPushConstantRange pushRange{};
+            if (pcCfg_.sizeBytes > 0) {
+                pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+                pushRange.offset = pcCfg_.offset;
+                pushRange.size = pcCfg_.sizeBytes;
+            }
+
+            VkPipelineLayoutCreateInfo layoutCreateInfo{
+                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                nullptr,
+                0,
+                static_cast<uint32_t>(setLayouts_.size()),
+                setLayouts_.data(),
+                pcCfg_.sizeBytes > 0 ? 1u : 0u,
+                pcCfg_.sizeBytes > 0 ? &pushRange : nullptr
+            };
+            VK_CHECK(vkCreatePipelineLayout(device_->vk(), &layoutCreateInfo, nullptr, &layout_));
+            initState_ = INIT_PIPELINE_LAYOUT;
+
+            // Snapshot descriptor contents per set, in binding order
+            setData_.resize(setLayouts_.size());
+            for (const auto &entry : info.bindings.entries) {
+                BoundDescriptor bound{
+                    entry.set,
+                    entry.binding,
+                    entry.type,
+                    static_cast<uint32_t>(setData_[entry.set].size()),
+                    static_cast<uint32_t>(entry.buffers.size()),
+                    entry.access
+                };
+                boundDescriptors_.push_back(bound);
+                setData_[entry.set].insert(setData_[entry.set].end(), entry.buffers.begin(), entry.buffers.end());
+            }
+            setsDirty_.assign(setLayouts_.size(), false);
+            descriptorSets_.assign(setLayouts_.size(), VK_NULL_HANDLE);
+
+            // Create descriptor pool and sets (a pushed set 0 needs neither)
+            const uint32_t firstPooledSet = pushDescriptors_ ? 1u : 0u;
+            if (!info.bindings.entries.empty() && setLayouts_.size() > firstPooledSet) {
+                std::map<VkDescriptorType, uint32_t> typeCounts;
+                for (const auto &entry : info.bindings.entries) {
+                    if (entry.set < firstPooledSet) continue;
+                    typeCounts[entry.type] += static_cast<uint32_t>(entry.buffers.size());
+                }
+
+                std::vector<VkDescriptorPoolSize> poolSizes;
+                poolSizes.reserve(typeCounts.size());
+                for (const auto &pair : typeCounts) {
+                    poolSizes.push_back({pair.first, pair.second});
+                }
+
+                const uint32_t pooledSetCount = static_cast<uint32_t>(setLayouts_.size()) - firstPooledSet;
+                VkDescriptorPoolCreateInfo poolCreateInfo{
+                    VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                    nullptr,
+                    0,
+                    pooledSetCount,
+                    static_cast<uint32_t>(poolSizes.size()),
+                    poolSizes.data()
+                };
+                VK_CHECK(vkCreateDescriptorPool(device_->vk(), &poolCreateInfo, nullptr, &dsp_));
+                ++device_->counters_->descriptorPoolsCreated;
+                initState_ = INIT_DESCRIPTOR_POOL;
+
+                VkDescriptorSetAllocateInfo allocInfo{
+                    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                    nullptr,
+                    dsp_,
+                    pooledSetCount,
+                    setLayouts_.data() + firstPooledSet
+                };
+                VK_CHECK(vkAllocateDescriptorSets(device_->vk(), &allocInfo, descriptorSets_.data() + firstPooledSet));
+            }
+
+            // Descriptor update templates turn a whole-set rewrite into one call
+            updateTemplates_.assign(setLayouts_.size(), VK_NULL_HANDLE);
+            for (uint32_t set = 0; set < setLayouts_.size(); ++set) {
+                const bool pushed = (set == 0 && pushDescriptors_);
+                if (setData_[set].empty() || vkCreateDescriptorUpdateTemplate == nullptr) continue;
+                if (pushed && vkCmdPushDescriptorSetWithTemplateKHR == nullptr) continue;
+
+                std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+                for (const auto &bound : boundDescriptors_) {
+                    if (bound.set != set) continue;
+                    templateEntries.push_back(VkDescriptorUpdateTemplateEntry{
+                        bound.binding,
+                        0,
+                        bound.count,
+                        bound.type,
+                        bound.first * sizeof(VkDescriptorBufferInfo),
+                        sizeof(VkDescriptorBufferInfo)
+                    });
+                }
+                VkDescriptorUpdateTemplateCreateInfo templateInfo{
+                    VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+                    nullptr,
+                    0,
+                    static_cast<uint32_t>(templateEntries.size()),
+                    templateEntries.data(),
+                    pushed ? VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR
+                           : VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+                    setLayouts_[set],
+                    VK_PIPELINE_BIND_POINT_COMPUTE,
+                    layout_,
+                    set
+                };
+                VK_CHECK(vkCreateDescriptorUpdateTemplate(device_->vk(), &templateInfo, nullptr, &updateTemplates_[set]));
+            }
+
+            // Initial descriptor contents
+            for (uint32_t set = 0; set < setLayouts_.size(); ++set) {
+                setsDirty_[set] = !setData_[set].empty() && !(set == 0 && pushDescriptors_);
+            }
+            flushDescriptorUpdates();
+
+            // Creation-time specialization: local size (IDs 0-2), local memory sizes (3 + index)
+            // and the user constants
+            specBase_[0] = localX_;
+            specBase_[1] = localY_;
+            specBase_[2] = localZ_;
+            for (const auto &mem : info.localMemory) {
+                specBase_[3 + mem.first] = mem.second;
+            }
+            for (const SpecConstant &constant : info.specConstants) {
+                specBase_[constant.id] = constant.value;
+            }
+
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            VK_CHECK(createPipeline(specBase_, &pipeline));
+            variants_[specializationKey(specBase_)] = pipeline;
+            pipeline_ = pipeline;
+            initState_ = INIT_PIPELINE;
+
+            // Create command resources
+            VkCommandPoolCreateInfo poolInfo{
+                VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                nullptr,
+                VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                device_->computeQueueFamilyIndex()
+            };
+            VK_CHECK(vkCreateCommandPool(device_->vk(), &poolInfo, nullptr, &cmdPool_));
+            initState_ = INIT_COMMAND_POOL;
+
+            VkCommandBufferAllocateInfo allocInfo{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                nullptr,
+                cmdPool_,
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                1
+            };
+            VK_CHECK(vkAllocateCommandBuffers(device_->vk(), &allocInfo, &cmdBuf_));
+            ++device_->counters_->commandBuffersAllocated;
+            initState_ = INIT_COMMAND_BUFFER;
+
+            VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
+            VK_CHECK(vkCreateFence(device_->vk(), &fenceInfo, nullptr, &fence_));
+            ++device_->counters_->fencesCreated;
+            initState_ = INIT_FENCE;
+
+            // Create timestamp query pool if supported
+            if (device_->supportsTimestamps()) {
+                VkQueryPoolCreateInfo queryPoolInfo{
+                    VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                    nullptr,
+                    0,
+                    VK_QUERY_TYPE_TIMESTAMP,
+                    2,
+                    0
+                };
+                VK_CHECK(vkCreateQueryPool(device_->vk(), &queryPoolInfo, nullptr, &timestampQueryPool_));
+                initState_ = INIT_QUERY_POOL;
+            }
+
+            initState_ = INIT_COMPLETE;
+            initialized_ = true;
+        } catch (...) {
+            teardownFrom(initState_);
+            throw;
+        }
+    }
+
+    ComputeProgram::ComputeProgram(ComputeProgram &&other) noexcept
+        : device_(other.device_),
+          childRef_(std::move(other.childRef_)),
+          setLayouts_(std::move(other.setLayouts_)),
+          layout_(other.layout_),
+          pipeline_(other.pipeline_),
+          variants_(std::move(other.variants_)),
+          specBase_(std::move(other.specBase_)),
+          entryPoint_(std::move(other.entryPoint_)),
+          requiredSubgroupSize_(other.requiredSubgroupSize_),
+          requireFullSubgroups_(other.requireFullSubgroups_),
+          pipelineCache_(other.pipelineCache_),
+          dsp_(other.dsp_),
+          descriptorSets_(std::move(other.descriptorSets_)),
+          boundDescriptors_(std::move(other.boundDescriptors_)),
+          setData_(std::move(other.setData_)),
+          updateTemplates_(std::move(other.updateTemplates_)),
+          setsDirty_(std::move(other.setsDirty_)),
+          pushDescriptors_(other.pushDescriptors_),
+          pushAddresses_(other.pushAddresses_),
+          shaderEntry_(other.shaderEntry_),
+          shader_(other.shader_),
+          cmdPool_(other.cmdPool_),
+          cmdBuf_(other.cmdBuf_),
+          fence_(other.fence_),
+          timestampQueryPool_(other.timestampQueryPool_),
+          statsQueryPool_(other.statsQueryPool_),
+          perfQueryPool_(other.perfQueryPool_),
+          perfCounterIndices_(std::move(other.perfCounterIndices_)),
+          perfPasses_(other.perfPasses_),
+          pcCapacityBytes_(other.pcCapacityBytes_),
+          pcCfg_(other.pcCfg_),
+          groupsX_(other.groupsX_),
+          groupsY_(other.groupsY_),
+          groupsZ_(other.groupsZ_),
+          localX_(other.localX_),
+          localY_(other.localY_),
+          localZ_(other.localZ_),
+          indirectBuffer_(other.indirectBuffer_),
+          indirectOffset_(other.indirectOffset_),
+          pcData_(std::move(other.pcData_)),
+          label_(std::move(other.label_)),
+          initialized_(other.initialized_),
+          tornDown_(other.tornDown_),
+          reuseCommands_(other.reuseCommands_),
+          commandsDirty_(other.commandsDirty_),
+          recordedHostBarrier_(other.recordedHostBarrier_),
+          recordedTimestamps_(other.recordedTimestamps_),
+          recordedIndirect_(other.recordedIndirect_),
+          recordedIndirectOffset_(other.recordedIndirectOffset_),
+          recordedProfiled_(other.recordedProfiled_),
+          recordedProfileSlot_(other.recordedProfileSlot_),
+          bindLock_(std::move(other.bindLock_)),
+          timestampInFlight_(other.timestampInFlight_),
+          initState_(other.initState_),
+          lastTimestamps_() {
+        lastTimestamps_[0] = other.lastTimestamps_[0];
+        lastTimestamps_[1] = other.lastTimestamps_[1];
+
+        other.layout_ = VK_NULL_HANDLE;
+        other.pipeline_ = VK_NULL_HANDLE;
+        other.variants_.clear();
+        other.dsp_ = VK_NULL_HANDLE;
+        other.shaderEntry_ = nullptr;
+        other.shader_ = VK_NULL_HANDLE;
+        other.cmdPool_ = VK_NULL_HANDLE;
+        other.cmdBuf_ = VK_NULL_HANDLE;
+        other.fence_ = VK_NULL_HANDLE;
+        other.timestampQueryPool_ = VK_NULL_HANDLE;
+        other.statsQueryPool_ = VK_NULL_HANDLE;
+        other.perfQueryPool_ = VK_NULL_HANDLE;
+        other.initialized_ = false;
+        other.tornDown_ = true;
+        other.timestampInFlight_ = false;
+        other.initState_ = INIT_NONE;
+    }
+
+    ComputeProgram &ComputeProgram::operator=(ComputeProgram &&other) noexcept {
+        if (this != &other) {
+            teardown();
+
+            device_ = other.device_;
+            childRef_ = std::move(other.childRef_);
+            setLayouts_ = std::move(other.setLayouts_);
+            layout_ = other.layout_;
+            pipeline_ = other.pipeline_;
+            variants_ = std::move(other.variants_);
+            specBase_ = std::move(other.specBase_);
+            entryPoint_ = std::move(other.entryPoint_);
+            requiredSubgroupSize_ = other.requiredSubgroupSize_;
+            requireFullSubgroups_ = other.requireFullSubgroups_;
+            pipelineCache_ = other.pipelineCache_;
+            dsp_ = other.dsp_;
+            descriptorSets_ = std::move(other.descriptorSets_);
+            boundDescriptors_ = std::move(other.boundDescriptors_);
+            setData_ = std::move(other.setData_);
+            updateTemplates_ = std::move(other.updateTemplates_);
+            setsDirty_ = std::move(other.setsDirty_);
+            pushDescriptors_ = other.pushDescriptors_;
+            pushAddresses_ = other.pushAddresses_;
+            shaderEntry_ = other.shaderEntry_;
+            shader_ = other.shader_;
+            cmdPool_ = other.cmdPool_;
+            cmdBuf_ = other.cmdBuf_;
+            fence_ = other.fence_;
+            timestampQueryPool_ = other.timestampQueryPool_;
+            statsQueryPool_ = other.statsQueryPool_;
+            perfQueryPool_ = other.perfQueryPool_;
+            perfCounterIndices_ = std::move(other.perfCounterIndices_);
+            perfPasses_ = other.perfPasses_;
+            pcCapacityBytes_ = other.pcCapacityBytes_;
+            pcCfg_ = other.pcCfg_;
+            groupsX_ = other.groupsX_;
+            groupsY_ = other.groupsY_;
+            groupsZ_ = other.groupsZ_;
+            localX_ = other.localX_;
+            localY_ = other.localY_;
+            localZ_ = other.localZ_;
+            indirectBuffer_ = other.indirectBuffer_;
+            indirectOffset_ = other.indirectOffset_;
+            pcData_ = std::move(other.pcData_);
+            label_ = std::move(other.label_);
+            initialized_ = other.initialized_;
+            tornDown_ = other.tornDown_;
+            reuseCommands_ = other.reuseCommands_;
+            commandsDirty_ = other.commandsDirty_;
+            recordedHostBarrier_ = other.recordedHostBarrier_;
+            recordedTimestamps_ = other.recordedTimestamps_;
+            recordedIndirect_ = other.recordedIndirect_;
+            recordedIndirectOffset_ = other.recordedIndirectOffset_;
+            recordedProfiled_ = other.recordedProfiled_;
+            recordedProfileSlot_ = other.recordedProfileSlot_;
+            bindLock_ = std::move(other.bindLock_);
+            timestampInFlight_ = other.timestampInFlight_;
+            initState_ = other.initState_;
+            lastTimestamps_[0] = other.lastTimestamps_[0];
+            lastTimestamps_[1] = other.lastTimestamps_[1];
+
+            other.layout_ = VK_NULL_HANDLE;
+            other.pipeline_ = VK_NULL_HANDLE;
+            other.variants_.clear();
+            other.dsp_ = VK_NULL_HANDLE;
+            other.shaderEntry_ = nullptr;
+            other.shader_ = VK_NULL_HANDLE;
+            other.cmdPool_ = VK_NULL_HANDLE;
+            other.cmdBuf_ = VK_NULL_HANDLE;
+            other.fence_ = VK_NULL_HANDLE;
+            other.timestampQueryPool_ = VK_NULL_HANDLE;
+            other.statsQueryPool_ = VK_NULL_HANDLE;
+            other.perfQueryPool_ = VK_NULL_HANDLE;
+            other.initialized_ = false;
+            other.tornDown_ = true;
+            other.timestampInFlight_ = false;
+            other.initState_ = INIT_NONE;
+        }
+        return *this;
+    }
+
+    ComputeProgram::~ComputeProgram() noexcept {
+        if (!tornDown_) {
+            teardown();
+        }
+    }
+
+    bool ComputeProgram::setPushConstantConfig(const PushConstantConfig &config) {
+        std::string error;
+        if (!config.validate(device_->limits().maxPushConstantsSize, error)) {
+            EVK_FAIL(error);
+        }
+
+        pcCfg_ = config;
+        if (pcCfg_.sizeBytes > 0) {
+            pcData_.assign(pcCfg_.sizeBytes, 0);
+        }
+        commandsDirty_ = true;
+        return true;
+    }
+
+    bool ComputeProgram::setPushConstants(const void *data, uint32_t bytes, uint32_t offset) {
+        if (!data && bytes > 0) {
+            EVK_FAIL("Push constant data cannot be null when bytes > 0");
+        }
+
+        if (pcData_.size() < pcCfg_.sizeBytes) pcData_.assign(pcCfg_.sizeBytes, 0);
+        if (!data || bytes == 0) return true;
+
+        if (offset > pcCfg_.sizeBytes || bytes > pcCfg_.sizeBytes - offset) {
+            EVK_FAIL("Push constant range exceeds configured size");
+        }
+
+        if (std::memcmp(pcData_.data() + offset, data, bytes) != 0) {
+            std::memcpy(pcData_.data() + offset, data, bytes);
+            commandsDirty_ = true;
+        }
+        return true;
+    }
+
+    bool ComputeProgram::setPushAddress(uint32_t offset, const BufferView &view) {
+        if (!device_ || !device_->bufferDeviceAddressEnabled()) {
+            EVK_FAIL("Buffer device addresses are not enabled on this device");
+        }
+        if (offset % 8 != 0) {
+            EVK_FAIL("Push constant address offset must be 8-byte aligned");
+        }
+        const VkDeviceAddress address = view.deviceAddress();
+        if (address == 0) {
+            EVK_FAIL("Buffer view has no device address");
+        }
+        if (!pushAddresses_) {
+            pushAddresses_ = true; // accesses through the pointer are no longer bound ranges
+            commandsDirty_ = true;
+        }
+        return setPushConstants(&address, static_cast<uint32_t>(sizeof(address)), offset);
+    }
+
+    bool ComputeProgram::setWorkgroups(uint32_t x, uint32_t y, uint32_t z) {
+        if (x == 0 || y == 0 || z == 0) {
+            EVK_FAIL("Workgroup counts must be greater than zero");
+        }
+
+        // Check against device limits
+        const auto &lim = device_->limits();
+        if (x > lim.maxComputeWorkGroupCount[0] ||
+            y > lim.maxComputeWorkGroupCount[1] ||
+            z > lim.maxComputeWorkGroupCount[2]) {
+            EVK_FAIL("Workgroup count exceeds device limits");
+        }
+
+        if (x != groupsX_ || y != groupsY_ || z != groupsZ_) {
+            groupsX_ = x;
+            groupsY_ = y;
+            groupsZ_ = z;
+            commandsDirty_ = true;
+        }
+        return true;
+    }
+
+    void ComputeProgram::setCommandReuse(bool enable) {
+        if (enable != reuseCommands_) {
+            reuseCommands_ = enable;
+            commandsDirty_ = true; // usage flags differ between the two modes
+        }
+    }
+
+    bool ComputeProgram::dispatch() {
+        return submitAndWait(true);
+    }
+
+    bool ComputeProgram::dispatchNoHostBarrier() {
+        return submitAndWait(false);
+    }
+
+    bool ComputeProgram::supportsTimestamps() const {
+        return device_ && device_->supportsTimestamps() && (timestampQueryPool_ != VK_NULL_HANDLE);
+    }
+
+    double ComputeProgram::dispatchWithTimingNs() {
+        if (!supportsTimestamps()) {
+            dispatch();
+            return 0.0;
+        }
+
+        if (!initialized_) {
+            EVK_FAIL("Program not initialized");
+        }
+
+        SubmitHandle handle = submitAsync(true, true);
+        if (!device_->wait(handle)) {
+            EVK_FAIL("Failed to wait for dispatch completion");
+        }
+
+        // Get timestamp results
+        uint64_t timestamps[2];
+        VkResult result = vkGetQueryPoolResults(device_->vk(), timestampQueryPool_, 0, 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+        if (result != VK_SUCCESS) {
+            return 0.0;
+        }
+
+        return static_cast<double>(timestamps[1] - timestamps[0]) * device_->timestampPeriod();
+    }
+
+    SubmitHandle ComputeProgram::dispatchWithTimingAsync() {
+        if (!supportsTimestamps()) {
+            return submitAsync(true, false);
+        }
+
+        timestampInFlight_ = true;
+        return submitAsync(true, true);
+    }
+
+    bool ComputeProgram::tryGetTimingNs(double& outNs) {
+        if (!supportsTimestamps() || !timestampInFlight_) {
+            return false;
+        }
+
+        struct QueryPair { uint64_t value; uint64_t available; };
+        QueryPair q[2] = {};
+        VkResult result = vkGetQueryPoolResults(device_->vk(), timestampQueryPool_, 0, 2,
+            sizeof(q), q, sizeof(QueryPair),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        if (result == VK_NOT_READY) {
+            return false;
+        }
+
+        if (result != VK_SUCCESS) {
+            return false;
+        }
+
+        if (q[0].available == 0 || q[1].available == 0) {
+            return false;
+        }
+
+        lastTimestamps_[0] = q[0].value;
+        lastTimestamps_[1] = q[1].value;
+        timestampInFlight_ = false;
+        outNs = static_cast<double>(q[1].value - q[0].value) * device_->timestampPeriod();
+        return true;
+    }
+
+    bool ComputeProgram::setPerformanceCounters(const std::vector<uint32_t> &counterIndices) {
+        if (!initialized_) {
+            EVK_FAIL("Program not initialized");
+        }
+        if (!counterIndices.empty() && !device_->performanceQueryEnabled()) {
+            EVK_FAIL("Performance queries are not enabled on this device");
+        }
+        for (uint32_t index : counterIndices) {
+            if (index >= device_->performanceCounters().size()) {
+                EVK_FAIL("Performance counter index out of range");
+            }
+        }
+
+        if (perfQueryPool_ != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device_->vk(), perfQueryPool_, nullptr);
+            perfQueryPool_ = VK_NULL_HANDLE;
+        }
+        perfCounterIndices_.clear();
+        perfPasses_ = 0;
+        if (counterIndices.empty()) return true;
+
+        VkQueryPoolPerformanceCreateInfoKHR perfInfo{
+            VK_STRUCTURE_TYPE_QUERY_POOL_PERFORMANCE_CREATE_INFO_KHR,
+            nullptr,
+            device_->computeQueueFamilyIndex(),
+            static_cast<uint32_t>(counterIndices.size()),
+            counterIndices.data()
+        };
+        uint32_t passes = 0;
+        vkGetPhysicalDeviceQueueFamilyPerformanceQueryPassesKHR(device_->physical(), &perfInfo, &passes);
+
+        VkQueryPoolCreateInfo queryPoolInfo{
+            VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            &perfInfo,
+            0,
+            VK_QUERY_TYPE_PERFORMANCE_QUERY_KHR,
+            1,
+            0
+        };
+        EVK_CHECK(vkCreateQueryPool(device_->vk(), &queryPoolInfo, nullptr, &perfQueryPool_),
+                  "vkCreateQueryPool (performance query) failed");
+        perfCounterIndices_ = counterIndices;
+        perfPasses_ = std::max<uint32_t>(passes, 1);
+        return true;
+    }
+
+    namespace {
+        // Holds the device profiling lock that performance query command buffers need
+        struct ProfilingLockGuard {
+            VkDevice device;
+            explicit ProfilingLockGuard(VkDevice d) : device(d) {}
+            ~ProfilingLockGuard() {
+                if (device != VK_NULL_HANDLE) vkReleaseProfilingLockKHR(device);
+            }
+        };
+
+        double performanceCounterValue(const VkPerformanceCounterResultKHR &r, VkPerformanceCounterStorageKHR storage) {
+            switch (storage) {
+                case VK_PERFORMANCE_COUNTER_STORAGE_INT32_KHR: return static_cast<double>(r.int32);
+                case VK_PERFORMANCE_COUNTER_STORAGE_INT64_KHR: return static_cast<double>(r.int64);
+                case VK_PERFORMANCE_COUNTER_STORAGE_UINT32_KHR: return static_cast<double>(r.uint32);
+                case VK_PERFORMANCE_COUNTER_STORAGE_UINT64_KHR: return static_cast<double>(r.uint64);
+                case VK_PERFORMANCE_COUNTER_STORAGE_FLOAT32_KHR: return static_cast<double>(r.float32);
+                case VK_PERFORMANCE_COUNTER_STORAGE_FLOAT64_KHR: return r.float64;
+                default: return 0.0;
+            }
+        }
+    } // namespace
+
+    bool ComputeProgram::dispatchWithReport(DispatchReport &out) {
+        if (!initialized_) {
+            EVK_FAIL("Program not initialized");
+        }
+        out = DispatchReport();
+
+        if (statsQueryPool_ == VK_NULL_HANDLE && device_->pipelineStatisticsEnabled()) {
+            VkQueryPoolCreateInfo queryPoolInfo{
+                VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                nullptr,
+                0,
+                VK_QUERY_TYPE_PIPELINE_STATISTICS,
+                1,
+                VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT
+            };
+            EVK_CHECK(vkCreateQueryPool(device_->vk(), &queryPoolInfo, nullptr, &statsQueryPool_),
+                      "vkCreateQueryPool (pipeline statistics) failed");
+        }
+
+        const bool timed = supportsTimestamps();
+        const bool counters = perfQueryPool_ != VK_NULL_HANDLE;
+        ProfilingLockGuard profilingLock(VK_NULL_HANDLE);
+        if (counters) {
+            VkAcquireProfilingLockInfoKHR lockInfo{
+                VK_STRUCTURE_TYPE_ACQUIRE_PROFILING_LOCK_INFO_KHR,
+                nullptr,
+                0,
+                UINT64_MAX
+            };
+            EVK_CHECK(vkAcquireProfilingLockKHR(device_->vk(), &lockInfo), "vkAcquireProfilingLockKHR failed");
+            profilingLock.device = device_->vk();
+
+            // Performance queries cannot be reset in the command buffer that begins them
+            VkCommandBuffer resetCmd = device_->acquireCommandBuffer();
+            VkCommandBufferBeginInfo beginInfo{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                nullptr,
+                VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                nullptr
+            };
+            VK_CHECK(vkBeginCommandBuffer(resetCmd, &beginInfo));
+            vkCmdResetQueryPool(resetCmd, perfQueryPool_, 0, 1);
+            VK_CHECK(vkEndCommandBuffer(resetCmd));
+            SubmitHandle resetHandle = device_->submitCommands(resetCmd, true);
+            if (!device_->wait(resetHandle)) {
+                EVK_FAIL("Failed to reset the performance query");
+            }
+        }
+
+        // Each counter pass replays the whole dispatch; timing and statistics keep the last one
+        const uint32_t passes = counters ? perfPasses_ : 1;
+        for (uint32_t pass = 0; pass < passes; ++pass) {
+            recordDispatch(true, timed, true);
+            if (counters) {
+                if (!device_->submitPerformancePass(cmdBuf_, pass)) return false;
+                recordedProfileSlot_ = UINT32_MAX;
+            } else {
+                SubmitHandle handle = device_->submitCommands(cmdBuf_, false);
+                if (handle.isValid()) recordedProfileSlot_ = UINT32_MAX;
+                if (!device_->wait(handle)) {
+                    EVK_FAIL("Failed to wait for dispatch completion");
+                }
+            }
+        }
+        out.passes = passes;
+
+        if (timed) {
+            uint64_t timestamps[2];
+            if (vkGetQueryPoolResults(device_->vk(), timestampQueryPool_, 0, 2, sizeof(timestamps), timestamps,
+                                      sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+                const uint32_t bits = device_->timestampValidBits();
+                const uint64_t mask = bits >= 64 ? UINT64_MAX : ((UINT64_C(1) << bits) - 1);
+                out.gpuNs = static_cast<double>((timestamps[1] - timestamps[0]) & mask) * device_->timestampPeriod();
+                out.hasTiming = true;
+            }
+        }
+
+        if (statsQueryPool_ != VK_NULL_HANDLE) {
+            uint64_t invocations = 0;
+            if (vkGetQueryPoolResults(device_->vk(), statsQueryPool_, 0, 1, sizeof(invocations), &invocations,
+                                      sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+                out.computeInvocations = invocations;
+                out.hasInvocations = true;
+            }
+        }
+
+        if (counters) {
+            std::vector<VkPerformanceCounterResultKHR> results(perfCounterIndices_.size());
+            const size_t bytes = results.size() * sizeof(VkPerformanceCounterResultKHR);
+            if (vkGetQueryPoolResults(device_->vk(), perfQueryPool_, 0, 1, bytes, results.data(), bytes,
+                                      VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+                const std::vector<PerformanceCounterInfo> &infos = device_->performanceCounters();
+                out.counters.resize(results.size());
+                for (size_t i = 0; i < results.size(); ++i) {
+                    out.counters[i] = performanceCounterValue(results[i], infos[perfCounterIndices_[i]].storage);
+                }
+                out.hasCounters = true;
+            }
+        }
+        return true;
+    }
+
+    void ComputeProgram::destroyReportPools() {
+        if (!device_ || device_->vk() == VK_NULL_HANDLE) return;
+        if (statsQueryPool_ != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device_->vk(), statsQueryPool_, nullptr);
+            statsQueryPool_ = VK_NULL_HANDLE;
+        }
+        if (perfQueryPool_ != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device_->vk(), perfQueryPool_, nullptr);
+            perfQueryPool_ = VK_NULL_HANDLE;
+        }
+    }
+
+    SubmitHandle ComputeProgram::dispatchAsync(const SubmitHandle &dependency, bool addHostBarrier) {
+        return submitAsync(addHostBarrier, false, dependency.isValid() ? &dependency : nullptr);
+    }
+
+    bool ComputeProgram::setIndirectSource(const Buffer *args, VkDeviceSize offset) {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        if (args) {
+            if (!args->isValid()) {
+                EVK_FAIL("dispatchIndirect: argument buffer is not valid");
+            }
+            if (&args->device() != device_) {
+                EVK_FAIL("dispatchIndirect: argument buffer belongs to a different device");
+            }
+            if (!(args->usageFlags() & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)) {
+                EVK_FAIL("dispatchIndirect: argument buffer lacks indirect usage (create it as BufferUsage::Storage)");
+            }
+            if (offset % 4 != 0) {
+                EVK_FAIL("dispatchIndirect: offset must be a multiple of 4");
+            }
+            if (offset > args->size() || args->size() - offset < sizeof(VkDispatchIndirectCommand)) {
+                EVK_FAIL("dispatchIndirect: VkDispatchIndirectCommand at offset " + std::to_string(offset) +
+                         " exceeds the argument buffer");
+            }
+            buffer = args->vk();
+        } else {
+            offset = 0;
+        }
+
+        if (buffer != indirectBuffer_ || offset != indirectOffset_) {
+            indirectBuffer_ = buffer;
+            indirectOffset_ = offset;
+            commandsDirty_ = true;
+        }
+        return true;
+    }
+
+    bool ComputeProgram::dispatchIndirect(const Buffer &args, VkDeviceSize offset) {
+        SubmitHandle handle = dispatchIndirectAsync(args, offset);
+        if (!handle.isValid()) return false;
+        return device_->wait(handle);
+    }
+
+    SubmitHandle ComputeProgram::dispatchIndirectAsync(const Buffer &args, VkDeviceSize offset,
+                                                       const SubmitHandle &dependency, bool addHostBarrier) {
+        if (!initialized_) {
+            EVK_FAIL("Program not initialized");
+        }
+        if (!setIndirectSource(&args, offset)) return SubmitHandle();
+        SubmitHandle handle = submitAsync(addHostBarrier, false, dependency.isValid() ? &dependency : nullptr);
+        // Plain dispatches go back to the host-side counts
+        indirectBuffer_ = VK_NULL_HANDLE;
+        indirectOffset_ = 0;
+        return handle;
+    }
+
+    SubmitHandle ComputeProgram::submitAsync(bool addHostBarrier, bool enableTimestamps,
+                                             const SubmitHandle *dependency) {
+        if (!initialized_) {
+            EVK_FAIL("Program not initialized");
+        }
+        TraceScope trace(device_->tracer(), "dispatch");
+
+        // A recording made for the other dispatch mode cannot be replayed
+        if (recordedIndirect_ != indirectBuffer_ || recordedIndirectOffset_ != indirectOffset_) {
+            commandsDirty_ = true;
+        }
+
+        // Replay the previous recording when nothing that affects it has changed
+        // (never while profiling, nor a profiled recording: every submission needs its own query pair)
+        const bool canReplay = reuseCommands_ && !commandsDirty_ &&
+                               recordedHostBarrier_ == addHostBarrier &&
+                               recordedTimestamps_ == enableTimestamps &&
+                               !recordedProfiled_ && device_->profiler() == nullptr;
+        if (!canReplay) {
+            recordDispatch(addHostBarrier, enableTimestamps);
+        }
+
+        SubmitHandle handle = device_->submitCommands(cmdBuf_, false, dependency, dependency ? 1u : 0u);
+        // The profiler now reads the slot from the query pool; a failed submission leaves it
+        // to be cancelled by the next recording or by teardown
+        if (handle.isValid()) recordedProfileSlot_ = UINT32_MAX;
+        return handle;
+    }
+
+    void ComputeProgram::cancelProfileSlot() {
+        if (recordedProfileSlot_ != UINT32_MAX && device_ && device_->profiler()) {
+            device_->profiler()->cancel(&recordedProfileSlot_, 1);
+        }
+        recordedProfileSlot_ = UINT32_MAX;
+    }
+
+    void ComputeProgram::recordDispatch(bool addHostBarrier, bool enableTimestamps, bool withReport) {
+        // The recording being replaced was never submitted: hand its query pair back
+        cancelProfileSlot();
+        VK_CHECK(vkResetCommandBuffer(cmdBuf_, 0));
+
+        // Reusable recordings may be resubmitted while a previous submission is still pending
+        VkCommandBufferBeginInfo beginInfo{
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            nullptr,
+            reuseCommands_ ? static_cast<VkCommandBufferUsageFlags>(VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT)
+                           : static_cast<VkCommandBufferUsageFlags>(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT),
+            nullptr
+        };
+        VK_CHECK(vkBeginCommandBuffer(cmdBuf_, &beginInfo));
+
+        // Command-buffer scoped counters require the performance query to enclose everything
+        const bool perfQuery = withReport && perfQueryPool_ != VK_NULL_HANDLE;
+        const bool statsQuery = withReport && statsQueryPool_ != VK_NULL_HANDLE;
+        if (perfQuery) {
+            vkCmdBeginQuery(cmdBuf_, perfQueryPool_, 0, 0);
+        }
+
+        if (enableTimestamps && timestampQueryPool_ != VK_NULL_HANDLE) {
+            vkCmdResetQueryPool(cmdBuf_, timestampQueryPool_, 0, 2);
+        }
+        if (statsQuery) {
+            vkCmdResetQueryPool(cmdBuf_, statsQueryPool_, 0, 1);
+        }
+
+        // Optional GPU label for captures
+        if (vkCmdBeginDebugUtilsLabelEXT) {
+            VkDebugUtilsLabelEXT label{VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
+            label.pLabelName = addHostBarrier ? "easyvk::dispatch" : "easyvk::dispatchNoHostBarrier";
+            vkCmdBeginDebugUtilsLabelEXT(cmdBuf_, &label);
+        }
+
+        recordBind(cmdBuf_);
+        recordInputBarriers(cmdBuf_);
+
+        if (enableTimestamps && timestampQueryPool_ != VK_NULL_HANDLE) {
+            vkCmdWriteTimestamp(cmdBuf_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool_, 0);
+        }
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t profileSlot = profiler ? profiler->beginScope(cmdBuf_, label_.c_str(),
+                                                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) : UINT32_MAX;
+        recordedProfiled_ = profiler != nullptr;
+        recordedProfileSlot_ = profileSlot;
+        if (statsQuery) {
+            vkCmdBeginQuery(cmdBuf_, statsQueryPool_, 0, 0);
+        }
+
+        if (indirectBuffer_ != VK_NULL_HANDLE) {
+            // Counts may come from the host or from an earlier kernel/copy
+            VkMemoryBarrier argsBarrier{
+                VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                nullptr,
+                VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+            };
+            vkCmdPipelineBarrier(cmdBuf_,
+                                 VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                 0, 1, &argsBarrier, 0, nullptr, 0, nullptr);
+            vkCmdDispatchIndirect(cmdBuf_, indirectBuffer_, indirectOffset_);
+        } else {
+            vkCmdDispatch(cmdBuf_, groupsX_, groupsY_, groupsZ_);
+        }
+
+        if (statsQuery) {
+            vkCmdEndQuery(cmdBuf_, statsQueryPool_, 0);
+        }
+        if (profileSlot != UINT32_MAX) {
+            profiler->endScope(cmdBuf_, profileSlot, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+
+        if (enableTimestamps && timestampQueryPool_ != VK_NULL_HANDLE) {
+            vkCmdWriteTimestamp(cmdBuf_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool_, 1);
+        }
+
+        if (addHostBarrier) {
+            recordHostBarriers(cmdBuf_);
+        }
+
+        if (vkCmdEndDebugUtilsLabelEXT) {
+            vkCmdEndDebugUtilsLabelEXT(cmdBuf_);
+        }
+
+        if (perfQuery) {
+            vkCmdEndQuery(cmdBuf_, perfQueryPool_, 0);
+        }
+
+        VK_CHECK(vkEndCommandBuffer(cmdBuf_));
+
+        recordedHostBarrier_ = addHostBarrier;
+        recordedTimestamps_ = enableTimestamps;
+        recordedIndirect_ = indirectBuffer_;
+        recordedIndirectOffset_ = indirectOffset_;
+        // Report queries must not end up in a replayed recording
+        commandsDirty_ = withReport;
+    }
+
+    void ComputeProgram::recordBind(VkCommandBuffer cmd) {
+        // Streams on other threads may record this program concurrently: the first one
+        // flushes the dirty sets, the others find them clean
+        std::unique_lock<std::mutex> lock;
+        if (bindLock_) lock = std::unique_lock<std::mutex>(*bindLock_);
+        flushDescriptorUpdates();
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+
+        if (pushDescriptors_) {
+            if (updateTemplates_[0] != VK_NULL_HANDLE) {
+                vkCmdPushDescriptorSetWithTemplateKHR(cmd, updateTemplates_[0], layout_, 0, setData_[0].data());
+            } else {
+                std::vector<VkWriteDescriptorSet> writes;
+                writeDescriptors(0, writes);
+                vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout_, 0,
+                                          static_cast<uint32_t>(writes.size()), writes.data());
+            }
+        }
+
+        const uint32_t firstBoundSet = pushDescriptors_ ? 1u : 0u;
+        if (descriptorSets_.size() > firstBoundSet) {
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout_, firstBoundSet,
+                                  static_cast<uint32_t>(descriptorSets_.size()) - firstBoundSet,
+                                  descriptorSets_.data() + firstBoundSet, 0, nullptr);
+        }
+
+        // Push constants
+        if (pcCfg_.sizeBytes > 0) {
+            if (pcData_.size() < pcCfg_.sizeBytes) pcData_.assign(pcCfg_.sizeBytes, 0);
+            vkCmdPushConstants(cmd, layout_, VK_SHADER_STAGE_COMPUTE_BIT, pcCfg_.offset, pcCfg_.sizeBytes, pcData_.data());
+        }
+    }
+
+    void ComputeProgram::recordInputBarriers(VkCommandBuffer cmd) const {
+        // Host writes made before vkQueueSubmit are visible without a barrier. What remains is
+        // earlier GPU work on the queue: its writes to ranges we read or write, and its reads
+        // of ranges we overwrite.
+        const VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        const VkAccessFlags srcAccess = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        std::vector<RangeBarrier> barriers;
+        if (!pushAddresses_) {
+            for (const BoundDescriptor &bound : boundDescriptors_) {
+                VkAccessFlags dstAccess = 0;
+                if (bound.access != BufferAccess::Write) dstAccess |= VK_ACCESS_SHADER_READ_BIT;
+                if (bound.access != BufferAccess::Read) dstAccess |= VK_ACCESS_SHADER_WRITE_BIT;
+                for (uint32_t i = 0; i < bound.count; ++i) {
+                    const VkDescriptorBufferInfo &info = setData_[bound.set][bound.first + i];
+                    if (info.buffer == VK_NULL_HANDLE) continue;
+                    barriers.push_back(RangeBarrier{info.buffer, info.offset, info.range,
+                                                    srcStage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                                    srcAccess, dstAccess});
+                }
+            }
+        }
+        if (pushAddresses_ || barriers.size() > kMaxRangeBarriers) {
+            barriers.assign(1, RangeBarrier{VK_NULL_HANDLE, 0, VK_WHOLE_SIZE,
+                                            srcStage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                            srcAccess, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT});
+        }
+        recordBarriers(*device_, cmd, barriers.data(), barriers.size());
+    }
+
+    void ComputeProgram::recordHostBarriers(VkCommandBuffer cmd) const {
+        std::vector<RangeBarrier> barriers;
+        if (!pushAddresses_) {
+            for (const BoundDescriptor &bound : boundDescriptors_) {
+                if (bound.access == BufferAccess::Read) continue;
+                for (uint32_t i = 0; i < bound.count; ++i) {
+                    const VkDescriptorBufferInfo &info = setData_[bound.set][bound.first + i];
+                    if (info.buffer == VK_NULL_HANDLE) continue;
+                    barriers.push_back(RangeBarrier{info.buffer, info.offset, info.range,
+                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                                                    VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT});
+                }
+            }
+        }
+        if (pushAddresses_ || barriers.size() > kMaxRangeBarriers) {
+            barriers.assign(1, RangeBarrier{VK_NULL_HANDLE, 0, VK_WHOLE_SIZE,
+                                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                                            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT});
+        }
+        recordBarriers(*device_, cmd, barriers.data(), barriers.size());
+    }
+
+    bool ComputeProgram::rebind(uint32_t binding, const Buffer &buf, VkDeviceSize offset, VkDeviceSize range) {
+        if (offset > buf.size() || (range != VK_WHOLE_SIZE && range > buf.size() - offset)) {
+            EVK_FAIL("rebind: range [" + std::to_string(offset) + ", +" + std::to_string(range) +
+                     ") exceeds buffer size " + std::to_string(buf.size()));
+        }
+        return rebind(0, binding, BufferView(buf, offset, range == VK_WHOLE_SIZE ? buf.size() - offset : range));
+    }
+
+    bool ComputeProgram::rebind(uint32_t set, uint32_t binding, const BufferView &view, uint32_t arrayElement) {
+        if (!isValid()) {
+            EVK_FAIL("rebind: program is not valid");
+        }
+        if (!view.isValid()) {
+            EVK_FAIL("rebind: invalid buffer view");
+        }
+
+        for (const auto &bound : boundDescriptors_) {
+            if (bound.set != set || bound.binding != binding) continue;
+            if (arrayElement >= bound.count) {
+                EVK_FAIL("rebind: array element " + std::to_string(arrayElement) + " out of range for binding " +
+                         std::to_string(binding));
+            }
+
+            const VkDeviceSize alignment = bound.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+                ? device_->limits().minUniformBufferOffsetAlignment
+                : device_->limits().minStorageBufferOffsetAlignment;
+            if (alignment > 0 && view.offset % alignment != 0) {
+                EVK_FAIL("rebind: offset " + std::to_string(view.offset) + " violates alignment requirement " +
+                         std::to_string(alignment));
+            }
+
+            VkDescriptorBufferInfo &slot = setData_[set][bound.first + arrayElement];
+            if (slot.buffer == view.vk() && slot.offset == view.offset && slot.range == view.range) {
+                return true;
+            }
+            slot = VkDescriptorBufferInfo{view.vk(), view.offset, view.range};
+            if (!(set == 0 && pushDescriptors_)) {
+                setsDirty_[set] = true;
+            }
+            commandsDirty_ = true;
+            return true;
+        }
+
+        EVK_FAIL("rebind: set " + std::to_string(set) + " binding " + std::to_string(binding) +
+                 " is not part of the program layout");
+    }
+
+    bool ComputeProgram::rebind(const ComputeBindings &bindings) {
+        if (!isValid()) {
+            EVK_FAIL("rebind: program is not valid");
+        }
+        // Validate everything first so a rejected set of bindings leaves the program untouched
+        std::string error;
+        if (!bindings.validate(*device_, error)) {
+            EVK_FAIL("rebind: " + error);
+        }
+        std::vector<const BoundDescriptor *> targets;
+        targets.reserve(bindings.entries.size());
+        for (const auto &entry : bindings.entries) {
+            const BoundDescriptor *target = nullptr;
+            for (const auto &bound : boundDescriptors_) {
+                if (bound.set == entry.set && bound.binding == entry.binding) target = &bound;
+            }
+            if (!target || target->type != entry.type) {
+                EVK_FAIL("rebind: bindings do not match the program layout (set " + std::to_string(entry.set) +
+                         ", binding " + std::to_string(entry.binding) + ")");
+            }
+            if (entry.buffers.size() > target->count) {
+                EVK_FAIL("rebind: too many array elements for binding " + std::to_string(entry.binding));
+            }
+            targets.push_back(target);
+        }
+
+        for (size_t e = 0; e < bindings.entries.size(); ++e) {
+            const auto &entry = bindings.entries[e];
+            for (size_t i = 0; i < entry.buffers.size(); ++i) {
+                setData_[entry.set][targets[e]->first + i] = entry.buffers[i];
+                if (!(entry.set == 0 && pushDescriptors_)) {
+                    setsDirty_[entry.set] = true;
+                }
+            }
+        }
+        commandsDirty_ = true;
+        return true;
+    }
+
+    void ComputeProgram::writeDescriptors(uint32_t set, std::vector<VkWriteDescriptorSet> &writes) const {
+        for (const auto &bound : boundDescriptors_) {
+            if (bound.set != set) continue;
+            writes.push_back(VkWriteDescriptorSet{
+                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                nullptr,
+                descriptorSets_[set], // ignored for push descriptors
+                bound.binding,
+                0,
+                bound.count,
+                bound.type,
+                nullptr,
+                setData_[set].data() + bound.first,
+                nullptr
+            });
+        }
+    }
+
+    void ComputeProgram::flushDescriptorUpdates() {
+        std::vector<VkWriteDescriptorSet> writes;
+        for (uint32_t set = 0; set < setsDirty_.size(); ++set) {
+            if (!setsDirty_[set]) continue;
+            setsDirty_[set] = false;
+            if (descriptorSets_[set] == VK_NULL_HANDLE) continue;
+
+            if (updateTemplates_[set] != VK_NULL_HANDLE) {
+                vkUpdateDescriptorSetWithTemplate(device_->vk(), descriptorSets_[set], updateTemplates_[set],
+                                                  setData_[set].data());
+            } else {
+                writeDescriptors(set, writes);
+            }
+        }
+        if (!writes.empty()) {
+            vkUpdateDescriptorSets(device_->vk(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+    }
+
+    bool ComputeProgram::submitAndWait(bool addHostBarrier) {
+        SubmitHandle handle = submitAsync(addHostBarrier, false);
+        return device_->wait(handle);
+    }
+
+    bool ComputeProgram::select(const std::vector<SpecConstant> &values) {
+        if (!isValid()) {
+            EVK_FAIL("ComputeProgram is not valid");
+        }
+
+        std::map<uint32_t, uint32_t> constants = specBase_;
+        for (const SpecConstant &value : values) {
+            constants[value.id] = value.value;
+        }
+
+        std::vector<uint32_t> key = specializationKey(constants);
+        auto it = variants_.find(key);
+        if (it == variants_.end()) {
+            std::string error;
+            if (!validateLocalSize(*device_, constants[0], constants[1], constants[2],
+                                   requiredSubgroupSize_, requireFullSubgroups_, error)) {
+                EVK_FAIL(error);
+            }
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            EVK_CHECK(createPipeline(constants, &pipeline), "Failed to create specialized pipeline");
+            it = variants_.insert(std::make_pair(std::move(key), pipeline)).first;
+        }
+
+        if (it->second != pipeline_) {
+            pipeline_ = it->second;
+            localX_ = constants[0];
+            localY_ = constants[1];
+            localZ_ = constants[2];
+            commandsDirty_ = true;
+        }
+        return true;
+    }
+
+    VkResult ComputeProgram::createPipeline(const std::map<uint32_t, uint32_t> &constants, VkPipeline *out) {
+        std::vector<VkSpecializationMapEntry> specEntries;
+        std::vector<uint32_t> specData;
+        specEntries.reserve(constants.size());
+        specData.reserve(constants.size());
+        for (const auto &constant : constants) {
+            specEntries.push_back({constant.first, static_cast<uint32_t>(specData.size() * sizeof(uint32_t)),
+                                   sizeof(uint32_t)});
+            specData.push_back(constant.second);
+        }
+
+        VkSpecializationInfo specInfo{
+            static_cast<uint32_t>(specEntries.size()),
+            specEntries.data(),
+            specData.size() * sizeof(uint32_t),
+            specData.data()
+        };
+
+        VkPipelineShaderStageRequiredSubgroupSizeCreateInfo subgroupSizeInfo{
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_REQUIRED_SUBGROUP_SIZE_CREATE_INFO,
+            nullptr,
+            requiredSubgroupSize_
+        };
+        VkPipelineShaderStageCreateInfo stageInfo{
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            requiredSubgroupSize_ ? &subgroupSizeInfo : nullptr,
+            requireFullSubgroups_ ? static_cast<VkPipelineShaderStageCreateFlags>(
+                                        VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT)
+                                  : 0,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            VK_NULL_HANDLE, // module or identifier, below
+            entryPoint_.c_str(),
+            &specInfo
+        };
+
+        VkComputePipelineCreateInfo pipelineInfo{
+            VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            nullptr,
+            0,
+            stageInfo,
+            layout_,
+            VK_NULL_HANDLE,
+            0
+        };
+        PipelineCache *cache = pipelineCache_ ? pipelineCache_ : device_->pipelineCache();
+        VkPipelineCache vkCache = (cache && cache->isValid()) ? cache->vk() : VK_NULL_HANDLE;
+        ShaderModuleCache *modules = device_->shaderModuleCache();
+
+        // Warm start: ask the pipeline cache for the pipeline by module identifier, which
+        // fails with VK_PIPELINE_COMPILE_REQUIRED instead of compiling on a miss
+        VkShaderModuleIdentifierEXT identifier;
+        if (shader_ == VK_NULL_HANDLE && vkCache != VK_NULL_HANDLE && device_->shaderModuleIdentifierEnabled() &&
+            modules->identifier(shaderEntry_, &identifier)) {
+            VkPipelineShaderStageModuleIdentifierCreateInfoEXT identifierInfo{
+                VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_MODULE_IDENTIFIER_CREATE_INFO_EXT,
+                stageInfo.pNext,
+                identifier.identifierSize,
+                identifier.identifier
+            };
+            VkComputePipelineCreateInfo identifierPipelineInfo = pipelineInfo;
+            identifierPipelineInfo.flags |= VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT;
+            identifierPipelineInfo.stage.pNext = &identifierInfo;
+            VkResult result = vkCreateComputePipelines(device_->vk(), vkCache, 1, &identifierPipelineInfo,
+                                                       nullptr, out);
+            if (result != VK_PIPELINE_COMPILE_REQUIRED) return result;
+            *out = VK_NULL_HANDLE;
+        }
+
+        // The module is shared with every other program (and variant) built from this SPIR-V
+        if (shader_ == VK_NULL_HANDLE) {
+            VkResult result = modules->module(shaderEntry_, &shader_);
+            if (result != VK_SUCCESS) return result;
+        }
+        pipelineInfo.stage.module = shader_;
+        return vkCreateComputePipelines(device_->vk(), vkCache, 1, &pipelineInfo, nullptr, out);
+    }
+
+    void ComputeProgram::teardown() {
+        if (tornDown_) return;
+        teardownFrom(INIT_COMPLETE);
+    }
+
+    void ComputeProgram::teardownFrom(InitState state) {
+        if (device_ && device_->vk() != VK_NULL_HANDLE) {
+            cancelProfileSlot();
+            if (state >= INIT_QUERY_POOL && timestampQueryPool_ != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(device_->vk(), timestampQueryPool_, nullptr);
+                timestampQueryPool_ = VK_NULL_HANDLE;
+            }
+            destroyReportPools();
+
+            if (state >= INIT_FENCE && fence_ != VK_NULL_HANDLE) {
+                vkDestroyFence(device_->vk(), fence_, nullptr);
+                fence_ = VK_NULL_HANDLE;
+            }
+
+            if (state >= INIT_COMMAND_BUFFER && cmdBuf_ != VK_NULL_HANDLE && cmdPool_ != VK_NULL_HANDLE) {
+                vkFreeCommandBuffers(device_->vk(), cmdPool_, 1, &cmdBuf_);
+                cmdBuf_ = VK_NULL_HANDLE;
+            }
+
+            if (state >= INIT_COMMAND_POOL && cmdPool_ != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(device_->vk(), cmdPool_, nullptr);
+                cmdPool_ = VK_NULL_HANDLE;
+            }
+
+            if (state >= INIT_PIPELINE) {
+                for (auto &variant : variants_) {
+                    vkDestroyPipeline(device_->vk(), variant.second, nullptr);
+                }
+                variants_.clear();
+                pipeline_ = VK_NULL_HANDLE;
+            }
+
+            for (VkDescriptorUpdateTemplate &updateTemplate : updateTemplates_) {
+                if (updateTemplate != VK_NULL_HANDLE) {
+                    vkDestroyDescriptorUpdateTemplate(device_->vk(), updateTemplate, nullptr);
+                    updateTemplate = VK_NULL_HANDLE;
+                }
+            }
+            updateTemplates_.clear();
+
+            if (state >= INIT_PIPELINE_LAYOUT && layout_ != VK_NULL_HANDLE) {
+                vkDestroyPipelineLayout(device_->vk(), layout_, nullptr);
+                layout_ = VK_NULL_HANDLE;
+            }
+
+            if (state >= INIT_DESCRIPTOR_POOL && dsp_ != VK_NULL_HANDLE) {
+                vkDestroyDescriptorPool(device_->vk(), dsp_, nullptr);
+                dsp_ = VK_NULL_HANDLE;
+            }
+
+            if (state >= INIT_SET_LAYOUTS) {
+                for (auto layout : setLayouts_) {
+                    if (layout != VK_NULL_HANDLE) {
+                        vkDestroyDescriptorSetLayout(device_->vk(), layout, nullptr);
+                    }
+                }
+                setLayouts_.clear();
+            }
+
+            if (state >= INIT_SHADER && shaderEntry_) {
+                // The module itself stays cached on the Device for other programs
+                device_->shaderModuleCache()->release(shaderEntry_);
+                shaderEntry_ = nullptr;
+                shader_ = VK_NULL_HANDLE;
+            }
+        }
+
+        initialized_ = false;
+        tornDown_ = true;
+    }
+
+    // -------- Parallel program construction -------------------------------------
+    std::vector<ComputeProgram> createPrograms(Device &dev, const std::vector<ComputeProgramCreateInfo> &infos,
+                                               uint32_t threadCount) {
+        std::vector<ComputeProgram> programs(infos.size());
+        if (infos.empty()) return programs;
+
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threadCount = static_cast<uint32_t>(std::min<size_t>(threadCount, infos.size()));
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> failed(false);
+#ifndef EASYVK_NO_EXCEPTIONS
+        std::exception_ptr firstError;
+        std::mutex errorLock;
+#endif
+        auto worker = [&]() {
+            for (;;) {
+                const size_t i = next.fetch_add(1);
+                if (i >= infos.size() || failed.load()) return;
+#ifndef EASYVK_NO_EXCEPTIONS
+                try {
+                    programs[i] = ComputeProgram(dev, infos[i]);
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(errorLock);
+                    if (!firstError) firstError = std::current_exception();
+                    failed = true;
+                }
+#else
+                programs[i] = ComputeProgram(dev, infos[i]);
+#endif
+            }
+        };
+
+        // The calling thread is one of the workers
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (uint32_t t = 1; t < threadCount; ++t) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+#ifndef EASYVK_NO_EXCEPTIONS
+        if (firstError) std::rethrow_exception(firstError);
+#endif
+        return programs;
+    }
+
+    std::future<ComputeProgram> createProgramAsync(Device &dev, const ComputeProgramCreateInfo &info) {
+        // The create info is copied; what it points to is the caller's to keep alive
+        return std::async(std::launch::async, [&dev, info]() { return ComputeProgram(dev, info); });
+    }
+
+    // -------- WorkgroupTuner implementation -------------------------------------
+    namespace {
+        const char kWorkgroupTunerMagic[] = "EVKWGTUNE";
+        const uint32_t kWorkgroupTunerFileVersion = 1;
+
+        uint32_t nextPowerOfTwo(uint32_t v) {
+            uint32_t p = 1;
+            while (p < v && p < (UINT32_C(1) << 31)) p <<= 1;
+            return p;
+        }
+
+        uint32_t ceilDiv(uint32_t a, uint32_t b) {
+            return a / b + (a % b != 0 ? 1 : 0);
+        }
+
+        void appendKeyBytes(std::vector<uint8_t> &bytes, const void *data, size_t size) {
+            const uint8_t *p = static_cast<const uint8_t *>(data);
+            bytes.insert(bytes.end(), p, p + size);
+        }
+    } // namespace
+
+    WorkgroupTuner::WorkgroupTuner(Device &dev, const char *cachePath)
+        : device_(&dev), childRef_(dev), path_(cachePath ? cachePath : "") {
+        if (cachePath) {
+            load(cachePath);
+        }
+    }
+
+    bool WorkgroupTuner::load(const char *path) {
+        std::ifstream fin(path);
+        if (!fin.is_open()) return false;
+
+        std::string magic;
+        uint32_t version = 0;
+        fin >> magic >> version;
+        if (magic != kWorkgroupTunerMagic || version != kWorkgroupTunerFileVersion) {
+            evk_log("Ignoring workgroup tuning cache %s (unknown format)\n", path);
+            return false;
+        }
+
+        Entry e;
+        while (fin >> std::hex >> e.key >> std::dec >> e.size.x >> e.size.y >> e.size.z >> e.medianNs) {
+            entries_.push_back(e);
+        }
+        return true;
+    }
+
+    bool WorkgroupTuner::save(const char *path) const {
+        if (!path) return false;
+
+        const std::string tmpPath = std::string(path) + ".tmp";
+        {
+            std::ofstream fout(tmpPath.c_str(), std::ios::trunc);
+            if (!fout.is_open()) {
+                evk_log("Failed to open workgroup tuning cache %s for writing\n", tmpPath.c_str());
+                return false;
+            }
+            fout << kWorkgroupTunerMagic << " " << kWorkgroupTunerFileVersion << "\n";
+            for (const Entry &e : entries_) {
+                char key[17];
+                std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(e.key));
+                fout << key << " " << e.size.x << " " << e.size.y << " " << e.size.z << " " << e.medianNs << "\n";
+            }
+            if (!fout.good()) {
+                fout.close();
+                std::remove(tmpPath.c_str());
+                return false;
+            }
+        }
+
+#ifdef _WIN32
+        std::remove(path); // rename() does not replace existing files on Windows
+#endif
+        if (std::rename(tmpPath.c_str(), path) != 0) {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t WorkgroupTuner::key(const ComputeProgramCreateInfo &info, const WorkgroupTuneInfo &tuneInfo) const {
+        std::vector<uint8_t> bytes;
+        appendKeyBytes(bytes, device_->deviceUUID(), VK_UUID_SIZE);
+        appendKeyBytes(bytes, device_->driverUUID(), VK_UUID_SIZE);
+        appendKeyBytes(bytes, &device_->properties().driverVersion, sizeof(uint32_t));
+        appendKeyBytes(bytes, info.spirvData(), info.spirvWords() * sizeof(uint32_t));
+        const char *entry = info.entryPointName ? info.entryPointName : "main";
+        appendKeyBytes(bytes, entry, std::strlen(entry) + 1);
+        appendKeyBytes(bytes, &info.pushConstantBytes, sizeof(uint32_t));
+        const uint32_t subgroup[2] = {info.requiredSubgroupSize, info.requireFullSubgroups ? 1u : 0u};
+        appendKeyBytes(bytes, subgroup, sizeof(subgroup));
+        for (const auto &mem : info.localMemory) {
+            appendKeyBytes(bytes, &mem.first, sizeof(uint32_t));
+            appendKeyBytes(bytes, &mem.second, sizeof(uint32_t));
+        }
+        for (const SpecConstant &constant : info.specConstants) {
+            appendKeyBytes(bytes, &constant.id, sizeof(uint32_t));
+            appendKeyBytes(bytes, &constant.value, sizeof(uint32_t));
+        }
+        const uint32_t problem[3] = {tuneInfo.problemX, tuneInfo.problemY, tuneInfo.problemZ};
+        appendKeyBytes(bytes, problem, sizeof(problem));
+        return fnv1a64(bytes.data(), bytes.size());
+    }
+
+    std::vector<WorkgroupSize> WorkgroupTuner::candidates(const ComputeProgramCreateInfo &info,
+                                                          const WorkgroupTuneInfo &tuneInfo) const {
+        const VkPhysicalDeviceLimits &lim = device_->limits();
+        const uint32_t maxInvocations = std::min<uint32_t>(lim.maxComputeWorkGroupInvocations, 1024);
+        const uint64_t problemInvocations = static_cast<uint64_t>(tuneInfo.problemX) * tuneInfo.problemY * tuneInfo.problemZ;
+        // At least one full subgroup, unless the whole problem is smaller than that
+        const uint32_t subgroupSize = info.requiredSubgroupSize ? info.requiredSubgroupSize : device_->subgroupSize();
+        const uint32_t minInvocations = static_cast<uint32_t>(std::min<uint64_t>(
+            std::max<uint32_t>(subgroupSize, 1), nextPowerOfTwo(static_cast<uint32_t>(
+                std::min<uint64_t>(problemInvocations, maxInvocations)))));
+
+        const uint32_t maxX = std::min(lim.maxComputeWorkGroupSize[0], nextPowerOfTwo(tuneInfo.problemX));
+        const uint32_t maxY = std::min(lim.maxComputeWorkGroupSize[1], nextPowerOfTwo(tuneInfo.problemY));
+        const uint32_t maxZ = std::min(lim.maxComputeWorkGroupSize[2], nextPowerOfTwo(tuneInfo.problemZ));
+
+        std::vector<WorkgroupSize> out;
+        for (uint32_t z = 1; z <= maxZ; z <<= 1) {
+            for (uint32_t y = 1; y <= maxY; y <<= 1) {
+                for (uint32_t x = 1; x <= maxX; x <<= 1) {
+                    const uint64_t invocations = static_cast<uint64_t>(x) * y * z;
+                    if (invocations < minInvocations || invocations > maxInvocations) continue;
+                    // Skip very elongated shapes in multi-dimensional problems
+                    const uint32_t hi = std::max(x, std::max(y, z));
+                    const uint32_t lo = std::min(tuneInfo.problemX > 1 ? x : hi,
+                                                 std::min(tuneInfo.problemY > 1 ? y : hi, tuneInfo.problemZ > 1 ? z : hi));
+                    if (hi / lo > 16) continue;
+                    WorkgroupSize size = {x, y, z};
+                    out.push_back(size);
+                }
+            }
+        }
+        return out;
+    }
+
+    namespace {
+        // Build one candidate and return the median of its timed dispatches
+        bool measureWorkgroupSize(Device &device, const ComputeProgramCreateInfo &ci, const uint32_t groups[3],
+                                  const WorkgroupTuneInfo &tuneInfo, uint32_t iterations, double &median) {
+            ComputeProgram program(device, ci);
+            if (!program.isValid()) return false;
+            if (tuneInfo.prepare) tuneInfo.prepare(program);
+            if (!program.setWorkgroups(groups[0], groups[1], groups[2])) return false;
+            // Warm-up: first-use costs stay out of the samples
+            if (!program.dispatch()) return false;
+
+            std::vector<double> samples;
+            samples.reserve(iterations);
+            for (uint32_t i = 0; i < iterations; ++i) {
+                if (program.supportsTimestamps()) {
+                    const double ns = program.dispatchWithTimingNs();
+                    if (ns <= 0.0) return false; // failed dispatch or unreadable queries
+                    samples.push_back(ns);
+                } else {
+                    auto start = std::chrono::steady_clock::now();
+                    if (!program.dispatch()) return false;
+                    samples.push_back(std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start).count());
+                }
+            }
+            std::sort(samples.begin(), samples.end());
+            median = samples[samples.size() / 2];
+            return true;
+        }
+    }
+
+    bool WorkgroupTuner::tune(const ComputeProgramCreateInfo &info, const WorkgroupTuneInfo &tuneInfo,
+                              WorkgroupTuneResult &out) {
+        if (!device_ || !device_->isValid()) {
+            EVK_FAIL("Device is not valid");
+        }
+        if (!info.spirvData() || info.spirvWords() == 0) {
+            EVK_FAIL("SPIR-V code is required");
+        }
+        if (tuneInfo.problemX == 0 || tuneInfo.problemY == 0 || tuneInfo.problemZ == 0) {
+            EVK_FAIL("Problem size must be >= 1 in all dimensions");
+        }
+
+        const uint64_t k = key(info, tuneInfo);
+        for (const Entry &e : entries_) {
+            if (e.key == k) {
+                out.best = e.size;
+                out.medianNs = e.medianNs;
+                out.cached = true;
+                out.tried = 0;
+                return true;
+            }
+        }
+
+        const std::vector<WorkgroupSize> sizes = tuneInfo.candidates.empty() ? candidates(info, tuneInfo)
+                                                                             : tuneInfo.candidates;
+        const VkPhysicalDeviceLimits &lim = device_->limits();
+        const uint32_t iterations = std::max<uint32_t>(tuneInfo.iterations, 1);
+        bool found = false;
+        uint32_t tried = 0;
+        WorkgroupSize best = {1, 1, 1};
+        double bestNs = 0.0;
+        std::string error;
+
+        for (const WorkgroupSize &size : sizes) {
+            ComputeProgramCreateInfo ci = info;
+            ci.localX = size.x;
+            ci.localY = size.y;
+            ci.localZ = size.z;
+            if (!ci.validate(*device_, error)) continue;
+
+            const uint32_t groups[3] = {ceilDiv(tuneInfo.problemX, size.x), ceilDiv(tuneInfo.problemY, size.y),
+                                        ceilDiv(tuneInfo.problemZ, size.z)};
+            if (groups[0] > lim.maxComputeWorkGroupCount[0] || groups[1] > lim.maxComputeWorkGroupCount[1] ||
+                groups[2] > lim.maxComputeWorkGroupCount[2]) {
+                continue;
+            }
+
+            // A candidate that fails to build or run is skipped, whichever way it reports it
+            double median = 0.0;
+#ifndef EASYVK_NO_EXCEPTIONS
+            try {
+                if (!measureWorkgroupSize(*device_, ci, groups, tuneInfo, iterations, median)) continue;
+            } catch (...) {
+                continue;
+            }
+#else
+            if (!measureWorkgroupSize(*device_, ci, groups, tuneInfo, iterations, median)) continue;
+#endif
+            ++tried;
+            if (!found || median < bestNs) {
+                found = true;
+                best = size;
+                bestNs = median;
+            }
+        }
+
+        if (!found) {
+            EVK_FAIL("No workgroup size candidate could be built");
+        }
+
+        Entry e;
+        e.key = k;
+        e.size = best;
+        e.medianNs = bestNs;
+        entries_.push_back(e);
+        if (!path_.empty()) {
+            save(path_.c_str());
+        }
+
+        out.best = best;
+        out.medianNs = bestNs;
+        out.cached = false;
+        out.tried = tried;
+        return true;
+    }
+
+    // -------- CommandBatch implementation ---------------------------------------
+    CommandBatch::CommandBatch(Device &dev)
+        : device_(&dev),
+          childRef_(dev),
+          cmdBuf_(VK_NULL_HANDLE),
+          context_(nullptr),
+          commandCount_(0),
+          tornDown_(false) {
+        if (!dev.isValid()) {
+            EVK_FAIL_VOID("Device is not valid");
+        }
+    }
+
+    CommandBatch::CommandBatch(CommandBatch &&other) noexcept
+        : device_(other.device_),
+          childRef_(std::move(other.childRef_)),
+          cmdBuf_(other.cmdBuf_),
+          context_(other.context_),
+          profileSlots_(std::move(other.profileSlots_)),
+          accesses_(std::move(other.accesses_)),
+          commandCount_(other.commandCount_),
+          dependencies_(std::move(other.dependencies_)),
+          tornDown_(other.tornDown_) {
+        other.cmdBuf_ = VK_NULL_HANDLE;
+        other.commandCount_ = 0;
+        other.tornDown_ = true;
+    }
+
+    CommandBatch &CommandBatch::operator=(CommandBatch &&other) noexcept {
+        if (this != &other) {
+            teardown();
+            device_ = other.device_;
+            childRef_ = std::move(other.childRef_);
+            cmdBuf_ = other.cmdBuf_;
+            context_ = other.context_;
+            profileSlots_ = std::move(other.profileSlots_);
+            accesses_ = std::move(other.accesses_);
+            commandCount_ = other.commandCount_;
+            dependencies_ = std::move(other.dependencies_);
+            tornDown_ = other.tornDown_;
+
+            other.cmdBuf_ = VK_NULL_HANDLE;
+            other.commandCount_ = 0;
+            other.tornDown_ = true;
+        }
+        return *this;
+    }
+
+    CommandBatch::~CommandBatch() noexcept {
+        if (!tornDown_) {
+            teardown();
+        }
+    }
+
+    CommandBatch::RangeAccess CommandBatch::rangeAccess(const Buffer &buf, VkDeviceSize offset, VkDeviceSize size,
+                                                        VkPipelineStageFlags stage, VkAccessFlags access, bool write) {
+        return RangeAccess{buf.buffer_, offset, size, stage, access, write,
+                           write && (buf.memFlags_ & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0, 0, 0};
+    }
+
+    void CommandBatch::programAccesses(const ComputeProgram &program, std::vector<RangeAccess> &out) const {
+        const VkPipelineStageFlags stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        if (program.pushAddresses_) {
+            // Unknown targets: order against everything, and let the host read anything back
+            out.push_back(RangeAccess{VK_NULL_HANDLE, 0, VK_WHOLE_SIZE, stage,
+                                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, true, true, 0, 0});
+            return;
+        }
+        for (const ComputeProgram::BoundDescriptor &bound : program.boundDescriptors_) {
+            const bool write = bound.access != BufferAccess::Read;
+            VkAccessFlags access = 0;
+            if (bound.access != BufferAccess::Write) access |= VK_ACCESS_SHADER_READ_BIT;
+            if (write) access |= VK_ACCESS_SHADER_WRITE_BIT;
+            for (uint32_t i = 0; i < bound.count; ++i) {
+                const VkDescriptorBufferInfo &info = program.setData_[bound.set][bound.first + i];
+                if (info.buffer == VK_NULL_HANDLE) continue;
+                // Only the VkBuffer is known here, so written bindings count as host-readable
+                out.push_back(RangeAccess{info.buffer, info.offset, info.range, stage, access, write, write, 0, 0});
+            }
+        }
+    }
+
+    bool CommandBatch::prepare(const std::vector<RangeAccess> &next) {
+        if (!isValid()) {
+            EVK_FAIL("CommandBatch is not valid");
+        }
+
+        if (cmdBuf_ == VK_NULL_HANDLE) {
+            context_ = device_->commandContext();
+            cmdBuf_ = device_->acquireCommandBuffer();
+
+            VkCommandBufferBeginInfo beginInfo{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                nullptr,
+                VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                nullptr
+            };
+            VK_CHECK(vkBeginCommandBuffer(cmdBuf_, &beginInfo));
+
+            if (vkCmdBeginDebugUtilsLabelEXT) {
+                VkDebugUtilsLabelEXT label{VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
+                label.pLabelName = "easyvk::CommandBatch";
+                vkCmdBeginDebugUtilsLabelEXT(cmdBuf_, &label);
+            }
+        }
+
+        // A recorded access conflicts with a new one when the ranges overlap, at least one of
+        // them writes, and no earlier barrier already covers the new stage (and, after a
+        // write, the new access). Each conflict yields one barrier over the new range.
+        // Only the new access's buffer and the whole-memory (VK_NULL_HANDLE) entries can
+        // conflict, unless the new access itself covers all memory. The first touch of a
+        // buffer seeds its list with a write by earlier work on the queue (other submissions
+        // read or wrote it with no barrier in between), as ComputeProgram::recordInputBarriers
+        // assumes for a single dispatch.
+        std::vector<RangeBarrier> barriers;
+        std::vector<RangeAccess *> conflicts;
+        std::vector<RangeAccess> pieces;
+        for (const RangeAccess &a : next) {
+            if (accesses_.find(a.buffer) == accesses_.end()) {
+                accesses_[a.buffer].push_back(RangeAccess{
+                    a.buffer, 0, VK_WHOLE_SIZE,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, true, false, 0, 0});
+            }
+            const VkDeviceSize aEnd = rangeEnd(a.offset, a.size);
+            conflicts.clear();
+            RangeBarrier barrier{a.buffer, a.offset, a.size, 0, a.stage, 0, a.access};
+            auto scan = [&](std::vector<RangeAccess> &recorded) {
+                for (RangeAccess &p : recorded) {
+                    if (!p.write && !a.write) continue;
+                    if (p.buffer != VK_NULL_HANDLE && a.buffer != VK_NULL_HANDLE &&
+                        (p.offset >= aEnd || a.offset >= rangeEnd(p.offset, p.size))) {
+                        continue;
+                    }
+                    const bool executionCovered = (p.syncedStages & a.stage) == a.stage;
+                    const bool memoryCovered = !p.write || (p.syncedAccess & a.access) == a.access;
+                    if (executionCovered && memoryCovered) continue;
+
+                    barrier.srcStage |= p.stage;
+                    if (p.write) barrier.srcAccess |= p.access & (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+                    conflicts.push_back(&p);
+                }
+            };
+            if (a.buffer == VK_NULL_HANDLE) {
+                for (auto &entry : accesses_) scan(entry.second);
+            } else {
+                auto it = accesses_.find(a.buffer);
+                if (it != accesses_.end()) scan(it->second);
+                it = accesses_.find(VK_NULL_HANDLE);
+                if (it != accesses_.end()) scan(it->second);
+            }
+            if (conflicts.empty()) continue;
+            barriers.push_back(barrier);
+
+            // Later commands with the same stage and access need no second barrier for the
+            // recorded accesses this one covered. One it covered only in part is split so that
+            // just the covered piece counts as synced.
+            pieces.clear();
+            for (RangeAccess *conflict : conflicts) {
+                RangeAccess &p = *conflict;
+                const VkDeviceSize pEnd = rangeEnd(p.offset, p.size);
+                if (a.buffer != VK_NULL_HANDLE && p.buffer == a.buffer && (p.offset < a.offset || aEnd < pEnd)) {
+                    if (p.offset < a.offset) {
+                        RangeAccess before = p;
+                        before.size = a.offset - p.offset;
+                        pieces.push_back(before);
+                    }
+                    if (aEnd < pEnd) {
+                        RangeAccess after = p;
+                        after.offset = aEnd;
+                        after.size = p.size == VK_WHOLE_SIZE ? VK_WHOLE_SIZE : pEnd - aEnd;
+                        pieces.push_back(after);
+                    }
+                    const VkDeviceSize start = std::max(p.offset, a.offset);
+                    p.size = std::min(pEnd, aEnd) == std::numeric_limits<VkDeviceSize>::max()
+                        ? VK_WHOLE_SIZE : std::min(pEnd, aEnd) - start;
+                    p.offset = start;
+                } else if (a.buffer != VK_NULL_HANDLE && p.buffer != a.buffer) {
+                    continue; // a whole-memory entry stays unsynced for the rest of memory
+                }
+                p.syncedStages |= a.stage;
+                p.syncedAccess |= a.access;
+            }
+            if (!pieces.empty()) {
+                std::vector<RangeAccess> &recorded = accesses_[a.buffer];
+                recorded.insert(recorded.end(), pieces.begin(), pieces.end());
+            }
+        }
+        if (barriers.size() > kMaxRangeBarriers) {
+            RangeBarrier global{VK_NULL_HANDLE, 0, VK_WHOLE_SIZE, 0, 0, 0, 0};
+            for (const RangeBarrier &b : barriers) {
+                global.srcStage |= b.srcStage;
+                global.dstStage |= b.dstStage;
+                global.srcAccess |= b.srcAccess;
+                global.dstAccess |= b.dstAccess;
+            }
+            barriers.assign(1, global);
+        }
+        recordBarriers(*device_, cmdBuf_, barriers.data(), barriers.size());
+
+        // A repeat of a recorded access replaces it: whatever conflicts with the old one
+        // conflicts with the new one too, and a barrier after the new one covers both. The
+        // lists stay as long as the distinct accesses, not the commands.
+        for (const RangeAccess &a : next) {
+            std::vector<RangeAccess> &recorded = accesses_[a.buffer];
+            bool merged = false;
+            for (RangeAccess &p : recorded) {
+                if (p.offset == a.offset && p.size == a.size && p.stage == a.stage && p.access == a.access &&
+                    p.write == a.write && p.hostVisible == a.hostVisible) {
+                    p.syncedStages = a.syncedStages;
+                    p.syncedAccess = a.syncedAccess;
+                    merged = true;
+                    break;
+                }
+            }
+            if (!merged) recorded.push_back(a);
+        }
+        return true;
+    }
+
+    bool CommandBatch::dispatch(ComputeProgram &program) {
+        if (!program.isValid()) {
+            EVK_FAIL("CommandBatch::dispatch: program is not valid");
+        }
+        if (program.device_ != device_) {
+            EVK_FAIL("CommandBatch::dispatch: program belongs to a different device");
+        }
+        std::vector<RangeAccess> accesses;
+        programAccesses(program, accesses);
+        if (!prepare(accesses)) return false;
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf_, program.label_.c_str(),
+                                                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) : UINT32_MAX;
+        program.recordBind(cmdBuf_);
+        vkCmdDispatch(cmdBuf_, program.groupsX_, program.groupsY_, program.groupsZ_);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf_, slot, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            profileSlots_.push_back(slot);
+        }
+        ++commandCount_;
+        return true;
+    }
+
+    bool CommandBatch::dispatchIndirect(ComputeProgram &program, const Buffer &args, VkDeviceSize offset) {
+        if (!program.isValid()) {
+            EVK_FAIL("CommandBatch::dispatchIndirect: program is not valid");
+        }
+        if (program.device_ != device_) {
+            EVK_FAIL("CommandBatch::dispatchIndirect: program belongs to a different device");
+        }
+        if (!args.isValid() || args.device_ != device_) {
+            EVK_FAIL("CommandBatch::dispatchIndirect: argument buffer is not valid or belongs to a different device");
+        }
+        if (!(args.usageFlags_ & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)) {
+            EVK_FAIL("CommandBatch::dispatchIndirect: argument buffer lacks indirect usage (create it as BufferUsage::Storage)");
+        }
+        if (offset % 4 != 0) {
+            EVK_FAIL("CommandBatch::dispatchIndirect: offset must be a multiple of 4");
+        }
+        if (!args.validateRange(offset, sizeof(VkDispatchIndirectCommand), "CommandBatch::dispatchIndirect")) {
+            return false;
+        }
+        std::vector<RangeAccess> accesses;
+        programAccesses(program, accesses);
+        accesses.push_back(rangeAccess(args, offset, sizeof(VkDispatchIndirectCommand),
+                                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, false));
+        if (!prepare(accesses)) return false;
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf_, program.label_.c_str(),
+                                                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) : UINT32_MAX;
+        program.recordBind(cmdBuf_);
+        vkCmdDispatchIndirect(cmdBuf_, args.buffer_, offset);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf_, slot, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            profileSlots_.push_back(slot);
+        }
+        ++commandCount_;
+        return true;
+    }
+
+    bool CommandBatch::copy(Buffer &src, Buffer &dst, VkDeviceSize bytes, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+        if (bytes == VK_WHOLE_SIZE) {
+            if (srcOffset >= src.size_ || dstOffset >= dst.size_) {
+                EVK_FAIL("CommandBatch::copy: offset beyond buffer size");
+            }
+            bytes = std::min(src.size_ - srcOffset, dst.size_ - dstOffset);
+        }
+
+        if (!src.validateRange(srcOffset, bytes, "CommandBatch::copy source")) {
+            return false;
+        }
+        if (!dst.validateRange(dstOffset, bytes, "CommandBatch::copy destination")) {
+            return false;
+        }
+        std::vector<RangeAccess> accesses;
+        accesses.push_back(rangeAccess(src, srcOffset, bytes, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                       VK_ACCESS_TRANSFER_READ_BIT, false));
+        accesses.push_back(rangeAccess(dst, dstOffset, bytes, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                       VK_ACCESS_TRANSFER_WRITE_BIT, true));
+        if (!prepare(accesses)) return false;
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf_, "copy", VK_PIPELINE_STAGE_TRANSFER_BIT)
+                                       : UINT32_MAX;
+        VkBufferCopy copyRegion{srcOffset, dstOffset, bytes};
+        vkCmdCopyBuffer(cmdBuf_, src.buffer_, dst.buffer_, 1, &copyRegion);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf_, slot, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            profileSlots_.push_back(slot);
+        }
+        ++commandCount_;
+        return true;
+    }
+
+    bool CommandBatch::fill(Buffer &dst, uint32_t value, VkDeviceSize offset, VkDeviceSize size) {
+        if (!dst.validateFill(offset, size, "CommandBatch::fill")) {
+            return false;
+        }
+        if (!prepare(std::vector<RangeAccess>(1, rangeAccess(dst, offset, size, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                             VK_ACCESS_TRANSFER_WRITE_BIT, true)))) {
+            return false;
+        }
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf_, "fill", VK_PIPELINE_STAGE_TRANSFER_BIT)
+                                       : UINT32_MAX;
+        vkCmdFillBuffer(cmdBuf_, dst.buffer_, offset, size, value);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf_, slot, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            profileSlots_.push_back(slot);
+        }
+        ++commandCount_;
+        return true;
+    }
+
+    bool CommandBatch::update(Buffer &dst, const void *data, VkDeviceSize offset, VkDeviceSize size) {
+        if (!dst.validateUpdate(data, offset, size, "CommandBatch::update")) {
+            return false;
+        }
+        if (!prepare(std::vector<RangeAccess>(1, rangeAccess(dst, offset, size, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                             VK_ACCESS_TRANSFER_WRITE_BIT, true)))) {
+            return false;
+        }
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf_, "update", VK_PIPELINE_STAGE_TRANSFER_BIT)
+                                       : UINT32_MAX;
+        vkCmdUpdateBuffer(cmdBuf_, dst.buffer_, offset, size, data);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf_, slot, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            profileSlots_.push_back(slot);
+        }
+        ++commandCount_;
+        return true;
+    }
+
+    SubmitHandle CommandBatch::submitAsync(bool addHostBarrier) {
+        if (!isValid()) {
+            EVK_FAIL("CommandBatch is not valid");
+        }
+        if (cmdBuf_ == VK_NULL_HANDLE || commandCount_ == 0) {
+            EVK_FAIL("CommandBatch is empty");
+        }
+
+        if (addHostBarrier) {
+            // Only written memory the host can map needs to be made visible to it
+            std::vector<RangeBarrier> barriers;
+            for (const auto &entry : accesses_) {
+                for (const RangeAccess &a : entry.second) {
+                    if (!a.hostVisible) continue;
+                    barriers.push_back(RangeBarrier{a.buffer, a.offset, a.size, a.stage, VK_PIPELINE_STAGE_HOST_BIT,
+                                                    a.access & (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT),
+                                                    VK_ACCESS_HOST_READ_BIT});
+                }
+            }
+            if (barriers.size() > kMaxRangeBarriers) {
+                RangeBarrier global{VK_NULL_HANDLE, 0, VK_WHOLE_SIZE, 0, VK_PIPELINE_STAGE_HOST_BIT, 0, VK_ACCESS_HOST_READ_BIT};
+                for (const RangeBarrier &b : barriers) {
+                    global.srcStage |= b.srcStage;
+                    global.srcAccess |= b.srcAccess;
+                }
+                barriers.assign(1, global);
+            }
+            recordBarriers(*device_, cmdBuf_, barriers.data(), barriers.size());
+        }
+
+        if (vkCmdEndDebugUtilsLabelEXT) {
+            vkCmdEndDebugUtilsLabelEXT(cmdBuf_);
+        }
+
+        VK_CHECK(vkEndCommandBuffer(cmdBuf_));
+
+        // Ownership of the command buffer moves to the handle (recycled by Device::wait)
+        VkCommandBuffer cmdBuf = cmdBuf_;
+        std::vector<SubmitHandle> deps;
+        deps.swap(dependencies_);
+        cmdBuf_ = VK_NULL_HANDLE;
+        accesses_.clear();
+        commandCount_ = 0;
+        profileSlots_.clear(); // the profiler picks these up from the query pool
+        return device_->submitCommands(cmdBuf, true, deps.empty() ? nullptr : deps.data(),
+                                       static_cast<uint32_t>(deps.size()), context_);
+    }
+
+    void CommandBatch::waitOn(const SubmitHandle &dependency) {
+        if (dependency.isValid()) {
+            dependencies_.push_back(dependency);
+        }
+    }
+
+    bool CommandBatch::submit(bool addHostBarrier) {
+        SubmitHandle handle = submitAsync(addHostBarrier);
+        return device_->wait(handle);
+    }
+
+    void CommandBatch::reset() {
+        if (cmdBuf_ != VK_NULL_HANDLE && device_ && device_->vk() != VK_NULL_HANDLE) {
+            device_->releaseCommandBuffer(cmdBuf_, context_);
+        }
+        if (!profileSlots_.empty() && device_ && device_->profiler()) {
+            device_->profiler()->cancel(profileSlots_.data(), profileSlots_.size());
+        }
+        profileSlots_.clear();
+        cmdBuf_ = VK_NULL_HANDLE;
+        accesses_.clear();
+        commandCount_ = 0;
+        dependencies_.clear();
+    }
+
+    void CommandBatch::teardown() {
+        if (tornDown_) return;
+        reset();
+        tornDown_ = true;
+    }
+
+    // -------- Stream implementation ---------------------------------------------
+    Stream::Stream()
+        : device_(nullptr),
+          queue_(VK_NULL_HANDLE),
+          queueIndex_(0),
+          cmdPool_(VK_NULL_HANDLE),
+          timeline_(VK_NULL_HANDLE),
+          timelineValue_(0),
+          tornDown_(true) {}
+
+    Stream::Stream(Device &dev, uint32_t queueIndex)
+        : device_(&dev),
+          childRef_(dev),
+          queue_(VK_NULL_HANDLE),
+          queueIndex_(0),
+          cmdPool_(VK_NULL_HANDLE),
+          timeline_(VK_NULL_HANDLE),
+          timelineValue_(0),
+          tornDown_(false) {
+        if (!dev.isValid()) {
+            EVK_FAIL_VOID("Device is not valid");
+        }
+
+        queueIndex_ = queueIndex % dev.computeQueueCount();
+        queue_ = dev.computeQueues_[queueIndex_];
+
+        VkCommandPoolCreateInfo poolInfo{
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            nullptr,
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            dev.queueFamilyIndex_
+        };
+        VK_CHECK(vkCreateCommandPool(dev.vk(), &poolInfo, nullptr, &cmdPool_));
+
+        if (dev.timelineSemaphoresEnabled()) {
+            VkSemaphoreTypeCreateInfo typeInfo{
+                VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                nullptr,
+                VK_SEMAPHORE_TYPE_TIMELINE,
+                0
+            };
+            VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &typeInfo, 0};
+            VkResult result = vkCreateSemaphore(dev.vk(), &semaphoreInfo, nullptr, &timeline_);
+            if (result != VK_SUCCESS) {
+                vkDestroyCommandPool(dev.vk(), cmdPool_, nullptr);
+                cmdPool_ = VK_NULL_HANDLE;
+                VK_CHECK(result);
+            }
+        }
+    }
+
+    Stream::Stream(Stream &&other) noexcept
+        : device_(other.device_),
+          childRef_(std::move(other.childRef_)),
+          queue_(other.queue_),
+          queueIndex_(other.queueIndex_),
+          cmdPool_(other.cmdPool_),
+          timeline_(other.timeline_),
+          timelineValue_(other.timelineValue_),
+          inFlight_(std::move(other.inFlight_)),
+          freeCmdBufs_(std::move(other.freeCmdBufs_)),
+          freeFences_(std::move(other.freeFences_)),
+          tornDown_(other.tornDown_) {
+        other.cmdPool_ = VK_NULL_HANDLE;
+        other.timeline_ = VK_NULL_HANDLE;
+        other.tornDown_ = true;
+    }
+
+    Stream &Stream::operator=(Stream &&other) noexcept {
+        if (this != &other) {
+            teardown();
+            device_ = other.device_;
+            childRef_ = std::move(other.childRef_);
+            queue_ = other.queue_;
+            queueIndex_ = other.queueIndex_;
+            cmdPool_ = other.cmdPool_;
+            timeline_ = other.timeline_;
+            timelineValue_ = other.timelineValue_;
+            inFlight_ = std::move(other.inFlight_);
+            freeCmdBufs_ = std::move(other.freeCmdBufs_);
+            freeFences_ = std::move(other.freeFences_);
+            tornDown_ = other.tornDown_;
+
+            other.cmdPool_ = VK_NULL_HANDLE;
+            other.timeline_ = VK_NULL_HANDLE;
+            other.tornDown_ = true;
+        }
+        return *this;
+    }
+
+    Stream::~Stream() noexcept {
+        if (!tornDown_) {
+            teardown();
+        }
+    }
+
+    void Stream::retire(size_t index) {
+        InFlight entry = inFlight_[index];
+        inFlight_[index] = inFlight_.back();
+        inFlight_.pop_back();
+
+        if (freeCmdBufs_.size() < kMaxPooledSubmitObjects && vkResetCommandBuffer(entry.cmdBuf, 0) == VK_SUCCESS) {
+            freeCmdBufs_.push_back(entry.cmdBuf);
+        } else {
+            vkFreeCommandBuffers(device_->vk(), cmdPool_, 1, &entry.cmdBuf);
+        }
+        if (entry.fence != VK_NULL_HANDLE) {
+            device_->retireFence(entry.fence);
+            if (freeFences_.size() < kMaxPooledSubmitObjects && vkResetFences(device_->vk(), 1, &entry.fence) == VK_SUCCESS) {
+                freeFences_.push_back(entry.fence);
+            } else {
+                vkDestroyFence(device_->vk(), entry.fence, nullptr);
+            }
+        }
+    }
+
+    void Stream::recycle() {
+        // Fence submissions are retired by wait()/synchronize(), which own the handle
+        if (timeline_ == VK_NULL_HANDLE || inFlight_.empty()) return;
+
+        uint64_t completed = 0;
+        if (device_->getSemaphoreCounterValue_(device_->vk(), timeline_, &completed) != VK_SUCCESS) return;
+        for (size_t i = inFlight_.size(); i-- > 0;) {
+            if (inFlight_[i].value <= completed) retire(i);
+        }
+    }
+
+    VkCommandBuffer Stream::beginCommands(const char *label) {
+        recycle();
+
+        VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+        if (!freeCmdBufs_.empty()) {
+            cmdBuf = freeCmdBufs_.back();
+            freeCmdBufs_.pop_back();
+        } else {
+            VkCommandBufferAllocateInfo allocInfo{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                nullptr,
+                cmdPool_,
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                1
+            };
+            VK_CHECK(vkAllocateCommandBuffers(device_->vk(), &allocInfo, &cmdBuf));
+            ++device_->counters_->commandBuffersAllocated;
+        }
+
+        VkCommandBufferBeginInfo beginInfo{
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            nullptr,
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            nullptr
+        };
+        VK_CHECK(vkBeginCommandBuffer(cmdBuf, &beginInfo));
+
+        if (vkCmdBeginDebugUtilsLabelEXT) {
+            VkDebugUtilsLabelEXT debugLabel{VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
+            debugLabel.pLabelName = label;
+            vkCmdBeginDebugUtilsLabelEXT(cmdBuf, &debugLabel);
+        }
+        return cmdBuf;
+    }
+
+    SubmitHandle Stream::submit(VkCommandBuffer cmdBuf, const SubmitHandle &dependency, uint32_t profileSlot) {
+        if (vkCmdEndDebugUtilsLabelEXT) {
+            vkCmdEndDebugUtilsLabelEXT(cmdBuf);
+        }
+        // Nothing reaches the queue on the error paths below: the slot would never be written
+        Profiler *profiler = device_->profiler();
+        auto cancelSlot = [&]() {
+            if (profileSlot != UINT32_MAX && profiler) profiler->cancel(&profileSlot, 1);
+        };
+        VkResult result = vkEndCommandBuffer(cmdBuf);
+        if (result != VK_SUCCESS) {
+            cancelSlot();
+            VK_CHECK(result);
+        }
+
+        // Timeline dependencies (from any queue) are waited for on the GPU
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        const bool gpuWait = dependency.isTimeline();
+        if (gpuWait && dependency.semaphore == device_->computeTimeline_) {
+            // A queued (coalesced) submission would leave this queue waiting forever
+            device_->flushThrough(dependency.value);
+        }
+        if (!gpuWait && dependency.fence != VK_NULL_HANDLE) {
+            result = device_->waitFenceDependency(dependency);
+            if (result != VK_SUCCESS) {
+                cancelSlot();
+                EVK_CHECK(result, "Waiting for a fence dependency failed");
+            }
+        }
+
+        InFlight entry{0, VK_NULL_HANDLE, cmdBuf};
+        uint64_t signalValue = timelineValue_ + 1;
+        VkTimelineSemaphoreSubmitInfo timelineInfo{
+            VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            nullptr,
+            gpuWait ? 1u : 0u, gpuWait ? &dependency.value : nullptr,
+            1, &signalValue
+        };
+        VkSubmitInfo submitInfo{
+            VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            timeline_ != VK_NULL_HANDLE ? &timelineInfo : nullptr,
+            gpuWait ? 1u : 0u,
+            gpuWait ? &dependency.semaphore : nullptr,
+            gpuWait ? &waitStage : nullptr,
+            1, &cmdBuf,
+            timeline_ != VK_NULL_HANDLE ? 1u : 0u,
+            timeline_ != VK_NULL_HANDLE ? &timeline_ : nullptr
+        };
+
+        if (timeline_ == VK_NULL_HANDLE) {
+            if (!freeFences_.empty()) {
+                entry.fence = freeFences_.back();
+                freeFences_.pop_back();
+            } else {
+                VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
+                result = vkCreateFence(device_->vk(), &fenceInfo, nullptr, &entry.fence);
+                if (result != VK_SUCCESS) {
+                    cancelSlot();
+                    VK_CHECK(result);
+                }
+                ++device_->counters_->fencesCreated;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(*device_->queueLocks_[queueIndex_]);
+            ++device_->counters_->queueSubmits;
+            result = vkQueueSubmit(queue_, 1, &submitInfo, entry.fence);
+        }
+        if (result != VK_SUCCESS) {
+            if (entry.fence != VK_NULL_HANDLE) freeFences_.push_back(entry.fence);
+            vkResetCommandBuffer(cmdBuf, 0);
+            freeCmdBufs_.push_back(cmdBuf);
+            cancelSlot();
+            EVK_CHECK(result, "vkQueueSubmit (stream) failed");
+        }
+
+        SubmitHandle handle;
+        if (timeline_ != VK_NULL_HANDLE) {
+            timelineValue_ = signalValue;
+            entry.value = signalValue;
+            handle.semaphore = timeline_;
+            handle.value = signalValue;
+        } else {
+            handle.fence = entry.fence;
+            handle.value = device_->claimFence(entry.fence);
+        }
+        handle.device = device_;
+        inFlight_.push_back(entry);
+        return handle;
+    }
+
+    SubmitHandle Stream::dispatchAsync(ComputeProgram &program, bool addHostBarrier, const SubmitHandle &dependency) {
+        if (!isValid()) {
+            EVK_FAIL("Stream is not valid");
+        }
+        if (!program.isValid()) {
+            EVK_FAIL("Stream::dispatch: program is not valid");
+        }
+        if (program.device_ != device_) {
+            EVK_FAIL("Stream::dispatch: program belongs to a different device");
+        }
+
+        VkCommandBuffer cmdBuf = beginCommands("easyvk::Stream::dispatch");
+        program.recordInputBarriers(cmdBuf);
+
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf, program.label_.c_str(),
+                                                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) : UINT32_MAX;
+        program.recordBind(cmdBuf);
+        vkCmdDispatch(cmdBuf, program.groupsX_, program.groupsY_, program.groupsZ_);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf, slot, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+
+        if (addHostBarrier) {
+            program.recordHostBarriers(cmdBuf);
+        }
+
+        return submit(cmdBuf, dependency, slot);
+    }
+
+    bool Stream::dispatch(ComputeProgram &program) {
+        SubmitHandle handle = dispatchAsync(program, true);
+        return wait(handle);
+    }
+
+    SubmitHandle Stream::copyAsync(Buffer &src, Buffer &dst, VkDeviceSize bytes, VkDeviceSize srcOffset,
+                                   VkDeviceSize dstOffset, const SubmitHandle &dependency) {
+        if (!isValid()) {
+            EVK_FAIL("Stream is not valid");
+        }
+        if (bytes == VK_WHOLE_SIZE) {
+            if (srcOffset >= src.size_ || dstOffset >= dst.size_) {
+                EVK_FAIL("Stream::copy: offset beyond buffer size");
+            }
+            bytes = std::min(src.size_ - srcOffset, dst.size_ - dstOffset);
+        }
+        if (!src.validateRange(srcOffset, bytes, "Stream::copy source")) {
+            return SubmitHandle();
+        }
+        if (!dst.validateRange(dstOffset, bytes, "Stream::copy destination")) {
+            return SubmitHandle();
+        }
+
+        VkCommandBuffer cmdBuf = beginCommands("easyvk::Stream::copy");
+        Profiler *profiler = device_->profiler();
+        const uint32_t slot = profiler ? profiler->beginScope(cmdBuf, "copy", VK_PIPELINE_STAGE_TRANSFER_BIT)
+                                       : UINT32_MAX;
+        VkBufferCopy copyRegion{srcOffset, dstOffset, bytes};
+        vkCmdCopyBuffer(cmdBuf, src.buffer_, dst.buffer_, 1, &copyRegion);
+        if (slot != UINT32_MAX) {
+            profiler->endScope(cmdBuf, slot, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        return submit(cmdBuf, dependency, slot);
     }
 
-    ComputeProgram::ComputeProgram(Device &dev, const ComputeProgramCreateInfo &info)
+    bool Stream::wait(const SubmitHandle &h, uint64_t timeoutNs) {
+        if (!h.isValid() || !isValid()) return false;
+
+        VkResult result;
+        if (h.isTimeline()) {
+            VkSemaphoreWaitInfo waitInfo{
+                VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                nullptr,
+                0,
+                1, &h.semaphore, &h.value
+            };
+            {
+                WaitScope scope(device_->counters_.get(), device_->tracer(), timeoutNs);
+                result = device_->waitSemaphores_(device_->vk(), &waitInfo, timeoutNs);
+            }
+            if (result == VK_SUCCESS) recycle();
+            return result == VK_SUCCESS;
+        }
+
+        {
+            WaitScope scope(device_->counters_.get(), device_->tracer(), timeoutNs);
+            result = vkWaitForFences(device_->vk(), 1, &h.fence, VK_TRUE, timeoutNs);
+        }
+        if (result != VK_SUCCESS) return false;
+        for (size_t i = 0; i < inFlight_.size(); ++i) {
+            if (inFlight_[i].fence == h.fence) {
+                retire(i);
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool Stream::isComplete(const SubmitHandle &h) const {
+        if (!isValid()) return false;
+        return device_->isComplete(h);
+    }
+
+    bool Stream::synchronize() {
+        if (!isValid()) return false;
+
+        if (timeline_ != VK_NULL_HANDLE) {
+            if (timelineValue_ == 0) return true;
+            VkSemaphoreWaitInfo waitInfo{
+                VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                nullptr,
+                0,
+                1, &timeline_, &timelineValue_
+            };
+            WaitScope scope(device_->counters_.get(), device_->tracer());
+            if (device_->waitSemaphores_(device_->vk(), &waitInfo, UINT64_MAX) != VK_SUCCESS) return false;
+            recycle();
+            return true;
+        }
+
+        std::vector<VkFence> fences;
+        for (const InFlight &entry : inFlight_) {
+            fences.push_back(entry.fence);
+        }
+        if (!fences.empty()) {
+            WaitScope scope(device_->counters_.get(), device_->tracer());
+            if (vkWaitForFences(device_->vk(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE,
+                                UINT64_MAX) != VK_SUCCESS) {
+                return false;
+            }
+        }
+        while (!inFlight_.empty()) {
+            retire(inFlight_.size() - 1);
+        }
+        return true;
+    }
+
+    void Stream::teardown() {
+        if (tornDown_) return;
+
+        if (device_ && device_->vk() != VK_NULL_HANDLE && cmdPool_ != VK_NULL_HANDLE) {
+            // Our pool and timeline may still be referenced by pending submissions; wait for
+            // this stream's work only, not for other streams sharing the queue
+            if (!synchronize()) {
+                std::lock_guard<std::mutex> lock(*device_->queueLocks_[queueIndex_]);
+                vkQueueWaitIdle(queue_);
+            }
+
+            for (const InFlight &entry : inFlight_) {
+                if (entry.fence == VK_NULL_HANDLE) continue;
+                device_->retireFence(entry.fence);
+                vkDestroyFence(device_->vk(), entry.fence, nullptr);
+            }
+            for (VkFence fence : freeFences_) {
+                vkDestroyFence(device_->vk(), fence, nullptr);
+            }
+            if (timeline_ != VK_NULL_HANDLE) {
+                vkDestroySemaphore(device_->vk(), timeline_, nullptr);
+            }
+            // Command buffers are released together with their pool
+            vkDestroyCommandPool(device_->vk(), cmdPool_, nullptr);
+        }
+
+        inFlight_.clear();
+        freeCmdBufs_.clear();
+        freeFences_.clear();
+        timeline_ = VK_NULL_HANDLE;
+        cmdPool_ = VK_NULL_HANDLE;
+        tornDown_ = true;
+    }
+
+    // -------- TaskGraph implementation ------------------------------------------
+#ifdef EASYVK_NO_EXCEPTIONS
+#  define EVK_FAIL_NODE(msg) do { lastError_ = (msg); return invalidNode; } while(0)
+#else
+#  define EVK_FAIL_NODE(msg) do { throw std::runtime_error(msg); } while(0)
+#endif
+
+    TaskGraph::TaskGraph(Device &dev)
         : device_(&dev),
-          layout_(VK_NULL_HANDLE),
-          pipeline_(VK_NULL_HANDLE),
-          dsp_(VK_NULL_HANDLE),
-          shader_(VK_NULL_HANDLE),
+          childRef_(dev),
           cmdPool_(VK_NULL_HANDLE),
-          cmdBuf_(VK_NULL_HANDLE),
           fence_(VK_NULL_HANDLE),
-          timestampQueryPool_(VK_NULL_HANDLE),
-          pcCapacityBytes_(info.pushConstantBytes),
-          pcCfg_{info.pushConstantBytes, 0},
-          groupsX_(1),
-          groupsY_(1),
-          groupsZ_(1),
-          localX_(info.localX),
-          localY_(info.localY),
-          localZ_(info.localZ),
-          initialized_(false),
-          tornDown_(false),
-          timestampInFlight_(false),
-          initState_(INIT_NONE),
-          lastTimestamps_() {
-        lastTimestamps_[0] = lastTimestamps_[1] = 0;
+          fenceInFlight_(false),
+          lastValue_(0),
+          compiled_(false),
+          barrierCount_(0),
+          semaphoreWaitCount_(0),
+          tornDown_(false) {
+        if (!dev.isValid()) {
+            EVK_FAIL_VOID("Device is not valid");
+        }
 
-        std::string validationError;
-        if (!info.validate(dev, validationError)) {
-            EVK_FAIL_VOID(validationError);
+        // Command buffers are recorded once and resubmitted, so no TRANSIENT/ONE_TIME usage
+        VkCommandPoolCreateInfo poolInfo{
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            nullptr,
+            0,
+            dev.queueFamilyIndex_
+        };
+        VK_CHECK(vkCreateCommandPool(dev.vk(), &poolInfo, nullptr, &cmdPool_));
+    }
+
+    TaskGraph::TaskGraph(TaskGraph &&other) noexcept
+        : device_(other.device_),
+          childRef_(std::move(other.childRef_)),
+          cmdPool_(other.cmdPool_),
+          nodes_(std::move(other.nodes_)),
+          chains_(std::move(other.chains_)),
+          fence_(other.fence_),
+          fenceInFlight_(other.fenceInFlight_),
+          lastValue_(other.lastValue_),
+          compiled_(other.compiled_),
+          barrierCount_(other.barrierCount_),
+          semaphoreWaitCount_(other.semaphoreWaitCount_),
+          tornDown_(other.tornDown_) {
+        other.cmdPool_ = VK_NULL_HANDLE;
+        other.fence_ = VK_NULL_HANDLE;
+        other.fenceInFlight_ = false;
+        other.compiled_ = false;
+        other.tornDown_ = true;
+    }
+
+    TaskGraph &TaskGraph::operator=(TaskGraph &&other) noexcept {
+        if (this != &other) {
+            teardown();
+            device_ = other.device_;
+            childRef_ = std::move(other.childRef_);
+            cmdPool_ = other.cmdPool_;
+            nodes_ = std::move(other.nodes_);
+            chains_ = std::move(other.chains_);
+            fence_ = other.fence_;
+            fenceInFlight_ = other.fenceInFlight_;
+            lastValue_ = other.lastValue_;
+            compiled_ = other.compiled_;
+            barrierCount_ = other.barrierCount_;
+            semaphoreWaitCount_ = other.semaphoreWaitCount_;
+            tornDown_ = other.tornDown_;
+
+            other.cmdPool_ = VK_NULL_HANDLE;
+            other.fence_ = VK_NULL_HANDLE;
+            other.fenceInFlight_ = false;
+            other.compiled_ = false;
+            other.tornDown_ = true;
         }
+        return *this;
+    }
 
-#ifdef EASYVK_USE_SPIRV_TOOLS
-        std::string spirvError;
-        if (!validateSPIRV(*info.spirv, spirvError)) {
-            EVK_FAIL_VOID("SPIR-V validation failed: " + spirvError);
+    TaskGraph::~TaskGraph() noexcept {
+        if (!tornDown_) {
+            teardown();
         }
-#endif
+    }
 
-        // Validate push constant constraints
-        if (pcCapacityBytes_ > 0) {
-            pcData_.resize(pcCapacityBytes_, 0);
+    uint32_t TaskGraph::addNode(Node &node) {
+        if (nodes_.size() >= invalidNode) {
+            EVK_FAIL_NODE("TaskGraph: too many nodes");
         }
+        nodes_.push_back(std::move(node));
+        compiled_ = false;
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
 
-        try {
-            // Create shader module
-            VkShaderModuleCreateInfo createInfo{
-                VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-                nullptr,
-                0,
-                info.spirv->size() * sizeof(uint32_t),
-                info.spirv->data()
-            };
-            VK_CHECK(vkCreateShaderModule(device_->vk(), &createInfo, nullptr, &shader_));
-            initState_ = INIT_SHADER;
+    uint32_t TaskGraph::addDispatch(ComputeProgram &program, const std::vector<const Buffer *> &reads,
+                                    const std::vector<const Buffer *> &writes) {
+        if (!isValid()) {
+            EVK_FAIL_NODE("TaskGraph is not valid");
+        }
+        if (!program.isValid()) {
+            EVK_FAIL_NODE("TaskGraph::addDispatch: program is not valid");
+        }
+        if (program.device_ != device_) {
+            EVK_FAIL_NODE("TaskGraph::addDispatch: program belongs to a different device");
+        }
 
-            // Group bindings by set
-            std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> setBindings;
-            for (const auto &entry : info.bindings.entries) {
-                setBindings[entry.set].push_back(VkDescriptorSetLayoutBinding{
-                    entry.binding,
-                    entry.type,
-                    static_cast<uint32_t>(entry.buffers.size()),
-                    VK_SHADER_STAGE_COMPUTE_BIT,
-                    nullptr
-                });
+        Node node;
+        node.type = NodeType::Dispatch;
+        node.program = &program;
+        for (const Buffer *buf : reads) {
+            if (!buf || !buf->isValid() || buf->device_ != device_) {
+                EVK_FAIL_NODE("TaskGraph::addDispatch: invalid read buffer");
             }
+            node.reads.push_back(buf->buffer_);
+        }
+        for (const Buffer *buf : writes) {
+            if (!buf || !buf->isValid() || buf->device_ != device_) {
+                EVK_FAIL_NODE("TaskGraph::addDispatch: invalid write buffer");
+            }
+            node.writes.push_back(buf->buffer_);
+        }
+        return addNode(node);
+    }
 
-            // Create descriptor set layouts (fill gaps with empty layouts)
-            setLayouts_.resize(setBindings.empty() ? 0 : setBindings.rbegin()->first + 1);
-            for (const auto &pair : setBindings) {
-                uint32_t setIndex = pair.first;
-                const auto &bindings = pair.second;
-                VkDescriptorSetLayoutCreateInfo dslCreateInfo{
-                    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-                    nullptr,
-                    0,
-                    static_cast<uint32_t>(bindings.size()),
-                    bindings.data()
-                };
-                VK_CHECK(vkCreateDescriptorSetLayout(device_->vk(), &dslCreateInfo, nullptr, &setLayouts_[setIndex]));
+    uint32_t TaskGraph::addCopy(Buffer &src, Buffer &dst, VkDeviceSize bytes, VkDeviceSize srcOffset,
+                                VkDeviceSize dstOffset) {
+        if (!isValid()) {
+            EVK_FAIL_NODE("TaskGraph is not valid");
+        }
+        if (src.device_ != device_ || dst.device_ != device_) {
+            EVK_FAIL_NODE("TaskGraph::addCopy: buffer belongs to a different device");
+        }
+        if (bytes == VK_WHOLE_SIZE) {
+            if (srcOffset >= src.size_ || dstOffset >= dst.size_) {
+                EVK_FAIL_NODE("TaskGraph::addCopy: offset beyond buffer size");
             }
-            for (VkDescriptorSetLayout &setLayout : setLayouts_) {
-                if (setLayout == VK_NULL_HANDLE) {
-                    // Create an empty (0-binding) layout for missing lower-index sets
-                    VkDescriptorSetLayoutCreateInfo emptyDsl{
-                        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-                        nullptr, 0, 0, nullptr
-                    };
-                    VK_CHECK(vkCreateDescriptorSetLayout(device_->vk(), &emptyDsl, nullptr, &setLayout));
+            bytes = std::min(src.size_ - srcOffset, dst.size_ - dstOffset);
+        }
+        if (!src.validateRange(srcOffset, bytes, "TaskGraph::addCopy source") ||
+            !dst.validateRange(dstOffset, bytes, "TaskGraph::addCopy destination")) {
+            EVK_FAIL_NODE("TaskGraph::addCopy: range outside the buffer");
+        }
+
+        Node node;
+        node.type = NodeType::Copy;
+        node.src = src.buffer_;
+        node.dst = dst.buffer_;
+        node.region = VkBufferCopy{srcOffset, dstOffset, bytes};
+        node.reads.push_back(src.buffer_);
+        node.writes.push_back(dst.buffer_);
+        return addNode(node);
+    }
+
+    uint32_t TaskGraph::addFill(Buffer &dst, uint32_t value, VkDeviceSize offset, VkDeviceSize size) {
+        if (!isValid()) {
+            EVK_FAIL_NODE("TaskGraph is not valid");
+        }
+        if (dst.device_ != device_) {
+            EVK_FAIL_NODE("TaskGraph::addFill: buffer belongs to a different device");
+        }
+        if (!dst.validateFill(offset, size, "TaskGraph::addFill")) {
+            EVK_FAIL_NODE("TaskGraph::addFill: invalid range");
+        }
+
+        Node node;
+        node.type = NodeType::Fill;
+        node.dst = dst.buffer_;
+        node.fillOffset = offset;
+        node.fillSize = size;
+        node.fillValue = value;
+        node.writes.push_back(dst.buffer_);
+        return addNode(node);
+    }
+
+    bool TaskGraph::dependsOn(uint32_t node, uint32_t before) {
+        if (!isValid()) {
+            EVK_FAIL("TaskGraph is not valid");
+        }
+        if (node >= nodes_.size() || before >= nodes_.size()) {
+            EVK_FAIL("TaskGraph::dependsOn: unknown node");
+        }
+        if (before >= node) {
+            EVK_FAIL("TaskGraph::dependsOn: a node can only depend on an earlier node");
+        }
+        nodes_[node].after.push_back(before);
+        compiled_ = false;
+        return true;
+    }
+
+    void TaskGraph::schedule() {
+        const size_t n = nodes_.size();
+
+        // 1. Buffer hazards in insertion order: readers wait for the last writer, writers
+        //    for the last writer and every reader since
+        struct Access {
+            uint32_t writer;
+            std::vector<uint32_t> readers;
+            Access() : writer(invalidNode) {}
+        };
+        std::map<VkBuffer, Access> access;
+        for (size_t i = 0; i < n; ++i) {
+            Node &node = nodes_[i];
+            std::vector<uint32_t> &deps = node.deps;
+            deps = node.after;
+            for (VkBuffer buf : node.reads) {
+                std::map<VkBuffer, Access>::const_iterator it = access.find(buf);
+                if (it != access.end() && it->second.writer != invalidNode) deps.push_back(it->second.writer);
+            }
+            for (VkBuffer buf : node.writes) {
+                const Access &a = access[buf];
+                if (a.writer != invalidNode) deps.push_back(a.writer);
+                deps.insert(deps.end(), a.readers.begin(), a.readers.end());
+            }
+            for (VkBuffer buf : node.writes) {
+                Access &a = access[buf];
+                a.writer = static_cast<uint32_t>(i);
+                a.readers.clear();
+            }
+            for (VkBuffer buf : node.reads) {
+                if (std::find(node.writes.begin(), node.writes.end(), buf) == node.writes.end()) {
+                    access[buf].readers.push_back(static_cast<uint32_t>(i));
                 }
             }
-            initState_ = INIT_SET_LAYOUTS;
+            std::sort(deps.begin(), deps.end());
+            deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+        }
+
+        // 2. Transitive reduction. Predecessors always have lower ids, so walking them from
+        //    the highest down sees every path through a later predecessor before the edge it
+        //    makes redundant. reach holds one bitset of (transitive) predecessors per node.
+        const size_t words = (n + 63) / 64;
+        std::vector<uint64_t> reach(n * words, 0);
+        std::vector<uint32_t> kept;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t *covered = &reach[i * words];
+            std::vector<uint32_t> &deps = nodes_[i].deps;
+            kept.clear();
+            for (size_t k = deps.size(); k-- > 0;) {
+                const uint32_t q = deps[k];
+                if ((covered[q / 64] >> (q % 64)) & 1) continue; // implied by a later predecessor
+                kept.push_back(q);
+                covered[q / 64] |= UINT64_C(1) << (q % 64);
+                const uint64_t *qReach = &reach[q * words];
+                for (size_t w = 0; w < words; ++w) covered[w] |= qReach[w];
+            }
+            deps.assign(kept.rbegin(), kept.rend());
+        }
+
+        // 3. Queues: continue on a predecessor's queue when it is that queue's latest node,
+        //    otherwise open another queue while any are left
+        const uint32_t maxChains = device_->timelineSemaphoresEnabled() ? device_->computeQueueCount() : 1u;
+        std::vector<uint32_t> tails;
+        std::vector<size_t> load;
+        for (size_t i = 0; i < n; ++i) {
+            Node &node = nodes_[i];
+            uint32_t chain = invalidNode;
+            for (uint32_t q : node.deps) {
+                if (tails[nodes_[q].chain] == q) {
+                    chain = nodes_[q].chain;
+                    break;
+                }
+            }
+            if (chain == invalidNode) {
+                if (tails.size() < maxChains) {
+                    chain = static_cast<uint32_t>(tails.size());
+                    tails.push_back(0);
+                    load.push_back(0);
+                } else if (!node.deps.empty()) {
+                    chain = nodes_[node.deps.back()].chain; // closest predecessor
+                } else {
+                    chain = static_cast<uint32_t>(std::min_element(load.begin(), load.end()) - load.begin());
+                }
+            }
+            node.chain = chain;
+            tails[chain] = static_cast<uint32_t>(i);
+            ++load[chain];
+        }
 
-            // Create pipeline layout
-            VkPushConstantRange pushRange{};
-            if (pcCfg_.sizeBytes > 0) {
-                pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-                pushRange.offset = pcCfg_.offset;
-                pushRange.size = pcCfg_.sizeBytes;
+        // 4. Segments: a node that waits on another queue starts one, a node another queue
+        //    waits on ends one. Waiting on a later segment of a queue implies its earlier ones.
+        std::vector<uint8_t> signaled(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            for (uint32_t q : nodes_[i].deps) {
+                if (nodes_[q].chain != nodes_[i].chain) signaled[q] = 1;
             }
+        }
 
-            VkPipelineLayoutCreateInfo layoutCreateInfo{
-                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-                nullptr,
-                0,
-                static_cast<uint32_t>(setLayouts_.size()),
-                setLayouts_.data(),
-                pcCfg_.sizeBytes > 0 ? 1u : 0u,
-                pcCfg_.sizeBytes > 0 ? &pushRange : nullptr
-            };
-            VK_CHECK(vkCreatePipelineLayout(device_->vk(), &layoutCreateInfo, nullptr, &layout_));
-            initState_ = INIT_PIPELINE_LAYOUT;
+        chains_.resize(tails.size());
+        for (size_t c = 0; c < chains_.size(); ++c) {
+            chains_[c].queueIndex = static_cast<uint32_t>(c);
+        }
+        std::vector<uint32_t> segmentOf(n, 0);
+        std::vector<uint8_t> open(chains_.size(), 0);
+        std::map<uint32_t, uint32_t> waits;
+        for (size_t i = 0; i < n; ++i) {
+            const Node &node = nodes_[i];
+            Chain &chain = chains_[node.chain];
 
-            // Create descriptor pool and sets
-            if (!info.bindings.entries.empty()) {
-                std::map<VkDescriptorType, uint32_t> typeCounts;
-                for (const auto &entry : info.bindings.entries) {
-                    typeCounts[entry.type] += static_cast<uint32_t>(entry.buffers.size());
-                }
+            waits.clear();
+            for (uint32_t q : node.deps) {
+                if (nodes_[q].chain == node.chain) continue;
+                uint32_t &segment = waits[nodes_[q].chain];
+                segment = std::max(segment, segmentOf[q]);
+            }
+            if (!open[node.chain] || !waits.empty()) {
+                chain.segments.push_back(Segment());
+                open[node.chain] = 1;
+            }
 
-                std::vector<VkDescriptorPoolSize> poolSizes;
-                poolSizes.reserve(typeCounts.size());
-                for (const auto &pair : typeCounts) {
-                    poolSizes.push_back({pair.first, pair.second});
-                }
+            Segment &segment = chain.segments.back();
+            for (const std::pair<const uint32_t, uint32_t> &w : waits) {
+                segment.waits.push_back(w);
+            }
+            segment.nodes.push_back(static_cast<uint32_t>(i));
+            segmentOf[i] = static_cast<uint32_t>(chain.segments.size() - 1);
+            if (signaled[i]) open[node.chain] = 0;
+        }
 
-                VkDescriptorPoolCreateInfo poolCreateInfo{
-                    VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        for (const Chain &chain : chains_) {
+            for (const Segment &segment : chain.segments) {
+                semaphoreWaitCount_ += static_cast<uint32_t>(segment.waits.size());
+            }
+        }
+    }
+
+    bool TaskGraph::record(bool addHostBarrier) {
+        const VkPipelineStageFlags allStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        auto stageOf = [this](uint32_t index) -> VkPipelineStageFlags {
+            return nodes_[index].type == NodeType::Dispatch ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                                            : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        };
+        auto writeAccess = [](VkPipelineStageFlags stages) -> VkAccessFlags {
+            VkAccessFlags access = 0;
+            if (stages & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) access |= VK_ACCESS_SHADER_WRITE_BIT;
+            if (stages & VK_PIPELINE_STAGE_TRANSFER_BIT) access |= VK_ACCESS_TRANSFER_WRITE_BIT;
+            return access;
+        };
+        // pending: recorded on this chain's queue and not yet made available to every stage;
+        // synced: destination stages a barrier after the node has already covered
+        std::vector<uint8_t> pending(nodes_.size(), 0);
+        std::vector<VkPipelineStageFlags> synced(nodes_.size(), 0);
+        std::vector<uint32_t> pendingNodes;
+
+        for (Chain &chain : chains_) {
+            VkPipelineStageFlags usedStages = 0;
+            // Nodes left pending by the previous chain ran on another queue: their results
+            // reach this chain through the semaphore wait, never through a barrier here
+            for (uint32_t q : pendingNodes) {
+                pending[q] = 0;
+                synced[q] = 0;
+            }
+            pendingNodes.clear();
+
+            for (size_t s = 0; s < chain.segments.size(); ++s) {
+                Segment &segment = chain.segments[s];
+                VkCommandBufferAllocateInfo allocInfo{
+                    VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
                     nullptr,
-                    0,
-                    static_cast<uint32_t>(setLayouts_.size()),
-                    static_cast<uint32_t>(poolSizes.size()),
-                    poolSizes.data()
+                    cmdPool_,
+                    VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                    1
                 };
-                VK_CHECK(vkCreateDescriptorPool(device_->vk(), &poolCreateInfo, nullptr, &dsp_));
-                initState_ = INIT_DESCRIPTOR_POOL;
+                VK_CHECK(vkAllocateCommandBuffers(device_->vk(), &allocInfo, &segment.cmdBuf));
+                ++device_->counters_->commandBuffersAllocated;
+
+                // Simultaneous use: the next execution may be queued before this one finishes
+                VkCommandBufferBeginInfo beginInfo{
+                    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                    nullptr,
+                    VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+                    nullptr
+                };
+                VkCommandBuffer cmdBuf = segment.cmdBuf;
+                VK_CHECK(vkBeginCommandBuffer(cmdBuf, &beginInfo));
+
+                if (vkCmdBeginDebugUtilsLabelEXT) {
+                    VkDebugUtilsLabelEXT label{VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
+                    label.pLabelName = "easyvk::TaskGraph";
+                    vkCmdBeginDebugUtilsLabelEXT(cmdBuf, &label);
+                }
+
+                for (uint32_t index : segment.nodes) {
+                    const Node &node = nodes_[index];
+                    const bool compute = node.type == NodeType::Dispatch;
+                    const VkPipelineStageFlags stage = stageOf(index);
+
+                    // Host writes before vkQueueSubmit are visible without a barrier, and
+                    // predecessors on other queues are covered by the semaphore wait. A
+                    // barrier only orders its destination stage, so a predecessor synced to
+                    // compute still needs one before a copy.
+                    bool needBarrier = false;
+                    for (uint32_t q : node.deps) {
+                        if (pending[q] && !(synced[q] & stage)) {
+                            needBarrier = true;
+                            break;
+                        }
+                    }
+                    if (needBarrier) {
+                        VkPipelineStageFlags srcStages = 0;
+                        for (uint32_t q : pendingNodes) {
+                            if (!(synced[q] & stage)) srcStages |= stageOf(q);
+                        }
+                        VkMemoryBarrier barrier{
+                            VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                            nullptr,
+                            writeAccess(srcStages),
+                            compute ? (VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+                                    : (VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT)
+                        };
+                        vkCmdPipelineBarrier(cmdBuf, srcStages, stage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+                        ++barrierCount_;
+                        // Every earlier command in srcStages is now ordered before stage;
+                        // drop nodes that are synced to all stages
+                        size_t kept = 0;
+                        for (size_t i = 0; i < pendingNodes.size(); ++i) {
+                            uint32_t q = pendingNodes[i];
+                            synced[q] |= stage;
+                            if (synced[q] == allStages) {
+                                pending[q] = 0;
+                                synced[q] = 0;
+                            } else {
+                                pendingNodes[kept++] = q;
+                            }
+                        }
+                        pendingNodes.resize(kept);
+                    }
+
+                    if (vkCmdBeginDebugUtilsLabelEXT) {
+                        VkDebugUtilsLabelEXT label{VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
+                        label.pLabelName = node.type == NodeType::Dispatch ? node.program->label_.c_str()
+                                         : node.type == NodeType::Copy ? "copy" : "fill";
+                        vkCmdBeginDebugUtilsLabelEXT(cmdBuf, &label);
+                    }
+                    switch (node.type) {
+                    case NodeType::Dispatch:
+                        node.program->recordBind(cmdBuf);
+                        vkCmdDispatch(cmdBuf, node.program->groupsX_, node.program->groupsY_, node.program->groupsZ_);
+                        break;
+                    case NodeType::Copy:
+                        vkCmdCopyBuffer(cmdBuf, node.src, node.dst, 1, &node.region);
+                        break;
+                    case NodeType::Fill:
+                        vkCmdFillBuffer(cmdBuf, node.dst, node.fillOffset, node.fillSize, node.fillValue);
+                        break;
+                    }
+                    if (vkCmdEndDebugUtilsLabelEXT) {
+                        vkCmdEndDebugUtilsLabelEXT(cmdBuf);
+                    }
 
-                descriptorSets_.resize(setLayouts_.size());
-                VkDescriptorSetAllocateInfo allocInfo{
-                    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-                    nullptr,
-                    dsp_,
-                    static_cast<uint32_t>(setLayouts_.size()),
-                    setLayouts_.data()
-                };
-                VK_CHECK(vkAllocateDescriptorSets(device_->vk(), &allocInfo, descriptorSets_.data()));
+                    pending[index] = 1;
+                    pendingNodes.push_back(index);
+                    usedStages |= stage;
+                }
 
-                // Update descriptor sets
-                std::vector<VkWriteDescriptorSet> writes;
-                writes.reserve(info.bindings.entries.size());
-                for (const auto &entry : info.bindings.entries) {
-                    writes.push_back(VkWriteDescriptorSet{
-                        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                        nullptr,
-                        descriptorSets_[entry.set],
-                        entry.binding,
-                        0,
-                        static_cast<uint32_t>(entry.buffers.size()),
-                        entry.type,
+                if (addHostBarrier && s + 1 == chain.segments.size()) {
+                    VkMemoryBarrier barrier{
+                        VK_STRUCTURE_TYPE_MEMORY_BARRIER,
                         nullptr,
-                        entry.buffers.data(),
-                        nullptr
-                    });
+                        writeAccess(usedStages),
+                        VK_ACCESS_HOST_READ_BIT
+                    };
+                    vkCmdPipelineBarrier(cmdBuf, usedStages, VK_PIPELINE_STAGE_HOST_BIT,
+                                         0, 1, &barrier, 0, nullptr, 0, nullptr);
                 }
-                vkUpdateDescriptorSets(device_->vk(),
-                                       static_cast<uint32_t>(writes.size()), writes.data(),
-                                       0, nullptr);
-            }
-
-            // Create specialization constants for workgroup size
-            std::vector<VkSpecializationMapEntry> specEntries = {
-                {0, 0 * sizeof(uint32_t), sizeof(uint32_t)},
-                {1, 1 * sizeof(uint32_t), sizeof(uint32_t)},
-                {2, 2 * sizeof(uint32_t), sizeof(uint32_t)}
-            };
-            std::vector<uint32_t> specData = {localX_, localY_, localZ_};
 
-            // Add local memory specialization constants
-            for (const auto &mem : info.localMemory) {
-                specEntries.push_back({3 + mem.first, static_cast<uint32_t>((3 + mem.first) * sizeof(uint32_t)), sizeof(uint32_t)});
-                if (specData.size() <= 3 + mem.first) {
-                    specData.resize(3 + mem.first + 1, 0);
+                if (vkCmdEndDebugUtilsLabelEXT) {
+                    vkCmdEndDebugUtilsLabelEXT(cmdBuf);
                 }
-                specData[3 + mem.first] = mem.second;
+                VK_CHECK(vkEndCommandBuffer(cmdBuf));
             }
+        }
+        return true;
+    }
 
-            VkSpecializationInfo specInfo{
-                static_cast<uint32_t>(specEntries.size()),
-                specEntries.data(),
-                specData.size() * sizeof(uint32_t),
-                specData.data()
-            };
+    bool TaskGraph::compile(bool addHostBarrier) {
+        if (!isValid()) {
+            EVK_FAIL("TaskGraph is not valid");
+        }
+        if (nodes_.empty()) {
+            EVK_FAIL("TaskGraph is empty");
+        }
 
-            // Create compute pipeline
-            VkPipelineShaderStageCreateInfo stageInfo{
-                VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-                nullptr,
-                0,
-                VK_SHADER_STAGE_COMPUTE_BIT,
-                shader_,
-                (info.entryPointName && info.entryPointName[0]) ? info.entryPointName : "main",
-                &specInfo
-            };
+        releaseCompiled();
+        schedule();
 
-            VkComputePipelineCreateInfo pipelineInfo{
-                VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        if (device_->timelineSemaphoresEnabled()) {
+            VkSemaphoreTypeCreateInfo typeInfo{
+                VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
                 nullptr,
-                0,
-                stageInfo,
-                layout_,
-                VK_NULL_HANDLE,
+                VK_SEMAPHORE_TYPE_TIMELINE,
                 0
             };
-            VK_CHECK(vkCreateComputePipelines(device_->vk(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline_));
-            initState_ = INIT_PIPELINE;
+            VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &typeInfo, 0};
+            for (Chain &chain : chains_) {
+                VK_CHECK(vkCreateSemaphore(device_->vk(), &semaphoreInfo, nullptr, &chain.timeline));
+            }
+        } else if (fence_ == VK_NULL_HANDLE) {
+            VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
+            VK_CHECK(vkCreateFence(device_->vk(), &fenceInfo, nullptr, &fence_));
+            ++device_->counters_->fencesCreated;
+        }
 
-            // Create command resources
-            VkCommandPoolCreateInfo poolInfo{
-                VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-                nullptr,
-                VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-                device_->computeQueueFamilyIndex()
-            };
-            VK_CHECK(vkCreateCommandPool(device_->vk(), &poolInfo, nullptr, &cmdPool_));
-            initState_ = INIT_COMMAND_POOL;
+        if (!record(addHostBarrier)) {
+            return false; // partial state is released by the next compile()/reset()
+        }
+        compiled_ = true;
+        return true;
+    }
 
-            VkCommandBufferAllocateInfo allocInfo{
-                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+    uint64_t TaskGraph::valuesPerExecution(uint32_t chain) const {
+        // Chain 0 also signals the join of all queues when there are several
+        return chains_[chain].segments.size() + (chain == 0 && chains_.size() > 1 ? 1 : 0);
+    }
+
+    SubmitHandle TaskGraph::execute(const SubmitHandle &dependency) {
+        if (!isValid()) {
+            EVK_FAIL("TaskGraph is not valid");
+        }
+        if (!compiled_) {
+            EVK_FAIL("TaskGraph is not compiled (or changed since compile)");
+        }
+
+        const bool gpuWait = dependency.isTimeline();
+        if (gpuWait && dependency.semaphore == device_->computeTimeline_) {
+            // A queued (coalesced) submission would leave our queues waiting forever
+            device_->flushThrough(dependency.value);
+        }
+        if (!gpuWait && dependency.fence != VK_NULL_HANDLE) {
+            EVK_CHECK(device_->waitFenceDependency(dependency), "Waiting for a fence dependency failed");
+        }
+
+        if (fence_ != VK_NULL_HANDLE) {
+            // Fence mode: a single queue with a single command buffer
+            if (fenceInFlight_) {
+                WaitScope scope(device_->counters_.get(), device_->tracer());
+                VK_CHECK(vkWaitForFences(device_->vk(), 1, &fence_, VK_TRUE, UINT64_MAX));
+                fenceInFlight_ = false;
+            }
+            device_->retireFence(fence_);
+            VK_CHECK(vkResetFences(device_->vk(), 1, &fence_));
+
+            const Chain &chain = chains_[0];
+            VkSubmitInfo submitInfo{
+                VK_STRUCTURE_TYPE_SUBMIT_INFO,
                 nullptr,
-                cmdPool_,
-                VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-                1
+                0, nullptr, nullptr,
+                1, &chain.segments[0].cmdBuf,
+                0, nullptr
             };
-            VK_CHECK(vkAllocateCommandBuffers(device_->vk(), &allocInfo, &cmdBuf_));
-            initState_ = INIT_COMMAND_BUFFER;
-
-            VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
-            VK_CHECK(vkCreateFence(device_->vk(), &fenceInfo, nullptr, &fence_));
-            initState_ = INIT_FENCE;
+            VkResult result;
+            {
+                std::lock_guard<std::mutex> lock(*device_->queueLocks_[chain.queueIndex]);
+                ++device_->counters_->queueSubmits;
+                result = vkQueueSubmit(device_->computeQueues_[chain.queueIndex], 1, &submitInfo, fence_);
+            }
+            EVK_CHECK(result, "vkQueueSubmit (task graph) failed");
+            fenceInFlight_ = true;
+            SubmitHandle handle(fence_);
+            handle.value = device_->claimFence(fence_);
+            handle.device = device_;
+            return handle;
+        }
+
+        // Timeline mode. Each chain's first segment waits for the previous execution (its
+        // join value on chain 0) and for the external dependency; segment s of chain c
+        // signals base + s + 1; the join waits for the last value of every other chain.
+        size_t total = 1;
+        for (const Chain &chain : chains_) total += chain.segments.size();
+
+        std::vector<std::vector<VkSemaphore>> waitSemaphores(total);
+        std::vector<std::vector<uint64_t>> waitValues(total);
+        std::vector<std::vector<VkPipelineStageFlags>> waitStages(total);
+        std::vector<uint64_t> signalValues(total);
+        std::vector<VkTimelineSemaphoreSubmitInfo> timelineInfos(total);
+        std::vector<VkSubmitInfo> submitInfos(total);
+        std::vector<size_t> firstSubmit(chains_.size() + 1, 0);
+
+        size_t k = 0;
+        for (size_t c = 0; c < chains_.size(); ++c) {
+            const Chain &chain = chains_[c];
+            firstSubmit[c] = k;
+
+            const size_t segmentCount = chain.segments.size();
+            const bool join = c == 0 && chains_.size() > 1;
+            for (size_t s = 0; s < segmentCount + (join ? 1 : 0); ++s, ++k) {
+                std::vector<VkSemaphore> &semaphores = waitSemaphores[k];
+                std::vector<uint64_t> &values = waitValues[k];
+                if (s == segmentCount) {
+                    for (size_t d = 1; d < chains_.size(); ++d) {
+                        semaphores.push_back(chains_[d].timeline);
+                        values.push_back(chains_[d].base + chains_[d].segments.size());
+                    }
+                } else {
+                    if (s == 0 && lastValue_ != 0) {
+                        semaphores.push_back(chains_[0].timeline);
+                        values.push_back(lastValue_);
+                    }
+                    if (s == 0 && gpuWait) {
+                        semaphores.push_back(dependency.semaphore);
+                        values.push_back(dependency.value);
+                    }
+                    for (const std::pair<uint32_t, uint32_t> &w : chain.segments[s].waits) {
+                        semaphores.push_back(chains_[w.first].timeline);
+                        values.push_back(chains_[w.first].base + w.second + 1);
+                    }
+                }
+                waitStages[k].assign(semaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+                signalValues[k] = chain.base + s + 1;
 
-            // Create timestamp query pool if supported
-            if (device_->supportsTimestamps()) {
-                VkQueryPoolCreateInfo queryPoolInfo{
-                    VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                const uint32_t waitCount = static_cast<uint32_t>(semaphores.size());
+                timelineInfos[k] = VkTimelineSemaphoreSubmitInfo{
+                    VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
                     nullptr,
-                    0,
-                    VK_QUERY_TYPE_TIMESTAMP,
-                    2,
-                    0
+                    waitCount, waitCount ? values.data() : nullptr,
+                    1, &signalValues[k]
+                };
+                submitInfos[k] = VkSubmitInfo{
+                    VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                    &timelineInfos[k],
+                    waitCount,
+                    waitCount ? semaphores.data() : nullptr,
+                    waitCount ? waitStages[k].data() : nullptr,
+                    s < segmentCount ? 1u : 0u,
+                    s < segmentCount ? &chain.segments[s].cmdBuf : nullptr,
+                    1, &chain.timeline
                 };
-                VK_CHECK(vkCreateQueryPool(device_->vk(), &queryPoolInfo, nullptr, &timestampQueryPool_));
-                initState_ = INIT_QUERY_POOL;
             }
+        }
+        firstSubmit[chains_.size()] = k;
 
-            initState_ = INIT_COMPLETE;
-            initialized_ = true;
-        } catch (...) {
-            teardownFrom(initState_);
-            throw;
+        // Waits may precede their signal operation across queues (allowed for timelines)
+        for (size_t c = 0; c < chains_.size(); ++c) {
+            const uint32_t queueIndex = chains_[c].queueIndex;
+            VkResult result;
+            {
+                std::lock_guard<std::mutex> lock(*device_->queueLocks_[queueIndex]);
+                ++device_->counters_->queueSubmits;
+                result = vkQueueSubmit(device_->computeQueues_[queueIndex],
+                                       static_cast<uint32_t>(firstSubmit[c + 1] - firstSubmit[c]),
+                                       &submitInfos[firstSubmit[c]], VK_NULL_HANDLE);
+            }
+            EVK_CHECK(result, "vkQueueSubmit (task graph) failed");
         }
-    }
 
-    ComputeProgram::ComputeProgram(ComputeProgram &&other) noexcept
-        : device_(other.device_),
-          setLayouts_(std::move(other.setLayouts_)),
-          layout_(other.layout_),
-          pipeline_(other.pipeline_),
-          dsp_(other.dsp_),
-          descriptorSets_(std::move(other.descriptorSets_)),
-          shader_(other.shader_),
-          cmdPool_(other.cmdPool_),
-          cmdBuf_(other.cmdBuf_),
-          fence_(other.fence_),
-          timestampQueryPool_(other.timestampQueryPool_),
-          pcCapacityBytes_(other.pcCapacityBytes_),
-          pcCfg_(other.pcCfg_),
-          groupsX_(other.groupsX_),
-          groupsY_(other.groupsY_),
-          groupsZ_(other.groupsZ_),
-          localX_(other.localX_),
-          localY_(other.localY_),
-          localZ_(other.localZ_),
-          pcData_(std::move(other.pcData_)),
-          initialized_(other.initialized_),
-          tornDown_(other.tornDown_),
-          timestampInFlight_(other.timestampInFlight_),
-          initState_(other.initState_),
-          lastTimestamps_() {
-        lastTimestamps_[0] = other.lastTimestamps_[0];
-        lastTimestamps_[1] = other.lastTimestamps_[1];
+        for (size_t c = 0; c < chains_.size(); ++c) {
+            chains_[c].base += valuesPerExecution(static_cast<uint32_t>(c));
+        }
+        lastValue_ = chains_[0].base;
 
-        other.layout_ = VK_NULL_HANDLE;
-        other.pipeline_ = VK_NULL_HANDLE;
-        other.dsp_ = VK_NULL_HANDLE;
-        other.shader_ = VK_NULL_HANDLE;
-        other.cmdPool_ = VK_NULL_HANDLE;
-        other.cmdBuf_ = VK_NULL_HANDLE;
-        other.fence_ = VK_NULL_HANDLE;
-        other.timestampQueryPool_ = VK_NULL_HANDLE;
-        other.initialized_ = false;
-        other.tornDown_ = true;
-        other.timestampInFlight_ = false;
-        other.initState_ = INIT_NONE;
+        SubmitHandle handle;
+        handle.semaphore = chains_[0].timeline;
+        handle.value = lastValue_;
+        handle.device = device_;
+        return handle;
     }
 
-    ComputeProgram &ComputeProgram::operator=(ComputeProgram &&other) noexcept {
-        if (this != &other) {
-            teardown();
+    bool TaskGraph::run() {
+        SubmitHandle handle = execute();
+        if (!handle.isValid()) return false;
+        return wait(handle);
+    }
 
-            device_ = other.device_;
-            setLayouts_ = std::move(other.setLayouts_);
-            layout_ = other.layout_;
-            pipeline_ = other.pipeline_;
-            dsp_ = other.dsp_;
-            descriptorSets_ = std::move(other.descriptorSets_);
-            shader_ = other.shader_;
-            cmdPool_ = other.cmdPool_;
-            cmdBuf_ = other.cmdBuf_;
-            fence_ = other.fence_;
-            timestampQueryPool_ = other.timestampQueryPool_;
-            pcCapacityBytes_ = other.pcCapacityBytes_;
-            pcCfg_ = other.pcCfg_;
-            groupsX_ = other.groupsX_;
-            groupsY_ = other.groupsY_;
-            groupsZ_ = other.groupsZ_;
-            localX_ = other.localX_;
-            localY_ = other.localY_;
-            localZ_ = other.localZ_;
-            pcData_ = std::move(other.pcData_);
-            initialized_ = other.initialized_;
-            tornDown_ = other.tornDown_;
-            timestampInFlight_ = other.timestampInFlight_;
-            initState_ = other.initState_;
-            lastTimestamps_[0] = other.lastTimestamps_[0];
-            lastTimestamps_[1] = other.lastTimestamps_[1];
+    bool TaskGraph::wait(const SubmitHandle &h, uint64_t timeoutNs) {
+        if (!h.isValid() || !isValid()) return false;
 
-            other.layout_ = VK_NULL_HANDLE;
-            other.pipeline_ = VK_NULL_HANDLE;
-            other.dsp_ = VK_NULL_HANDLE;
-            other.shader_ = VK_NULL_HANDLE;
-            other.cmdPool_ = VK_NULL_HANDLE;
-            other.cmdBuf_ = VK_NULL_HANDLE;
-            other.fence_ = VK_NULL_HANDLE;
-            other.timestampQueryPool_ = VK_NULL_HANDLE;
-            other.initialized_ = false;
-            other.tornDown_ = true;
-            other.timestampInFlight_ = false;
-            other.initState_ = INIT_NONE;
+        if (h.isTimeline()) {
+            VkSemaphoreWaitInfo waitInfo{
+                VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                nullptr,
+                0,
+                1, &h.semaphore, &h.value
+            };
+            WaitScope scope(device_->counters_.get(), device_->tracer(), timeoutNs);
+            return device_->waitSemaphores_(device_->vk(), &waitInfo, timeoutNs) == VK_SUCCESS;
         }
-        return *this;
+
+        {
+            WaitScope scope(device_->counters_.get(), device_->tracer(), timeoutNs);
+            if (vkWaitForFences(device_->vk(), 1, &h.fence, VK_TRUE, timeoutNs) != VK_SUCCESS) return false;
+        }
+        if (h.fence == fence_) fenceInFlight_ = false;
+        return true;
     }
 
-    ComputeProgram::~ComputeProgram() noexcept {
-        if (!tornDown_) {
-            teardown();
+    bool TaskGraph::synchronize() {
+        if (!isValid()) return false;
+
+        if (fence_ != VK_NULL_HANDLE && fenceInFlight_) {
+            return wait(SubmitHandle(fence_));
+        }
+        if (lastValue_ != 0 && !chains_.empty()) {
+            SubmitHandle handle;
+            handle.semaphore = chains_[0].timeline;
+            handle.value = lastValue_;
+            return wait(handle);
         }
+        return true;
     }
 
-    bool ComputeProgram::setPushConstantConfig(const PushConstantConfig &config) {
-        std::string error;
-        if (!config.validate(device_->limits().maxPushConstantsSize, error)) {
-            EVK_FAIL(error);
+    void TaskGraph::releaseCompiled() {
+        // Command buffers and semaphores may still be referenced by a running execution
+        if (!synchronize()) {
+            for (const Chain &chain : chains_) {
+                std::lock_guard<std::mutex> lock(*device_->queueLocks_[chain.queueIndex]);
+                vkQueueWaitIdle(device_->computeQueues_[chain.queueIndex]);
+            }
         }
+        fenceInFlight_ = false;
 
-        pcCfg_ = config;
-        if (pcCfg_.sizeBytes > 0) {
-            pcData_.assign(pcCfg_.sizeBytes, 0);
+        for (Chain &chain : chains_) {
+            for (Segment &segment : chain.segments) {
+                if (segment.cmdBuf != VK_NULL_HANDLE) {
+                    vkFreeCommandBuffers(device_->vk(), cmdPool_, 1, &segment.cmdBuf);
+                }
+            }
+            if (chain.timeline != VK_NULL_HANDLE) {
+                vkDestroySemaphore(device_->vk(), chain.timeline, nullptr);
+            }
         }
-        return true;
+        chains_.clear();
+        lastValue_ = 0;
+        compiled_ = false;
+        barrierCount_ = 0;
+        semaphoreWaitCount_ = 0;
     }
 
-    bool ComputeProgram::setPushConstants(const void *data, uint32_t bytes, uint32_t offset) {
-        if (!data && bytes > 0) {
-            EVK_FAIL("Push constant data cannot be null when bytes > 0");
+    void TaskGraph::reset() {
+        if (!isValid()) return;
+        releaseCompiled();
+        nodes_.clear();
+    }
+
+    void TaskGraph::teardown() {
+        if (tornDown_) return;
+
+        if (device_ && device_->vk() != VK_NULL_HANDLE && cmdPool_ != VK_NULL_HANDLE) {
+            releaseCompiled();
+            if (fence_ != VK_NULL_HANDLE) {
+                device_->retireFence(fence_);
+                vkDestroyFence(device_->vk(), fence_, nullptr);
+            }
+            vkDestroyCommandPool(device_->vk(), cmdPool_, nullptr);
         }
+        nodes_.clear();
+        chains_.clear();
+        fence_ = VK_NULL_HANDLE;
+        cmdPool_ = VK_NULL_HANDLE;
+        tornDown_ = true;
+    }
 
-        if (pcData_.size() < pcCfg_.sizeBytes) pcData_.assign(pcCfg_.sizeBytes, 0);
-        if (!data || bytes == 0) return true;
+#undef EVK_FAIL_NODE
 
-        if (offset > pcCfg_.sizeBytes || bytes > pcCfg_.sizeBytes - offset) {
-            EVK_FAIL("Push constant range exceeds configured size");
+    // -------- CompletionQueue implementation ------------------------------------
+    class CompletionWorker {
+    public:
+        explicit CompletionWorker(Device &dev)
+            : device_(&dev),
+              active_(0),
+              stop_(false),
+              thread_([this]() { run(); }) {}
+
+        ~CompletionWorker() {
+            {
+                std::lock_guard<std::mutex> lock(lock_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            thread_.join();
         }
 
-        std::memcpy(pcData_.data() + offset, data, bytes);
-        return true;
+        void add(const SubmitHandle &h, std::function<void(bool)> callback) {
+            {
+                std::lock_guard<std::mutex> lock(lock_);
+                incoming_.push_back(Entry{h, std::move(callback)});
+            }
+            wake_.notify_all();
+        }
+
+        size_t pending() const {
+            std::lock_guard<std::mutex> lock(lock_);
+            return incoming_.size() + active_;
+        }
+
+        void drain() {
+            std::unique_lock<std::mutex> lock(lock_);
+            idle_.wait(lock, [this]() { return incoming_.empty() && active_ == 0; });
+        }
+
+    private:
+        struct Entry {
+            SubmitHandle handle;
+            std::function<void(bool)> callback;
+        };
+
+        // Bound on one driver wait, so handles tracked meanwhile join within this latency
+        static const uint64_t kSliceNs = 1000000;
+
+        Device *device_;
+        mutable std::mutex lock_;
+        std::condition_variable wake_; // new entries or stop_
+        std::condition_variable idle_; // nothing tracked
+        std::vector<Entry> incoming_;  // guarded by lock_
+        size_t active_;                // entries owned by the thread, guarded by lock_
+        bool stop_;                    // guarded by lock_
+        std::thread thread_;           // last: started once the members above exist
+
+        void run();
+    };
+
+    void CompletionWorker::run() {
+        std::vector<Entry> watching;
+        std::vector<SubmitHandle> handles;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(lock_);
+                active_ = watching.size();
+                if (watching.empty() && incoming_.empty()) {
+                    idle_.notify_all();
+                    // Only exits idle, so destruction completes every tracked submission
+                    wake_.wait(lock, [this]() { return stop_ || !incoming_.empty(); });
+                    if (incoming_.empty()) return;
+                }
+                for (Entry &entry : incoming_) watching.push_back(std::move(entry));
+                incoming_.clear();
+                active_ = watching.size();
+            }
+
+            handles.clear();
+            for (const Entry &entry : watching) handles.push_back(entry.handle);
+            const VkResult result = device_->waitHandles(handles, true, kSliceNs);
+            // Device loss: nothing will complete any more, fail everything tracked
+            const bool lost = result != VK_SUCCESS && result != VK_TIMEOUT;
+
+            // One wait can cover many completions (timeline values retire in order)
+            size_t kept = 0;
+            for (size_t i = 0; i < watching.size(); ++i) {
+                Entry &entry = watching[i];
+                if (!lost && !device_->isComplete(entry.handle)) {
+                    if (kept != i) watching[kept] = std::move(entry);
+                    ++kept;
+                    continue;
+                }
+                bool ok = !lost;
+                if (entry.handle.context != nullptr) ok = device_->wait(entry.handle, 0) && ok;
+                if (entry.callback) entry.callback(ok);
+            }
+            watching.erase(watching.begin() + kept, watching.end());
+        }
     }
 
-    bool ComputeProgram::setWorkgroups(uint32_t x, uint32_t y, uint32_t z) {
-        if (x == 0 || y == 0 || z == 0) {
-            EVK_FAIL("Workgroup counts must be greater than zero");
+    CompletionQueue::CompletionQueue(Device &dev)
+        : device_(&dev), childRef_(dev) {
+        if (!dev.isValid()) {
+            EVK_FAIL_VOID("Device is not valid");
         }
+        worker_.reset(new CompletionWorker(dev));
+    }
 
-        // Check against device limits
-        const auto &lim = device_->limits();
-        if (x > lim.maxComputeWorkGroupCount[0] ||
-            y > lim.maxComputeWorkGroupCount[1] ||
-            z > lim.maxComputeWorkGroupCount[2]) {
-            EVK_FAIL("Workgroup count exceeds device limits");
+    CompletionQueue::CompletionQueue(CompletionQueue &&other) noexcept
+        : device_(other.device_),
+          childRef_(std::move(other.childRef_)),
+          worker_(std::move(other.worker_)) {
+        other.device_ = nullptr;
+    }
+
+    CompletionQueue &CompletionQueue::operator=(CompletionQueue &&other) noexcept {
+        if (this != &other) {
+            // The old worker finishes its submissions before it is replaced
+            worker_ = std::move(other.worker_);
+            device_ = other.device_;
+            childRef_ = std::move(other.childRef_);
+
+            other.device_ = nullptr;
         }
+        return *this;
+    }
+
+    CompletionQueue::~CompletionQueue() noexcept {}
 
-        groupsX_ = x;
-        groupsY_ = y;
-        groupsZ_ = z;
+    bool CompletionQueue::onComplete(const SubmitHandle &h, std::function<void(bool)> callback) {
+        if (!isValid()) {
+            EVK_FAIL("CompletionQueue is not valid");
+        }
+        if (!h.isValid()) {
+            EVK_FAIL("CompletionQueue::onComplete: invalid submit handle");
+        }
+        if (h.device != nullptr && h.device != device_) {
+            EVK_FAIL("CompletionQueue::onComplete: handle was issued by another device");
+        }
+        worker_->add(h, std::move(callback));
         return true;
     }
 
-    bool ComputeProgram::dispatch() {
-        return submitAndWait(true);
+    std::future<bool> CompletionQueue::track(const SubmitHandle &h) {
+        // std::function needs a copyable callable; the promise is shared with the callback
+        std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+        std::future<bool> future = promise->get_future();
+        if (!onComplete(h, [promise](bool ok) { promise->set_value(ok); })) return std::future<bool>();
+        return future;
     }
 
-    bool ComputeProgram::dispatchNoHostBarrier() {
-        return submitAndWait(false);
+    size_t CompletionQueue::pending() const {
+        return worker_ ? worker_->pending() : 0;
     }
 
-    bool ComputeProgram::supportsTimestamps() const {
-        return device_ && device_->supportsTimestamps() && (timestampQueryPool_ != VK_NULL_HANDLE);
+    bool CompletionQueue::drain() {
+        if (!isValid()) {
+            EVK_FAIL("CompletionQueue is not valid");
+        }
+        worker_->drain();
+        return true;
     }
 
-    double ComputeProgram::dispatchWithTimingNs() {
-        if (!supportsTimestamps()) {
-            dispatch();
-            return 0.0;
+    // -------- DeviceGroup implementation ----------------------------------------
+    DeviceGroup::DeviceGroup(Instance &inst, const DeviceGroupCreateInfo &info) {
+        const std::vector<VkPhysicalDevice> physical = inst.physicalDevices();
+        if (physical.empty()) {
+            EVK_FAIL_VOID("No physical devices available");
         }
 
-        if (!initialized_) {
-            EVK_FAIL("Program not initialized");
+        std::vector<int> indices = info.physicalIndices;
+        if (indices.empty()) {
+            VkPhysicalDevice best = selectBestDevice(physical);
+            if (best == VK_NULL_HANDLE || findComputeQueueFamily(best) == UINT32_MAX) {
+                EVK_FAIL_VOID("No physical device with a compute queue");
+            }
+            VkPhysicalDeviceProperties bestProps;
+            vkGetPhysicalDeviceProperties(best, &bestProps);
+            for (size_t i = 0; i < physical.size(); ++i) {
+                if (findComputeQueueFamily(physical[i]) == UINT32_MAX) continue;
+                VkPhysicalDeviceProperties props;
+                vkGetPhysicalDeviceProperties(physical[i], &props);
+                if (props.deviceType == bestProps.deviceType) {
+                    indices.push_back(static_cast<int>(i));
+                }
+            }
         }
 
-        SubmitHandle handle = submitAsync(true, true);
-        if (!device_->wait(handle)) {
-            EVK_FAIL("Failed to wait for dispatch completion");
+        for (size_t i = 0; i < indices.size(); ++i) {
+            const int index = indices[i];
+            // selectBestDevice silently falls back for unusable indices; a group must not
+            if (index < 0 || index >= static_cast<int>(physical.size()) ||
+                findComputeQueueFamily(physical[index]) == UINT32_MAX) {
+                devices_.clear();
+                EVK_FAIL_VOID("DeviceGroup: physical device " + std::to_string(index) + " has no compute queue");
+            }
+            if (std::find(indices.begin(), indices.begin() + i, index) != indices.begin() + i) {
+                devices_.clear();
+                EVK_FAIL_VOID("DeviceGroup: physical device " + std::to_string(index) + " listed twice");
+            }
+
+            DeviceCreateInfo deviceInfo = info.device;
+            deviceInfo.preferredIndex = index;
+            std::unique_ptr<Device> dev(new Device(inst, deviceInfo));
+            if (!dev->isValid()) {
+                devices_.clear();
+                EVK_FAIL_VOID("DeviceGroup: failed to open physical device " + std::to_string(index));
+            }
+            devices_.push_back(std::move(dev));
         }
+    }
 
-        // Get timestamp results
-        uint64_t timestamps[2];
-        VkResult result = vkGetQueryPoolResults(device_->vk(), timestampQueryPool_, 0, 2,
-            sizeof(timestamps), timestamps, sizeof(uint64_t),
-            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    DeviceGroup::DeviceGroup(DeviceGroup &&other) noexcept
+        : devices_(std::move(other.devices_)) {}
 
-        if (result != VK_SUCCESS) {
-            return 0.0;
+    DeviceGroup &DeviceGroup::operator=(DeviceGroup &&other) noexcept {
+        if (this != &other) {
+            devices_ = std::move(other.devices_);
         }
+        return *this;
+    }
 
-        return static_cast<double>(timestamps[1] - timestamps[0]) * device_->timestampPeriod();
+    DeviceGroup::~DeviceGroup() noexcept {
     }
 
-    SubmitHandle ComputeProgram::dispatchWithTimingAsync() {
-        if (!supportsTimestamps()) {
-            return submitAsync(true, false);
+    bool DeviceGroup::hostImportSupported() const {
+        if (devices_.empty()) return false;
+        for (const std::unique_ptr<Device> &dev : devices_) {
+            if (!dev->externalMemoryHostEnabled()) return false;
         }
+        return true;
+    }
 
-        timestampInFlight_ = true;
-        return submitAsync(true, true);
+    VkDeviceSize DeviceGroup::hostImportAlignment() const {
+        VkDeviceSize alignment = 1;
+        for (const std::unique_ptr<Device> &dev : devices_) {
+            alignment = std::max(alignment, dev->minImportedHostPointerAlignment());
+        }
+        return alignment;
     }
 
-    bool ComputeProgram::tryGetTimingNs(double& outNs) {
-        if (!supportsTimestamps() || !timestampInFlight_) {
-            return false;
+    std::vector<Buffer> DeviceGroup::importHostMemory(void *hostPointer, VkDeviceSize sizeBytes, BufferUsage usage) {
+        std::vector<Buffer> buffers;
+        std::string error;
+        const VkDeviceSize alignment = hostImportAlignment();
+        if (!hostImportSupported()) {
+            error = "DeviceGroup::importHostMemory: VK_EXT_external_memory_host is not enabled on every member";
+        } else if (!hostPointer || sizeBytes == 0 ||
+                   reinterpret_cast<uintptr_t>(hostPointer) % alignment != 0 || sizeBytes % alignment != 0) {
+            error = "DeviceGroup::importHostMemory: pointer and size must be non-zero multiples of "
+                    "hostImportAlignment()";
+        }
+        if (!error.empty()) {
+#ifdef EASYVK_NO_EXCEPTIONS
+            lastError_ = error;
+            return buffers;
+#else
+            throw std::invalid_argument(error);
+#endif
         }
 
-        struct QueryPair { uint64_t value; uint64_t available; };
-        QueryPair q[2] = {};
-        VkResult result = vkGetQueryPoolResults(device_->vk(), timestampQueryPool_, 0, 2,
-            sizeof(q), q, sizeof(QueryPair),
-            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        BufferCreateInfo bufferInfo(sizeBytes, usage, HostAccess::ReadWrite);
+        bufferInfo.hostPointer = hostPointer;
+        buffers.reserve(devices_.size());
+        for (const std::unique_ptr<Device> &dev : devices_) {
+            buffers.emplace_back(*dev, bufferInfo);
+            if (!buffers.back().isValid()) {
+#ifdef EASYVK_NO_EXCEPTIONS
+                lastError_ = "DeviceGroup::importHostMemory: " + buffers.back().lastError();
+                buffers.clear();
+                return buffers;
+#endif
+            }
+        }
+        return buffers;
+    }
 
-        if (result == VK_NOT_READY) {
-            return false;
+    // -------- MultiDeviceProgram implementation ---------------------------------
+    MultiDeviceProgram::MultiDeviceProgram(DeviceGroup &group, const ComputeProgramCreateInfo &info,
+                                           uint32_t groupOffsetPushOffset,
+                                           const std::function<void(uint32_t, ComputeProgramCreateInfo &)> &perDevice)
+        : groupOffsetPushOffset_(groupOffsetPushOffset) {
+        if (!group.isValid()) {
+            EVK_FAIL_VOID("Device group is not valid");
+        }
+        if (groupOffsetPushOffset % 4 != 0 ||
+            static_cast<uint64_t>(groupOffsetPushOffset) + 4 > info.pushConstantBytes) {
+            EVK_FAIL_VOID("MultiDeviceProgram: the group offset must be a 4-byte aligned uint32 inside "
+                          "the push constant range");
         }
 
-        if (result != VK_SUCCESS) {
-            return false;
+        const uint32_t n = group.size();
+        if (n > 1 && !perDevice && !info.bindings.entries.empty()) {
+            EVK_FAIL_VOID("MultiDeviceProgram: bindings reference buffers of one device; pass perDevice "
+                          "to bind each member's own buffers");
         }
 
-        if (q[0].available == 0 || q[1].available == 0) {
-            return false;
+        // Buffers and pipeline caches are per-device handles
+        std::vector<ComputeProgramCreateInfo> infos(n, info);
+        for (uint32_t i = 0; i < n; ++i) {
+            if (infos[i].pipelineCache && infos[i].pipelineCache->device() != &group.device(i)) {
+                infos[i].pipelineCache = nullptr;
+            }
+            if (perDevice) perDevice(i, infos[i]);
+            if (infos[i].pipelineCache && infos[i].pipelineCache->device() != &group.device(i)) {
+                EVK_FAIL_VOID("MultiDeviceProgram: the pipeline cache of member " + std::to_string(i) +
+                              " belongs to another device");
+            }
         }
 
-        lastTimestamps_[0] = q[0].value;
-        lastTimestamps_[1] = q[1].value;
-        timestampInFlight_ = false;
-        outNs = static_cast<double>(q[1].value - q[0].value) * device_->timestampPeriod();
-        return true;
-    }
+        std::vector<std::future<ComputeProgram>> futures;
+        futures.reserve(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            futures.push_back(createProgramAsync(group.device(i), infos[i]));
+        }
 
-    SubmitHandle ComputeProgram::submitAsync(bool addHostBarrier, bool enableTimestamps) {
-        if (!initialized_) {
-            EVK_FAIL("Program not initialized");
+        // Collect every future before rethrowing: the builders reference infos
+        programs_.reserve(n);
+#ifndef EASYVK_NO_EXCEPTIONS
+        std::exception_ptr firstError;
+        for (std::future<ComputeProgram> &future : futures) {
+            try {
+                programs_.push_back(future.get());
+            } catch (...) {
+                if (!firstError) firstError = std::current_exception();
+            }
+        }
+        if (firstError) {
+            programs_.clear();
+            std::rethrow_exception(firstError);
+        }
+#else
+        bool failed = false;
+        for (std::future<ComputeProgram> &future : futures) {
+            programs_.push_back(future.get());
+            failed = failed || !programs_.back().isValid();
+        }
+        if (failed) {
+            programs_.clear();
+            lastError_ = "MultiDeviceProgram: building a member program failed";
+            return;
         }
+#endif
 
-        VK_CHECK(vkResetCommandBuffer(cmdBuf_, 0));
+        devices_.reserve(n);
+        for (uint32_t i = 0; i < n; ++i) devices_.push_back(&group.device(i));
+        weights_.assign(n, 1.0);
+        first_.assign(n, 0);
+        count_.assign(n, 0);
+        lastNs_.assign(n, 0);
+    }
 
-        VkCommandBufferBeginInfo beginInfo{
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            nullptr,
-            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-            nullptr
-        };
-        VK_CHECK(vkBeginCommandBuffer(cmdBuf_, &beginInfo));
+    MultiDeviceProgram::MultiDeviceProgram(MultiDeviceProgram &&other) noexcept
+        : devices_(std::move(other.devices_)),
+          programs_(std::move(other.programs_)),
+          groupOffsetPushOffset_(other.groupOffsetPushOffset_),
+          weights_(std::move(other.weights_)),
+          first_(std::move(other.first_)),
+          count_(std::move(other.count_)),
+          lastNs_(std::move(other.lastNs_)) {}
 
-        if (enableTimestamps && timestampQueryPool_ != VK_NULL_HANDLE) {
-            vkCmdResetQueryPool(cmdBuf_, timestampQueryPool_, 0, 2);
+    MultiDeviceProgram &MultiDeviceProgram::operator=(MultiDeviceProgram &&other) noexcept {
+        if (this != &other) {
+            devices_ = std::move(other.devices_);
+            programs_ = std::move(other.programs_);
+            groupOffsetPushOffset_ = other.groupOffsetPushOffset_;
+            weights_ = std::move(other.weights_);
+            first_ = std::move(other.first_);
+            count_ = std::move(other.count_);
+            lastNs_ = std::move(other.lastNs_);
         }
+        return *this;
+    }
 
-        vkCmdBindPipeline(cmdBuf_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+    MultiDeviceProgram::~MultiDeviceProgram() noexcept {}
 
-        // Optional GPU label for captures
-        if (vkCmdBeginDebugUtilsLabelEXT) {
-            VkDebugUtilsLabelEXT label{VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
-            label.pLabelName = addHostBarrier ? "easyvk::dispatch" : "easyvk::dispatchNoHostBarrier";
-            vkCmdBeginDebugUtilsLabelEXT(cmdBuf_, &label);
+    bool MultiDeviceProgram::setWeights(const std::vector<double> &weights) {
+        if (!isValid()) {
+            EVK_FAIL("MultiDeviceProgram is not valid");
         }
-
-        if (!descriptorSets_.empty()) {
-            vkCmdBindDescriptorSets(cmdBuf_, VK_PIPELINE_BIND_POINT_COMPUTE, layout_, 0,
-                                  static_cast<uint32_t>(descriptorSets_.size()),
-                                  descriptorSets_.data(), 0, nullptr);
+        if (weights.size() != programs_.size()) {
+            EVK_FAIL("MultiDeviceProgram::setWeights: one weight per member required");
         }
-
-        // Push constants
-        if (pcCfg_.sizeBytes > 0) {
-            if (pcData_.size() < pcCfg_.sizeBytes) pcData_.assign(pcCfg_.sizeBytes, 0);
-            vkCmdPushConstants(cmdBuf_, layout_, VK_SHADER_STAGE_COMPUTE_BIT, pcCfg_.offset, pcCfg_.sizeBytes, pcData_.data());
+        double total = 0;
+        for (double w : weights) {
+            if (!(w >= 0)) {
+                EVK_FAIL("MultiDeviceProgram::setWeights: weights must be non-negative");
+            }
+            total += w;
         }
-
-        // Host->Device barrier
-        VkMemoryBarrier hostToDeviceBarrier{
-            VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-            nullptr,
-            VK_ACCESS_HOST_WRITE_BIT,
-            VK_ACCESS_SHADER_READ_BIT
-        };
-        vkCmdPipelineBarrier(cmdBuf_, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                             0, 1, &hostToDeviceBarrier, 0, nullptr, 0, nullptr);
-
-        if (enableTimestamps && timestampQueryPool_ != VK_NULL_HANDLE) {
-            vkCmdWriteTimestamp(cmdBuf_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool_, 0);
+        if (total <= 0) {
+            EVK_FAIL("MultiDeviceProgram::setWeights: at least one weight must be positive");
         }
+        weights_ = weights;
+        return true;
+    }
 
-        vkCmdDispatch(cmdBuf_, groupsX_, groupsY_, groupsZ_);
-
-        if (enableTimestamps && timestampQueryPool_ != VK_NULL_HANDLE) {
-            vkCmdWriteTimestamp(cmdBuf_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool_, 1);
+    bool MultiDeviceProgram::rebalance() {
+        if (!isValid()) {
+            EVK_FAIL("MultiDeviceProgram is not valid");
         }
-
-        if (addHostBarrier) {
-            VkMemoryBarrier barrier{
-                VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-                nullptr,
-                VK_ACCESS_SHADER_WRITE_BIT,
-                VK_ACCESS_HOST_READ_BIT
-            };
-            vkCmdPipelineBarrier(cmdBuf_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
-                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        std::vector<double> weights = weights_;
+        bool measured = false;
+        for (size_t i = 0; i < programs_.size(); ++i) {
+            // Members without work last time keep their weight
+            if (count_[i] == 0 || lastNs_[i] == 0) continue;
+            weights[i] = static_cast<double>(count_[i]) * 1e9 / static_cast<double>(lastNs_[i]);
+            measured = true;
         }
-
-        if (vkCmdEndDebugUtilsLabelEXT) {
-            vkCmdEndDebugUtilsLabelEXT(cmdBuf_);
+        if (!measured) {
+            EVK_FAIL("MultiDeviceProgram::rebalance: no timed dispatch yet");
         }
-
-        VK_CHECK(vkEndCommandBuffer(cmdBuf_));
-
-        VkFence asyncFence;
-        VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
-        VK_CHECK(vkCreateFence(device_->vk(), &fenceInfo, nullptr, &asyncFence));
-
-        VkSubmitInfo submitInfo{
-            VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            nullptr,
-            0, nullptr, nullptr,
-            1, &cmdBuf_,
-            0, nullptr
-        };
-
-        VK_CHECK(vkQueueSubmit(device_->computeQueue(), 1, &submitInfo, asyncFence));
-        return SubmitHandle{asyncFence, VK_NULL_HANDLE};
+        weights_ = weights;
+        return true;
     }
 
-    bool ComputeProgram::submitAndWait(bool addHostBarrier) {
-        SubmitHandle handle = submitAsync(addHostBarrier, false);
-        return device_->wait(handle);
+    bool MultiDeviceProgram::setPushConstants(const void *data, uint32_t bytes, uint32_t offset) {
+        if (!isValid()) {
+            EVK_FAIL("MultiDeviceProgram is not valid");
+        }
+        if (offset < groupOffsetPushOffset_ + 4 && groupOffsetPushOffset_ < static_cast<uint64_t>(offset) + bytes) {
+            EVK_FAIL("MultiDeviceProgram::setPushConstants: range overlaps the group offset");
+        }
+        for (ComputeProgram &program : programs_) {
+            if (!program.setPushConstants(data, bytes, offset)) return false;
+        }
+        return true;
     }
 
-    void ComputeProgram::teardown() {
-        if (tornDown_) return;
-        teardownFrom(INIT_COMPLETE);
-    }
+    bool MultiDeviceProgram::split(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ) {
+        if (!isValid()) {
+            EVK_FAIL("MultiDeviceProgram is not valid");
+        }
+        if (groupsX == 0 || groupsY == 0 || groupsZ == 0) {
+            EVK_FAIL("Workgroup counts must be greater than zero");
+        }
 
-    void ComputeProgram::teardownFrom(InitState state) {
-        if (device_ && device_->vk() != VK_NULL_HANDLE) {
-            if (state >= INIT_QUERY_POOL && timestampQueryPool_ != VK_NULL_HANDLE) {
-                vkDestroyQueryPool(device_->vk(), timestampQueryPool_, nullptr);
-                timestampQueryPool_ = VK_NULL_HANDLE;
+        // Boundaries at rounded cumulative shares: counts always add up to groupsX
+        double total = 0;
+        for (double w : weights_) total += w;
+        double cumulative = 0;
+        uint32_t previous = 0;
+        for (size_t i = 0; i < programs_.size(); ++i) {
+            cumulative += weights_[i];
+            uint32_t end = static_cast<uint32_t>(std::floor(static_cast<double>(groupsX) * (cumulative / total) + 0.5));
+            end = std::min(std::max(end, previous), groupsX);
+            first_[i] = previous;
+            count_[i] = end - previous;
+            previous = end;
+        }
+        // Rounding can leave a remainder behind trailing zero-weight members
+        for (size_t i = programs_.size(); previous < groupsX && i-- > 0;) {
+            if (weights_[i] > 0) {
+                count_[i] += groupsX - previous;
+                for (size_t j = i + 1; j < programs_.size(); ++j) first_[j] = groupsX;
+                previous = groupsX;
             }
+        }
 
-            if (state >= INIT_FENCE && fence_ != VK_NULL_HANDLE) {
-                vkDestroyFence(device_->vk(), fence_, nullptr);
-                fence_ = VK_NULL_HANDLE;
+        for (size_t i = 0; i < programs_.size(); ++i) {
+            if (count_[i] == 0) continue;
+            ComputeProgram &program = programs_[i];
+            if (!program.setWorkgroups(count_[i], groupsY, groupsZ) ||
+                !program.setPushConstants(&first_[i], static_cast<uint32_t>(sizeof(uint32_t)), groupOffsetPushOffset_)) {
+                return false;
             }
+        }
+        return true;
+    }
 
-            if (state >= INIT_COMMAND_BUFFER && cmdBuf_ != VK_NULL_HANDLE && cmdPool_ != VK_NULL_HANDLE) {
-                vkFreeCommandBuffers(device_->vk(), cmdPool_, 1, &cmdBuf_);
-                cmdBuf_ = VK_NULL_HANDLE;
-            }
+    std::vector<SubmitHandle> MultiDeviceProgram::dispatchAsync(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ,
+                                                                bool addHostBarrier) {
+        std::vector<SubmitHandle> handles;
+        if (!split(groupsX, groupsY, groupsZ)) return handles;
 
-            if (state >= INIT_COMMAND_POOL && cmdPool_ != VK_NULL_HANDLE) {
-                vkDestroyCommandPool(device_->vk(), cmdPool_, nullptr);
-                cmdPool_ = VK_NULL_HANDLE;
-            }
+        handles.resize(programs_.size());
+        for (size_t i = 0; i < programs_.size(); ++i) {
+            if (count_[i] == 0) continue;
+            handles[i] = programs_[i].dispatchAsync(SubmitHandle(), addHostBarrier);
+        }
+        return handles;
+    }
 
-            if (state >= INIT_PIPELINE && pipeline_ != VK_NULL_HANDLE) {
-                vkDestroyPipeline(device_->vk(), pipeline_, nullptr);
-                pipeline_ = VK_NULL_HANDLE;
-            }
+    bool MultiDeviceProgram::wait(const std::vector<SubmitHandle> &handles) {
+        if (!isValid() || handles.size() != programs_.size()) return false;
+        bool ok = true;
+        for (size_t i = 0; i < handles.size(); ++i) {
+            if (handles[i].isValid()) ok = devices_[i]->wait(handles[i]) && ok;
+        }
+        return ok;
+    }
 
-            if (state >= INIT_PIPELINE_LAYOUT && layout_ != VK_NULL_HANDLE) {
-                vkDestroyPipelineLayout(device_->vk(), layout_, nullptr);
-                layout_ = VK_NULL_HANDLE;
-            }
+    bool MultiDeviceProgram::dispatch(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ) {
+        if (!split(groupsX, groupsY, groupsZ)) return false;
 
-            if (state >= INIT_DESCRIPTOR_POOL && dsp_ != VK_NULL_HANDLE) {
-                vkDestroyDescriptorPool(device_->vk(), dsp_, nullptr);
-                dsp_ = VK_NULL_HANDLE;
-            }
+        // One host thread per member so each one's completion time is measured on its own
+        std::vector<std::future<bool>> done(programs_.size());
+        for (size_t i = 0; i < programs_.size(); ++i) {
+            lastNs_[i] = 0;
+            if (count_[i] == 0) continue;
+            done[i] = std::async(std::launch::async, [this, i]() {
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                const bool ok = programs_[i].dispatch();
+                lastNs_[i] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+                return ok;
+            });
+        }
 
-            if (state >= INIT_SET_LAYOUTS) {
-                for (auto layout : setLayouts_) {
-                    if (layout != VK_NULL_HANDLE) {
-                        vkDestroyDescriptorSetLayout(device_->vk(), layout, nullptr);
-                    }
-                }
-                setLayouts_.clear();
-            }
+        bool ok = true;
+        for (std::future<bool> &f : done) {
+            if (f.valid()) ok = f.get() && ok;
+        }
+        return ok;
+    }
 
-            if (state >= INIT_SHADER && shader_ != VK_NULL_HANDLE) {
-                vkDestroyShaderModule(device_->vk(), shader_, nullptr);
-                shader_ = VK_NULL_HANDLE;
+    bool MultiDeviceProgram::gather(const std::vector<Buffer *> &sources, VkDeviceSize bytesPerGroup, void *dst,
+                                    VkDeviceSize baseOffset) {
+        if (!isValid()) {
+            EVK_FAIL("MultiDeviceProgram is not valid");
+        }
+        if (sources.size() != programs_.size()) {
+            EVK_FAIL("MultiDeviceProgram::gather: one source buffer per member required");
+        }
+        if (!dst || bytesPerGroup == 0) {
+            EVK_FAIL("MultiDeviceProgram::gather: destination and bytesPerGroup are required");
+        }
+
+        std::vector<std::future<bool>> done(programs_.size());
+        for (size_t i = 0; i < programs_.size(); ++i) {
+            if (count_[i] == 0) continue;
+            if (!sources[i] || &sources[i]->device() != devices_[i]) {
+                EVK_FAIL("MultiDeviceProgram::gather: source " + std::to_string(i) + " is not a buffer of member " +
+                         std::to_string(i));
             }
         }
+        for (size_t i = 0; i < programs_.size(); ++i) {
+            if (count_[i] == 0) continue;
+            const VkDeviceSize offset = baseOffset + static_cast<VkDeviceSize>(first_[i]) * bytesPerGroup;
+            const VkDeviceSize bytes = static_cast<VkDeviceSize>(count_[i]) * bytesPerGroup;
+            Device *dev = devices_[i];
+            Buffer *src = sources[i];
+            uint8_t *out = static_cast<uint8_t *>(dst) + offset;
+            done[i] = std::async(std::launch::async, [dev, src, out, bytes, offset]() {
+                return dev->download(*src, out, bytes, offset);
+            });
+        }
 
-        initialized_ = false;
-        tornDown_ = true;
+        bool ok = true;
+        for (std::future<bool> &f : done) {
+            if (f.valid()) ok = f.get() && ok;
+        }
+        return ok;
     }
 
     // -------- Debug utilities ---------------------------------------------------
@@ -2403,6 +9059,118 @@ namespace easyvk {
         }
     }
 
+    // -------- SpirvFile implementation ------------------------------------------
+    SpirvFile::SpirvFile() : words_(nullptr), wordCount_(0), mapping_(nullptr) {}
+
+    SpirvFile::SpirvFile(const char *path) : words_(nullptr), wordCount_(0), mapping_(nullptr) {
+        if (!path) {
+            EVK_FAIL_VOID("SPIR-V filename cannot be null");
+        }
+
+        size_t size = 0;
+        const void *view = nullptr;
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            EVK_FAIL_VOID(std::string("failed opening file ") + path + " for reading");
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            EVK_FAIL_VOID(std::string("failed querying the size of ") + path);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size != 0 && size % 4 == 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (view) {
+                    mapping_ = mapping;
+                } else {
+                    CloseHandle(mapping);
+                }
+            }
+        }
+        CloseHandle(file); // the mapping keeps the file open
+#else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            EVK_FAIL_VOID(std::string("failed opening file ") + path + " for reading");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            EVK_FAIL_VOID(std::string("failed querying the size of ") + path);
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size != 0 && size % 4 == 0) {
+            void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) view = addr;
+        }
+        close(fd); // the mapping keeps the file open
+#endif
+
+        if (size == 0) {
+            EVK_FAIL_VOID(std::string("SPIR-V file ") + path + " is empty");
+        }
+        if (size % 4 != 0) {
+            EVK_FAIL_VOID(std::string("SPIR-V file ") + path + " has invalid size " + std::to_string(size) +
+                          " (not multiple of 4 bytes)");
+        }
+        if (!view) {
+            EVK_FAIL_VOID(std::string("failed mapping file ") + path);
+        }
+
+        words_ = static_cast<const uint32_t *>(view);
+        wordCount_ = size / 4;
+        if (!isValidSPIRV(words_, wordCount_)) {
+            teardown();
+            EVK_FAIL_VOID(std::string("Invalid SPIR-V content in file: ") + path);
+        }
+    }
+
+    SpirvFile::SpirvFile(SpirvFile &&other) noexcept
+        : words_(other.words_), wordCount_(other.wordCount_), mapping_(other.mapping_) {
+        other.words_ = nullptr;
+        other.wordCount_ = 0;
+        other.mapping_ = nullptr;
+    }
+
+    SpirvFile &SpirvFile::operator=(SpirvFile &&other) noexcept {
+        if (this != &other) {
+            teardown();
+            words_ = other.words_;
+            wordCount_ = other.wordCount_;
+            mapping_ = other.mapping_;
+
+            other.words_ = nullptr;
+            other.wordCount_ = 0;
+            other.mapping_ = nullptr;
+        }
+        return *this;
+    }
+
+    SpirvFile::~SpirvFile() noexcept {
+        teardown();
+    }
+
+    void SpirvFile::teardown() {
+        if (words_) {
+#ifdef _WIN32
+            UnmapViewOfFile(words_);
+#else
+            munmap(const_cast<uint32_t *>(words_), wordCount_ * sizeof(uint32_t));
+#endif
+        }
+#ifdef _WIN32
+        if (mapping_) CloseHandle(static_cast<HANDLE>(mapping_));
+#endif
+        words_ = nullptr;
+        wordCount_ = 0;
+        mapping_ = nullptr;
+    }
+
     // -------- Utility functions -------------------------------------------------
     std::vector<uint32_t> readSpirv(const char *filename) {
         if (!filename) {
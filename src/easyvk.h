@@ -20,7 +20,14 @@
 #ifndef EASYVK_H
 #define EASYVK_H
 
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 #include <string>
@@ -93,18 +100,40 @@ namespace easyvk {
     } while(0)
 
     // -------- Small enums / handles ---------------------------------------------
+    class CommandContext; // internal per-thread command pool, defined in easyvk.cpp
+    class Device;
+
+    // Tracks one queue submission. With timeline semaphores enabled on the Device the
+    // submission is identified by (semaphore, value) and fence is VK_NULL_HANDLE;
+    // otherwise a (pooled) binary fence is used.
     struct SubmitHandle {
         VkFence fence;
         VkCommandBuffer cmdBuf; // transient CB allocated for this submission
-
-        SubmitHandle() : fence(VK_NULL_HANDLE), cmdBuf(VK_NULL_HANDLE) {}
-        explicit SubmitHandle(VkFence f, VkCommandBuffer cb = VK_NULL_HANDLE) : fence(f), cmdBuf(cb) {}
+        VkSemaphore semaphore;  // queue timeline semaphore (timeline mode)
+        uint64_t value;         // timeline value signaled on completion; fence mode: fence owner serial
+        CommandContext *context; // internal: per-thread pool that gets cmdBuf/fence back
+        const Device *device;    // device that issued the submission (used by poll())
+
+        SubmitHandle()
+            : fence(VK_NULL_HANDLE), cmdBuf(VK_NULL_HANDLE), semaphore(VK_NULL_HANDLE), value(0), context(nullptr),
+              device(nullptr) {}
+        explicit SubmitHandle(VkFence f, VkCommandBuffer cb = VK_NULL_HANDLE)
+            : fence(f), cmdBuf(cb), semaphore(VK_NULL_HANDLE), value(0), context(nullptr), device(nullptr) {}
+
+        bool isValid() const { return fence != VK_NULL_HANDLE || semaphore != VK_NULL_HANDLE; }
+        bool isTimeline() const { return semaphore != VK_NULL_HANDLE; }
+        // Non-blocking completion check through the issuing device (Device::isComplete);
+        // never consumes the handle. False for handles not issued by a Device, Stream or TaskGraph.
+        bool poll() const;
     };
 
     enum class HostAccess { None, Write, Read, ReadWrite };
 
     enum class BufferUsage { Storage, Uniform, Staging, TransferSrc, TransferDst };
 
+    // How a kernel uses a bound buffer; decides which barriers its dispatches need.
+    enum class BufferAccess { Read, Write, ReadWrite };
+
     // -------- Instance -----------------------------------------------------------
     struct InstanceCreateInfo {
         bool enableValidationLayers;               // request VK_LAYER_KHRONOS_validation
@@ -175,21 +204,110 @@ namespace easyvk {
     };
 
     // -------- Device -------------------------------------------------------------
+    class PipelineCache; // fwd for Device
+    class Profiler;      // fwd for Device
+    class Tracer;        // fwd for Device
+    class Buffer;
+    class StagingRing;   // internal, defined in easyvk.cpp
+    class MemoryArena;   // internal, defined in easyvk.cpp
+    class CommandContextRegistry; // internal, defined in easyvk.cpp
+    class ShaderModuleCache;      // internal, defined in easyvk.cpp
+    class CompletionWorker;       // internal, defined in easyvk.cpp
+    struct DeviceCounters;        // internal, defined in easyvk.cpp
+    struct ShaderModuleEntry;
+
     struct DeviceCreateInfo {
         int preferredIndex;            // -1: pick best discrete > integrated > cpu
         bool enableRobustBufferAccess; // core robustBufferAccess
         bool enableRobustness2;        // VK_EXT_robustness2 features (if supported)
         bool enableDebugMarkers;       // VK_EXT_debug_marker (optional)
         uint32_t apiVersion;           // override instance API version if needed
+        // Buffer copies of at least this many bytes run on the dedicated transfer queue
+        // (needs timeline semaphores); smaller ones stay on the compute queue, where the
+        // ownership-transfer round trip would cost more than it overlaps. UINT64_MAX disables.
+        VkDeviceSize transferQueueMinCopyBytes;
+        // Persistently mapped staging ring used by Device::upload/download: transfers are
+        // split into chunks of stagingChunkBytes cycling through stagingChunkCount slots
+        // (>= 2 so memcpy of one chunk overlaps the copy of the previous one).
+        VkDeviceSize stagingChunkBytes;
+        uint32_t stagingChunkCount;
+        // Without VMA, buffers whose memory requirement is at most this many bytes are
+        // sub-allocated from shared, size-classed VkDeviceMemory pages instead of getting
+        // their own allocation. 0 gives every Buffer a dedicated vkAllocateMemory.
+        VkDeviceSize memoryArenaMaxAllocationBytes;
+        // Queues to create on the compute family (clamped to what the family offers). Queue 0
+        // serves the Device's own submissions; every queue can be driven by Streams.
+        uint32_t computeQueueCount;
+        // Opt-in submission coalescing (needs timeline semaphores): compute-queue submissions
+        // are queued on the host and handed to the driver together in one vkQueueSubmit /
+        // vkQueueSubmit2 once coalesceMaxPending are queued, once the oldest has waited
+        // coalesceMaxLatencyUs (checked when the next one arrives), or on Device::flush().
+        bool coalesceSubmits;
+        uint32_t coalesceMaxPending;
+        uint32_t coalesceMaxLatencyUs;
+        // VK_KHR_performance_query hardware counters for ComputeProgram::dispatchWithReport
+        // (if supported). Pipeline statistics queries are enabled whenever available.
+        bool enablePerformanceQuery;
+        // bufferDeviceAddress (Vulkan 1.2 core or VK_KHR_buffer_device_address, if supported):
+        // every Buffer gets a GPU address (Buffer::deviceAddress()) that kernels can take
+        // through push constants instead of descriptors (ComputeProgram::setPushAddress).
+        bool enableBufferDeviceAddress;
 
         DeviceCreateInfo()
             : preferredIndex(-1),
               enableRobustBufferAccess(false),
               enableRobustness2(false),
               enableDebugMarkers(false),
-              apiVersion(VK_API_VERSION_1_3) {}
+              apiVersion(VK_API_VERSION_1_3),
+              transferQueueMinCopyBytes(256 * 1024),
+              stagingChunkBytes(4 * 1024 * 1024),
+              stagingChunkCount(3),
+              memoryArenaMaxAllocationBytes(1024 * 1024),
+              computeQueueCount(1),
+              coalesceSubmits(false),
+              coalesceMaxPending(32),
+              coalesceMaxLatencyUs(200),
+              enablePerformanceQuery(false),
+              enableBufferDeviceAddress(false) {}
+    };
+
+    // One VK_KHR_performance_query counter of the compute queue family.
+    struct PerformanceCounterInfo {
+        std::string name;
+        std::string category;
+        std::string description;
+        VkPerformanceCounterUnitKHR unit;
+        VkPerformanceCounterScopeKHR scope;
+        VkPerformanceCounterStorageKHR storage;
+    };
+
+    // Snapshot of Device::stats(). Covers every object the library creates for the device:
+    // Buffers, programs, Streams, task graphs and the internal pools. Under EASYVK_USE_VMA,
+    // Buffer memory is counted per VMA allocation rather than per VkDeviceMemory block.
+    struct DeviceStats {
+        uint64_t memoryAllocations;      // live device memory allocations (arena pages, dedicated, imported)
+        uint64_t memoryAllocationsTotal; // allocations made since creation
+        uint64_t memoryTypeBytes[VK_MAX_MEMORY_TYPES]; // live allocated bytes per memory type
+        uint64_t fencesCreated;
+        uint64_t commandBuffersAllocated;
+        uint64_t descriptorPoolsCreated;
+        uint64_t queueSubmits;           // vkQueueSubmit/vkQueueSubmit2 calls on every queue
+        uint64_t hostWaits;              // blocking fence/semaphore waits (zero timeouts excluded)
+        uint64_t hostWaitNs;             // host time spent in them
     };
 
+    // Every object created on a Device (Buffer, ComputeProgram, PipelineCache, Profiler,
+    // CommandBatch, Stream, TaskGraph, CompletionQueue, WorkgroupTuner) keeps a pointer to
+    // it, so a Device may only be moved while none of them exist (asserted in debug builds);
+    // keep it in place, e.g. behind a unique_ptr as DeviceGroup does, once it has children.
+    //
+    // Thread safety: submission entry points (Buffer copies, ComputeProgram dispatches,
+    // CommandBatch, upload/download, wait/isComplete) may be called from several host threads
+    // at once. Each thread records into its own lazily created command pool and only the
+    // vkQueueSubmit itself is serialized, per queue. Individual Buffer, ComputeProgram and
+    // CommandBatch objects are still externally synchronized, and a CommandBatch must be
+    // recorded on a single thread. Construction, move and destruction of the Device are not
+    // thread-safe.
     class Device {
     public:
         explicit Device(Instance &inst, const DeviceCreateInfo &info);
@@ -206,26 +324,152 @@ namespace easyvk {
         VkDevice vk() const { return device_; }
         VkPhysicalDevice physical() const { return phys_; }
         VkQueue computeQueue() const { return queue_; }
+        // All compute queues created (>= 1); index 0 is computeQueue()
+        uint32_t computeQueueCount() const { return static_cast<uint32_t>(computeQueues_.size()); }
+        VkQueue computeQueue(uint32_t index) const { return computeQueues_[index]; }
         // Optional transfer queue (may equal compute when no dedicated family created)
         VkQueue transferQueue() const { return transferQueue_ ? transferQueue_ : queue_; }
         uint32_t computeQueueFamilyIndex() const { return queueFamilyIndex_; }
         uint32_t transferQueueFamilyIndex() const { return transferQueueFamilyIndex_ != UINT32_MAX ? transferQueueFamilyIndex_ : queueFamilyIndex_; }
         bool timelineSemaphoresEnabled() const { return timelineEnabled_; }
+        // True when large Buffer copies are routed through the dedicated transfer queue
+        bool transferQueueCopiesEnabled() const { return transferTimeline_ != VK_NULL_HANDLE; }
         bool synchronization2Enabled() const { return sync2Enabled_; }
         const VkPhysicalDeviceLimits &limits() const { return limits_; }
-
-        // Wait for an async fence (copy/dispatch). Consumes & destroys the fence and frees
-        // the transient command buffer if present. Returns true on VK_SUCCESS.
+        const VkPhysicalDeviceProperties &properties() const { return properties_; }
+        const uint8_t *deviceUUID() const { return deviceUUID_; }
+        const uint8_t *driverUUID() const { return driverUUID_; }
+
+        // Optional device-wide pipeline cache used by ComputePrograms that do not name one
+        // explicitly. Not owned; must outlive every program created while attached. An
+        // attached cache (and profiler) follows a move of the Device, and is torn down with
+        // it so its Vulkan object never outlives the VkDevice.
+        void setPipelineCache(PipelineCache *cache) { pipelineCache_ = cache; }
+        PipelineCache *pipelineCache() const { return pipelineCache_; }
+
+        // Optional device-wide GPU profiler: while attached, every ComputeProgram dispatch,
+        // CommandBatch command, Stream command and compute-queue Buffer copy is bracketed by
+        // timestamps. Not owned; must outlive the attachment and every recording made under it.
+        void setProfiler(Profiler *profiler) { profiler_ = profiler; }
+        Profiler *profiler() const { return profiler_; }
+
+        // Counters since creation (or the last resetStats(), which keeps the live values:
+        // memoryAllocations and memoryTypeBytes). Lock-free; safe from any thread.
+        DeviceStats stats() const;
+        void resetStats();
+
+        // Optional host-side tracer: while attached, ComputeProgram dispatch submissions and
+        // construction, Buffer copies, mapWrite/mapRead (and the unmap that flushes) and
+        // blocking waits each report one span. Not owned; must outlive the attachment.
+        void setTracer(Tracer *tracer) { tracer_ = tracer; }
+        Tracer *tracer() const { return tracer_; }
+
+        // Wait for an async fence (copy/dispatch). On success the fence and the transient
+        // command buffer (if any) are returned to the device's recycling pools and the
+        // handle must not be used again. On VK_TIMEOUT nothing is consumed and the same
+        // handle may be waited on again. Returns true on VK_SUCCESS.
         bool wait(const SubmitHandle &h, uint64_t timeoutNs = UINT64_C(0xFFFFFFFFFFFFFFFF));
 
+        // Non-blocking completion check; never consumes the handle.
+        bool isComplete(const SubmitHandle &h) const;
+
+        // Wait for all handles, or for any one of them, with a single driver wait. Completed
+        // handles issued by this Device are consumed as by wait() (waitAny consumes only the
+        // one it returns); Stream and TaskGraph handles are only observed. On timeout nothing
+        // is consumed. waitAny returns the index of a completed handle, or UINT32_MAX on
+        // timeout, failure or when no handle is valid.
+        bool waitAll(const std::vector<SubmitHandle> &handles, uint64_t timeoutNs = UINT64_C(0xFFFFFFFFFFFFFFFF));
+        uint32_t waitAny(const std::vector<SubmitHandle> &handles, uint64_t timeoutNs = UINT64_C(0xFFFFFFFFFFFFFFFF));
+
+        // Timeline submission tracking (requires timelineSemaphoresEnabled()). Every
+        // submission on the compute queue signals the next value of computeTimeline().
+        VkSemaphore computeTimeline() const { return computeTimeline_; }
+        uint64_t lastSubmittedValue() const { return computeTimelineValue_.load(); }
+        uint64_t completedValue() const; // current counter value of the compute timeline
+        // Block until the compute timeline reaches value. Does not recycle any handle.
+        bool waitFor(uint64_t value, uint64_t timeoutNs = UINT64_C(0xFFFFFFFFFFFFFFFF)) const;
+
+        // Submission coalescing (DeviceCreateInfo::coalesceSubmits). flush() hands every
+        // queued submission to the driver in a single call. wait(), isComplete() and waitFor()
+        // flush on their own when they need a submission that is still queued, and so do
+        // GPU-side dependencies from Streams; anything else has to call flush() to get work
+        // onto the GPU without reaching a threshold.
+        bool submitCoalescingEnabled() const { return coalesceSubmits_; }
+        bool flush();
+        uint32_t pendingSubmissions() const;
+
+        // Streaming host<->device transfers through the device's staging ring (created on
+        // first use). dst/src may be device-local. Both return after the GPU copy finished,
+        // so the host pointer can be reused and later submissions see the data.
+        bool upload(Buffer &dst, const void *src, VkDeviceSize bytes, VkDeviceSize dstOffset = 0);
+        bool download(Buffer &src, void *dst, VkDeviceSize bytes, VkDeviceSize srcOffset = 0);
+
         bool robustAccessEnabled() const { return robustAccessEnabled_; }
         bool robustness2Enabled() const { return robustness2Enabled_; }
-
+        // VK_KHR_push_descriptor (enabled whenever the device exposes it)
+        bool pushDescriptorsEnabled() const { return pushDescriptorsEnabled_; }
+        uint32_t maxPushDescriptors() const { return maxPushDescriptors_; }
+        // VK_EXT_external_memory_host (enabled whenever the device exposes it): Buffers can
+        // import host allocations aligned to minImportedHostPointerAlignment().
+        bool externalMemoryHostEnabled() const { return externalMemoryHostEnabled_; }
+        VkDeviceSize minImportedHostPointerAlignment() const { return minImportedHostPointerAlignment_; }
+        // VK_EXT_shader_module_identifier (enabled whenever supported): programs built with a
+        // pipeline cache first try the cached pipeline by module identifier, so a warm start
+        // never creates a VkShaderModule.
+        bool shaderModuleIdentifierEnabled() const { return shaderModuleIdentifierEnabled_; }
+        // DeviceCreateInfo::enableBufferDeviceAddress and supported
+        bool bufferDeviceAddressEnabled() const { return bufferDeviceAddressEnabled_; }
+        // Shader modules shared by every ComputeProgram built from the same SPIR-V
+        // (keyed by content hash). Unreferenced ones stay cached until trimShaderModules().
+        size_t shaderModuleCount() const;
+        size_t trimShaderModules(); // returns the number of entries released
+        // Command pools and fences are created per submitting thread on first use and kept
+        // until the Device is destroyed. A thread done with this Device (e.g. a worker about
+        // to exit) calls releaseThreadContext(); its pools are destroyed as soon as every
+        // command buffer and fence handed out from them is back. trimThreadContexts() retries
+        // released contexts that were still busy. Both return the number destroyed.
+        size_t releaseThreadContext();
+        size_t trimThreadContexts();
+        // Core pipelineStatisticsQuery feature (compute shader invocation counts)
+        bool pipelineStatisticsEnabled() const { return pipelineStatisticsEnabled_; }
+        // VK_KHR_performance_query (DeviceCreateInfo::enablePerformanceQuery and supported)
+        bool performanceQueryEnabled() const { return performanceQueryEnabled_; }
+        // Counters of the compute family; indices select them in ComputeProgram::setPerformanceCounters
+        const std::vector<PerformanceCounterInfo> &performanceCounters() const { return performanceCounters_; }
+
+        // First memory type containing all of flags (cached memory properties).
         uint32_t selectMemory(uint32_t memoryTypeBits, VkMemoryPropertyFlags flags);
-        uint32_t subgroupSize() const;
+        // Best memory type for the given host access intent, or UINT32_MAX:
+        //  None      -> DEVICE_LOCAL, preferring types outside the BAR window
+        //  Write     -> HOST_VISIBLE, preferring DEVICE_LOCAL (ReBAR/UMA; small BAR heaps only
+        //               for buffers <= heap/16) and uncached write-combined memory
+        //  Read      -> HOST_VISIBLE|HOST_CACHED; uncached device-local reads are penalized
+        //  ReadWrite -> HOST_VISIBLE, preferring HOST_CACHED|HOST_COHERENT
+        uint32_t selectMemory(uint32_t memoryTypeBits, HostAccess access, VkDeviceSize sizeBytes = 0) const;
+        // All usable types for the intent, best first (Buffer falls back along this list).
+        std::vector<uint32_t> rankMemoryTypes(uint32_t memoryTypeBits, HostAccess access, VkDeviceSize sizeBytes = 0) const;
+        const VkPhysicalDeviceMemoryProperties &memoryProperties() const { return memProperties_; }
+        // Integrated/CPU device: device-local memory is ordinary host memory
+        bool unifiedMemory() const { return unifiedMemory_; }
+        // Subgroup properties, queried once at construction
+        uint32_t subgroupSize() const { return subgroupSize_; } // default size
+        VkShaderStageFlags subgroupSupportedStages() const { return subgroupStages_; }
+        VkSubgroupFeatureFlags subgroupSupportedOperations() const { return subgroupOperations_; }
+        bool supportsSubgroupOperations(VkSubgroupFeatureFlags ops) const {
+            return (subgroupStages_ & VK_SHADER_STAGE_COMPUTE_BIT) && (subgroupOperations_ & ops) == ops;
+        }
+        // Subgroup size control (Vulkan 1.3 or VK_EXT_subgroup_size_control): selectable sizes
+        // are the powers of two in [minSubgroupSize, maxSubgroupSize]; both equal
+        // subgroupSize() without it.
+        bool subgroupSizeControlEnabled() const { return subgroupSizeControl_; }
+        bool computeFullSubgroupsEnabled() const { return computeFullSubgroups_; }
+        uint32_t minSubgroupSize() const { return minSubgroupSize_; }
+        uint32_t maxSubgroupSize() const { return maxSubgroupSize_; }
+        uint32_t maxComputeWorkgroupSubgroups() const { return maxComputeWorkgroupSubgroups_; }
         const char *vendorName() const;
         bool supportsTimestamps() const { return supportsTimestamps_; }
         double timestampPeriod() const { return timestampPeriod_; }
+        uint32_t timestampValidBits() const { return timestampValidBits_; } // compute family
 
 #ifdef EASYVK_USE_VMA
         VmaAllocator allocator() const { return allocator_; }
@@ -243,17 +487,91 @@ namespace easyvk {
         VkDevice device_;
         VkQueue queue_;
         VkQueue transferQueue_ = VK_NULL_HANDLE;
+        std::vector<VkQueue> computeQueues_;
+        // vkQueueSubmit needs external synchronization per queue; one lock per compute queue
+        std::vector<std::unique_ptr<std::mutex>> queueLocks_;
         uint32_t queueFamilyIndex_;
         uint32_t transferQueueFamilyIndex_ = UINT32_MAX;
         VkPhysicalDeviceLimits limits_;
-        VkCommandPool transferCmdPool_; // internal one-time submit pool
+        VkPhysicalDeviceProperties properties_;
+        VkPhysicalDeviceMemoryProperties memProperties_;
+        bool unifiedMemory_ = false;
+        uint8_t deviceUUID_[VK_UUID_SIZE];
+        uint8_t driverUUID_[VK_UUID_SIZE];
+        PipelineCache *pipelineCache_ = nullptr;
+        Profiler *profiler_ = nullptr;
+        Tracer *tracer_ = nullptr;
+        std::unique_ptr<DeviceCounters> counters_; // shared with the internal pools; stable across moves
+        uint64_t id_; // process-unique, keys the per-thread command context cache
+        std::unique_ptr<CommandContextRegistry> contexts_; // per-thread pools and fences
         bool robustAccessEnabled_;
         bool robustness2Enabled_;
         bool debugMarkersEnabled_;
+        bool pushDescriptorsEnabled_ = false;
+        uint32_t maxPushDescriptors_ = 0;
+        bool externalMemoryHostEnabled_ = false;
+        VkDeviceSize minImportedHostPointerAlignment_ = 0;
+        bool shaderModuleIdentifierEnabled_ = false;
+        bool bufferDeviceAddressEnabled_ = false;
+        uint32_t subgroupSize_ = 0;
+        VkShaderStageFlags subgroupStages_ = 0;
+        VkSubgroupFeatureFlags subgroupOperations_ = 0;
+        bool subgroupSizeControl_ = false;
+        bool computeFullSubgroups_ = false;
+        uint32_t minSubgroupSize_ = 0;
+        uint32_t maxSubgroupSize_ = 0;
+        uint32_t maxComputeWorkgroupSubgroups_ = 0;
+        bool pipelineStatisticsEnabled_ = false;
+        bool performanceQueryEnabled_ = false;
+        std::vector<PerformanceCounterInfo> performanceCounters_;
         bool timelineEnabled_ = false;
         bool sync2Enabled_ = false;
+        VkSemaphore computeTimeline_ = VK_NULL_HANDLE;
+        std::atomic<uint64_t> computeTimelineValue_; // last value signaled on the compute queue (under its lock)
+        // Core 1.2 entry points, or the KHR aliases when only VK_KHR_timeline_semaphore exists
+        PFN_vkWaitSemaphores waitSemaphores_ = nullptr;
+        PFN_vkGetSemaphoreCounterValue getSemaphoreCounterValue_ = nullptr;
+        // Dedicated transfer queue copies: per-thread pools on the transfer family plus a
+        // timeline the compute queue waits on before re-acquiring buffer ownership.
+        VkDeviceSize transferQueueMinCopyBytes_ = UINT64_MAX;
+        VkSemaphore transferTimeline_ = VK_NULL_HANDLE;
+        uint64_t transferTimelineValue_ = 0;              // guarded by transferQueueLock_
+        std::unique_ptr<std::mutex> transferQueueLock_;
+        std::unique_ptr<std::mutex> lazyInitLock_;        // staging_ / arena_ creation
+        // Fence-mode submissions (Device, Stream, TaskGraph) record which submission owns each
+        // fence; a handle whose serial no longer matches has completed and its fence may
+        // already serve a later submission. Recycling a fence takes the lock first.
+        std::unique_ptr<std::mutex> fenceOwnersLock_;
+        std::map<VkFence, uint64_t> fenceOwners_;        // guarded by fenceOwnersLock_
+        uint64_t fenceSerial_ = 0;                        // guarded by fenceOwnersLock_
+        // Queued compute submissions (coalescing mode), guarded by queueLocks_[0]. Waits of
+        // every entry are stored back to back in pendingWaits_.
+        struct PendingSubmit {
+            VkCommandBuffer cmdBuf;
+            uint64_t signalValue;
+            uint32_t waitCount;
+        };
+        struct PendingWait {
+            VkSemaphore semaphore;
+            uint64_t value;
+            VkPipelineStageFlags stage;
+        };
+        bool coalesceSubmits_ = false;
+        uint32_t coalesceMaxPending_ = 0;
+        uint64_t coalesceMaxLatencyNs_ = 0;
+        mutable std::vector<PendingSubmit> pendingSubmits_;
+        mutable std::vector<PendingWait> pendingWaits_;
+        mutable uint64_t oldestPendingNs_ = 0;
+        mutable std::atomic<uint64_t> flushedValue_; // highest compute value handed to the driver
+        VkDeviceSize stagingChunkBytes_ = 0;
+        uint32_t stagingChunkCount_ = 0;
+        std::unique_ptr<StagingRing> staging_; // lazily created by upload/download
+        VkDeviceSize arenaMaxAllocationBytes_ = 0;
+        std::unique_ptr<MemoryArena> arena_;   // lazily created by the first arena-eligible Buffer
+        std::unique_ptr<ShaderModuleCache> shaderModules_; // lazily created by the first ComputeProgram
         bool supportsTimestamps_;
         double timestampPeriod_;
+        uint32_t timestampValidBits_ = 0;
         bool tornDown_;
 
 #ifdef EASYVK_USE_VMA
@@ -265,29 +583,302 @@ namespace easyvk {
 #endif
 
         void teardown();
+        MemoryArena *memoryArena(); // null when disabled
+        ShaderModuleCache *shaderModuleCache(); // created on first use
+        StagingRing *stagingRing(); // created on first use
+
+        // Recycling pools for per-submission objects. Buffers come from the calling thread's
+        // CommandContext; releases may happen on any thread and go back to owner (null: the
+        // calling thread's context).
+        CommandContext *commandContext();
+        VkFence acquireFence();
+        void releaseFence(VkFence fence, CommandContext *owner = nullptr);
+        VkCommandBuffer acquireCommandBuffer();
+        void releaseCommandBuffer(VkCommandBuffer cmdBuf, CommandContext *owner = nullptr);
+        // Submit cmdBuf on the compute queue, signaling the compute timeline (or a pooled
+        // fence without timeline support). When transient is true the returned handle owns
+        // cmdBuf (recycled by wait()) on behalf of owner (null: the calling thread). The GPU
+        // waits for every timeline handle in deps (at waitStage); fence-only deps are waited
+        // for on the host.
+        SubmitHandle submitCommands(VkCommandBuffer cmdBuf, bool transient,
+                                    const SubmitHandle *deps = nullptr, uint32_t depCount = 0,
+                                    CommandContext *owner = nullptr,
+                                    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        // Transfer queue copy path
+        VkCommandBuffer acquireTransferQueueCommandBuffer();
+        void releaseTransferQueueCommandBuffer(VkCommandBuffer cmdBuf);
+        // Recycle cmdBuf (from the calling thread's pools) once the compute timeline passes value
+        void deferCommandBuffer(VkCommandBuffer cmdBuf, bool transferFamily, uint64_t value);
+
+        // Coalescing: submit queued work so that compute timeline value becomes reachable.
+        // Const so the const wait/poll paths can use it; the queue itself is mutable.
+        bool flushThrough(uint64_t value) const;
+        VkResult flushPendingLocked() const; // caller holds queueLocks_[0]
+        // Fence ownership: claim after a successful submit (returns the handle's value),
+        // retire before the fence is reset or destroyed.
+        uint64_t claimFence(VkFence fence);
+        void retireFence(VkFence fence);
+        // Host wait for a fence-mode dependency; VK_SUCCESS at once when its fence was retired.
+        VkResult waitFenceDependency(const SubmitHandle &h);
+        // One vkWaitSemaphores/vkWaitForFences over every valid handle; consumes nothing.
+        VkResult waitHandles(const std::vector<SubmitHandle> &handles, bool any, uint64_t timeoutNs) const;
+        bool useTransferQueueFor(VkDeviceSize bytes) const {
+            return transferTimeline_ != VK_NULL_HANDLE && bytes >= transferQueueMinCopyBytes_;
+        }
+        // Release src/dst from the compute family, copy on the transfer queue, then hand
+        // ownership back. The returned handle completes once the compute queue re-acquired
+        // both buffers, so later compute submissions are ordered after the copy.
+        SubmitHandle copyOnTransferQueue(Buffer &src, Buffer &dst, const VkBufferCopy &region);
+        // Submit cmdBuf on the compute queue as counter pass passIndex of a performance query
+        // and wait for it (bypasses the timeline; pending coalesced work is flushed first).
+        bool submitPerformancePass(VkCommandBuffer cmdBuf, uint32_t passIndex);
+
         friend class Buffer;
         friend class ComputeProgram;
+        friend class CommandBatch;
+        friend class StagingRing;
+        friend class Stream;
+        friend class TaskGraph;
+        friend class Profiler;
+        friend class CompletionWorker;
+        friend class DeviceChildRef;
         friend void setObjectName(Instance &, Device &, uint64_t, VkObjectType, const char *);
     };
 
+    // Counts one live object created on a Device (see the Device move note) and moves with
+    // it. Internal; every Device child holds one next to its device_ pointer.
+    class DeviceChildRef {
+    public:
+        DeviceChildRef() : counters_(nullptr) {}
+        explicit DeviceChildRef(Device &dev);
+        ~DeviceChildRef() noexcept;
+
+        DeviceChildRef(const DeviceChildRef &) = delete;
+        DeviceChildRef &operator=(const DeviceChildRef &) = delete;
+        DeviceChildRef(DeviceChildRef &&other) noexcept : counters_(other.counters_) { other.counters_ = nullptr; }
+        DeviceChildRef &operator=(DeviceChildRef &&other) noexcept;
+
+    private:
+        DeviceCounters *counters_;
+    };
+
+    // -------- Pipeline cache -----------------------------------------------------
+    // Device-level VkPipelineCache with optional on-disk persistence. Files carry an
+    // easyvk header keyed by vendor/device ID, driver version and device/driver UUIDs;
+    // blobs written by a different GPU or driver are rejected on load.
+    class PipelineCache {
+    public:
+        PipelineCache(); // invalid placeholder
+        // Creates an empty cache, then tries load(path) when path is non-null.
+        explicit PipelineCache(Device &dev, const char *path = nullptr);
+        ~PipelineCache() noexcept;
+
+        PipelineCache(const PipelineCache &) = delete;
+        PipelineCache &operator=(const PipelineCache &) = delete;
+        PipelineCache(PipelineCache &&) noexcept;
+        PipelineCache &operator=(PipelineCache &&) noexcept;
+
+        VkPipelineCache vk() const { return cache_; }
+        Device *device() const { return device_; }
+
+        // Merge a previously saved blob into this cache. Returns false (leaving the cache
+        // untouched) if the file is missing, corrupt or was produced by another device/driver.
+        bool load(const char *path);
+        // Write the current cache contents to path (via a temporary file + rename).
+        bool save(const char *path) const;
+        // Raw VkPipelineCache data as returned by the driver (no easyvk header).
+        std::vector<uint8_t> data() const;
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return cache_ != VK_NULL_HANDLE && !tornDown_; }
+
+    private:
+        Device *device_;
+        DeviceChildRef childRef_;
+        VkPipelineCache cache_;
+        bool tornDown_;
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+
+        void teardown();
+
+        friend class Device;
+    };
+
+    // -------- Profiler -----------------------------------------------------------
+    // Latency summary for one label. Percentiles come from a log-scale histogram with
+    // eight buckets per power of two (about 9% resolution).
+    struct ProfileStats {
+        std::string label;
+        uint64_t count;
+        double minNs, maxNs, meanNs;
+        double p50Ns, p99Ns;
+    };
+
+    // Device-wide ring of timestamp query pairs. Each timed command takes a pair at record
+    // time; collect() picks up finished pairs without waiting on the GPU, adds them to
+    // per-label histograms and recycles the pairs (reset on the GPU by one small submission
+    // per collect). When every pair is in flight further commands simply go untimed
+    // (droppedCount()). Attach with Device::setProfiler. Thread-safe. Profiled ComputeProgram
+    // dispatches are re-recorded on every submit, since a replayed recording would reuse its
+    // query pair.
+    class Profiler {
+    public:
+        Profiler(); // invalid placeholder
+        // capacity: number of commands that can be in flight (recorded, not yet collected)
+        explicit Profiler(Device &dev, uint32_t capacity = 1024);
+        ~Profiler() noexcept;
+
+        Profiler(const Profiler &) = delete;
+        Profiler &operator=(const Profiler &) = delete;
+        Profiler(Profiler &&) noexcept;
+        Profiler &operator=(Profiler &&) noexcept;
+
+        // Harvest every finished command; returns how many samples were added. Never blocks.
+        uint32_t collect();
+        // Per-label summaries sorted by label.
+        std::vector<ProfileStats> stats() const;
+        // Clear the histograms (queries in flight still land in the next collect()).
+        void clear();
+        uint64_t droppedCount() const;
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return pool_ != VK_NULL_HANDLE && !tornDown_; }
+
+    private:
+        enum class SlotState : uint8_t { Free, Recorded, Resetting };
+        struct Histogram {
+            std::string label;
+            std::vector<uint64_t> buckets;
+            uint64_t count;
+            double sumNs, minNs, maxNs;
+        };
+
+        Device *device_;
+        DeviceChildRef childRef_;
+        VkQueryPool pool_;
+        uint32_t capacity_;
+        uint64_t timestampMask_;
+        std::unique_ptr<std::mutex> lock_;
+        std::vector<SlotState> slotStates_;
+        std::vector<uint32_t> slotLabels_;   // histogram index per slot
+        std::vector<uint32_t> freeSlots_;
+        std::vector<uint32_t> needsReset_;   // harvested, waiting for the next reset submission
+        std::vector<uint32_t> resetting_;    // covered by resetHandle_
+        SubmitHandle resetHandle_;
+        std::vector<Histogram> histograms_;
+        uint64_t dropped_;
+        bool tornDown_;
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+
+        // Write the opening timestamp of a timed command; UINT32_MAX when the ring is full.
+        uint32_t beginScope(VkCommandBuffer cmd, const char *label, VkPipelineStageFlags stage);
+        void endScope(VkCommandBuffer cmd, uint32_t slot, VkPipelineStageFlags stage);
+        // Recorded but never submitted (e.g. CommandBatch::reset): recycle without a sample
+        void cancel(const uint32_t *slots, size_t count);
+        uint32_t labelIndex(const char *label);
+        void submitReset(const std::vector<uint32_t> &slots);
+        void teardown();
+
+        friend class ComputeProgram;
+        friend class CommandBatch;
+        friend class Stream;
+        friend class Buffer;
+        friend class Device;
+    };
+
+    // -------- Host tracing -------------------------------------------------------
+    // One host-side span. name is a static string: "dispatch", "createProgram", "copy",
+    // "mapWrite", "mapRead", "unmap" or "wait".
+    struct TraceEvent {
+        const char *name;
+        uint64_t startNs;    // std::chrono::steady_clock
+        uint64_t durationNs;
+        uint64_t bytes;      // copied or mapped bytes; 0 otherwise
+        uint32_t threadId;   // small process-wide id of the reporting thread
+    };
+
+    // Collects the spans of every Device it is attached to (Device::setTracer). Events are
+    // kept in memory up to capacity (further ones are only counted by droppedCount()) and,
+    // when a callback is set, also handed to it on the reporting thread. Thread-safe.
+    class Tracer {
+    public:
+        // capacity 0: keep nothing, only invoke the callback
+        explicit Tracer(size_t capacity = 1u << 20);
+        ~Tracer() noexcept;
+
+        Tracer(const Tracer &) = delete;
+        Tracer &operator=(const Tracer &) = delete;
+        Tracer(Tracer &&) noexcept;
+        Tracer &operator=(Tracer &&) noexcept;
+
+        // Runs on the reporting thread outside the tracer's lock, so it may record or read
+        // the tracer; concurrent reports call it concurrently. A callback replaced while a
+        // report is in flight may still see that one event.
+        void setCallback(std::function<void(const TraceEvent &)> callback);
+        void record(const TraceEvent &event);
+
+        std::vector<TraceEvent> events() const;
+        void clear();
+        uint64_t droppedCount() const;
+        // Chrome trace-event JSON (one complete event per span) for chrome://tracing or Perfetto
+        bool writeChromeTrace(const std::string &path) const;
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+    private:
+        std::unique_ptr<std::mutex> lock_;
+        // Shared so record() can call it after dropping the lock
+        std::shared_ptr<const std::function<void(const TraceEvent &)>> callback_;
+        std::vector<TraceEvent> events_;
+        size_t capacity_;
+        uint64_t dropped_;
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+    };
+
     // -------- Buffer -------------------------------------------------------------
     struct BufferCreateInfo {
         VkDeviceSize sizeBytes;
         BufferUsage usage;
         HostAccess host;
+        // Map host-visible memory once at creation and keep it mapped: mapWrite/mapRead then
+        // return views of that mapping without vkMapMemory/vkUnmapMemory (see mappedData()).
+        bool persistentMap;
+        // VK_EXT_external_memory_host: back the buffer with this existing host allocation
+        // instead of allocating (no copy). It must outlive the Buffer, and both the pointer and
+        // sizeBytes must be multiples of Device::minImportedHostPointerAlignment(). Imported
+        // buffers are always persistently mapped; mappedData() returns hostPointer.
+        void *hostPointer;
 
         explicit BufferCreateInfo(VkDeviceSize s = 0, BufferUsage u = BufferUsage::Storage, HostAccess h = HostAccess::None)
-            : sizeBytes(s), usage(u), host(h) {}
+            : sizeBytes(s), usage(u), host(h), persistentMap(false), hostPointer(nullptr) {}
 
         bool validate(std::string &error) const;
     };
 
     class Buffer; // fwd for BufferMapping
+    struct BufferView;
+    struct MemoryArenaPage;
 
     // RAII mapping for host-visible memory. For non-coherent memory:
     //  - mapWrite: dtor FLUSHES the aligned mapped subrange
     //  - mapRead : caller INVALIDATES after mapping (see mapRead()), dtor does nothing
-    // All mappings use an aligned superset to satisfy nonCoherentAtomSize.
+    // All mappings use an aligned superset to satisfy nonCoherentAtomSize. On persistently
+    // mapped buffers a mapping is only a view: nothing is mapped or unmapped.
     class BufferMapping {
     public:
         BufferMapping();
@@ -339,6 +930,30 @@ namespace easyvk {
         VkBuffer vk() const { return buffer_; }
         VkDeviceSize size() const { return size_; }
         Device &device() const { return *device_; }
+        // VkBufferUsageFlags the buffer was created with (from BufferCreateInfo::usage)
+        VkBufferUsageFlags usageFlags() const { return usageFlags_; }
+        // True when the memory is a slot of the Device memory arena (non-VMA path)
+        bool isSuballocated() const { return arenaPage_ != nullptr; }
+        // Property flags / index of the memory type the buffer actually lives in
+        VkMemoryPropertyFlags memoryFlags() const { return memFlags_; }
+        uint32_t memoryTypeIndex() const { return memoryTypeIndex_; }
+        // Host address of byte 0 while the memory stays mapped (persistentMap, imported host
+        // memory, host-visible arena slots), else nullptr. Pair with flush()/invalidate().
+        void *mappedData() const { return mapped_; }
+        bool isPersistentlyMapped() const { return mapped_ != nullptr; }
+        // True when the memory is an imported host allocation (BufferCreateInfo::hostPointer)
+        bool isHostImported() const { return hostImported_; }
+        // GPU address of byte 0 (Device::bufferDeviceAddressEnabled()), else 0. Kernels read
+        // it as a PhysicalStorageBuffer pointer, e.g. passed via ComputeProgram::setPushAddress.
+        VkDeviceAddress deviceAddress() const { return deviceAddress_; }
+
+        // Make host writes through mappedData() visible to the device / device writes visible
+        // to the host. No-ops on coherent memory.
+        bool flush(VkDeviceSize offsetBytes = 0, VkDeviceSize lengthBytes = VK_WHOLE_SIZE);
+        bool invalidate(VkDeviceSize offsetBytes = 0, VkDeviceSize lengthBytes = VK_WHOLE_SIZE);
+
+        // Non-owning window [offsetBytes, offsetBytes + lengthBytes) for descriptor binding.
+        BufferView view(VkDeviceSize offsetBytes = 0, VkDeviceSize lengthBytes = VK_WHOLE_SIZE) const;
 
         // Map for CPU writes (host->device). On non-coherent memory, dtor flushes.
         BufferMapping mapWrite(VkDeviceSize offsetBytes = 0, VkDeviceSize lengthBytes = VK_WHOLE_SIZE);
@@ -351,6 +966,18 @@ namespace easyvk {
         // Asynchronous copy; returns a fence to wait on.
         SubmitHandle copyToAsync(Buffer &dst, VkDeviceSize bytes = VK_WHOLE_SIZE, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
 
+        // Fill [offset, offset + size) with a repeated 32-bit value (vkCmdFillBuffer) without
+        // a staging buffer. offset and size must be multiples of 4 (or size VK_WHOLE_SIZE).
+        bool fill(uint32_t value, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        SubmitHandle fillAsync(uint32_t value, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+        // Write a small payload inline in the command buffer (vkCmdUpdateBuffer). data is
+        // copied at record time and may be reused immediately. offset and size must be
+        // multiples of 4 and size at most maxInlineUpdateSize; use a staging copy beyond that.
+        static const VkDeviceSize maxInlineUpdateSize = 65536;
+        bool update(const void *data, VkDeviceSize offset, VkDeviceSize size);
+        SubmitHandle updateAsync(const void *data, VkDeviceSize offset, VkDeviceSize size);
+
 #ifdef EASYVK_NO_EXCEPTIONS
         const std::string &lastError() const { return lastError_; }
 #endif
@@ -359,12 +986,24 @@ namespace easyvk {
 
     private:
         Device *device_;
+        DeviceChildRef childRef_;
         VkBuffer buffer_;
         VkDeviceMemory memory_;
         VkDeviceSize size_;
         VkMemoryPropertyFlags memFlags_;
+        uint32_t memoryTypeIndex_;
         HostAccess hostAccess_;
+        VkBufferUsageFlags usageFlags_;
         bool tornDown_;
+        bool hostImported_;
+        VkDeviceAddress deviceAddress_;
+
+        // Arena sub-allocation: memory_ is the shared page, bound at memoryOffset_
+        MemoryArenaPage *arenaPage_;
+        uint32_t arenaSlot_;
+        VkDeviceSize memoryOffset_;
+        VkDeviceSize allocationSize_; // arena slot or dedicated allocation size (>= size_)
+        void *mapped_;                // persistent mapping of byte 0 (arena slot, persistentMap or import)
 
 #ifdef EASYVK_USE_VMA
         VmaAllocation allocation_;
@@ -376,12 +1015,41 @@ namespace easyvk {
 
         void teardown();
         bool validateRange(VkDeviceSize offset, VkDeviceSize len, const char *operation) const;
+        bool validateFill(VkDeviceSize offset, VkDeviceSize size, const char *operation) const;
+        bool validateUpdate(const void *data, VkDeviceSize offset, VkDeviceSize size, const char *operation) const;
+        VkCommandBuffer beginOneShot();
+        // Ends and submits cmdBuf; on failure frees it and cancels profileSlot
+        SubmitHandle submitOneShot(VkCommandBuffer cmdBuf, uint32_t profileSlot = UINT32_MAX);
         bool createVkBuffer(VkBuffer *buf, VkDeviceMemory *mem, VkDeviceSize sizeBytes,
-                            VkBufferUsageFlags usage, VkMemoryPropertyFlags props);
+                            VkBufferUsageFlags usage, bool persistentMap = false);
+        bool importHostMemory(void *hostPointer, VkBufferUsageFlags usage);
+        void queryDeviceAddress();
         void flushRange(VkDeviceSize offset, VkDeviceSize sizeBytes);
         void invalidateRange(VkDeviceSize offset, VkDeviceSize sizeBytes);
 
         friend class BufferMapping;
+        friend class CommandBatch;
+        friend class StagingRing;
+        friend class Stream;
+        friend class TaskGraph;
+    };
+
+    // Non-owning (offset, range) window into a Buffer, e.g. one job's slice of a shared
+    // buffer. Binding a view is the same as passing its offset/range explicitly.
+    struct BufferView {
+        const Buffer *buffer;
+        VkDeviceSize offset;
+        VkDeviceSize range;
+
+        BufferView() : buffer(nullptr), offset(0), range(0) {}
+        BufferView(const Buffer &b, VkDeviceSize off, VkDeviceSize len) : buffer(&b), offset(off), range(len) {}
+
+        VkBuffer vk() const { return buffer ? buffer->vk() : VK_NULL_HANDLE; }
+        // Address of the first byte of the view (0 without buffer device addresses)
+        VkDeviceAddress deviceAddress() const {
+            return (buffer && buffer->deviceAddress()) ? buffer->deviceAddress() + offset : 0;
+        }
+        bool isValid() const { return buffer != nullptr && range > 0; }
     };
 
     // -------- Compute pipeline (program) -----------------------------------------
@@ -390,15 +1058,18 @@ namespace easyvk {
         uint32_t binding;
         VkDescriptorType type; // VK_DESCRIPTOR_TYPE_STORAGE_BUFFER or UNIFORM_BUFFER
         std::vector<VkDescriptorBufferInfo> buffers; // support for descriptor arrays
+        BufferAccess access;   // Read for uniform buffers, ReadWrite for storage by default
 
         // Helper constructors for single buffer bindings (backward compatibility)
         ComputeBindingEntry(uint32_t b, VkDescriptorType t, VkBuffer buf, VkDeviceSize offset, VkDeviceSize range)
-            : set(0), binding(b), type(t) {
+            : set(0), binding(b), type(t),
+              access(t == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ? BufferAccess::Read : BufferAccess::ReadWrite) {
             buffers.push_back({buf, offset, range});
         }
 
         ComputeBindingEntry(uint32_t s, uint32_t b, VkDescriptorType t, const std::vector<VkDescriptorBufferInfo> &bufs)
-            : set(s), binding(b), type(t), buffers(bufs) {}
+            : set(s), binding(b), type(t), buffers(bufs),
+              access(t == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ? BufferAccess::Read : BufferAccess::ReadWrite) {}
     };
 
     struct ComputeBindings {
@@ -407,19 +1078,96 @@ namespace easyvk {
         // Single-buffer methods (use set 0)
         void addStorage(uint32_t binding, const Buffer &buf, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
         void addUniform(uint32_t binding, const Buffer &buf, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        // Views must reference a buffer and lie inside it; a bad view is rejected (and, without
+        // exceptions, makes validate() fail so the program is not built without it)
+        void addStorage(uint32_t binding, const BufferView &view);
+        void addUniform(uint32_t binding, const BufferView &view);
 
         // Methods for multiple sets and descriptor arrays
         void addStorageArray(uint32_t set, uint32_t binding, const std::vector<Buffer*> &buffers);
         void addUniformArray(uint32_t set, uint32_t binding, const std::vector<Buffer*> &buffers);
         void addStorageToSet(uint32_t set, uint32_t binding, const Buffer &buf, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
         void addUniformToSet(uint32_t set, uint32_t binding, const Buffer &buf, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        void addStorageToSet(uint32_t set, uint32_t binding, const BufferView &view);
+        void addUniformToSet(uint32_t set, uint32_t binding, const BufferView &view);
+
+        // Declare a storage binding read-only or write-only so dispatches only wait for (and
+        // are only waited for by) the accesses that actually conflict. Returns false if the
+        // (set, binding) pair has not been added.
+        bool setAccess(uint32_t set, uint32_t binding, BufferAccess access);
 
         bool validate(const Device &device, std::string &error) const;
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+    private:
+#ifdef EASYVK_NO_EXCEPTIONS
+        std::string lastError_;
+#endif
+
+        bool checkView(const BufferView &view, const char *what);
+    };
+
+    // Read-only memory mapping of a SPIR-V file (mmap / MapViewOfFile): the words are used in
+    // place instead of being read into a vector. Only the size and magic number are checked.
+    class SpirvFile {
+    public:
+        SpirvFile(); // invalid placeholder
+        explicit SpirvFile(const char *path);
+        ~SpirvFile() noexcept;
+
+        SpirvFile(const SpirvFile &) = delete;
+        SpirvFile &operator=(const SpirvFile &) = delete;
+        SpirvFile(SpirvFile &&other) noexcept;
+        SpirvFile &operator=(SpirvFile &&other) noexcept;
+
+        const uint32_t *data() const { return words_; }
+        size_t wordCount() const { return wordCount_; }
+        size_t sizeBytes() const { return wordCount_ * sizeof(uint32_t); }
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return words_ != nullptr; }
+
+    private:
+        const uint32_t *words_;
+        size_t wordCount_;
+        void *mapping_; // file mapping handle (Windows only)
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+
+        void teardown();
+    };
+
+    // One 32-bit specialization constant (OpSpecConstant with SpecId id). Floats and bools
+    // are passed as their 32-bit pattern (see fromFloat / fromBool).
+    struct SpecConstant {
+        uint32_t id;
+        uint32_t value;
+
+        SpecConstant(uint32_t i, uint32_t v) : id(i), value(v) {}
+
+        static SpecConstant fromInt(uint32_t id, int32_t v) { return SpecConstant(id, static_cast<uint32_t>(v)); }
+        static SpecConstant fromBool(uint32_t id, bool v) { return SpecConstant(id, v ? 1u : 0u); }
+        static SpecConstant fromFloat(uint32_t id, float v) {
+            uint32_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            return SpecConstant(id, bits);
+        }
     };
 
     struct ComputeProgramCreateInfo {
         // SPIR-V (uint32_t words) of the compute shader.
         const std::vector<uint32_t> *spirv;
+        // Alternative to spirv, read when spirv is null: words used in place (e.g. a SpirvFile,
+        // which must stay mapped until the program is constructed).
+        const uint32_t *spirvCode;
+        size_t spirvWordCount;
 
         // Specialization constants for local workgroup size (>=1).
         uint32_t localX, localY, localZ;
@@ -427,16 +1175,50 @@ namespace easyvk {
         // Optional: (index, bytes) declarations for thread-group (shared) memory.
         std::vector<std::pair<uint32_t, uint32_t>> localMemory;
 
+        // Further specialization constants. IDs 0-2 are taken by localX/Y/Z and 3+index by
+        // the localMemory entries; every other ID is free. ComputeProgram::select() builds
+        // variants with different values (sharing module, layouts and descriptor sets).
+        std::vector<SpecConstant> specConstants;
+
         // Push-constant capacity in bytes (must be >0, multiple of 4, <= maxPushConstantsSize).
         uint32_t pushConstantBytes;
 
         // Name of the SPIR-V OpEntryPoint for this compute shader (default "main")
         const char *entryPointName;
 
-        // Resource bindings snapshot (copied at initialization).
+        // Resource bindings snapshot (copied at initialization). May be empty for kernels that
+        // take buffer device addresses through push constants: no descriptor pool, sets or
+        // updates are created then.
         ComputeBindings bindings;
 
-        ComputeProgramCreateInfo() : spirv(nullptr), localX(1), localY(1), localZ(1), pushConstantBytes(0), entryPointName("main") {}
+        // Optional pipeline cache; when null, Device::pipelineCache() is used (if attached).
+        // Not owned: the program keeps the pointer for the variants select() compiles later,
+        // so the cache must outlive the program.
+        PipelineCache *pipelineCache;
+
+        // Optional name for profiler samples and debug labels (copied; default "dispatch").
+        const char *label;
+
+        // Subgroup size control (Device::subgroupSizeControlEnabled()). requiredSubgroupSize pins
+        // the size (0 = driver choice; otherwise a power of two in [min, maxSubgroupSize]).
+        // requireFullSubgroups (Device::computeFullSubgroupsEnabled()) makes every subgroup
+        // fully populated; localX must then be a multiple of the required size, or of
+        // maxSubgroupSize when none is given.
+        uint32_t requiredSubgroupSize;
+        bool requireFullSubgroups;
+
+        ComputeProgramCreateInfo()
+            : spirv(nullptr), spirvCode(nullptr), spirvWordCount(0), localX(1), localY(1), localZ(1), pushConstantBytes(0), entryPointName("main"),
+              pipelineCache(nullptr), label(nullptr), requiredSubgroupSize(0), requireFullSubgroups(false) {}
+
+        void setSpirv(const SpirvFile &file) {
+            spirv = nullptr;
+            spirvCode = file.data();
+            spirvWordCount = file.wordCount();
+        }
+        // The SPIR-V to build from: *spirv when set, else spirvCode
+        const uint32_t *spirvData() const { return spirv ? spirv->data() : spirvCode; }
+        size_t spirvWords() const { return spirv ? spirv->size() : spirvWordCount; }
 
         bool validate(const Device &device, std::string &error) const;
     };
@@ -452,6 +1234,22 @@ namespace easyvk {
         bool validate(uint32_t maxSize, std::string &error) const;
     };
 
+    // Result of ComputeProgram::dispatchWithReport. Fields whose has* flag is false were not
+    // collected (unsupported, or no performance counters selected).
+    struct DispatchReport {
+        bool hasTiming;
+        double gpuNs;                   // timestamp delta around the dispatch
+        bool hasInvocations;
+        uint64_t computeInvocations;    // pipeline statistics: shader invocations
+        bool hasCounters;
+        std::vector<double> counters;   // in setPerformanceCounters() order
+        uint32_t passes;                // times the dispatch was executed to gather everything
+
+        DispatchReport()
+            : hasTiming(false), gpuNs(0.0), hasInvocations(false), computeInvocations(0),
+              hasCounters(false), passes(0) {}
+    };
+
     class ComputeProgram {
     public:
         ComputeProgram(); // invalid placeholder
@@ -475,14 +1273,54 @@ namespace easyvk {
             return setPushConstants(&pod, static_cast<uint32_t>(sizeof(T)), offset);
         }
 
+        // Write a buffer device address (8 bytes) into the push constants at offset, for
+        // kernels that take raw GPU pointers instead of descriptors. Needs
+        // Device::bufferDeviceAddressEnabled(); offset must be 8-byte aligned.
+        bool setPushAddress(uint32_t offset, const BufferView &view);
+        bool setPushAddress(uint32_t offset, const Buffer &buf) { return setPushAddress(offset, buf.view()); }
+
         bool setWorkgroups(uint32_t x, uint32_t y = 1, uint32_t z = 1);
 
+        // Record-once mode: the dispatch command buffer is kept and replayed on later
+        // submissions, and only re-recorded when workgroups, push constants or bindings
+        // actually change. Do not change those while a previous dispatch is in flight.
+        void setCommandReuse(bool enable);
+        bool commandReuseEnabled() const { return reuseCommands_; }
+
+        // Point an existing binding at another buffer without rebuilding the pipeline. The
+        // (set, binding) must exist in the creation-time bindings with the same descriptor
+        // type; arrays are addressed by arrayElement. Set 0 is pushed at record time via
+        // VK_KHR_push_descriptor when available, so rebinding it is free and may differ per
+        // CommandBatch dispatch. Other sets are rewritten (one templated update per set) at
+        // the next recording: do not rebind them while a dispatch of this program is in
+        // flight or recorded into an unsubmitted CommandBatch.
+        bool rebind(uint32_t binding, const Buffer &buf, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        bool rebind(uint32_t set, uint32_t binding, const BufferView &view, uint32_t arrayElement = 0);
+        // Replace every binding listed in bindings (layout must match the creation-time one).
+        bool rebind(const ComputeBindings &bindings);
+        bool usesPushDescriptors() const { return pushDescriptors_; }
+
         // Submit with default Compute->Host barrier for safe CPU readback.
         bool dispatch();
 
-        // Submit without the final Host barrier. Use for GPU->GPU chains.
+        // Submit without the final Host barrier. Use for GPU->GPU chains: every dispatch
+        // starts with buffer-range barriers from earlier GPU work on its bound ranges (per
+        // the bindings' BufferAccess), so a chain on one queue needs no further sync.
         bool dispatchNoHostBarrier();
 
+        // Asynchronous dispatch. If dependency is valid the dispatch waits for it on the GPU
+        // (timeline mode) or on the host (fence mode) before executing.
+        SubmitHandle dispatchAsync(const SubmitHandle &dependency = SubmitHandle(), bool addHostBarrier = true);
+
+        // Indirect dispatch: the workgroup counts are a VkDispatchIndirectCommand (3 x uint32)
+        // read from args at offset when the dispatch executes, so an earlier kernel can size
+        // it on the GPU. offset must be a multiple of 4; args must be a Storage buffer
+        // (those carry INDIRECT_BUFFER usage). setWorkgroups() is ignored for these calls.
+        bool dispatchIndirect(const Buffer &args, VkDeviceSize offset = 0);
+        SubmitHandle dispatchIndirectAsync(const Buffer &args, VkDeviceSize offset = 0,
+                                           const SubmitHandle &dependency = SubmitHandle(),
+                                           bool addHostBarrier = true);
+
         // Timestamped dispatch; returns time in nanoseconds if supported.
         bool supportsTimestamps() const;
         double dispatchWithTimingNs();
@@ -491,6 +1329,27 @@ namespace easyvk {
         SubmitHandle dispatchWithTimingAsync(); // returns fence; query IDs are fixed at {0,1}
         bool tryGetTimingNs(double& outNs);     // non-blocking; returns false if not ready
 
+        // Select VK_KHR_performance_query counters (indices into Device::performanceCounters())
+        // for dispatchWithReport; an empty list disables them. Some selections need several
+        // passes, each of which re-executes the kernel, so it must tolerate running again.
+        bool setPerformanceCounters(const std::vector<uint32_t> &counterIndices);
+        uint32_t performanceCounterPasses() const { return perfPasses_; }
+
+        // Synchronous instrumented dispatch (with host barrier): GPU time, compute shader
+        // invocations and selected hardware counters, whichever the device supports.
+        bool dispatchWithReport(DispatchReport &out);
+
+        // Switch to the pipeline variant specialized with values (applied over the
+        // creation-time constants; IDs 0-2 change the local size). Each distinct constant
+        // tuple is compiled once on first use and kept until the program is destroyed;
+        // select({}) returns to the creation-time variant. Affects dispatches recorded after
+        // the call; earlier recordings (including CommandBatch entries) keep their variant.
+        bool select(const std::vector<SpecConstant> &values);
+        size_t variantCount() const { return variants_.size(); }
+        uint32_t localSizeX() const { return localX_; }
+        uint32_t localSizeY() const { return localY_; }
+        uint32_t localSizeZ() const { return localZ_; }
+
 #ifdef EASYVK_NO_EXCEPTIONS
         const std::string &lastError() const { return lastError_; }
 #endif
@@ -499,25 +1358,71 @@ namespace easyvk {
 
     private:
         Device *device_;
+        DeviceChildRef childRef_;
         std::vector<VkDescriptorSetLayout> setLayouts_; // support multiple sets
         VkPipelineLayout layout_;
-        VkPipeline pipeline_;
+        VkPipeline pipeline_; // active variant (owned by variants_)
+        // Specialization variants keyed by their flattened (id, value) pairs in ID order;
+        // specBase_ holds the creation-time constants including local size and memory.
+        std::map<std::vector<uint32_t>, VkPipeline> variants_;
+        std::map<uint32_t, uint32_t> specBase_;
+        // Pipeline creation state kept for select()
+        std::string entryPoint_;
+        uint32_t requiredSubgroupSize_;
+        bool requireFullSubgroups_;
+        PipelineCache *pipelineCache_; // ComputeProgramCreateInfo::pipelineCache (may be null, not owned)
         VkDescriptorPool dsp_;
-        std::vector<VkDescriptorSet> descriptorSets_; // multiple sets
-        VkShaderModule shader_;
+        std::vector<VkDescriptorSet> descriptorSets_; // multiple sets (null for a pushed set 0)
+
+        // Current descriptor contents. setData_[set] holds the buffer infos of that set in
+        // template order; boundDescriptors_ maps (set, binding) into it.
+        struct BoundDescriptor {
+            uint32_t set;
+            uint32_t binding;
+            VkDescriptorType type;
+            uint32_t first; // index of the first element in setData_[set]
+            uint32_t count;
+            BufferAccess access;
+        };
+        std::vector<BoundDescriptor> boundDescriptors_;
+        std::vector<std::vector<VkDescriptorBufferInfo>> setData_;
+        std::vector<VkDescriptorUpdateTemplate> updateTemplates_; // per set; push template for set 0
+        std::vector<bool> setsDirty_;                          // pending set update before next record
+        bool pushDescriptors_;
+        bool pushAddresses_; // setPushAddress used: the kernel may touch unbound buffers
+        ShaderModuleEntry *shaderEntry_; // reference into the Device's shader module cache
+        VkShaderModule shader_;          // borrowed from shaderEntry_; null if built by identifier
         VkCommandPool cmdPool_;
         VkCommandBuffer cmdBuf_;
         VkFence fence_;
         VkQueryPool timestampQueryPool_;
+        VkQueryPool statsQueryPool_;          // pipeline statistics, created on first report
+        VkQueryPool perfQueryPool_;           // performance query for perfCounterIndices_
+        std::vector<uint32_t> perfCounterIndices_;
+        uint32_t perfPasses_;
 
         uint32_t pcCapacityBytes_;
         PushConstantConfig pcCfg_;
         uint32_t groupsX_, groupsY_, groupsZ_;
         uint32_t localX_, localY_, localZ_;
+        VkBuffer indirectBuffer_;     // non-null: next recording uses vkCmdDispatchIndirect
+        VkDeviceSize indirectOffset_;
         std::vector<uint8_t> pcData_;
+        std::string label_;
         bool initialized_;
         bool tornDown_;
 
+        // Command buffer reuse state
+        bool reuseCommands_;
+        bool commandsDirty_;       // recorded commands no longer match current state
+        bool recordedHostBarrier_; // variant captured by the current recording
+        bool recordedTimestamps_;
+        VkBuffer recordedIndirect_;
+        VkDeviceSize recordedIndirectOffset_;
+        bool recordedProfiled_;          // recording carries Device profiler timestamps
+        uint32_t recordedProfileSlot_;   // its profiler slot until submitted (UINT32_MAX: none)
+        std::unique_ptr<std::mutex> bindLock_; // recordBind from several Streams at once
+
         // Timestamp state for async operations
         bool timestampInFlight_;
         uint64_t lastTimestamps_[2];
@@ -545,7 +1450,575 @@ namespace easyvk {
         void teardown();
         void teardownFrom(InitState state);
         bool submitAndWait(bool addHostBarrier);
-        SubmitHandle submitAsync(bool addHostBarrier, bool enableTimestamps = false);
+        SubmitHandle submitAsync(bool addHostBarrier, bool enableTimestamps = false,
+                                 const SubmitHandle *dependency = nullptr);
+        // withReport additionally brackets the dispatch with the statistics/performance queries
+        void recordDispatch(bool addHostBarrier, bool enableTimestamps, bool withReport = false);
+        void cancelProfileSlot(); // release the unsubmitted recording's profiler slot
+        void destroyReportPools();
+        // Build (without registering) the pipeline specialized with constants
+        VkResult createPipeline(const std::map<uint32_t, uint32_t> &constants, VkPipeline *out);
+        // Select direct (null buffer) or indirect dispatch for the next submission
+        bool setIndirectSource(const Buffer *args, VkDeviceSize offset);
+        // Bind pipeline, descriptor sets and push constants into cmd.
+        void recordBind(VkCommandBuffer cmd);
+        // Barriers from earlier GPU writes (and reads, for written bindings) to the bound ranges
+        void recordInputBarriers(VkCommandBuffer cmd) const;
+        // Barriers from this dispatch's writes to host reads, over the written bindings only
+        void recordHostBarriers(VkCommandBuffer cmd) const;
+        void flushDescriptorUpdates();
+        void writeDescriptors(uint32_t set, std::vector<VkWriteDescriptorSet> &writes) const;
+
+        friend class CommandBatch;
+        friend class Stream;
+        friend class TaskGraph;
+    };
+
+    // -------- Parallel program construction --------------------------------------
+    // Shader module, layout and pipeline creation only touch per-program objects (and the
+    // internally synchronized pipeline cache), so programs can be built on several threads.
+    // The SPIR-V vectors and bindings referenced by the create infos must outlive the call
+    // (for createProgramAsync: until the future is ready).
+
+    // Builds infos[i] into result[i] on up to threadCount worker threads (0 = one per
+    // hardware thread). With exceptions the first failure is rethrown once every worker has
+    // finished; with EASYVK_NO_EXCEPTIONS failed programs are left invalid.
+    std::vector<ComputeProgram> createPrograms(Device &dev, const std::vector<ComputeProgramCreateInfo> &infos,
+                                               uint32_t threadCount = 0);
+
+    // Builds one program on a new thread; an exception is delivered through the future.
+    std::future<ComputeProgram> createProgramAsync(Device &dev, const ComputeProgramCreateInfo &info);
+
+    // -------- Workgroup autotuning -----------------------------------------------
+    struct WorkgroupSize {
+        uint32_t x, y, z;
+    };
+
+    struct WorkgroupTuneInfo {
+        // Invocations the kernel covers; each candidate is dispatched with ceil(problem/local)
+        // workgroups, so the kernel must bounds-check its global id.
+        uint32_t problemX, problemY, problemZ;
+        // Timed dispatches per candidate (the median counts), after one warm-up dispatch.
+        uint32_t iterations;
+        // Explicit candidates; empty derives power-of-two sizes from limits() and subgroupSize().
+        std::vector<WorkgroupSize> candidates;
+        // Called on each candidate program before timing (push constants, rebinds, ...).
+        std::function<void(ComputeProgram &)> prepare;
+
+        WorkgroupTuneInfo() : problemX(1), problemY(1), problemZ(1), iterations(5) {}
+    };
+
+    struct WorkgroupTuneResult {
+        WorkgroupSize best;
+        double medianNs;   // of the winner; host time if the queue has no timestamps
+        bool cached;       // answered from the cache without dispatching
+        uint32_t tried;    // candidates timed
+    };
+
+    // Picks localX/localY/localZ for a kernel by timing candidate sizes on the device. Winners
+    // are keyed by device/driver UUID, driver version, SPIR-V, entry point, push constant size
+    // and problem size, kept in memory and, when a path is given, in a small text file that is
+    // rewritten after every new result. Not thread-safe.
+    class WorkgroupTuner {
+    public:
+        // Loads cachePath when it exists; a missing or unreadable file starts an empty cache.
+        explicit WorkgroupTuner(Device &dev, const char *cachePath = nullptr);
+
+        // info.localX/Y/Z are ignored. On success out.best holds the size to build with.
+        bool tune(const ComputeProgramCreateInfo &info, const WorkgroupTuneInfo &tuneInfo, WorkgroupTuneResult &out);
+        bool save(const char *path) const;
+        size_t size() const { return entries_.size(); }
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+    private:
+        struct Entry {
+            uint64_t key;
+            WorkgroupSize size;
+            double medianNs;
+        };
+
+        Device *device_;
+        DeviceChildRef childRef_;
+        std::string path_;
+        std::vector<Entry> entries_;
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+
+        bool load(const char *path);
+        uint64_t key(const ComputeProgramCreateInfo &info, const WorkgroupTuneInfo &tuneInfo) const;
+        std::vector<WorkgroupSize> candidates(const ComputeProgramCreateInfo &info, const WorkgroupTuneInfo &tuneInfo) const;
+    };
+
+    // -------- Command batch ------------------------------------------------------
+    // Records several dispatches, copies and fills into one command buffer and submits
+    // them with a single vkQueueSubmit/fence. Accesses are tracked per buffer range: a
+    // command waits only for earlier commands of the batch that wrote a range it touches (or
+    // read a range it writes), through buffer-range barriers (synchronization2 when enabled),
+    // so independent commands may overlap. Dispatches access their bound ranges as declared
+    // with ComputeBindings::setAccess; programs using setPushAddress are treated as touching
+    // all memory. Host writes made before submit need no barrier.
+    // Programs and buffers must stay alive until the returned handle has been waited on.
+    class CommandBatch {
+    public:
+        explicit CommandBatch(Device &dev);
+        ~CommandBatch() noexcept;
+
+        CommandBatch(const CommandBatch &) = delete;
+        CommandBatch &operator=(const CommandBatch &) = delete;
+        CommandBatch(CommandBatch &&) noexcept;
+        CommandBatch &operator=(CommandBatch &&) noexcept;
+
+        // Record a dispatch using the program's current push constants and workgroup counts
+        // (both are captured at record time).
+        bool dispatch(ComputeProgram &program);
+        // Record an indirect dispatch (see ComputeProgram::dispatchIndirect). Counts written by
+        // an earlier command of the batch are visible to it.
+        bool dispatchIndirect(ComputeProgram &program, const Buffer &args, VkDeviceSize offset = 0);
+        // Record a buffer-to-buffer copy (same semantics as Buffer::copyTo).
+        bool copy(Buffer &src, Buffer &dst, VkDeviceSize bytes = VK_WHOLE_SIZE,
+                  VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+        // Record vkCmdFillBuffer; offset and size must be multiples of 4 (or VK_WHOLE_SIZE).
+        bool fill(Buffer &dst, uint32_t value, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        // Record vkCmdUpdateBuffer (same rules as Buffer::update); data is copied now.
+        bool update(Buffer &dst, const void *data, VkDeviceSize offset, VkDeviceSize size);
+
+        // Make the next submit wait for another submission on the GPU (timeline mode) or on
+        // the host (fence mode). Cleared after every submit/reset.
+        void waitOn(const SubmitHandle &dependency);
+
+        size_t size() const { return commandCount_; }
+        bool empty() const { return commandCount_ == 0; }
+
+        // Submit everything recorded so far. The batch is empty afterwards and can be reused.
+        // addHostBarrier appends a final ->Host barrier for safe CPU readback.
+        SubmitHandle submitAsync(bool addHostBarrier = true);
+        bool submit(bool addHostBarrier = true);
+
+        // Discard recorded commands without submitting.
+        void reset();
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return device_ != nullptr && !tornDown_; }
+
+    private:
+        // One buffer range touched by a recorded command (null buffer: all memory), with the
+        // stages/accesses that later barriers have already made it available to
+        struct RangeAccess {
+            VkBuffer buffer;
+            VkDeviceSize offset, size;
+            VkPipelineStageFlags stage;
+            VkAccessFlags access;
+            bool write;
+            bool hostVisible; // written memory the host may read back
+            VkPipelineStageFlags syncedStages;
+            VkAccessFlags syncedAccess;
+        };
+
+        Device *device_;
+        DeviceChildRef childRef_;
+        VkCommandBuffer cmdBuf_;
+        CommandContext *context_; // pool cmdBuf_ came from (the recording thread's)
+        std::vector<uint32_t> profileSlots_; // Device profiler query pairs used by this recording
+        // Distinct accesses recorded since the last submit/reset, per buffer (VK_NULL_HANDLE:
+        // accesses that may touch any memory, e.g. through buffer device addresses)
+        std::map<VkBuffer, std::vector<RangeAccess>> accesses_;
+        size_t commandCount_;
+        std::vector<SubmitHandle> dependencies_;
+        bool tornDown_;
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+
+        // Begin recording if needed and insert the barriers the next command's accesses need
+        // against the accesses recorded so far, and against earlier work on the queue.
+        bool prepare(const std::vector<RangeAccess> &next);
+        void programAccesses(const ComputeProgram &program, std::vector<RangeAccess> &out) const;
+        static RangeAccess rangeAccess(const Buffer &buf, VkDeviceSize offset, VkDeviceSize size,
+                                       VkPipelineStageFlags stage, VkAccessFlags access, bool write);
+        void teardown();
+    };
+
+    // -------- Stream -------------------------------------------------------------
+    // Independent submission context bound to one of the device's compute queues. A Stream
+    // owns its command pool and its own timeline semaphore (or fences), so Streams on
+    // different queues run concurrently on GPUs with several hardware queues.
+    // Thread safety: a Stream is externally synchronized; use one Stream per thread. Distinct
+    // Streams share no state and take no global lock, except that Streams mapped onto the
+    // same VkQueue serialize their vkQueueSubmit on that queue's lock. A ComputeProgram may
+    // be dispatched from several Streams at once (recording its bindings takes a per-program
+    // lock, so pending descriptor writes are flushed once) as long as nobody rebinds or
+    // reconfigures it meanwhile: a rebind rewrites descriptor sets that submissions on other
+    // Streams may still be reading. Destroy every Stream before its Device.
+    class Stream {
+    public:
+        Stream(); // invalid placeholder
+        // queueIndex is taken modulo dev.computeQueueCount()
+        explicit Stream(Device &dev, uint32_t queueIndex = 0);
+        ~Stream() noexcept;
+
+        Stream(const Stream &) = delete;
+        Stream &operator=(const Stream &) = delete;
+        Stream(Stream &&) noexcept;
+        Stream &operator=(Stream &&) noexcept;
+
+        VkQueue queue() const { return queue_; }
+        uint32_t queueIndex() const { return queueIndex_; }
+
+        // Record and submit one dispatch with the program's current push constants, workgroup
+        // counts and bindings (captured now). dependency is waited for on the GPU (timeline
+        // handles, from any queue) or on the host (fences).
+        SubmitHandle dispatchAsync(ComputeProgram &program, bool addHostBarrier = true,
+                                   const SubmitHandle &dependency = SubmitHandle());
+        bool dispatch(ComputeProgram &program);
+
+        // Buffer-to-buffer copy on this stream's queue (same semantics as Buffer::copyTo).
+        SubmitHandle copyAsync(Buffer &src, Buffer &dst, VkDeviceSize bytes = VK_WHOLE_SIZE,
+                               VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0,
+                               const SubmitHandle &dependency = SubmitHandle());
+
+        // Handles returned by this stream must be waited on here (not Device::wait). Fence
+        // handles are consumed by a successful wait; timeline handles stay valid forever.
+        bool wait(const SubmitHandle &h, uint64_t timeoutNs = UINT64_C(0xFFFFFFFFFFFFFFFF));
+        bool isComplete(const SubmitHandle &h) const;
+        // Wait for everything submitted so far; consumes all outstanding fence handles.
+        bool synchronize();
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return device_ != nullptr && cmdPool_ != VK_NULL_HANDLE && !tornDown_; }
+
+    private:
+        // Submission whose command buffer cannot be reused yet
+        struct InFlight {
+            uint64_t value;  // timeline value (timeline mode)
+            VkFence fence;   // fence mode
+            VkCommandBuffer cmdBuf;
+        };
+
+        Device *device_;
+        DeviceChildRef childRef_;
+        VkQueue queue_;
+        uint32_t queueIndex_;
+        VkCommandPool cmdPool_;
+        VkSemaphore timeline_;
+        uint64_t timelineValue_;
+        std::vector<InFlight> inFlight_;
+        std::vector<VkCommandBuffer> freeCmdBufs_;
+        std::vector<VkFence> freeFences_;
+        bool tornDown_;
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+
+        VkCommandBuffer beginCommands(const char *label);
+        // profileSlot: Device profiler slot recorded into cmdBuf, cancelled if the submit fails
+        SubmitHandle submit(VkCommandBuffer cmdBuf, const SubmitHandle &dependency,
+                            uint32_t profileSlot = UINT32_MAX);
+        void recycle(); // return finished timeline submissions to the free lists
+        void retire(size_t index);
+        void teardown();
+    };
+
+    // -------- Task graph ---------------------------------------------------------
+    // DAG of dispatches, copies and fills that is compiled once and re-executed cheaply.
+    // Edges come from declared buffer accesses (read-after-write, write-after-read and
+    // write-after-write, whole-buffer granularity) plus explicit dependsOn() edges; nodes
+    // may only depend on nodes added before them. compile() drops transitively implied
+    // edges, spreads independent branches over the device's compute queues, and records
+    // reusable command buffers with a barrier only where a node consumes the output of an
+    // earlier node on the same queue. Cross-queue edges become timeline semaphore waits.
+    // Without timeline semaphores everything runs on one queue with one fence.
+    // Push constants, workgroup counts and bindings are captured by compile(); change them
+    // and compile() again. Programs and buffers must outlive the graph (or the next reset).
+    class TaskGraph {
+    public:
+        static const uint32_t invalidNode = UINT32_MAX;
+
+        explicit TaskGraph(Device &dev);
+        ~TaskGraph() noexcept;
+
+        TaskGraph(const TaskGraph &) = delete;
+        TaskGraph &operator=(const TaskGraph &) = delete;
+        TaskGraph(TaskGraph &&) noexcept;
+        TaskGraph &operator=(TaskGraph &&) noexcept;
+
+        // Nodes return their id, or invalidNode on failure (no-exceptions builds).
+        // reads/writes list the buffers the kernel accesses; a buffer in both is read-write.
+        uint32_t addDispatch(ComputeProgram &program, const std::vector<const Buffer *> &reads,
+                             const std::vector<const Buffer *> &writes);
+        // Same semantics as Buffer::copyTo / Buffer::fill.
+        uint32_t addCopy(Buffer &src, Buffer &dst, VkDeviceSize bytes = VK_WHOLE_SIZE,
+                         VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+        uint32_t addFill(Buffer &dst, uint32_t value, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        // Extra ordering edge for dependencies the buffer lists do not express.
+        bool dependsOn(uint32_t node, uint32_t before);
+
+        // Build the schedule and record command buffers. Waits for a running execution.
+        // addHostBarrier appends a final ->Host barrier on every queue for CPU readback.
+        bool compile(bool addHostBarrier = true);
+
+        // Submit the compiled graph. Executions are ordered on the GPU: each one starts after
+        // the previous one has finished. dependency is waited for on the GPU (timeline) or on
+        // the host (fence). Wait on the returned handle with TaskGraph::wait; timeline handles
+        // may also be passed to Device::wait/isComplete or used as another submission's
+        // dependency.
+        SubmitHandle execute(const SubmitHandle &dependency = SubmitHandle());
+        bool run(); // execute() + wait()
+        bool wait(const SubmitHandle &h, uint64_t timeoutNs = UINT64_C(0xFFFFFFFFFFFFFFFF));
+        // Wait for the last execution, if any.
+        bool synchronize();
+
+        // Drop all nodes and compiled state (waits for a running execution first).
+        void reset();
+
+        size_t size() const { return nodes_.size(); }
+        bool isCompiled() const { return compiled_; }
+        // Schedule statistics of the last compile()
+        uint32_t queueCount() const { return static_cast<uint32_t>(chains_.size()); }
+        uint32_t barrierCount() const { return barrierCount_; }
+        uint32_t semaphoreWaitCount() const { return semaphoreWaitCount_; }
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return device_ != nullptr && cmdPool_ != VK_NULL_HANDLE && !tornDown_; }
+
+    private:
+        enum class NodeType { Dispatch, Copy, Fill };
+
+        struct Node {
+            NodeType type;
+            ComputeProgram *program;
+            VkBuffer src, dst;       // copies and fills
+            VkBufferCopy region;     // copies
+            VkDeviceSize fillOffset, fillSize;
+            uint32_t fillValue;
+            std::vector<VkBuffer> reads, writes;
+            std::vector<uint32_t> after; // dependsOn() edges
+            // Filled by compile(): direct predecessors after transitive reduction, and queue
+            std::vector<uint32_t> deps;
+            uint32_t chain;
+
+            Node()
+                : type(NodeType::Dispatch), program(nullptr), src(VK_NULL_HANDLE), dst(VK_NULL_HANDLE),
+                  region{0, 0, 0}, fillOffset(0), fillSize(0), fillValue(0), chain(0) {}
+        };
+
+        // Run of nodes on one queue submitted as one command buffer
+        struct Segment {
+            VkCommandBuffer cmdBuf;
+            std::vector<uint32_t> nodes;
+            std::vector<std::pair<uint32_t, uint32_t>> waits; // (chain, segment) signaled first
+
+            Segment() : cmdBuf(VK_NULL_HANDLE) {}
+        };
+
+        // One queue's share of the graph; its timeline advances once per segment
+        struct Chain {
+            uint32_t queueIndex;
+            VkSemaphore timeline;
+            uint64_t base; // timeline value before the current execution
+            std::vector<Segment> segments;
+
+            Chain() : queueIndex(0), timeline(VK_NULL_HANDLE), base(0) {}
+        };
+
+        Device *device_;
+        DeviceChildRef childRef_;
+        VkCommandPool cmdPool_;
+        std::vector<Node> nodes_;
+        std::vector<Chain> chains_;
+        VkFence fence_;              // fence mode
+        bool fenceInFlight_;
+        uint64_t lastValue_;         // chain 0 value signaled by the last execution
+        bool compiled_;
+        uint32_t barrierCount_;
+        uint32_t semaphoreWaitCount_;
+        bool tornDown_;
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+
+        uint32_t addNode(Node &node);
+        void schedule();
+        bool record(bool addHostBarrier);
+        uint64_t valuesPerExecution(uint32_t chain) const;
+        void releaseCompiled();
+        void teardown();
+    };
+
+    // -------- Completion queue ---------------------------------------------------
+    // Background thread that watches submissions of one Device and reports their completion,
+    // so an event loop can keep many jobs in flight without a blocked thread per job. All
+    // tracked handles are covered by one driver wait per pass. Device handles are consumed
+    // as by Device::wait() before their callback runs; Stream and TaskGraph handles are only
+    // observed. Callbacks run on the completion thread, must not throw and must not call
+    // drain(); they may submit work and track it again.
+    class CompletionQueue {
+    public:
+        explicit CompletionQueue(Device &dev);
+        ~CompletionQueue() noexcept; // waits for every tracked submission first
+
+        CompletionQueue(const CompletionQueue &) = delete;
+        CompletionQueue &operator=(const CompletionQueue &) = delete;
+        CompletionQueue(CompletionQueue &&) noexcept;
+        CompletionQueue &operator=(CompletionQueue &&) noexcept;
+
+        // callback(ok) runs once h completed; ok is false when waiting failed (device loss).
+        bool onComplete(const SubmitHandle &h, std::function<void(bool)> callback);
+        // Future that becomes ready with the same ok value. Invalid future on failure.
+        std::future<bool> track(const SubmitHandle &h);
+
+        size_t pending() const; // tracked submissions whose callback has not returned yet
+        // Block until every tracked submission completed and its callback returned.
+        bool drain();
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return worker_ != nullptr; }
+
+    private:
+        Device *device_;
+        DeviceChildRef childRef_;
+        std::unique_ptr<CompletionWorker> worker_; // owns the thread; stable across moves
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+    };
+
+    // -------- Multi-GPU ----------------------------------------------------------
+    // Opens one Device per suitable physical device. Members are independent Devices (not a
+    // Vulkan device group), so buffers and programs exist per member and results meet in
+    // host memory: through per-member downloads, or through one host allocation imported
+    // into every member (VK_EXT_external_memory_host), which GPUs write in place.
+    struct DeviceGroupCreateInfo {
+        DeviceCreateInfo device; // applied to every member; preferredIndex is ignored
+        // Indices into Instance::physicalDevices() to open. Empty opens every device with a
+        // compute queue whose type matches the best device's (discrete boxes skip integrated
+        // and software devices).
+        std::vector<int> physicalIndices;
+
+        DeviceGroupCreateInfo() {}
+    };
+
+    class DeviceGroup {
+    public:
+        explicit DeviceGroup(Instance &inst, const DeviceGroupCreateInfo &info = DeviceGroupCreateInfo());
+        ~DeviceGroup() noexcept;
+
+        DeviceGroup(const DeviceGroup &) = delete;
+        DeviceGroup &operator=(const DeviceGroup &) = delete;
+        DeviceGroup(DeviceGroup &&) noexcept;
+        DeviceGroup &operator=(DeviceGroup &&) noexcept;
+
+        uint32_t size() const { return static_cast<uint32_t>(devices_.size()); }
+        Device &device(uint32_t index) { return *devices_[index]; }
+        const Device &device(uint32_t index) const { return *devices_[index]; }
+
+        // True when every member can import host memory; pointers and sizes handed to
+        // importHostMemory must be multiples of hostImportAlignment() (largest member value).
+        bool hostImportSupported() const;
+        VkDeviceSize hostImportAlignment() const;
+        // One Buffer per member backed by the same host pages. The caller keeps the
+        // allocation alive until every returned buffer is destroyed.
+        std::vector<Buffer> importHostMemory(void *hostPointer, VkDeviceSize sizeBytes,
+                                             BufferUsage usage = BufferUsage::Storage);
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return !devices_.empty(); }
+
+    private:
+        std::vector<std::unique_ptr<Device>> devices_; // stable addresses for Buffers/programs
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+    };
+
+    // One ComputeProgram per DeviceGroup member built from the same create info, with each
+    // dispatch's X workgroup range split across the members in proportion to their weights.
+    // Member i runs groups [firstGroup(i), firstGroup(i) + groupCount(i)); the kernel adds
+    // the uint32 written at groupOffsetPushOffset to gl_WorkGroupID.x to find its slice.
+    class MultiDeviceProgram {
+    public:
+        // perDevice(i, info) adjusts member i's copy of info before it is built, typically
+        // pointing the bindings at buffers created on group.device(i); it is required when a
+        // group of several devices gets non-empty bindings. info.pipelineCache is kept only for
+        // the member it was created on; the others fall back to their Device::pipelineCache()
+        // unless perDevice sets one of theirs. Members build concurrently.
+        // groupOffsetPushOffset + 4 must fit in info.pushConstantBytes. The program keeps
+        // pointers to the group's devices, not to the DeviceGroup object itself.
+        MultiDeviceProgram(DeviceGroup &group, const ComputeProgramCreateInfo &info, uint32_t groupOffsetPushOffset,
+                           const std::function<void(uint32_t, ComputeProgramCreateInfo &)> &perDevice = nullptr);
+        ~MultiDeviceProgram() noexcept;
+
+        MultiDeviceProgram(const MultiDeviceProgram &) = delete;
+        MultiDeviceProgram &operator=(const MultiDeviceProgram &) = delete;
+        MultiDeviceProgram(MultiDeviceProgram &&) noexcept;
+        MultiDeviceProgram &operator=(MultiDeviceProgram &&) noexcept;
+
+        uint32_t size() const { return static_cast<uint32_t>(programs_.size()); }
+        ComputeProgram &program(uint32_t index) { return programs_[index]; }
+
+        // Relative throughput per member (default: all 1). Zero keeps a member idle.
+        bool setWeights(const std::vector<double> &weights);
+        const std::vector<double> &weights() const { return weights_; }
+        // Set weights to groups per second measured by the last dispatch(), so the next split
+        // finishes on all members at about the same time.
+        bool rebalance();
+
+        // Same push constants on every member (must not overlap the group offset slot).
+        bool setPushConstants(const void *data, uint32_t bytes, uint32_t offset = 0);
+
+        // Split, dispatch on every member and wait; members run concurrently.
+        bool dispatch(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1);
+        // Returns one handle per member (invalid for idle members); wait with wait().
+        std::vector<SubmitHandle> dispatchAsync(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1,
+                                                bool addHostBarrier = true);
+        bool wait(const std::vector<SubmitHandle> &handles);
+
+        // Split of the last dispatch
+        uint32_t firstGroup(uint32_t index) const { return first_[index]; }
+        uint32_t groupCount(uint32_t index) const { return count_[index]; }
+
+        // Copy every member's slice of the last dispatch from sources[i] (a buffer on member
+        // i) into dst: bytes [baseOffset + first * bytesPerGroup, + count * bytesPerGroup)
+        // land at the same offset in dst. Downloads run concurrently.
+        bool gather(const std::vector<Buffer *> &sources, VkDeviceSize bytesPerGroup, void *dst,
+                    VkDeviceSize baseOffset = 0);
+
+#ifdef EASYVK_NO_EXCEPTIONS
+        const std::string &lastError() const { return lastError_; }
+#endif
+
+        bool isValid() const { return !programs_.empty(); }
+
+    private:
+        std::vector<Device *> devices_; // member i's Device (owned by the DeviceGroup)
+        std::vector<ComputeProgram> programs_;
+        uint32_t groupOffsetPushOffset_;
+        std::vector<double> weights_;
+        std::vector<uint32_t> first_, count_;
+        std::vector<uint64_t> lastNs_; // host time of each member in the last dispatch()
+#ifdef EASYVK_NO_EXCEPTIONS
+        mutable std::string lastError_;
+#endif
+
+        bool split(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ);
     };
 
     // -------- Utility functions -------------------------------------------------
@@ -556,8 +2029,10 @@ namespace easyvk {
 
     // SPIR-V validation (optional, requires SPIRV-Tools)
     bool isValidSPIRV(const std::vector<uint32_t> &code);
+    bool isValidSPIRV(const uint32_t *code, size_t wordCount);
 #ifdef EASYVK_USE_SPIRV_TOOLS
     bool validateSPIRV(const std::vector<uint32_t> &code, std::string &errorMessage);
+    bool validateSPIRV(const uint32_t *code, size_t wordCount, std::string &errorMessage);
 #endif
 
     // Alignment utilities